@@ -12,10 +12,16 @@ static const float4x4 gTex =
 
 cbuffer cbPerObject : register(b0)
 {
-    float4x4 gWorld;
-    float4x4 gPrevWorld;
+    float4x4 gObjectWorld;
+    float4x4 gObjectPrevWorld;
+    uint gInstanced;
 };
 
+// Transforms of the object being drawn, selected by LoadObjectTransform()
+// from the per-object constants or the per-instance vertex stream.
+static float4x4 gWorld;
+static float4x4 gPrevWorld;
+
 cbuffer cbPerCamera : register(b1)
 {
     float4x4 gView;
@@ -78,6 +84,7 @@ struct VertexIn
     float3 Normal       : NORMAL;
     float3 Tangent	    : TANGENT;
     float4x4 InstanceTransform : INSTANCETRANSFORM;
+    float4x4 InstancePrevTransform : INSTANCEPREVTRANSFORM;
 #ifdef RIGGED
 	uint   BoneIndices  : BONEINDICES;
 	float4 BoneWeights  : BONEWEIGHTS;
@@ -153,7 +160,12 @@ inline float3 LocalToWorldNormal(float3 normalL)
 
 #endif
 
+#define LoadObjectTransform(vin)                                                    \
+	gWorld = gInstanced ? vin.InstanceTransform : gObjectWorld;                     \
+	gPrevWorld = gInstanced ? vin.InstancePrevTransform : gObjectPrevWorld;         \
+
 #define ConstructVSOutput(vin, vout)                                                \
+	LoadObjectTransform(vin);                                                       \
 	vout.PosW = ObjectToWorldPos(LocalToObjectPos(vin));                            \
 	vout.PosH = WorldToClipPos(vout.PosW, vin);                                     \
 	vout.Tex = vin.Tex;                                                             \
@@ -6,22 +6,60 @@
 
 namespace udsdx
 {
-	static std::tuple<size_t, size_t, float> ToTimeFraction(const std::vector<float>& timeStamps, float time)
+	// Moves the key to the first one at or after the time. Only a cursor moving forward steps over the keys, otherwise they are searched.
+	static UINT AdvanceKey(std::span<const float> timeStamps, UINT key, float time, bool search)
+	{
+		if (search || (key > 0 && timeStamps[key - 1] >= time))
+		{
+			return static_cast<UINT>(std::distance(timeStamps.begin(), std::lower_bound(timeStamps.begin(), timeStamps.end(), time)));
+		}
+		while (key < timeStamps.size() && timeStamps[key] < time)
+		{
+			++key;
+		}
+		return key;
+	}
+
+	// Largest magnitude of the components left after dropping the largest one of a unit quaternion
+	static constexpr float SmallestThreeRange = 0.70710678f;
+
+	static XMVECTOR DecodeVector(const UINT16* words, const Vector3& rangeMin, const Vector3& rangeExtent)
+	{
+		XMVECTOR normalized = XMVectorScale(XMVectorSet(words[0], words[1], words[2], 0.0f), 1.0f / 65535.0f);
+		return XMVectorMultiplyAdd(normalized, XMLoadFloat3(&rangeExtent), XMLoadFloat3(&rangeMin));
+	}
+
+	// The top bits of the 48 hold the index of the dropped component, followed by the other components in 15 bits each
+	static XMVECTOR DecodeRotation(const UINT16* words)
+	{
+		UINT64 bits = (static_cast<UINT64>(words[0]) << 32) | (static_cast<UINT64>(words[1]) << 16) | words[2];
+		float scale = 2.0f * SmallestThreeRange / 32767.0f;
+		float a = static_cast<float>((bits >> 30) & 0x7FFF) * scale - SmallestThreeRange;
+		float b = static_cast<float>((bits >> 15) & 0x7FFF) * scale - SmallestThreeRange;
+		float c = static_cast<float>(bits & 0x7FFF) * scale - SmallestThreeRange;
+		float values[4] = { a, b, c, std::sqrt(std::max(1.0f - a * a - b * b - c * c, 0.0f)) };
+
+		// Slots of the values each component is read from, for every index of the dropped component, so decoding does not branch on it
+		static constexpr int Slots[4][4] = { { 3, 0, 1, 2 }, { 0, 3, 1, 2 }, { 0, 1, 3, 2 }, { 0, 1, 2, 3 } };
+		const int* slots = Slots[(bits >> 45) & 3];
+		return XMVectorSet(values[slots[0]], values[slots[1]], values[slots[2]], values[slots[3]]);
+	}
+
+	static std::tuple<size_t, size_t, float> ToTimeFraction(std::span<const float> timeStamps, UINT key, float time)
 	{
 		auto size = timeStamps.size();
-		auto seg = std::distance(timeStamps.begin(), std::lower_bound(timeStamps.begin(), timeStamps.end(), time));
-		if (seg == 0)
+		if (key == 0)
 		{
 			return { 0, size - 1, 0.0f };
 		}
-		if (seg == size)
+		if (key == size)
 		{
 			return { 0, size - 1, 1.0f };
 		}
-		float begin = timeStamps[seg - 1];
-		float end = timeStamps[seg];
+		float begin = timeStamps[key - 1];
+		float end = timeStamps[key];
 		float fraction = (time - begin) / (end - begin);
-		return { seg - 1, seg, fraction };
+		return { key - 1, key, fraction };
 	}
 
 	AnimationClip::AnimationClip(const std::filesystem::path& resourcePath)
@@ -33,9 +71,14 @@ namespace udsdx
 			return;
 		}
 
-		// Read bone data
+		// Read bone data, after the tag of the compressed format if there is one
 		size_t boneCount = 0;
 		file.read(reinterpret_cast<char*>(&boneCount), sizeof(size_t));
+		bool compressed = boneCount == CompressedFormatTag;
+		if (compressed)
+		{
+			file.read(reinterpret_cast<char*>(&boneCount), sizeof(size_t));
+		}
 		m_bones.resize(boneCount);
 		m_boneParents.resize(boneCount, -1);
 		m_boneIndexMap.clear();
@@ -58,12 +101,24 @@ namespace udsdx
 			m_boneParents[i] = parentIndex;
 		}
 
+		m_bindPose.resize(boneCount);
+		for (size_t i = 0; i < boneCount; ++i)
+		{
+			LocalTransform& bind = m_bindPose[i];
+			XMMATRIX transform = XMLoadFloat4x4(&m_bones[i].Transform);
+			XMVECTOR s, q, p;
+			XMMatrixDecompose(&s, &q, &p, transform);
+			XMStoreFloat3(&bind.Position, p);
+			XMStoreFloat4(&bind.Rotation, q);
+			XMStoreFloat3(&bind.Scale, s);
+		}
+
 		size_t animationCount = 0;
 		file.read(reinterpret_cast<char*>(&animationCount), sizeof(size_t));
 
 		for (size_t i = 0; i < animationCount; ++i)
 		{
-			Animation animationDest = Animation(this, file);
+			Animation animationDest = Animation(this, file, compressed);
 			m_animations.emplace(animationDest.GetName().data(), std::move(animationDest));
 		}
 	}
@@ -113,7 +168,26 @@ namespace udsdx
 		return static_cast<UINT>(m_bones.size());
 	}
 
-	Animation::Animation(const AnimationClip* clip, std::ifstream& fileStream) : m_clip(clip)
+	template <typename Key_T>
+	Animation::Track Animation::ReadTrack(std::ifstream& fileStream, std::vector<float>& timeStamps, std::vector<Key_T>& keys)
+	{
+		size_t keyCount = 0;
+		fileStream.read(reinterpret_cast<char*>(&keyCount), sizeof(size_t));
+
+		Track track;
+		track.FirstKey = static_cast<UINT>(keys.size());
+		track.KeyCount = static_cast<UINT>(keyCount);
+		timeStamps.resize(track.FirstKey + keyCount);
+		keys.resize(track.FirstKey + keyCount);
+		for (size_t j = track.FirstKey; j < timeStamps.size(); ++j)
+		{
+			fileStream.read(reinterpret_cast<char*>(&timeStamps[j]), sizeof(float));
+			fileStream.read(reinterpret_cast<char*>(&keys[j]), sizeof(Key_T));
+		}
+		return track;
+	}
+
+	Animation::Animation(const AnimationClip* clip, std::ifstream& fileStream, bool compressed) : m_clip(clip)
 	{
 		// Read animation data
 		size_t nameLength = 0;
@@ -122,45 +196,45 @@ namespace udsdx
 		fileStream.read(m_name.data(), nameLength);
 		fileStream.read(reinterpret_cast<char*>(&m_ticksPerSecond), sizeof(float));
 		fileStream.read(reinterpret_cast<char*>(&m_duration), sizeof(float));
-		size_t channelCount = 0;
 
+		// The compressed tracks and keys are read in one go each
+		if (compressed)
+		{
+			fileStream.read(reinterpret_cast<char*>(&m_sampleInterval), sizeof(float));
+
+			size_t trackCount = 0;
+			fileStream.read(reinterpret_cast<char*>(&trackCount), sizeof(size_t));
+			m_compressedTracks.resize(trackCount);
+			fileStream.read(reinterpret_cast<char*>(m_compressedTracks.data()), trackCount * sizeof(CompressedTrack));
+
+			size_t keyWordCount = 0;
+			fileStream.read(reinterpret_cast<char*>(&keyWordCount), sizeof(size_t));
+			m_compressedKeys.resize(keyWordCount);
+			fileStream.read(reinterpret_cast<char*>(m_compressedKeys.data()), keyWordCount * sizeof(UINT16));
+
+			m_boneTracks.resize(std::max<size_t>(trackCount / 3, m_clip->GetBoneCount()));
+			for (size_t i = 0; i < trackCount / 3; ++i)
+			{
+				const CompressedTrack* tracks = &m_compressedTracks[i * 3];
+				m_boneTracks[i].Animated = tracks[0].KeyCount > 0 && tracks[1].KeyCount > 0 && tracks[2].KeyCount > 0;
+			}
+			return;
+		}
+
+		size_t channelCount = 0;
 		fileStream.read(reinterpret_cast<char*>(&channelCount), sizeof(size_t));
-		m_channels.resize(channelCount);
+		m_boneTracks.resize(std::max<size_t>(channelCount, m_clip->GetBoneCount()));
 		for (size_t i = 0; i < channelCount; ++i)
 		{
-			Animation::Channel& channel = m_channels[i];
+			BoneTracks& tracks = m_boneTracks[i];
 			size_t channelNameLength = 0;
 			fileStream.read(reinterpret_cast<char*>(&channelNameLength), sizeof(size_t));
-			channel.Name.resize(channelNameLength);
-			fileStream.read(channel.Name.data(), channelNameLength);
-
-			size_t positionKeyCount = 0;
-			fileStream.read(reinterpret_cast<char*>(&positionKeyCount), sizeof(size_t));
-			channel.PositionTimestamps.resize(positionKeyCount);
-			channel.Positions.resize(positionKeyCount);
-			for (size_t j = 0; j < positionKeyCount; ++j)
-			{
-				fileStream.read(reinterpret_cast<char*>(&channel.PositionTimestamps[j]), sizeof(float));
-				fileStream.read(reinterpret_cast<char*>(&channel.Positions[j]), sizeof(Vector3));
-			}
-			size_t rotationKeyCount = 0;
-			fileStream.read(reinterpret_cast<char*>(&rotationKeyCount), sizeof(size_t));
-			channel.RotationTimestamps.resize(rotationKeyCount);
-			channel.Rotations.resize(rotationKeyCount);
-			for (size_t j = 0; j < rotationKeyCount; ++j)
-			{
-				fileStream.read(reinterpret_cast<char*>(&channel.RotationTimestamps[j]), sizeof(float));
-				fileStream.read(reinterpret_cast<char*>(&channel.Rotations[j]), sizeof(Quaternion));
-			}
-			size_t scaleKeyCount = 0;
-			fileStream.read(reinterpret_cast<char*>(&scaleKeyCount), sizeof(size_t));
-			channel.ScaleTimestamps.resize(scaleKeyCount);
-			channel.Scales.resize(scaleKeyCount);
-			for (size_t j = 0; j < scaleKeyCount; ++j)
-			{
-				fileStream.read(reinterpret_cast<char*>(&channel.ScaleTimestamps[j]), sizeof(float));
-				fileStream.read(reinterpret_cast<char*>(&channel.Scales[j]), sizeof(Vector3));
-			}
+			fileStream.seekg(channelNameLength, std::ios::cur);
+
+			tracks.Position = ReadTrack(fileStream, m_positionTimes, m_positions);
+			tracks.Rotation = ReadTrack(fileStream, m_rotationTimes, m_rotations);
+			tracks.Scale = ReadTrack(fileStream, m_scaleTimes, m_scales);
+			tracks.Animated = channelNameLength > 0 && tracks.Position.KeyCount > 0 && tracks.Rotation.KeyCount > 0 && tracks.Scale.KeyCount > 0;
 		}
 	}
 
@@ -179,62 +253,174 @@ namespace udsdx
 		PopulateTransforms(animationTime, boneMap, out);
 	}
 
-	void Animation::PopulateTransforms(float animationTime, const std::vector<int>& boneMap, std::vector<Matrix4x4>& out, const std::map<std::string_view, Matrix4x4>& modifiers) const
+	void Animation::PopulateTransforms(float animationTime, const std::vector<int>& boneMap, std::vector<Matrix4x4>& out, std::span<const BoneModifier> modifiers) const
+	{
+		AnimationCursor cursor;
+		std::vector<Matrix4x4> scratch(m_clip->GetBoneCount());
+		out.resize(boneMap.size());
+
+		PopulateTransforms(animationTime, cursor, boneMap, scratch, out, modifiers);
+	}
+
+	void Animation::PopulateTransforms(float animationTime, AnimationCursor& cursor, std::span<const int> boneMap, std::span<Matrix4x4> scratch, std::span<Matrix4x4> out, std::span<const BoneModifier> modifiers) const
 	{
 		UINT boneCount = static_cast<UINT>(m_clip->GetBoneCount());
+		assert(scratch.size() >= boneCount && out.size() == boneMap.size());
 
-		float animationTicks = animationTime * m_ticksPerSecond;
-		std::vector<Matrix4x4> in(boneCount);
+		const auto& bones = m_clip->GetBones();
+		const auto& boneParents = m_clip->GetBoneParents();
 
+		bool search = BindCursor(cursor);
+		float animationTicks = animationTime * m_ticksPerSecond;
+		auto modifier = modifiers.begin();
 		for (UINT i = 0; i < boneCount; ++i)
 		{
-			const Bone& bone = m_clip->GetBones().at(i);
-			const Animation::Channel& channel = m_channels[i];
+			const BoneTracks& tracks = m_boneTracks[i];
 
 			XMMATRIX tParent = XMMatrixIdentity();
-			if (m_clip->GetBoneParents().at(i) != -1)
+			if (boneParents[i] != -1)
 			{
-				tParent = XMLoadFloat4x4(&in[m_clip->GetBoneParents().at(i)]);
+				tParent = XMLoadFloat4x4(&scratch[boneParents[i]]);
 			}
 
 			XMMATRIX tLocal;
-			if (channel.Name.empty())
-				tLocal = XMLoadFloat4x4(&bone.Transform);
+			if (!tracks.Animated)
+				tLocal = XMLoadFloat4x4(&bones[i].Transform);
 			else
 			{
-				auto [ps1, ps2, pf] = ToTimeFraction(channel.PositionTimestamps, animationTicks);
-				auto [rs1, rs2, rf] = ToTimeFraction(channel.RotationTimestamps, animationTicks);
-				auto [ss1, ss2, sf] = ToTimeFraction(channel.ScaleTimestamps, animationTicks);
-
-				XMVECTOR p0 = XMLoadFloat3(&channel.Positions[ps1]);
-				XMVECTOR p1 = XMLoadFloat3(&channel.Positions[ps2]);
-				XMVECTOR p = XMVectorLerp(p0, p1, pf);
-
-				XMVECTOR q0 = XMLoadFloat4(&channel.Rotations[rs1]);
-				XMVECTOR q1 = XMLoadFloat4(&channel.Rotations[rs2]);
-				XMVECTOR q = XMQuaternionSlerp(q0, q1, rf);
-
-				XMVECTOR s0 = XMLoadFloat3(&channel.Scales[ss1]);
-				XMVECTOR s1 = XMLoadFloat3(&channel.Scales[ss2]);
-				XMVECTOR s = XMVectorLerp(s0, s1, sf);
+				XMVECTOR p, q, s;
+				if (m_compressedTracks.empty())
+				{
+					SampleKeys(i, animationTicks, &cursor.m_keys[static_cast<size_t>(i) * 3], search, p, q, s);
+				}
+				else
+				{
+					SampleCompressedKeys(i, animationTicks, p, q, s);
+				}
 
 				tLocal = XMMatrixAffineTransformation(s, XMVectorZero(), q, p);
-				if (modifiers.find(bone.Name) != modifiers.end())
+			}
+
+			// The modifiers are sorted, so the next one is the only one which may apply to the bone.
+			// The ones of the bones without tracks are skipped, as before.
+			if (modifier != modifiers.end() && modifier->Bone == i)
+			{
+				if (tracks.Animated)
 				{
-					XMMATRIX modifier = XMLoadFloat4x4(&modifiers.at(bone.Name));
-					tLocal = tLocal * modifier;
+					tLocal = tLocal * XMLoadFloat4x4(&modifier->Transform);
 				}
+				++modifier;
 			}
 
-			XMStoreFloat4x4(&in[i], tLocal * tParent);
+			XMStoreFloat4x4(&scratch[i], tLocal * tParent);
 		}
 
-		out.resize(boneMap.size());
 		for (UINT i = 0; i < out.size(); ++i)
 		{
 			int boneID = boneMap[i];
-			XMMATRIX boneTransform = boneID >= 0 ? XMLoadFloat4x4(&in[boneID]) : XMMatrixIdentity();
+			XMMATRIX boneTransform = boneID >= 0 ? XMLoadFloat4x4(&scratch[boneID]) : XMMatrixIdentity();
 			XMStoreFloat4x4(&out[i], boneTransform);
 		}
 	}
+
+	void Animation::PopulateLocalPose(float animationTime, AnimationCursor& cursor, std::span<const int> boneMap, std::span<LocalTransform> out) const
+	{
+		assert(out.size() == boneMap.size());
+
+		const auto& bindPose = m_clip->GetBindPose();
+		bool search = BindCursor(cursor);
+		float animationTicks = animationTime * m_ticksPerSecond;
+		for (size_t i = 0; i < out.size(); ++i)
+		{
+			int boneID = boneMap[i];
+			if (boneID < 0)
+			{
+				continue;
+			}
+			if (!m_boneTracks[boneID].Animated)
+			{
+				out[i] = bindPose[boneID];
+				continue;
+			}
+
+			XMVECTOR p, q, s;
+			if (m_compressedTracks.empty())
+			{
+				SampleKeys(boneID, animationTicks, &cursor.m_keys[static_cast<size_t>(boneID) * 3], search, p, q, s);
+			}
+			else
+			{
+				SampleCompressedKeys(boneID, animationTicks, p, q, s);
+			}
+			XMStoreFloat3(&out[i].Position, p);
+			XMStoreFloat4(&out[i].Rotation, q);
+			XMStoreFloat3(&out[i].Scale, s);
+		}
+	}
+
+	bool Animation::BindCursor(AnimationCursor& cursor) const
+	{
+		// A cursor left by another animation has its keys searched again
+		if (cursor.m_animation == this)
+		{
+			return false;
+		}
+		cursor.m_animation = this;
+		cursor.m_keys.resize(static_cast<size_t>(m_clip->GetBoneCount()) * 3);
+		return true;
+	}
+
+	void Animation::SampleKeys(UINT bone, float animationTicks, UINT* cursorKeys, bool search, XMVECTOR& position, XMVECTOR& rotation, XMVECTOR& scale) const
+	{
+		const BoneTracks& tracks = m_boneTracks[bone];
+		std::span<const float> positionTimes(m_positionTimes.data() + tracks.Position.FirstKey, tracks.Position.KeyCount);
+		std::span<const float> rotationTimes(m_rotationTimes.data() + tracks.Rotation.FirstKey, tracks.Rotation.KeyCount);
+		std::span<const float> scaleTimes(m_scaleTimes.data() + tracks.Scale.FirstKey, tracks.Scale.KeyCount);
+
+		cursorKeys[0] = AdvanceKey(positionTimes, cursorKeys[0], animationTicks, search);
+		cursorKeys[1] = AdvanceKey(rotationTimes, cursorKeys[1], animationTicks, search);
+		cursorKeys[2] = AdvanceKey(scaleTimes, cursorKeys[2], animationTicks, search);
+
+		auto [ps1, ps2, pf] = ToTimeFraction(positionTimes, cursorKeys[0], animationTicks);
+		auto [rs1, rs2, rf] = ToTimeFraction(rotationTimes, cursorKeys[1], animationTicks);
+		auto [ss1, ss2, sf] = ToTimeFraction(scaleTimes, cursorKeys[2], animationTicks);
+
+		const Vector3* positions = m_positions.data() + tracks.Position.FirstKey;
+		const Quaternion* rotations = m_rotations.data() + tracks.Rotation.FirstKey;
+		const Vector3* scales = m_scales.data() + tracks.Scale.FirstKey;
+
+		position = XMVectorLerp(XMLoadFloat3(&positions[ps1]), XMLoadFloat3(&positions[ps2]), pf);
+		rotation = XMQuaternionSlerp(XMLoadFloat4(&rotations[rs1]), XMLoadFloat4(&rotations[rs2]), rf);
+		scale = XMVectorLerp(XMLoadFloat3(&scales[ss1]), XMLoadFloat3(&scales[ss2]), sf);
+	}
+
+	void Animation::SampleCompressedKeys(UINT bone, float animationTicks, XMVECTOR& position, XMVECTOR& rotation, XMVECTOR& scale) const
+	{
+		const CompressedTrack* tracks = &m_compressedTracks[static_cast<size_t>(bone) * 3];
+		position = SampleCompressedTrack(tracks[0], false, animationTicks);
+		rotation = SampleCompressedTrack(tracks[1], true, animationTicks);
+		scale = SampleCompressedTrack(tracks[2], false, animationTicks);
+	}
+
+	XMVECTOR Animation::SampleCompressedTrack(const CompressedTrack& track, bool rotation, float animationTicks) const
+	{
+		auto decode = [&](UINT key)
+		{
+			const UINT16* words = &m_compressedKeys[(static_cast<size_t>(track.FirstKey) + key) * 3];
+			return rotation ? DecodeRotation(words) : DecodeVector(words, track.RangeMin, track.RangeExtent);
+		};
+		if (track.KeyCount == 1)
+		{
+			return decode(0);
+		}
+
+		// Constant spacing, so the keys around the time are found by a division
+		float position = std::clamp(animationTicks / (m_sampleInterval * track.FrameStride), 0.0f, static_cast<float>(track.KeyCount - 1));
+		UINT key = std::min(static_cast<UINT>(position), track.KeyCount - 2);
+		float fraction = position - static_cast<float>(key);
+
+		XMVECTOR key0 = decode(key);
+		XMVECTOR key1 = decode(key + 1);
+		return rotation ? XMQuaternionSlerp(key0, key1, fraction) : XMVectorLerp(key0, key1, fraction);
+	}
 }
\ No newline at end of file
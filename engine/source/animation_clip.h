@@ -7,43 +7,133 @@ namespace udsdx
 {
 	struct Bone;
 	class AnimationClip;
+	class Animation;
+
+	// Transform of a bone relative to its parent, kept apart so poses can be blended
+	struct LocalTransform
+	{
+		Vector3 Position;
+		Quaternion Rotation;
+		Vector3 Scale = Vector3::One;
+	};
+
+	// Transform multiplied into the local transform of a bone after it is sampled.
+	// Modifiers are passed as a sparse array sorted by the bone indices of the skeleton they apply to, and walked along with the bones.
+	struct BoneModifier
+	{
+		UINT Bone;
+		Matrix4x4 Transform;
+	};
+
+	// Keys each track of an animation was last sampled at, kept by every playing instance.
+	// Sampling forward in time only steps over the keys passed since the last sample, and any other jump searches the keys again.
+	// The compressed tracks find their keys from the time alone, and leave the cursor untouched.
+	class AnimationCursor
+	{
+	public:
+		// Forgets the keys, so the next sample searches them
+		void Reset() { m_animation = nullptr; }
+
+	private:
+		friend class Animation;
+
+		const Animation* m_animation = nullptr;
+		// First key at or after the sampled time, for the position, rotation and scale tracks of every bone
+		std::vector<UINT> m_keys;
+	};
 
 	class Animation
 	{
 	private:
-		struct Channel
+		// Range of the keys of one track in the packed arrays of its kind
+		struct Track
 		{
-			std::string Name{};
+			UINT FirstKey = 0;
+			UINT KeyCount = 0;
+		};
 
-			std::vector<float> PositionTimestamps{};
-			std::vector<float> RotationTimestamps{};
-			std::vector<float> ScaleTimestamps{};
+		// Track of the compressed files, read as is.
+		// The keys are spaced evenly by the stride in frames of the sample interval, and take three 16-bit words each:
+		// positions and scales are quantized over the range of the track, and rotations keep their smallest three components.
+		struct CompressedTrack
+		{
+			UINT FirstKey;
+			UINT KeyCount;
+			UINT FrameStride;
+			Vector3 RangeMin;
+			Vector3 RangeExtent;
+		};
+		static_assert(sizeof(CompressedTrack) == 36, "The tracks are read as is");
 
-			std::vector<Vector3> Positions{};
-			std::vector<Quaternion> Rotations{};
-			std::vector<Vector3> Scales{};
+		// Bones without a channel hold their bind transform
+		struct BoneTracks
+		{
+			Track Position;
+			Track Rotation;
+			Track Scale;
+			bool Animated = false;
 		};
 
 	public:
 		Animation() = delete;
-		Animation(const AnimationClip* clip, std::ifstream& fileStream);
+		// Reads either the raw keys or the compressed tracks of the animation, depending on the format of the clip
+		Animation(const AnimationClip* clip, std::ifstream& fileStream, bool compressed);
 		void PopulateTransforms(float animationTime, std::vector<Matrix4x4>& out) const;
-		void PopulateTransforms(float animationTime, const std::vector<int>& boneMap, std::vector<Matrix4x4>& out, const std::map<std::string_view, Matrix4x4>& modifiers = {}) const;
+		void PopulateTransforms(float animationTime, const std::vector<int>& boneMap, std::vector<Matrix4x4>& out, std::span<const BoneModifier> modifiers = {}) const;
+		// Samples from the keys of the cursor, which is moved to the time.
+		// The scratch holds the model space transform of every bone of the clip, and the output one transform per entry of the bone map.
+		// The modifiers are indexed by the bones of the clip.
+		void PopulateTransforms(float animationTime, AnimationCursor& cursor, std::span<const int> boneMap, std::span<Matrix4x4> scratch, std::span<Matrix4x4> out, std::span<const BoneModifier> modifiers = {}) const;
+		// Samples the transforms relative to their parents, one per entry of the bone map, without applying the hierarchy.
+		// The entries mapped to no bone of the clip are left as they are.
+		void PopulateLocalPose(float animationTime, AnimationCursor& cursor, std::span<const int> boneMap, std::span<LocalTransform> out) const;
 		float GetAnimationDuration() const { return m_duration / m_ticksPerSecond; }
 		std::string_view GetName() const { return m_name; }
 		const AnimationClip* GetAnimationClip() const { return m_clip; }
 
+	private:
+		// Appends the keys of the next track of the file to the packed arrays of its kind
+		template <typename Key_T>
+		static Track ReadTrack(std::ifstream& fileStream, std::vector<float>& timeStamps, std::vector<Key_T>& keys);
+
+		// Binds the cursor to the animation, and returns whether its keys have to be searched
+		bool BindCursor(AnimationCursor& cursor) const;
+
+		// Interpolates the raw keys around the time, moving the keys of the cursor of the bone
+		void SampleKeys(UINT bone, float animationTicks, UINT* cursorKeys, bool search, XMVECTOR& position, XMVECTOR& rotation, XMVECTOR& scale) const;
+		// Interpolates the compressed keys around the time, which are found from the time alone
+		void SampleCompressedKeys(UINT bone, float animationTicks, XMVECTOR& position, XMVECTOR& rotation, XMVECTOR& scale) const;
+		XMVECTOR SampleCompressedTrack(const CompressedTrack& track, bool rotation, float animationTicks) const;
+
 	private:
 		const AnimationClip* m_clip = nullptr;
-		std::vector<Channel> m_channels;
 		std::string m_name;
 
+		// Keys of all the channels packed per kind, the times apart from the values so the cursors only walk the times
+		std::vector<BoneTracks> m_boneTracks;
+		std::vector<float> m_positionTimes;
+		std::vector<float> m_rotationTimes;
+		std::vector<float> m_scaleTimes;
+		std::vector<Vector3> m_positions;
+		std::vector<Quaternion> m_rotations;
+		std::vector<Vector3> m_scales;
+
+		// Tracks of the position, rotation and scale of every bone, and their keys, in the compressed files.
+		// Either these or the raw keys are filled.
+		float m_sampleInterval = 0.0f;
+		std::vector<CompressedTrack> m_compressedTracks;
+		std::vector<UINT16> m_compressedKeys;
+
 		float m_duration = 0.0f;
 		float m_ticksPerSecond = 30.0f;
 	};
 
 	class AnimationClip : public ResourceObject
 	{
+	public:
+		// Written in place of the bone count at the start of the compressed files, "YAC2" in ASCII
+		static constexpr size_t CompressedFormatTag = 0x32434159;
+
 	public:
 		AnimationClip(const std::filesystem::path& resourcePath);
 
@@ -52,6 +142,8 @@ namespace udsdx
 		int GetBoneIndex(std::string_view boneName) const;
 		const std::vector<Bone>& GetBones() const { return m_bones; };
 		const std::vector<int>& GetBoneParents() const { return m_boneParents; }
+		// Bone transforms decomposed, for the bones without a channel in local space poses
+		const std::vector<LocalTransform>& GetBindPose() const { return m_bindPose; }
 		const Animation& GetAnimation(std::string_view name) const;
 		const Animation& GetAnimation() const;
 		UINT GetBoneCount() const;
@@ -61,6 +153,7 @@ namespace udsdx
 
 		std::vector<Bone> m_bones;
 		std::vector<int> m_boneParents;
+		std::vector<LocalTransform> m_bindPose;
 		std::unordered_map<std::string, int> m_boneIndexMap;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,23 @@
+#include "pch.h"
+#include "animation_lod.h"
+#include "lod_selector.h"
+
+namespace udsdx
+{
+	UINT AnimationLod::SelectInterval(float screenSize, UINT currentInterval, float hysteresis)
+	{
+		// The intervals are powers of two, indexed by their levels
+		UINT currentLevel = currentInterval == Paused ? 0 : static_cast<UINT>(std::countr_zero(currentInterval));
+		return 1u << LodSelector::Select(ScreenSizes, screenSize, currentLevel, hysteresis);
+	}
+
+	bool AnimationLod::IsDue(UINT64 frame, UINT phase, UINT interval, UINT skippedFrames)
+	{
+		if (interval == Paused)
+		{
+			return false;
+		}
+		// In steady state both conditions hold on the same frames, the first one only catches up after a change
+		return skippedFrames + 1 >= interval || ((frame + phase) & (interval - 1)) == 0;
+	}
+}
\ No newline at end of file
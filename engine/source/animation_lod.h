@@ -0,0 +1,25 @@
+#pragma once
+
+#include "pch.h"
+
+namespace udsdx
+{
+	// Picks how often the pose of a rigged renderer is evaluated, from the projected size of its bounds in the main view.
+	// Renderers sharing an interval are staggered by their phases, so their evaluations spread evenly over the frames.
+	class AnimationLod
+	{
+	public:
+		// Interval of the renderers outside the view, which only advance their time
+		static constexpr UINT Paused = 0;
+		// Screen sizes below which the pose is evaluated every 2nd, 4th and 8th frame, in decreasing order
+		static constexpr std::array<float, 3> ScreenSizes = { 0.2f, 0.1f, 0.05f };
+
+	public:
+		// Frames between two evaluations for the screen size, keeping the current interval until the size passes a threshold by the hysteresis fraction
+		static UINT SelectInterval(float screenSize, UINT currentInterval, float hysteresis);
+
+		// Whether the pose is evaluated on the frame, given the frames it was kept for since it was last evaluated.
+		// A pose is never kept longer than its interval, even right after the interval changed or the renderer resumed.
+		static bool IsDue(UINT64 frame, UINT phase, UINT interval, UINT skippedFrames);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "pch.h"
+#include "bone_palette.h"
+
+namespace udsdx
+{
+	void BonePalette::Reset(std::span<const Submesh> submeshes)
+	{
+		m_offsets.resize(submeshes.size() + 1);
+		m_offsets[0] = 0;
+		for (size_t index = 0; index < submeshes.size(); ++index)
+		{
+			assert(submeshes[index].BoneOffsets.size() <= MaxBoneCount);
+			m_offsets[index + 1] = m_offsets[index] + submeshes[index].BoneOffsets.size();
+		}
+
+		m_palette.assign(m_offsets.back(), Matrix4x4::Identity);
+		m_prevPalette.assign(m_offsets.back(), Matrix4x4::Identity);
+	}
+
+	void BonePalette::Swap()
+	{
+		std::swap(m_palette, m_prevPalette);
+	}
+
+	void BonePalette::Build(size_t submesh, const Submesh& source, std::span<const int> boneMap, std::span<const Matrix4x4> boneTransforms, Matrix4x4* destination)
+	{
+		assert(source.BoneOffsets.size() == GetBoneCount(submesh));
+		Compose(source.BoneOffsets, boneMap, boneTransforms, destination, m_palette.data() + m_offsets[submesh]);
+	}
+
+	std::span<const Matrix4x4> BonePalette::GetPalette(size_t submesh) const
+	{
+		return std::span<const Matrix4x4>(m_palette.data() + m_offsets[submesh], GetBoneCount(submesh));
+	}
+
+	std::span<const Matrix4x4> BonePalette::GetPrevPalette(size_t submesh) const
+	{
+		return std::span<const Matrix4x4>(m_prevPalette.data() + m_offsets[submesh], GetBoneCount(submesh));
+	}
+
+	UINT BonePalette::GetBoneCount(size_t submesh) const
+	{
+		return static_cast<UINT>(m_offsets[submesh + 1] - m_offsets[submesh]);
+	}
+
+	void BonePalette::Compose(std::span<const Matrix4x4> boneOffsets, std::span<const int> boneMap, std::span<const Matrix4x4> boneTransforms, Matrix4x4* output, Matrix4x4* secondOutput)
+	{
+		for (size_t boneIndex = 0; boneIndex < boneOffsets.size(); ++boneIndex)
+		{
+			XMMATRIX boneOffset = XMLoadFloat4x4(&boneOffsets[boneIndex]);
+			XMMATRIX boneTransform = XMLoadFloat4x4(&boneTransforms[boneMap[boneIndex]]);
+			XMMATRIX skinTransform = XMMatrixMultiplyTranspose(boneOffset, boneTransform);
+
+			XMStoreFloat4x4(&output[boneIndex], skinTransform);
+			if (secondOutput != nullptr)
+			{
+				XMStoreFloat4x4(&secondOutput[boneIndex], skinTransform);
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "pch.h"
+#include "mesh_base.h"
+
+namespace udsdx
+{
+	// Skinning matrices of every submesh of a rigged mesh, packed contiguously, along with the ones of the previous build.
+	// The matrices are transposed as the shaders read them, and only the bones the submeshes use are stored.
+	class BonePalette
+	{
+	public:
+		// Size of the bone array the shaders declare
+		static constexpr UINT MaxBoneCount = 256;
+
+	public:
+		// Lays the palettes out for the bones of the submeshes, starting both builds with identities
+		void Reset(std::span<const Submesh> submeshes);
+
+		// Makes the current palettes the previous ones, before the submeshes are built again. The storage is swapped rather than copied.
+		void Swap();
+		// Composes the bone offsets of the submesh with the transforms of the bones they map to, into its current palette and the destination.
+		// The destination is usually mapped upload memory, which is only written to.
+		void Build(size_t submesh, const Submesh& source, std::span<const int> boneMap, std::span<const Matrix4x4> boneTransforms, Matrix4x4* destination);
+
+		std::span<const Matrix4x4> GetPalette(size_t submesh) const;
+		std::span<const Matrix4x4> GetPrevPalette(size_t submesh) const;
+		UINT GetBoneCount(size_t submesh) const;
+
+	public:
+		// Writes the transposed products of the offsets with the mapped transforms to both outputs, the second one being optional
+		static void Compose(std::span<const Matrix4x4> boneOffsets, std::span<const int> boneMap, std::span<const Matrix4x4> boneTransforms, Matrix4x4* output, Matrix4x4* secondOutput);
+
+	private:
+		std::vector<Matrix4x4> m_palette;
+		std::vector<Matrix4x4> m_prevPalette;
+		// Start of the palette of each submesh, followed by the total bone count
+		std::vector<size_t> m_offsets;
+	};
+}
\ No newline at end of file
@@ -8,20 +8,12 @@
 
 namespace udsdx
 {
-	void Camera::OnInitialize()
-	{
-		for (auto& buffer : m_constantBuffers)
-		{
-			buffer = std::make_unique<UploadBuffer<CameraConstants>>(INSTANCE(Core)->GetDevice(), 1, true);
-		}
-	}
-
 	void Camera::PostUpdate(const Time& time, Scene& scene)
 	{
 		scene.EnqueueRenderCamera(this);
 	}
 
-	D3D12_GPU_VIRTUAL_ADDRESS Camera::UpdateConstantBuffer(int frameResourceIndex, float width, float height)
+	D3D12_GPU_VIRTUAL_ADDRESS Camera::UpdateConstantBuffer(ConstantAllocator& constantAllocator, float width, float height)
 	{
 		float aspect = width / height;
 
@@ -43,8 +35,7 @@ namespace udsdx
 
 		m_prevViewProjMatrix = viewProjMat;
 
-		m_constantBuffers[frameResourceIndex]->CopyData(0, constants);
-		return m_constantBuffers[frameResourceIndex]->Resource()->GetGPUVirtualAddress();
+		return constantAllocator.Upload(constants);
 	}
 
 	Matrix4x4 Camera::GetViewMatrix(bool validate) const
@@ -94,9 +85,9 @@ namespace udsdx
 		return m;
 	}
 
-	std::unique_ptr<BoundingCamera> CameraPerspective::GetViewFrustumWorld(float aspect) const
+	ViewVolume CameraPerspective::GetViewFrustumWorld(float aspect) const
 	{
-		return std::make_unique<BoundingCameraPerspective>(GetViewMatrix(false), GetProjMatrix(aspect));
+		return ViewVolume::CreateFrustum(GetViewMatrix(false), GetProjMatrix(aspect));
 	}
 
 	void CameraPerspective::SetFov(float fov)
@@ -136,9 +127,9 @@ namespace udsdx
 		return m;
 	}
 
-	std::unique_ptr<BoundingCamera> CameraOrthographic::GetViewFrustumWorld(float aspect) const
+	ViewVolume CameraOrthographic::GetViewFrustumWorld(float aspect) const
 	{
-		return std::make_unique<BoundingCameraOrthographic>(GetViewMatrix(false), m_radius * 2.0f * aspect, m_radius * 2.0f, m_near, m_far);
+		return ViewVolume::CreateOrientedBox(GetViewMatrix(false), m_radius * 2.0f * aspect, m_radius * 2.0f, m_near, m_far);
 	}
 
 	void CameraOrthographic::SetNear(float fNear)
@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "component.h"
 #include "scene_object.h"
+#include "scene.h"
 
 namespace udsdx
 {
@@ -61,15 +62,19 @@ namespace udsdx
 		}
 
 		m_isActive = active;
-		if (GetSceneObject()->GetActiveInScene())
+		std::shared_ptr<SceneObject> object = GetSceneObject();
+		if (object->GetActiveInScene())
 		{
+			Scene* scene = object->GetScene();
 			if (active)
 			{
+				scene->RegisterActiveComponent(this);
 				OnActive();
 			}
 			else
 			{
 				OnInactive();
+				scene->UnregisterActiveComponent(this);
 			}
 		}
 	}
@@ -2,6 +2,7 @@
 
 #include "pch.h"
 #include "scene_object.h"
+#include "component_registry.h"
 
 namespace udsdx
 {
@@ -12,6 +13,8 @@ namespace udsdx
 	class Component
 	{
 		friend class SceneObject;
+		friend class Scene;
+		friend class ComponentRegistry;
 
 	protected:
 		Component();
@@ -29,7 +32,8 @@ namespace udsdx
 		// - The component is hierarchically activated by SceneObject::SetActive(true) or Component::SetActive(true)
 		virtual void OnActive();
 
-		// Called when the component is about to call Update() function for the first time
+		// Called once before the first Update() or PostUpdate() after the component becomes active
+		// Update(), PostUpdate() and Begin() are only dispatched to the types which override them
 		virtual void Begin();
 
 		friend class SceneObject;
@@ -67,5 +71,15 @@ namespace udsdx
 		std::weak_ptr<SceneObject> m_object;
 		bool m_isActive = true;
 		bool m_isBegin = true;
+
+	private:
+		// Type ID of the concrete type, assigned by SceneObject::AddComponent()
+		ComponentRegistry::TypeID m_typeID = 0;
+		// Index in the component pool of the scene, while attached to a scene
+		UINT m_poolIndex = 0;
+		// Indices in the dispatch lists of the scene, while active in a scene
+		UINT m_batchIndex = 0;
+		UINT m_updateIndex = 0;
+		UINT m_postUpdateIndex = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,31 @@
+#include "pch.h"
+#include "component_registry.h"
+#include "component.h"
+
+namespace udsdx
+{
+	bool ComponentRegistry::IsA(const Component* component, TypeID queryTypeID)
+	{
+		std::vector<INT8>& row = m_isA[component->m_typeID];
+		if (row.size() <= queryTypeID)
+		{
+			row.resize(m_casters.size(), -1);
+		}
+
+		INT8& result = row[queryTypeID];
+		if (result < 0)
+		{
+			result = m_casters[queryTypeID](component) ? 1 : 0;
+		}
+		return result != 0;
+	}
+
+	ComponentRegistry::TypeID ComponentRegistry::Register(Caster caster, const Systems& systems)
+	{
+		TypeID typeID = static_cast<TypeID>(m_casters.size());
+		m_casters.emplace_back(caster);
+		m_systems.emplace_back(systems);
+		m_isA.emplace_back();
+		return typeID;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "pch.h"
+
+namespace udsdx
+{
+	class Component;
+	class Scene;
+
+	// Assigns a type ID to every component type and answers whether a component is of a given type.
+	// The answer for each pair of (concrete type, queried type) is resolved once with RTTI and cached,
+	// so the lookups in the hot path are plain table reads.
+	class ComponentRegistry
+	{
+	public:
+		using TypeID = UINT;
+
+		// Updates every active component of one concrete type in a single call
+		using BatchFunction = void(*)(std::span<Component* const> components, const Time& time, Scene& scene);
+
+		// The batch functions of a concrete type, null for the phases it leaves to the per-object path.
+		// A type opts in by declaring static UpdateAll() or PostUpdateAll() taking std::span<Component_T*>.
+		// Derived types do not inherit them, since the span of the base type does not match.
+		struct Systems
+		{
+			BatchFunction Update = nullptr;
+			BatchFunction PostUpdate = nullptr;
+
+			// Whether the type overrides the hooks of Component, so the scene skips the empty ones.
+			// Overrides which are not accessible from here are conservatively treated as overridden.
+			bool OverridesBegin = true;
+			bool OverridesUpdate = true;
+			bool OverridesPostUpdate = true;
+
+			bool HasAny() const { return Update != nullptr || PostUpdate != nullptr; }
+		};
+
+	public:
+		template <typename Component_T>
+		static TypeID GetTypeID()
+		{
+			static const TypeID typeID = INSTANCE(ComponentRegistry)->Register(
+				[](const Component* component) { return dynamic_cast<const Component_T*>(component) != nullptr; },
+				MakeSystems<Component_T>()
+			);
+			return typeID;
+		}
+
+		// Tags a new component with the type ID of its concrete type
+		template <typename Component_T>
+		static void AssignTypeID(Component_T& component)
+		{
+			component.m_typeID = GetTypeID<Component_T>();
+		}
+
+	public:
+		// Whether the component is of the queried type or derives from it
+		bool IsA(const Component* component, TypeID queryTypeID);
+		const Systems& GetSystems(TypeID typeID) const { return m_systems[typeID]; }
+		size_t GetTypeCount() const { return m_casters.size(); }
+
+	private:
+		using Caster = bool(*)(const Component*);
+		TypeID Register(Caster caster, const Systems& systems);
+
+		template <typename Component_T>
+		static Systems MakeSystems()
+		{
+			Systems systems;
+			if constexpr (requires(std::span<Component_T*> components, const Time& time, Scene& scene) { Component_T::UpdateAll(components, time, scene); })
+			{
+				systems.Update = [](std::span<Component* const> components, const Time& time, Scene& scene) {
+					Component_T::UpdateAll(Downcast<Component_T>(components), time, scene);
+				};
+			}
+			if constexpr (requires(std::span<Component_T*> components, const Time& time, Scene& scene) { Component_T::PostUpdateAll(components, time, scene); })
+			{
+				systems.PostUpdate = [](std::span<Component* const> components, const Time& time, Scene& scene) {
+					Component_T::PostUpdateAll(Downcast<Component_T>(components), time, scene);
+				};
+			}
+			systems.OverridesBegin = !requires { requires std::is_same_v<decltype(&Component_T::Begin), void (Component::*)()>; };
+			systems.OverridesUpdate = !requires { requires std::is_same_v<decltype(&Component_T::Update), void (Component::*)(const Time&, Scene&)>; };
+			systems.OverridesPostUpdate = !requires { requires std::is_same_v<decltype(&Component_T::PostUpdate), void (Component::*)(const Time&, Scene&)>; };
+			return systems;
+		}
+
+		// Copies the pointers into a scratch buffer, so the batch does not see the list change under it
+		// when a component is activated or deactivated during the call.
+		template <typename Component_T>
+		static std::span<Component_T*> Downcast(std::span<Component* const> components)
+		{
+			thread_local std::vector<Component_T*> scratch;
+			scratch.resize(components.size());
+			for (size_t i = 0; i < components.size(); ++i)
+			{
+				scratch[i] = static_cast<Component_T*>(components[i]);
+			}
+			return scratch;
+		}
+
+	private:
+		std::vector<Caster> m_casters;
+		std::vector<Systems> m_systems;
+		// Indexed by [concrete type][queried type], -1 if not resolved yet
+		std::vector<std::vector<INT8>> m_isA;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include "pch.h"
+#include "constant_allocator.h"
+
+namespace udsdx
+{
+	ConstantAllocator::ConstantAllocator(ID3D12Device* device) : m_device(device), m_allocator(PageSize, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT)
+	{
+		CreatePage();
+	}
+
+	ConstantAllocator::~ConstantAllocator()
+	{
+		for (Page& page : m_pages)
+		{
+			page.Resource->Unmap(0, nullptr);
+		}
+	}
+
+	ConstantAllocator::Allocation ConstantAllocator::Allocate(UINT64 size)
+	{
+		LinearAllocator::Allocation allocation = m_allocator.Allocate(size);
+
+		// Pages are only added, the ones of a busy frame are kept for the next frames using the same frame resource
+		while (m_pages.size() <= allocation.Page)
+		{
+			CreatePage();
+		}
+
+		const Page& page = m_pages[allocation.Page];
+		return Allocation{ page.MappedData + allocation.Offset, page.Resource->GetGPUVirtualAddress() + allocation.Offset };
+	}
+
+	void ConstantAllocator::CreatePage()
+	{
+		D3D12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+		D3D12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(PageSize);
+
+		Page& page = m_pages.emplace_back();
+		ThrowIfFailed(m_device->CreateCommittedResource(
+			&heapProperty,
+			D3D12_HEAP_FLAG_NONE,
+			&resourceDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&page.Resource)));
+
+		// Kept mapped for the lifetime of the page
+		ThrowIfFailed(page.Resource->Map(0, nullptr, reinterpret_cast<void**>(&page.MappedData)));
+	}
+}
\ No newline at end of file
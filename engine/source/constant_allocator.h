@@ -0,0 +1,60 @@
+#pragma once
+
+#include "pch.h"
+#include "linear_allocator.h"
+
+namespace udsdx
+{
+	// Per frame resource suballocator of constant buffers, over persistently mapped pages of the upload heap.
+	// The constants written in a frame live until the frame resource is reused, so they are uploaded again every frame.
+	class ConstantAllocator
+	{
+	public:
+		static constexpr UINT64 PageSize = 2 << 20;
+
+		struct Allocation
+		{
+			void* CpuAddress;
+			D3D12_GPU_VIRTUAL_ADDRESS GpuAddress;
+		};
+
+	public:
+		ConstantAllocator(ID3D12Device* device);
+		ConstantAllocator(const ConstantAllocator& rhs) = delete;
+		ConstantAllocator& operator=(const ConstantAllocator& rhs) = delete;
+		~ConstantAllocator();
+
+	public:
+		// Placed at a multiple of 256 bytes, so the address can be bound as a root constant buffer view
+		Allocation Allocate(UINT64 size);
+
+		// Copies the constants to a new allocation, and returns its address
+		template <typename T>
+		D3D12_GPU_VIRTUAL_ADDRESS Upload(const T& data)
+		{
+			Allocation allocation = Allocate(sizeof(T));
+			memcpy(allocation.CpuAddress, &data, sizeof(T));
+			return allocation.GpuAddress;
+		}
+
+		// Called with the fence of the frame after it is submitted, and with the completed fence when the frame resource is reused
+		void Retire(UINT64 fence) { m_allocator.Retire(fence); }
+		bool Reclaim(UINT64 completedFence) { return m_allocator.Reclaim(completedFence); }
+
+		UINT64 GetUsedSize() const { return m_allocator.GetUsedSize(); }
+
+	private:
+		struct Page
+		{
+			ComPtr<ID3D12Resource> Resource;
+			BYTE* MappedData = nullptr;
+		};
+
+		void CreatePage();
+
+	private:
+		ComPtr<ID3D12Device> m_device;
+		LinearAllocator m_allocator;
+		std::vector<Page> m_pages;
+	};
+}
\ No newline at end of file
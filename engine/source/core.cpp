@@ -22,6 +22,8 @@
 #include "post_process_bloom.h"
 #include "post_process_fxaa.h"
 #include "post_process_outline.h"
+#include "job_system.h"
+#include "state_tracking_command_list.h"
 
 // Forward declare message handler from imgui_impl_win32.cpp
 extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
@@ -68,6 +70,8 @@ namespace udsdx
 			m_frameResources[i] = std::make_unique<FrameResource>(m_d3dDevice.Get());
 		}
 
+		// Registers the main thread as the first worker
+		auto jobSystem = Singleton<JobSystem>::GetInstance();
 		auto audio = Singleton<Audio>::GetInstance();
 		auto resource = Singleton<Resource>::GetInstance();
 		m_timeMeasure = Singleton<TimeMeasure>::GetInstance();
@@ -219,6 +223,8 @@ namespace udsdx
 			nullptr,
 			IID_PPV_ARGS(m_commandList.GetAddressOf())
 		));
+		m_commandListTarget = std::make_unique<D3D12CommandList>(m_commandList.Get());
+		m_trackedCommandList = std::make_unique<StateTrackingCommandList>(m_commandListTarget.get());
 
 		// Create fence for cpu-gpu synchronization
 		ThrowIfFailed(m_d3dDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
@@ -299,6 +305,8 @@ namespace udsdx
 	{ ZoneScoped;
 		if (m_d3dDevice != nullptr)
 		{
+			SetPipelinedRendering(false);
+
 			// Ensure that the GPU is no longer referencing resources that are about to be destroyed.
 			FlushCommandQueue();
 			SetWindowFullscreen(false);
@@ -492,7 +500,8 @@ namespace udsdx
 		if (delta * RefreshRate > 1.0)
 		{
 			int fps = static_cast<int>(round(1.0 / delta * frameCount));
-			SetWindowText(m_hMainWnd, (m_mainWndCaption + std::format(L" [{} x {}] @ {} FPS", m_clientWidth, m_clientHeight, fps)).c_str());
+			float latency = m_frameLatency.load(std::memory_order_relaxed);
+			SetWindowText(m_hMainWnd, (m_mainWndCaption + std::format(L" [{} x {}] @ {} FPS, {:.1f} ms latency", m_clientWidth, m_clientHeight, fps, latency)).c_str());
 			frameCount = 0;
 			lc = c;
 		}
@@ -508,6 +517,8 @@ namespace udsdx
 
 	void Core::FlushCommandQueue()
 	{ ZoneScoped;
+		WaitForRenderThread();
+
 		// Advance the fence value to mark commands up to this fence point.
 		m_currentFence++;
 
@@ -528,6 +539,9 @@ namespace udsdx
 
 	void Core::PrepareDirectCommandList()
 	{
+		// The command list is shared with the render thread
+		WaitForRenderThread();
+
 		// Reset the command allocator for the next frame.
 		m_directCmdListAlloc->Reset();
 		m_commandList->Reset(m_directCmdListAlloc.Get(), nullptr);
@@ -568,11 +582,16 @@ namespace udsdx
 			::WaitForSingleObject(m_fenceEvent, INFINITE);
 		}
 
+		// The constants of the last frame using the resource are no longer read by the GPU
+		bool reclaimed = frameResource->GetConstantAllocator()->Reclaim(m_fence->GetCompletedValue());
+		assert(reclaimed);
+
 		SceneObject::GarbageCollector::Collect(m_currFrameResourceIndex);
 	}
 
 	void Core::Update()
 	{ ZoneScopedC(0xFAAB36);
+		m_frameBeginTimes[m_currFrameResourceIndex] = std::chrono::steady_clock::now();
 		DisplayFrameStats();
 
 		// Advance the time measure
@@ -599,6 +618,7 @@ namespace udsdx
 		}
 		if (m_drawImGUIElements)
 		{
+			WaitForRenderThread();
 			ImGuiNewFrame();
 		}
 
@@ -616,17 +636,33 @@ namespace udsdx
 
 	void Core::Render()
 	{ ZoneScopedC(0xF78104);
-		TracyD3D12Collect(m_tracyQueueCtx);
-		TracyD3D12NewFrame(m_tracyQueueCtx);
+		// The ImGui overlay reads the live scene, so the frame is recorded serially while it is shown
+		if (!m_pipelinedRendering || m_drawImGUIElements)
+		{
+			WaitForRenderThread();
+			RenderParam param = CreateRenderParam(m_currFrameResourceIndex);
+			PublishFrame(param);
+			RecordFrame(param, false);
+			return;
+		}
 
-		auto frameResource = CurrentFrameResource();
-		auto cmdListAlloc = frameResource->GetCommandListAllocator();
+		// Publish the frame here, where the culling fans out across the workers, and hand the recording to the render thread
+		m_renderIdle.acquire();
+		m_renderParam = CreateRenderParam(m_currFrameResourceIndex);
+		PublishFrame(m_renderParam);
+		m_renderRequested.release();
+	}
+
+	RenderParam Core::CreateRenderParam(int frameResourceIndex)
+	{
+		auto frameResource = m_frameResources[frameResourceIndex].get();
 		auto objectCB = frameResource->GetObjectCB();
 
-		// Ready all the resources for rendering.
-		RenderParam param{
+		return RenderParam{
 			.Device = m_d3dDevice.Get(),
 			.CommandList = m_commandList.Get(),
+			.TrackedCommandList = m_trackedCommandList.get(),
+			.ConstantAllocator = frameResource->GetConstantAllocator(),
 			.RootSignature = m_rootSignature.Get(),
 			.SRVDescriptorHeap = m_srvHeap.Get(),
 
@@ -634,8 +670,9 @@ namespace udsdx
 			.RenderOptions = &m_renderOptions,
 
 			.AspectRatio = GetAspectRatio(),
-			.FrameResourceIndex = m_currFrameResourceIndex,
+			.FrameResourceIndex = frameResourceIndex,
 			.RenderStageIndex = 0,
+			// Captured here, as the time measure advances during the next Update() while the frame is recorded
 			.Time = m_timeMeasure->GetTime(),
 
 			.Viewport = m_screenViewport,
@@ -662,6 +699,25 @@ namespace udsdx
 
 			.TracyQueueContext = &m_tracyQueueCtx
 		};
+	}
+
+	void Core::PublishFrame(RenderParam& param)
+	{ ZoneScoped;
+		// The render thread is not a worker, so publishing there would run the culling inline while the workers idle
+		assert(JobSystem::IsWorkerThread() && "The frame must be published from a thread of the job system.");
+
+		// Capture everything the frame needs from the scene, after which the main thread may continue.
+		m_scene->PublishRenderSnapshot(param);
+	}
+
+	void Core::RecordFrame(RenderParam& param, bool onRenderThread)
+	{ ZoneScoped;
+		TracyD3D12Collect(m_tracyQueueCtx);
+		TracyD3D12NewFrame(m_tracyQueueCtx);
+
+		const int frameResourceIndex = param.FrameResourceIndex;
+		auto frameResource = m_frameResources[frameResourceIndex].get();
+		auto cmdListAlloc = frameResource->GetCommandListAllocator();
 
 		// Command list allocators can only be reset when the associated 
 		// command lists have finished execution on the GPU; apps should use 
@@ -672,6 +728,8 @@ namespace udsdx
 		// ID3D12PipelineState: This is optional and can be NULL.
 		// If NULL, the runtime sets a dummy initial pipeline state so that drivers don't have to deal with undefined state.
 		ThrowIfFailed(m_commandList->Reset(cmdListAlloc, nullptr));
+		m_trackedCommandList->Invalidate();
+		m_trackedCommandList->ResetStatistics();
 
 		ID3D12DescriptorHeap* descriptorHeaps[] = { m_srvHeap.Get() };
 		m_commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
@@ -688,8 +746,11 @@ namespace udsdx
 
 		// Draw the scene objects. 
 		m_scene->Render(param);
+		m_issuedStateCalls.store(m_trackedCommandList->GetStatistics().Issued, std::memory_order_relaxed);
+		m_skippedStateCalls.store(m_trackedCommandList->GetStatistics().Skipped, std::memory_order_relaxed);
 
-		if (m_drawImGUIElements)
+		// The render thread only runs while the overlay is hidden
+		if (!onRenderThread && m_drawImGUIElements)
 		{
 			// Draw the debug window with ImGui.
 			ImGuiRender();
@@ -733,6 +794,62 @@ namespace udsdx
 
 		// Add the one-shot resource to the command queue for execution.
 		m_graphicsMemory->Commit(m_commandQueue.Get());
+
+		float latency = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_frameBeginTimes[frameResourceIndex]).count();
+		m_frameLatency.store(std::lerp(m_frameLatency.load(std::memory_order_relaxed), latency, 0.1f), std::memory_order_relaxed);
+		TracyPlot("Frame Latency (ms)", latency);
+	}
+
+	void Core::RenderThreadMain()
+	{
+		tracy::SetThreadName("Render Thread");
+
+		while (true)
+		{
+			m_renderRequested.acquire();
+			if (!m_pipelinedRendering)
+			{
+				break;
+			}
+
+			RecordFrame(m_renderParam, true);
+			m_renderIdle.release();
+		}
+	}
+
+	void Core::SetPipelinedRendering(bool enabled)
+	{
+		if (enabled == m_pipelinedRendering)
+		{
+			return;
+		}
+
+		if (enabled)
+		{
+			m_pipelinedRendering = true;
+			m_renderThread = std::thread(&Core::RenderThreadMain, this);
+		}
+		else
+		{
+			WaitForRenderThread();
+			m_pipelinedRendering = false;
+			m_renderRequested.release();
+			m_renderThread.join();
+		}
+	}
+
+	bool Core::GetPipelinedRendering() const
+	{
+		return m_pipelinedRendering;
+	}
+
+	void Core::WaitForRenderThread()
+	{ ZoneScoped;
+		if (m_pipelinedRendering)
+		{
+			m_renderIdle.acquire();
+			m_renderIdle.release();
+		}
 	}
 
 	void Core::UpdateMainPassCB()
@@ -1079,6 +1196,8 @@ namespace udsdx
 		ImGui::Text("Frame Per Second 10%%:  %.3f FPS", 10.0f / frameTimesPsum[9]);
 		ImGui::Text("Frame Per Second 1%%:   %.3f FPS", 1.0f / frameTimesPsum[0]);
 		ImGui::Text("Allocated SceneObjects: %llu", g_sceneObjectCount);
+		ImGui::Text("Frame Latency: %.3f ms", m_frameLatency.load(std::memory_order_relaxed));
+		ImGui::Text("State Calls Issued: %u, Skipped: %u", m_issuedStateCalls.load(std::memory_order_relaxed), m_skippedStateCalls.load(std::memory_order_relaxed));
 		ImGui::PushStyleColor(ImGuiCol_PlotHistogram, ImVec4(1.0f, 1.0f, 1.0f, 1.0f));
 		ImGui::PushStyleColor(ImGuiCol_PlotHistogramHovered, ImVec4(1.0f, 1.0f, 1.0f, 0.5f));
 		ImGui::PlotHistogram("Frame Times", frameTimes.data(), static_cast<int>(frameTimes.size()), 0, nullptr, 0.0f, smoothMaxFrameTime, ImVec2(0.0f, 100.0f));
@@ -1086,7 +1205,15 @@ namespace udsdx
 		ImGui::PopStyleColor(2);
 
 
+		bool pipelinedRendering = m_pipelinedRendering;
+		if (ImGui::Checkbox("Pipelined Rendering", &pipelinedRendering))
+		{
+			SetPipelinedRendering(pipelinedRendering);
+		}
 		ImGui::Checkbox("Draw Shadow Map", &m_renderOptions.DrawShadowMap);
+		ImGui::Checkbox("Use Occlusion Culling", &m_renderOptions.UseOcclusionCulling);
+		ImGui::Checkbox("Use Mesh LOD", &m_renderOptions.UseMeshLod);
+		ImGui::Checkbox("Use Animation LOD", &m_renderOptions.UseAnimationLod);
 		bool changeSSAO = ImGui::Checkbox("Draw SSAO", &m_renderOptions.DrawSSAO);
 		ImGui::Checkbox("Draw Motion Blur", &m_renderOptions.DrawMotionBlur);
 		ImGui::Checkbox("Draw Post Process Bloom", &m_renderOptions.DrawBloom);
@@ -15,6 +15,8 @@ namespace udsdx
 	class PostProcessBloom;
 	class PostProcessFXAA;
 	class PostProcessOutline;
+	class D3D12CommandList;
+	class StateTrackingCommandList;
 
 	class Core
 	{
@@ -46,6 +48,13 @@ namespace udsdx
 		void BroadcastUpdateMessage();
 		void Render();
 		void UpdateMainPassCB();
+
+		// In pipelined mode, Render() hands the frame to a render thread which records it while the next frame is updated.
+		// The frame is still published before Render() returns, and the renderers are then recorded from the copies they took in PrepareRender().
+		// Removed components are deleted by the GarbageCollector once their frame resource is reused, so the render thread never outlives them.
+		void SetPipelinedRendering(bool enabled);
+		bool GetPipelinedRendering() const;
+		void WaitForRenderThread();
 		void SetWindowFullscreen(bool fullscreen);
 		LRESULT ProcessMessage(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 		virtual bool OnResizeWindow(int width, int height);
@@ -111,6 +120,13 @@ namespace udsdx
 
 		void InitializeSpriteBatch();
 
+		RenderParam CreateRenderParam(int frameResourceIndex);
+		// Captures the scene into the snapshot of the frame resource, on the main thread
+		void PublishFrame(RenderParam& param);
+		// Records, submits and presents the published frame
+		void RecordFrame(RenderParam& param, bool onRenderThread);
+		void RenderThreadMain();
+
 	protected:
 		HINSTANCE	m_hInstance = 0;
 		HWND		m_hMainWnd = 0;
@@ -183,6 +199,8 @@ namespace udsdx
 
 		// A collection of commands to be appended to a command queue
 		ComPtr<ID3D12GraphicsCommandList> m_commandList;
+		std::unique_ptr<D3D12CommandList> m_commandListTarget;
+		std::unique_ptr<StateTrackingCommandList> m_trackedCommandList;
 
 		// Frame Resources for parameters of each frame
 		// Each frame resource contains a command allocator and
@@ -254,6 +272,22 @@ namespace udsdx
 		// DirectXTK Sprite Batch for HUD rendering
 		std::unique_ptr<SpriteBatch> m_hudSpriteBatch;
 		std::unique_ptr<SpriteBatch> m_hudSpriteBatchPremultipliedAlpha;
+
+		// Pipelined rendering
+		bool m_pipelinedRendering = false;
+		std::thread m_renderThread;
+		std::binary_semaphore m_renderRequested{ 0 };
+		std::binary_semaphore m_renderIdle{ 1 };
+		// Frame published for the render thread, only written while it is idle
+		RenderParam m_renderParam{};
+
+		// Time from the beginning of Update() to Present() of each frame
+		std::array<std::chrono::steady_clock::time_point, FrameResourceCount> m_frameBeginTimes;
+		std::atomic<float> m_frameLatency = 0.0f;
+
+		// State calls of the draw loops of the last recorded frame
+		std::atomic<UINT> m_issuedStateCalls = 0;
+		std::atomic<UINT> m_skippedStateCalls = 0;
 	};
 }
 
@@ -0,0 +1,420 @@
+#include "pch.h"
+#include "culling.h"
+#include "job_system.h"
+#include "occlusion_buffer.h"
+
+namespace udsdx
+{
+	static XMVECTOR LoadLanes(const float* lanes)
+	{
+		return XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(lanes));
+	}
+
+	static void StoreLanes(float* lanes, FXMVECTOR value)
+	{
+		XMStoreFloat4A(reinterpret_cast<XMFLOAT4A*>(lanes), value);
+	}
+
+	// Bit i of the result is set if lane i of the comparison result is set
+	static UINT64 GetLaneMask(FXMVECTOR comparison)
+	{
+#if defined(_XM_SSE_INTRINSICS_)
+		return static_cast<UINT64>(_mm_movemask_ps(comparison));
+#else
+		XMUINT4 lanes;
+		XMStoreUInt4(&lanes, comparison);
+		return (lanes.x & 1) | (lanes.y & 2) | (lanes.z & 4) | (lanes.w & 8);
+#endif
+	}
+
+	ViewVolume ViewVolume::CreateFrustum(const Matrix4x4& viewMatrix, const Matrix4x4& projMatrix)
+	{
+		// Points are transformed as row vectors, so each clip plane is a combination of the columns of the matrix
+		Matrix4x4 viewProj = viewMatrix * projMatrix;
+		auto column = [&viewProj](int index) {
+			return Vector4(viewProj.m[0][index], viewProj.m[1][index], viewProj.m[2][index], viewProj.m[3][index]);
+			};
+		Vector4 x = column(0);
+		Vector4 y = column(1);
+		Vector4 z = column(2);
+		Vector4 w = column(3);
+		std::array<Vector4, 6> planes = { w + x, w - x, w + y, w - y, z, w - z };
+
+		ViewVolume volume;
+		volume.m_type = Type::Frustum;
+		for (size_t i = 0; i < planes.size(); ++i)
+		{
+			XMStoreFloat4A(&volume.m_planes[i], XMPlaneNormalize(planes[i]));
+		}
+		return volume;
+	}
+
+	ViewVolume ViewVolume::CreateOrientedBox(const Matrix4x4& viewMatrix, float width, float height, float nearPlane, float farPlane)
+	{
+		Matrix4x4 viewToWorld = viewMatrix.Invert();
+		std::array<Vector3, 3> axes = {
+			Vector3::TransformNormal(Vector3::UnitX, viewToWorld),
+			Vector3::TransformNormal(Vector3::UnitY, viewToWorld),
+			Vector3::TransformNormal(Vector3::UnitZ, viewToWorld)
+		};
+		Vector3 center = Vector3::Transform(Vector3(0.0f, 0.0f, (nearPlane + farPlane) * 0.5f), viewToWorld);
+		std::array<float, 3> extents = { width * 0.5f, height * 0.5f, (farPlane - nearPlane) * 0.5f };
+
+		ViewVolume volume;
+		volume.m_type = Type::OrientedBox;
+		Vector3 worldExtents = Vector3::Zero;
+		for (size_t i = 0; i < axes.size(); ++i)
+		{
+			Vector3 axis = axes[i];
+			axis.Normalize();
+			volume.m_axes[i] = XMFLOAT4A(axis.x, axis.y, axis.z, axis.Dot(center));
+
+			worldExtents += Vector3(std::abs(axis.x), std::abs(axis.y), std::abs(axis.z)) * extents[i];
+		}
+		volume.m_extents = XMFLOAT4A(extents[0], extents[1], extents[2], 0.0f);
+		volume.m_center = XMFLOAT4A(center.x, center.y, center.z, 0.0f);
+		volume.m_worldExtents = XMFLOAT4A(worldExtents.x, worldExtents.y, worldExtents.z, 0.0f);
+		return volume;
+	}
+
+	bool ViewVolume::Intersects(const BoundingBox& box) const
+	{
+		const XMFLOAT3& c = box.Center;
+		const XMFLOAT3& e = box.Extents;
+		if (m_type == Type::Frustum)
+		{
+			for (const XMFLOAT4A& plane : m_planes)
+			{
+				float distance = plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w;
+				float radius = std::abs(plane.x) * e.x + std::abs(plane.y) * e.y + std::abs(plane.z) * e.z;
+				if (distance + radius < 0.0f)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		std::array<float, 3> extents = { m_extents.x, m_extents.y, m_extents.z };
+		for (size_t i = 0; i < m_axes.size(); ++i)
+		{
+			const XMFLOAT4A& axis = m_axes[i];
+			float distance = axis.x * c.x + axis.y * c.y + axis.z * c.z - axis.w;
+			float radius = std::abs(axis.x) * e.x + std::abs(axis.y) * e.y + std::abs(axis.z) * e.z;
+			if (std::abs(distance) > extents[i] + radius)
+			{
+				return false;
+			}
+		}
+		return std::abs(c.x - m_center.x) <= e.x + m_worldExtents.x &&
+			std::abs(c.y - m_center.y) <= e.y + m_worldExtents.y &&
+			std::abs(c.z - m_center.z) <= e.z + m_worldExtents.z;
+	}
+
+	void VisibilitySet::Reset(size_t count)
+	{
+		m_words.resize((count + 63) / 64);
+	}
+
+	size_t VisibilitySet::GetVisibleCount() const
+	{
+		size_t count = 0;
+		for (UINT64 word : m_words)
+		{
+			count += std::popcount(word);
+		}
+		return count;
+	}
+
+	void CullingBounds::Resize(size_t count)
+	{
+		m_count = count;
+		m_blocks.resize((count + LaneCount - 1) / LaneCount);
+	}
+
+	void CullingBounds::Set(size_t index, const BoundingBox& localBounds, const Matrix4x4& world)
+	{
+		// The extents are transformed by the absolute values of the matrix, which encloses the transformed box
+		const XMFLOAT3& e = localBounds.Extents;
+		Vector3 center = Vector3::Transform(localBounds.Center, world);
+
+		Block& block = m_blocks[index / LaneCount];
+		size_t lane = index % LaneCount;
+		block.CenterX[lane] = center.x;
+		block.CenterY[lane] = center.y;
+		block.CenterZ[lane] = center.z;
+		block.ExtentX[lane] = std::abs(world._11) * e.x + std::abs(world._21) * e.y + std::abs(world._31) * e.z;
+		block.ExtentY[lane] = std::abs(world._12) * e.x + std::abs(world._22) * e.y + std::abs(world._32) * e.z;
+		block.ExtentZ[lane] = std::abs(world._13) * e.x + std::abs(world._23) * e.y + std::abs(world._33) * e.z;
+	}
+
+	void CullingBounds::SetUnbounded(size_t index)
+	{
+		Block& block = m_blocks[index / LaneCount];
+		size_t lane = index % LaneCount;
+		block.CenterX[lane] = 0.0f;
+		block.CenterY[lane] = 0.0f;
+		block.CenterZ[lane] = 0.0f;
+		block.ExtentX[lane] = UnboundedExtent;
+		block.ExtentY[lane] = UnboundedExtent;
+		block.ExtentZ[lane] = UnboundedExtent;
+	}
+
+	// A view volume with its components replicated across the lanes, so a block is tested without shuffles
+	struct CullingBounds::SplatVolume
+	{
+		struct Plane
+		{
+			XMVECTOR X, Y, Z, W;
+			XMVECTOR AbsX, AbsY, AbsZ;
+		};
+
+		struct Axis
+		{
+			XMVECTOR X, Y, Z, Offset;
+			XMVECTOR AbsX, AbsY, AbsZ, Extent;
+		};
+
+		ViewVolume::Type Type;
+		std::array<Plane, 6> Planes;
+		std::array<Axis, 3> Axes;
+		XMVECTOR CenterX, CenterY, CenterZ;
+		XMVECTOR ExtentX, ExtentY, ExtentZ;
+
+		// Lanes of the block whose boxes are entirely outside the volume
+		XMVECTOR GetOutside(const Block& block) const
+		{
+			XMVECTOR centerX = LoadLanes(block.CenterX);
+			XMVECTOR centerY = LoadLanes(block.CenterY);
+			XMVECTOR centerZ = LoadLanes(block.CenterZ);
+			XMVECTOR extentX = LoadLanes(block.ExtentX);
+			XMVECTOR extentY = LoadLanes(block.ExtentY);
+			XMVECTOR extentZ = LoadLanes(block.ExtentZ);
+
+			// Frustum: a box is outside if it lies entirely behind any of the planes
+			if (Type == ViewVolume::Type::Frustum)
+			{
+				XMVECTOR outside = XMVectorFalseInt();
+				for (const Plane& plane : Planes)
+				{
+					XMVECTOR distance = XMVectorMultiplyAdd(plane.X, centerX, XMVectorMultiplyAdd(plane.Y, centerY, XMVectorMultiplyAdd(plane.Z, centerZ, plane.W)));
+					XMVECTOR radius = XMVectorMultiplyAdd(plane.AbsX, extentX, XMVectorMultiplyAdd(plane.AbsY, extentY, XMVectorMultiply(plane.AbsZ, extentZ)));
+					outside = XMVectorOrInt(outside, XMVectorLess(XMVectorAdd(distance, radius), XMVectorZero()));
+				}
+				return outside;
+			}
+
+			// Oriented box: separating axis test on the world axes and the axes of the box, the cross products of the edges are skipped
+			XMVECTOR outside = XMVectorOrInt(
+				XMVectorGreater(XMVectorAbs(XMVectorSubtract(centerX, CenterX)), XMVectorAdd(extentX, ExtentX)),
+				XMVectorOrInt(
+					XMVectorGreater(XMVectorAbs(XMVectorSubtract(centerY, CenterY)), XMVectorAdd(extentY, ExtentY)),
+					XMVectorGreater(XMVectorAbs(XMVectorSubtract(centerZ, CenterZ)), XMVectorAdd(extentZ, ExtentZ))));
+			for (const Axis& axis : Axes)
+			{
+				XMVECTOR distance = XMVectorSubtract(XMVectorMultiplyAdd(axis.X, centerX, XMVectorMultiplyAdd(axis.Y, centerY, XMVectorMultiply(axis.Z, centerZ))), axis.Offset);
+				XMVECTOR radius = XMVectorMultiplyAdd(axis.AbsX, extentX, XMVectorMultiplyAdd(axis.AbsY, extentY, XMVectorMultiply(axis.AbsZ, extentZ)));
+				outside = XMVectorOrInt(outside, XMVectorGreater(XMVectorAbs(distance), XMVectorAdd(axis.Extent, radius)));
+			}
+			return outside;
+		}
+	};
+
+	void CullingBounds::Cull(const ViewVolume& volume, VisibilitySet& visibility) const
+	{
+		Cull(std::span<const ViewVolume>(&volume, 1), std::span<VisibilitySet>(&visibility, 1));
+	}
+
+	void CullingBounds::Cull(std::span<const ViewVolume> volumes, std::span<VisibilitySet> visibilities) const
+	{ ZoneScoped;
+		for (size_t first = 0; first < volumes.size(); first += MaxVolumesPerPass)
+		{
+			size_t count = std::min(volumes.size() - first, MaxVolumesPerPass);
+			std::array<SplatVolume, MaxVolumesPerPass> splatVolumes;
+			for (size_t i = 0; i < count; ++i)
+			{
+				splatVolumes[i] = Splat(volumes[first + i]);
+				visibilities[first + i].Reset(m_count);
+			}
+
+			// Every range of words is written by a single job, so the jobs never share a word
+			std::span<const SplatVolume> passVolumes(splatVolumes.data(), count);
+			std::span<VisibilitySet> passVisibilities = visibilities.subspan(first, count);
+			UINT wordCount = static_cast<UINT>((m_count + 63) / 64);
+			INSTANCE(JobSystem)->ParallelFor(wordCount, [&](UINT begin, UINT end) {
+				CullWords(passVolumes, passVisibilities, begin, end);
+				}, WordsPerJob);
+		}
+
+		// The lanes after the last item do not hold any bounds
+		if (m_count % 64 != 0)
+		{
+			for (VisibilitySet& visibility : visibilities)
+			{
+				visibility.GetWords().back() &= (1ull << (m_count % 64)) - 1;
+			}
+		}
+	}
+
+	CullingBounds::SplatVolume CullingBounds::Splat(const ViewVolume& volume)
+	{
+		SplatVolume splat = {};
+		splat.Type = volume.m_type;
+		if (volume.m_type == ViewVolume::Type::Frustum)
+		{
+			for (size_t i = 0; i < splat.Planes.size(); ++i)
+			{
+				XMVECTOR plane = XMLoadFloat4A(&volume.m_planes[i]);
+				XMVECTOR absPlane = XMVectorAbs(plane);
+				splat.Planes[i] = {
+					XMVectorSplatX(plane), XMVectorSplatY(plane), XMVectorSplatZ(plane), XMVectorSplatW(plane),
+					XMVectorSplatX(absPlane), XMVectorSplatY(absPlane), XMVectorSplatZ(absPlane)
+				};
+			}
+			return splat;
+		}
+
+		XMVECTOR extents = XMLoadFloat4A(&volume.m_extents);
+		std::array<XMVECTOR, 3> axisExtents = { XMVectorSplatX(extents), XMVectorSplatY(extents), XMVectorSplatZ(extents) };
+		for (size_t i = 0; i < splat.Axes.size(); ++i)
+		{
+			XMVECTOR axis = XMLoadFloat4A(&volume.m_axes[i]);
+			XMVECTOR absAxis = XMVectorAbs(axis);
+			splat.Axes[i] = {
+				XMVectorSplatX(axis), XMVectorSplatY(axis), XMVectorSplatZ(axis), XMVectorSplatW(axis),
+				XMVectorSplatX(absAxis), XMVectorSplatY(absAxis), XMVectorSplatZ(absAxis), axisExtents[i]
+			};
+		}
+		XMVECTOR center = XMLoadFloat4A(&volume.m_center);
+		XMVECTOR worldExtents = XMLoadFloat4A(&volume.m_worldExtents);
+		splat.CenterX = XMVectorSplatX(center);
+		splat.CenterY = XMVectorSplatY(center);
+		splat.CenterZ = XMVectorSplatZ(center);
+		splat.ExtentX = XMVectorSplatX(worldExtents);
+		splat.ExtentY = XMVectorSplatY(worldExtents);
+		splat.ExtentZ = XMVectorSplatZ(worldExtents);
+		return splat;
+	}
+
+	void CullingBounds::CullWords(std::span<const SplatVolume> volumes, std::span<VisibilitySet> visibilities, size_t beginWord, size_t endWord) const
+	{
+		for (size_t word = beginWord; word < endWord; ++word)
+		{
+			size_t blockBegin = word * BlocksPerWord;
+			size_t blockEnd = std::min(blockBegin + BlocksPerWord, m_blocks.size());
+
+			// Each block is loaded once and tested against every volume while it is in the cache
+			std::array<UINT64, MaxVolumesPerPass> visible = {};
+			for (size_t index = blockBegin; index < blockEnd; ++index)
+			{
+				const Block& block = m_blocks[index];
+				UINT shift = static_cast<UINT>((index - blockBegin) * LaneCount);
+				for (size_t i = 0; i < volumes.size(); ++i)
+				{
+					visible[i] |= (~GetLaneMask(volumes[i].GetOutside(block)) & 0xF) << shift;
+				}
+			}
+			for (size_t i = 0; i < volumes.size(); ++i)
+			{
+				visibilities[i].GetWords()[word] = visible[i];
+			}
+		}
+	}
+
+	void CullingBounds::Occlude(const OcclusionBuffer& buffer, VisibilitySet& visibility) const
+	{ ZoneScoped;
+		// Every range of words is written by a single job, as in Cull()
+		UINT wordCount = static_cast<UINT>(visibility.GetWords().size());
+		INSTANCE(JobSystem)->ParallelFor(wordCount, [&](UINT begin, UINT end) {
+			OccludeWords(buffer, visibility, begin, end);
+			}, WordsPerJob);
+	}
+
+	void CullingBounds::OccludeWords(const OcclusionBuffer& buffer, VisibilitySet& visibility, size_t beginWord, size_t endWord) const
+	{
+		// The elements of the matrix are replicated, so the corners of the four boxes of a block are projected together
+		const Matrix4x4& viewProj = buffer.GetViewProjMatrix();
+		std::array<std::array<XMVECTOR, 4>, 4> m;
+		for (size_t row = 0; row < 4; ++row)
+		{
+			for (size_t column = 0; column < 4; ++column)
+			{
+				m[row][column] = XMVectorReplicate(viewProj.m[row][column]);
+			}
+		}
+		auto project = [&m](FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, size_t column) {
+			return XMVectorMultiplyAdd(x, m[0][column], XMVectorMultiplyAdd(y, m[1][column], XMVectorMultiplyAdd(z, m[2][column], m[3][column])));
+			};
+
+		std::span<UINT64> words = visibility.GetWords();
+		for (size_t word = beginWord; word < endWord; ++word)
+		{
+			if (words[word] == 0)
+			{
+				continue;
+			}
+
+			size_t blockBegin = word * BlocksPerWord;
+			size_t blockEnd = std::min(blockBegin + BlocksPerWord, m_blocks.size());
+			for (size_t index = blockBegin; index < blockEnd; ++index)
+			{
+				UINT shift = static_cast<UINT>((index - blockBegin) * LaneCount);
+				UINT64 lanes = (words[word] >> shift) & 0xF;
+				if (lanes == 0)
+				{
+					continue;
+				}
+
+				const Block& block = m_blocks[index];
+				XMVECTOR centerX = LoadLanes(block.CenterX);
+				XMVECTOR centerY = LoadLanes(block.CenterY);
+				XMVECTOR centerZ = LoadLanes(block.CenterZ);
+				XMVECTOR extentX = LoadLanes(block.ExtentX);
+				XMVECTOR extentY = LoadLanes(block.ExtentY);
+				XMVECTOR extentZ = LoadLanes(block.ExtentZ);
+
+				// Screen rectangle and nearest depth of the projected corners
+				XMVECTOR minX = XMVectorReplicate(std::numeric_limits<float>::max());
+				XMVECTOR minY = minX;
+				XMVECTOR minZ = minX;
+				XMVECTOR minW = minX;
+				XMVECTOR maxX = XMVectorReplicate(-std::numeric_limits<float>::max());
+				XMVECTOR maxY = maxX;
+				for (UINT corner = 0; corner < 8; ++corner)
+				{
+					XMVECTOR x = (corner & 1) ? XMVectorAdd(centerX, extentX) : XMVectorSubtract(centerX, extentX);
+					XMVECTOR y = (corner & 2) ? XMVectorAdd(centerY, extentY) : XMVectorSubtract(centerY, extentY);
+					XMVECTOR z = (corner & 4) ? XMVectorAdd(centerZ, extentZ) : XMVectorSubtract(centerZ, extentZ);
+					XMVECTOR clipW = project(x, y, z, 3);
+					XMVECTOR reciprocalW = XMVectorReciprocal(clipW);
+					XMVECTOR ndcX = XMVectorMultiply(project(x, y, z, 0), reciprocalW);
+					XMVECTOR ndcY = XMVectorMultiply(project(x, y, z, 1), reciprocalW);
+					XMVECTOR ndcZ = XMVectorMultiply(project(x, y, z, 2), reciprocalW);
+					minX = XMVectorMin(minX, ndcX);
+					maxX = XMVectorMax(maxX, ndcX);
+					minY = XMVectorMin(minY, ndcY);
+					maxY = XMVectorMax(maxY, ndcY);
+					minZ = XMVectorMin(minZ, ndcZ);
+					minW = XMVectorMin(minW, clipW);
+				}
+
+				// Boxes reaching behind the eye do not project to a rectangle, and are kept
+				lanes &= ~GetLaneMask(XMVectorLessOrEqual(minW, XMVectorZero()));
+
+				alignas(16) float rectMinX[LaneCount], rectMinY[LaneCount], rectMaxX[LaneCount], rectMaxY[LaneCount], nearest[LaneCount];
+				StoreLanes(rectMinX, minX);
+				StoreLanes(rectMinY, minY);
+				StoreLanes(rectMaxX, maxX);
+				StoreLanes(rectMaxY, maxY);
+				StoreLanes(nearest, minZ);
+				for (UINT lane = 0; lane < LaneCount; ++lane)
+				{
+					if (((lanes >> lane) & 1) && buffer.IsOccluded(rectMinX[lane], rectMinY[lane], rectMaxX[lane], rectMaxY[lane], nearest[lane]))
+					{
+						words[word] &= ~(1ull << (shift + lane));
+					}
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
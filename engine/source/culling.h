@@ -0,0 +1,112 @@
+#pragma once
+
+#include "pch.h"
+
+namespace udsdx
+{
+	class OcclusionBuffer;
+
+	// Convex volume of a view, held by value so that building one per view and per frame does not allocate.
+	// Perspective views are bounded by their frustum planes, orthographic views by an oriented box.
+	class ViewVolume
+	{
+	public:
+		enum class Type : UINT8
+		{
+			Frustum,
+			OrientedBox,
+		};
+
+		// The planes are extracted from the view projection matrix, so the clip offset of the projection is respected
+		static ViewVolume CreateFrustum(const Matrix4x4& viewMatrix, const Matrix4x4& projMatrix);
+		// The box spans the width and height around the view axis, and the depth between the near and far planes
+		static ViewVolume CreateOrientedBox(const Matrix4x4& viewMatrix, float width, float height, float nearPlane, float farPlane);
+
+	public:
+		// Scalar test of a single box, conservative in the same way as the batched kernels
+		bool Intersects(const BoundingBox& box) const;
+		Type GetType() const { return m_type; }
+
+	private:
+		friend class CullingBounds;
+
+		Type m_type = Type::Frustum;
+
+		// Frustum only: the planes with their normals facing inwards, normalized
+		std::array<XMFLOAT4A, 6> m_planes = {};
+
+		// Oriented box only: the unit axes of the box with the center projected on them in w, and the half extents along them.
+		// The center and the half extents along the world axes add the separating axes of the tested boxes.
+		std::array<XMFLOAT4A, 3> m_axes = {};
+		XMFLOAT4A m_extents = {};
+		XMFLOAT4A m_center = {};
+		XMFLOAT4A m_worldExtents = {};
+	};
+
+	// One bit per item of a list, set if the item is visible in the view
+	class VisibilitySet
+	{
+	public:
+		void Reset(size_t count);
+		bool IsVisible(size_t index) const { return (m_words[index >> 6] >> (index & 63)) & 1; }
+		size_t GetVisibleCount() const;
+
+		std::span<UINT64> GetWords() { return m_words; }
+
+	private:
+		std::vector<UINT64> m_words;
+	};
+
+	// World space axis aligned bounds of the items of a list, stored in blocks of four lanes.
+	// The culling kernels test a whole block against a plane at once with DirectXMath vectors.
+	class CullingBounds
+	{
+	public:
+		void Resize(size_t count);
+		// Transforms the local bounds, the resulting box encloses the transformed one
+		void Set(size_t index, const BoundingBox& localBounds, const Matrix4x4& world);
+		// The item is visible in every view
+		void SetUnbounded(size_t index);
+
+		size_t GetSize() const { return m_count; }
+
+		// Writes the visibility of every item in the view. Large lists are split across the job system.
+		void Cull(const ViewVolume& volume, VisibilitySet& visibility) const;
+		// Culls against several views in a single pass over the bounds, writing the visibility of each view to the set of the same index
+		void Cull(std::span<const ViewVolume> volumes, std::span<VisibilitySet> visibilities) const;
+		// Clears the visibility of the items hidden behind the occluders of the buffer, which was rasterized for the same view
+		void Occlude(const OcclusionBuffer& buffer, VisibilitySet& visibility) const;
+
+	private:
+		static constexpr size_t LaneCount = 4;
+		// Blocks written to a single word of the visibility set
+		static constexpr size_t BlocksPerWord = 64 / LaneCount;
+		// Words of the visibility set culled by a single job
+		static constexpr UINT WordsPerJob = 64;
+		// Views tested together in one pass over the bounds
+		static constexpr size_t MaxVolumesPerPass = 4;
+		// Large enough to contain any view, small enough to keep the products with zero finite
+		static constexpr float UnboundedExtent = 1e30f;
+
+		struct alignas(16) Block
+		{
+			float CenterX[LaneCount];
+			float CenterY[LaneCount];
+			float CenterZ[LaneCount];
+			float ExtentX[LaneCount];
+			float ExtentY[LaneCount];
+			float ExtentZ[LaneCount];
+		};
+
+		// A view volume with its components replicated across the lanes, defined along with the kernels
+		struct SplatVolume;
+
+		static SplatVolume Splat(const ViewVolume& volume);
+		void CullWords(std::span<const SplatVolume> volumes, std::span<VisibilitySet> visibilities, size_t beginWord, size_t endWord) const;
+		void OccludeWords(const OcclusionBuffer& buffer, VisibilitySet& visibility, size_t beginWord, size_t endWord) const;
+
+	private:
+		std::vector<Block> m_blocks;
+		size_t m_count = 0;
+	};
+}
\ No newline at end of file
@@ -32,15 +32,15 @@ namespace udsdx
 	// Wrap Around Interpolation [-180, 180]
 	inline float LerpAngle(const float a, const float b, const float t)
 	{
-		float delta = std::fmodf((b - a + 540.0f), 360.0f) - 180.0f;
-		return std::fmodf((a + delta * t + 180.0f), 360.0f) - 180.0f;
+		float delta = std::fmod((b - a + 540.0f), 360.0f) - 180.0f;
+		return std::fmod((a + delta * t + 180.0f), 360.0f) - 180.0f;
 	}
 
 	// Wrap Around Interpolation [-, ]
 	inline float LerpAngleRadian(const float a, const float b, const float t)
 	{
-		float delta = std::fmodf((b - a + PI2 + PI), PI2) - PI;
-		return std::fmodf((a + delta * t + PI), PI2) - PI;
+		float delta = std::fmod((b - a + PI2 + PI), PI2) - PI;
+		return std::fmod((a + delta * t + PI), PI2) - PI;
 	}
 
 	static constexpr float SmoothStep(float t)
@@ -29,7 +29,9 @@ namespace udsdx
 	class PostProcessBloom;
 	class PostProcessFXAA;
 	class PostProcessOutline;
-	class BoundingCamera;
+	class VisibilitySet;
+	class StateTrackingCommandList;
+	class ConstantAllocator;
 
 	struct RenderOptions
 	{
@@ -39,6 +41,12 @@ namespace udsdx
 		bool DrawFXAA = true;
 		bool DrawOutline = true;
 		bool DrawShadowMap = true;
+		bool UseOcclusionCulling = true;
+		bool UseMeshLod = true;
+		// Fraction of a level of detail threshold the screen size must pass before the level switches
+		float LodHysteresis = 0.1f;
+		// Evaluates the poses of the far rigged renderers every few frames, and pauses the ones outside the main view
+		bool UseAnimationLod = true;
 		unsigned int ShadowMapSize = 4096u;
 		Color FogColor = Color(1.381f, 1.691f, 2.000f, 1.0f);
 		Color FogSunColor = Color(2.000f, 1.433f, 0.987f, 1.0f);
@@ -51,22 +59,27 @@ namespace udsdx
 	{
 		ID3D12Device* Device;
 		ID3D12GraphicsCommandList* CommandList;
+		// Drops the state calls of the draw loops which bind the same state again, records to CommandList
+		StateTrackingCommandList* TrackedCommandList;
+		// Constants of the frame resource, valid until the frame resource is reused
+		udsdx::ConstantAllocator* ConstantAllocator;
 		ID3D12RootSignature* RootSignature;
 		ID3D12DescriptorHeap* SRVDescriptorHeap;
 
 		DeferredRenderer* Renderer;
-		RenderOptions* RenderOptions;
+		udsdx::RenderOptions* RenderOptions;
 
 		float AspectRatio;
 		int FrameResourceIndex;
 		int RenderStageIndex;
-		const Time& Time;
+		const udsdx::Time& Time;
 
 		const D3D12_VIEWPORT& Viewport;
 		const D3D12_RECT& ScissorRect;
 
 		Camera* TargetCamera;
-		BoundingCamera* ViewFrustumWorld;
+		// Visibility of the draw items of the current pass, drawn regardless if null or if the culling is disabled
+		const VisibilitySet* Visibility;
 		bool UseFrustumCulling;
 
 		const D3D12_GPU_VIRTUAL_ADDRESS& ConstantBufferView;
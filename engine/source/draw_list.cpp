@@ -0,0 +1,116 @@
+#include "pch.h"
+#include "draw_list.h"
+#include "material.h"
+
+namespace udsdx
+{
+	UINT64 DrawList::MakeSortKey(UINT group, UINT shaderID, UINT variant, UINT textureID, UINT meshID, UINT submesh)
+	{
+		auto field = [](UINT value, UINT bits) { return static_cast<UINT64>(value) & ((1ull << bits) - 1); };
+
+		UINT64 key = field(group, GroupBits);
+		key = (key << ShaderBits) | field(shaderID, ShaderBits);
+		key = (key << VariantBits) | field(variant, VariantBits);
+		key = (key << TextureBits) | field(textureID, TextureBits);
+		key = (key << MeshBits) | field(meshID, MeshBits);
+		key = (key << SubmeshBits) | field(submesh, SubmeshBits);
+		return key << DepthBits;
+	}
+
+	UINT64 DrawList::MakeDepthBucket(float depth)
+	{
+		// The bits of a non-negative float are ordered as integers, the sign, exponent and 7 mantissa bits are kept
+		UINT bits = std::bit_cast<UINT>(std::max(depth, 0.0f));
+		return static_cast<UINT64>(bits >> (32 - DepthBits));
+	}
+
+	void DrawList::Sort()
+	{ ZoneScoped;
+		const size_t count = m_items.size();
+		if (count < 2)
+		{
+			return;
+		}
+
+		// Sorts (key, index) pairs rather than moving the items through every pass
+		m_entries.resize(count);
+		m_entriesScratch.resize(count);
+		std::array<std::array<UINT, 256>, sizeof(UINT64)> histograms = {};
+		for (size_t i = 0; i < count; ++i)
+		{
+			UINT64 key = m_items[i].SortKey;
+			m_entries[i] = { key, static_cast<UINT>(i) };
+			for (size_t digit = 0; digit < sizeof(UINT64); ++digit)
+			{
+				++histograms[digit][(key >> (digit * 8)) & 0xFF];
+			}
+		}
+
+		for (size_t digit = 0; digit < sizeof(UINT64); ++digit)
+		{
+			std::array<UINT, 256>& histogram = histograms[digit];
+
+			// Every key has the same value for the digit, the pass would not change the order
+			UINT64 firstValue = (m_entries[0].Key >> (digit * 8)) & 0xFF;
+			if (histogram[firstValue] == count)
+			{
+				continue;
+			}
+
+			UINT offset = 0;
+			for (UINT& bucket : histogram)
+			{
+				UINT bucketCount = bucket;
+				bucket = offset;
+				offset += bucketCount;
+			}
+			for (const SortEntry& entry : m_entries)
+			{
+				m_entriesScratch[histogram[(entry.Key >> (digit * 8)) & 0xFF]++] = entry;
+			}
+			m_entries.swap(m_entriesScratch);
+		}
+
+		m_sortedItems.resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			m_sortedItems[i] = m_items[m_entries[i].Index];
+		}
+		m_items.swap(m_sortedItems);
+	}
+
+	void DrawList::BuildBatches(std::span<const DrawItem> items, std::vector<DrawBatch>& batches)
+	{ ZoneScoped;
+		auto compatible = [](const DrawItem& lhs, const DrawItem& rhs) {
+			return lhs.Instancing && rhs.Instancing &&
+				lhs.Mesh == rhs.Mesh &&
+				lhs.Parameter == rhs.Parameter &&
+				lhs.Lod == rhs.Lod &&
+				lhs.PipelineState == rhs.PipelineState &&
+				lhs.Topology == rhs.Topology &&
+				lhs.DrawOutline == rhs.DrawOutline &&
+				(lhs.Material == rhs.Material || *lhs.Material == *rhs.Material);
+		};
+
+		batches.clear();
+		for (UINT index = 0; index < static_cast<UINT>(items.size()); ++index)
+		{
+			if (!batches.empty() && compatible(items[batches.back().First], items[index]))
+			{
+				++batches.back().Count;
+			}
+			else
+			{
+				batches.push_back({ index, 1 });
+			}
+		}
+	}
+
+	std::span<const DrawItem> DrawList::GetGroup(UINT group) const
+	{
+		const UINT groupShift = 64 - GroupBits;
+		auto begin = std::partition_point(m_items.begin(), m_items.end(), [=](const DrawItem& item) { return (item.SortKey >> groupShift) < group; });
+		auto end = std::partition_point(begin, m_items.end(), [=](const DrawItem& item) { return (item.SortKey >> groupShift) <= group; });
+		return std::span<const DrawItem>(begin, end);
+	}
+}
\ No newline at end of file
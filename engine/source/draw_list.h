@@ -0,0 +1,85 @@
+#pragma once
+
+#include "pch.h"
+
+namespace udsdx
+{
+	class RendererBase;
+	class ResourceObject;
+	struct Material;
+
+	struct DrawItem
+	{
+		UINT64 SortKey = 0;
+		RendererBase* Object = nullptr;
+		ID3D12PipelineState* PipelineState = nullptr;
+		ID3D12PipelineState* DeferredPipelineState = nullptr;
+		const ResourceObject* Mesh = nullptr;
+		// Live material of the renderer when queued, replaced by the copy of PrepareRender() when the frame is published
+		const udsdx::Material* Material = nullptr;
+		int Parameter = 0;
+		// Level of detail of the submesh, picked when the frame is published
+		UINT Lod = 0;
+		D3D_PRIMITIVE_TOPOLOGY Topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		bool DrawOutline = false;
+		// Whether the renderer can draw the item along with compatible items in one instanced draw
+		bool Instancing = false;
+	};
+
+	// A run of consecutive draw items which are drawn with a single instanced draw call
+	struct DrawBatch
+	{
+		UINT First = 0;
+		UINT Count = 0;
+	};
+
+	// Flat array of the draw items of a frame, ordered by their 64-bit sort keys.
+	// The storage is kept across frames, so filling and sorting it does not allocate in steady state.
+	class DrawList
+	{
+	public:
+		// Fields of the sort key, from the most significant bit.
+		// The IDs are truncated to their fields, so a collision only costs extra state changes.
+		static constexpr UINT DepthBits = 16;
+		static constexpr UINT SubmeshBits = 6;
+		static constexpr UINT MeshBits = 14;
+		static constexpr UINT TextureBits = 14;
+		static constexpr UINT VariantBits = 1;
+		static constexpr UINT ShaderBits = 12;
+		static constexpr UINT GroupBits = 1;
+
+		// The shader determines the deferred pipeline state, and the variant picks one of its pipeline states
+		static UINT64 MakeSortKey(UINT group, UINT shaderID, UINT variant, UINT textureID, UINT meshID, UINT submesh);
+		// Monotonic in the depth for non-negative values, so the items are ordered front to back
+		static UINT64 MakeDepthBucket(float depth);
+
+	public:
+		void Clear() { m_items.clear(); }
+		void Add(const DrawItem& item) { m_items.emplace_back(item); }
+
+		// Sorts the items by their keys with a least significant digit radix sort
+		void Sort();
+
+		// Splits the items into runs which can be drawn with one instanced draw each.
+		// Items in a run share the mesh, submesh, level of detail, material, pipeline state, topology and stencil, and all allow instancing.
+		static void BuildBatches(std::span<const DrawItem> items, std::vector<DrawBatch>& batches);
+
+		std::span<DrawItem> GetItems() { return m_items; }
+		std::span<const DrawItem> GetItems() const { return m_items; }
+		// The items of the render group, which are contiguous once sorted
+		std::span<const DrawItem> GetGroup(UINT group) const;
+		size_t GetSize() const { return m_items.size(); }
+
+	private:
+		struct SortEntry
+		{
+			UINT64 Key;
+			UINT Index;
+		};
+
+		std::vector<DrawItem> m_items;
+		std::vector<DrawItem> m_sortedItems;
+		std::vector<SortEntry> m_entries;
+		std::vector<SortEntry> m_entriesScratch;
+	};
+}
\ No newline at end of file
@@ -10,6 +10,7 @@ namespace udsdx
 			IID_PPV_ARGS(&m_commandListAllocator)
 		));
 		m_objectCB = std::make_unique<UploadBuffer<PassConstants>>(device, 1, true);
+		m_constantAllocator = std::make_unique<ConstantAllocator>(device);
 	}
 
 	FrameResource::~FrameResource()
@@ -27,6 +28,11 @@ namespace udsdx
 		return m_objectCB.get();
 	}
 
+	ConstantAllocator* FrameResource::GetConstantAllocator() const
+	{
+		return m_constantAllocator.get();
+	}
+
 	UINT64 FrameResource::GetFence() const
 	{
 		return m_fence;
@@ -35,5 +41,6 @@ namespace udsdx
 	void FrameResource::SetFence(UINT64 fence)
 	{
 		m_fence = fence;
+		m_constantAllocator->Retire(fence);
 	}
 }
\ No newline at end of file
@@ -1,10 +1,20 @@
 #pragma once
 
 #include "pch.h"
+#include "constant_allocator.h"
 
 namespace udsdx
 {
 	struct ObjectConstants
+	{
+		Matrix4x4 World = Matrix4x4::Identity;
+		Matrix4x4 PrevWorld = Matrix4x4::Identity;
+		// Nonzero if the transforms are read from the instance stream instead
+		UINT Instanced = 0;
+	};
+
+	// Element of the per-instance vertex stream, in slot 1. Not transposed, as the rows are fed as vertex attributes.
+	struct InstanceData
 	{
 		Matrix4x4 World = Matrix4x4::Identity;
 		Matrix4x4 PrevWorld = Matrix4x4::Identity;
@@ -56,13 +66,16 @@ namespace udsdx
 	public:
 		ID3D12CommandAllocator* GetCommandListAllocator() const;
 		UploadBuffer<PassConstants>* GetObjectCB() const;
+		ConstantAllocator* GetConstantAllocator() const;
 
 		UINT64 GetFence() const;
+		// Also retires the constants allocated for the frame, until the fence is completed
 		void SetFence(UINT64 fence);
 
 	private:
 		ComPtr<ID3D12CommandAllocator> m_commandListAllocator;
 		std::unique_ptr<UploadBuffer<PassConstants>> m_objectCB = nullptr;
+		std::unique_ptr<ConstantAllocator> m_constantAllocator = nullptr;
 
 		UINT64 m_fence = 0;
 	};
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "frame_resource.h"
+#include "state_tracking_command_list.h"
 #include "inline_mesh_renderer.h"
 #include "shader.h"
 #include "material.h"
@@ -12,10 +13,10 @@ namespace udsdx
 	{
 		RendererBase::PostUpdate(time, scene);
 
-		scene.EnqueueRenderObject(this, m_renderGroup, m_materials[0].GetShader()->DefaultPipelineState(), m_materials[0].GetShader()->DeferredPipelineState(), 0);
+		scene.EnqueueRenderObject(this, m_renderGroup, m_materials[0], m_materials[0].GetShader()->DefaultPipelineState(), nullptr, 0);
 		if (m_castShadow == true)
 		{
-			scene.EnqueueRenderShadowObject(this, m_materials[0].GetShader()->ShadowPipelineState(), 0);
+			scene.EnqueueRenderShadowObject(this, m_materials[0], m_materials[0].GetShader()->ShadowPipelineState(), nullptr, 0);
 		}
 	}
 
@@ -26,13 +27,20 @@ namespace udsdx
 		objectConstants.PrevWorld = m_prevTransformCache.Transpose();
 
 		param.CommandList->SetGraphicsRoot32BitConstants(RootParam::PerObjectCBV, sizeof(ObjectConstants) / 4, &objectConstants, 0);
-		param.CommandList->SetGraphicsRootDescriptorTable(RootParam::SrcTexSRV_0, m_materials[0].GetSourceTexture()->GetSrvGpu());
+		param.TrackedCommandList->SetGraphicsRootDescriptorTable(RootParam::SrcTexSRV_0, m_renderMaterials[0].GetSourceTexture()->GetSrvGpu());
 
-		param.CommandList->IASetVertexBuffers(0, 0, nullptr);
-		param.CommandList->IASetIndexBuffer(nullptr);
-		param.CommandList->IASetPrimitiveTopology(m_topology);
+		param.TrackedCommandList->IASetVertexBuffers(0, 0, nullptr);
+		param.TrackedCommandList->IASetIndexBuffer(nullptr);
+		param.TrackedCommandList->IASetPrimitiveTopology(m_renderTopology);
 
-		param.CommandList->DrawInstanced(m_vertexCount, 1, 0, 0);
+		param.CommandList->DrawInstanced(m_renderVertexCount, 1, 0, 0);
+	}
+
+	void InlineMeshRenderer::PrepareRender(int frameResourceIndex, ConstantAllocator& constantAllocator)
+	{
+		RendererBase::PrepareRender(frameResourceIndex, constantAllocator);
+
+		m_renderVertexCount = m_vertexCount;
 	}
 
 	void InlineMeshRenderer::SetVertexCount(unsigned int value)
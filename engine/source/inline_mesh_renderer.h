@@ -10,6 +10,7 @@ namespace udsdx
 	public:
 		virtual void PostUpdate(const Time& time, Scene& scene) override;
 		virtual void Render(RenderParam& param, int parameter) override;
+		virtual void PrepareRender(int frameResourceIndex, ConstantAllocator& constantAllocator) override;
 
 	public:
 		void SetVertexCount(unsigned int value);
@@ -17,5 +18,7 @@ namespace udsdx
 
 	public:
 		unsigned int m_vertexCount = 0;
+		// Vertex count read by Render(), copied from the live one when the frame is published
+		unsigned int m_renderVertexCount = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "pch.h"
+#include "job_system.h"
+
+namespace udsdx
+{
+	thread_local int JobSystem::t_workerIndex = -1;
+
+	bool JobSystem::WorkStealingQueue::Push(Job* job)
+	{
+		INT64 bottom = m_bottom.load(std::memory_order_relaxed);
+		INT64 top = m_top.load(std::memory_order_acquire);
+		if (bottom - top >= static_cast<INT64>(QueueCapacity))
+		{
+			return false;
+		}
+
+		m_jobs[bottom & (QueueCapacity - 1)].store(job, std::memory_order_relaxed);
+		m_bottom.store(bottom + 1, std::memory_order_release);
+		return true;
+	}
+
+	JobSystem::Job* JobSystem::WorkStealingQueue::Pop()
+	{
+		INT64 bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+		m_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		INT64 top = m_top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			// The queue is empty
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Job* job = m_jobs[bottom & (QueueCapacity - 1)].load(std::memory_order_relaxed);
+		if (top == bottom)
+		{
+			// The last job, which a thief may be taking at the same time
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				job = nullptr;
+			}
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	JobSystem::Job* JobSystem::WorkStealingQueue::Steal()
+	{
+		INT64 top = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		INT64 bottom = m_bottom.load(std::memory_order_acquire);
+
+		if (top >= bottom)
+		{
+			return nullptr;
+		}
+
+		Job* job = m_jobs[top & (QueueCapacity - 1)].load(std::memory_order_relaxed);
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			// Lost the race against the owner or another thief
+			return nullptr;
+		}
+		return job;
+	}
+
+	JobSystem::JobSystem() : JobSystem(std::thread::hardware_concurrency())
+	{
+	}
+
+	JobSystem::JobSystem(UINT workerCount)
+	{
+		workerCount = std::max(workerCount, 1u);
+		for (UINT i = 0; i < workerCount; ++i)
+		{
+			m_workers.emplace_back(std::make_unique<Worker>());
+		}
+
+		t_workerIndex = 0;
+		for (UINT i = 1; i < workerCount; ++i)
+		{
+			m_threads.emplace_back(&JobSystem::WorkerMain, this, i);
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		m_running.store(false);
+		m_wakeCounter.fetch_add(1);
+		m_wakeCounter.notify_all();
+
+		for (std::thread& thread : m_threads)
+		{
+			thread.join();
+		}
+	}
+
+	void JobSystem::Wait(JobCounter& counter)
+	{ ZoneScoped;
+		while (counter.Pending.load(std::memory_order_acquire) > 0)
+		{
+			if (Job* job = FindJob())
+			{
+				Execute(job);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	JobSystem::Job* JobSystem::AllocateJob()
+	{
+		if (t_workerIndex < 0)
+		{
+			return nullptr;
+		}
+
+		// A job still in flight after a full turn of the ring is not overwritten, the caller runs inline instead.
+		Worker& worker = *m_workers[t_workerIndex];
+		Job& job = worker.Jobs[worker.NextJob++ & (QueueCapacity - 1)];
+		if (job.InUse.load(std::memory_order_acquire))
+		{
+			return nullptr;
+		}
+		job.InUse.store(true, std::memory_order_relaxed);
+		return &job;
+	}
+
+	void JobSystem::Submit(Job* job)
+	{
+		if (!m_workers[t_workerIndex]->Queue.Push(job))
+		{
+			Execute(job);
+			return;
+		}
+
+		m_wakeCounter.fetch_add(1);
+		if (m_sleepingCount.load() > 0)
+		{
+			m_wakeCounter.notify_one();
+		}
+	}
+
+	JobSystem::Job* JobSystem::FindJob()
+	{
+		Worker& worker = *m_workers[t_workerIndex];
+		if (Job* job = worker.Queue.Pop())
+		{
+			return job;
+		}
+
+		// Steal from the other workers, starting after the last successful victim
+		const UINT workerCount = GetWorkerCount();
+		for (UINT i = 0; i < workerCount; ++i)
+		{
+			UINT victim = (worker.NextVictim + i) % workerCount;
+			if (victim == static_cast<UINT>(t_workerIndex))
+			{
+				continue;
+			}
+			if (Job* job = m_workers[victim]->Queue.Steal())
+			{
+				worker.NextVictim = victim;
+				return job;
+			}
+		}
+		return nullptr;
+	}
+
+	void JobSystem::Execute(Job* job)
+	{
+		job->Invoke(*job);
+
+		JobCounter* counter = job->Counter;
+		job->InUse.store(false, std::memory_order_release);
+		counter->Pending.fetch_sub(1, std::memory_order_release);
+	}
+
+	void JobSystem::WorkerMain(UINT workerIndex)
+	{
+		t_workerIndex = static_cast<int>(workerIndex);
+
+		while (m_running.load(std::memory_order_acquire))
+		{
+			// Reading the counter before searching ensures a submission in between is not missed
+			UINT wakeCounter = m_wakeCounter.load();
+			if (Job* job = FindJob())
+			{
+				Execute(job);
+				continue;
+			}
+
+			m_sleepingCount.fetch_add(1);
+			m_wakeCounter.wait(wakeCounter);
+			m_sleepingCount.fetch_sub(1);
+		}
+	}
+}
\ No newline at end of file
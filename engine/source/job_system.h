@@ -0,0 +1,147 @@
+#pragma once
+
+#include "pch.h"
+
+namespace udsdx
+{
+	// Number of jobs dispatched with the counter which have not finished yet.
+	// A job can dispatch child jobs with its own counter and wait on it, which forms a fork-join.
+	struct JobCounter
+	{
+		std::atomic<UINT> Pending = 0;
+	};
+
+	// Work-stealing scheduler with a fixed set of worker threads.
+	// The thread which creates the instance is registered as worker 0 and executes jobs while waiting.
+	// Jobs dispatched from threads which are not registered run inline.
+	class JobSystem
+	{
+	private:
+		static constexpr UINT QueueCapacity = 4096;
+		static constexpr size_t JobStorageSize = 64;
+
+		struct Job
+		{
+			void (*Invoke)(Job& job) = nullptr;
+			JobCounter* Counter = nullptr;
+			std::atomic<bool> InUse = false;
+			alignas(std::max_align_t) std::byte Storage[JobStorageSize];
+		};
+
+		// Chase-Lev deque. The owner pushes and pops at the bottom, other workers steal from the top.
+		class WorkStealingQueue
+		{
+		public:
+			bool Push(Job* job);
+			Job* Pop();
+			Job* Steal();
+
+		private:
+			alignas(64) std::atomic<INT64> m_top = 0;
+			alignas(64) std::atomic<INT64> m_bottom = 0;
+			std::array<std::atomic<Job*>, QueueCapacity> m_jobs;
+		};
+
+		struct Worker
+		{
+			WorkStealingQueue Queue;
+			// Jobs are recycled in a ring, and skipped while they are still in flight
+			std::array<Job, QueueCapacity> Jobs;
+			UINT NextJob = 0;
+			UINT NextVictim = 0;
+		};
+
+	public:
+		JobSystem();
+		// Starts workerCount - 1 threads next to the calling one, regardless of the number of hardware threads
+		explicit JobSystem(UINT workerCount);
+		JobSystem(const JobSystem& rhs) = delete;
+		JobSystem& operator=(const JobSystem& rhs) = delete;
+		~JobSystem();
+
+	public:
+		template <typename Function_T>
+		void Dispatch(JobCounter& counter, Function_T&& function)
+		{
+			using Callable_T = std::decay_t<Function_T>;
+			static_assert(sizeof(Callable_T) <= JobStorageSize, "The captures of the job are too large");
+			static_assert(alignof(Callable_T) <= alignof(std::max_align_t));
+
+			counter.Pending.fetch_add(1, std::memory_order_relaxed);
+
+			Job* job = AllocateJob();
+			if (job == nullptr)
+			{
+				function();
+				counter.Pending.fetch_sub(1, std::memory_order_release);
+				return;
+			}
+
+			new (job->Storage) Callable_T(std::forward<Function_T>(function));
+			job->Invoke = [](Job& job) {
+				Callable_T* callable = std::launder(reinterpret_cast<Callable_T*>(job.Storage));
+				(*callable)();
+				callable->~Callable_T();
+			};
+			job->Counter = &counter;
+			Submit(job);
+		}
+
+		// Executes other jobs until every job of the counter has finished.
+		void Wait(JobCounter& counter);
+
+		// Calls function(begin, end) for consecutive ranges covering [0, count), and waits for all of them.
+		// If grainSize is 0, the ranges are sized to give every worker a few of them to balance the load.
+		template <typename Function_T>
+		void ParallelFor(UINT count, Function_T&& function, UINT grainSize = 0)
+		{
+			if (count == 0)
+			{
+				return;
+			}
+			if (grainSize == 0)
+			{
+				grainSize = std::max(count / (GetWorkerCount() * GrainsPerWorker), 1u);
+			}
+			if (count <= grainSize || t_workerIndex < 0)
+			{
+				function(0u, count);
+				return;
+			}
+
+			JobCounter counter;
+			for (UINT begin = grainSize; begin < count; begin += grainSize)
+			{
+				UINT end = std::min(begin + grainSize, count);
+				Dispatch(counter, [&function, begin, end]() { function(begin, end); });
+			}
+			// The calling thread takes the first range, and helps with the others afterwards
+			function(0u, grainSize);
+			Wait(counter);
+		}
+
+		UINT GetWorkerCount() const { return static_cast<UINT>(m_workers.size()); }
+		// Whether the calling thread is registered, so that ParallelFor spreads its ranges across the workers from it
+		static bool IsWorkerThread() { return t_workerIndex >= 0; }
+
+	private:
+		static constexpr UINT GrainsPerWorker = 4;
+
+		Job* AllocateJob();
+		void Submit(Job* job);
+		Job* FindJob();
+		void Execute(Job* job);
+		void WorkerMain(UINT workerIndex);
+
+	private:
+		static thread_local int t_workerIndex;
+
+		std::vector<std::unique_ptr<Worker>> m_workers;
+		std::vector<std::thread> m_threads;
+		std::atomic<bool> m_running = true;
+
+		// Incremented on every submission, sleeping workers wait for it to change
+		std::atomic<UINT> m_wakeCounter = 0;
+		std::atomic<UINT> m_sleepingCount = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "pch.h"
+#include "linear_allocator.h"
+
+namespace udsdx
+{
+	LinearAllocator::LinearAllocator(UINT64 pageSize, UINT64 alignment) : m_pageSize(pageSize), m_alignment(alignment)
+	{
+		assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+		assert(alignment <= pageSize);
+	}
+
+	LinearAllocator::Allocation LinearAllocator::Allocate(UINT64 size)
+	{
+		if (size > m_pageSize)
+		{
+			throw std::runtime_error("Allocation is larger than a page of the linear allocator");
+		}
+
+		UINT64 offset = (m_offset + m_alignment - 1) & ~(m_alignment - 1);
+		if (offset + size > m_pageSize)
+		{
+			++m_page;
+			m_pageCount = std::max(m_pageCount, m_page + 1);
+			offset = 0;
+		}
+
+		m_offset = offset + size;
+		return Allocation{ m_page, offset };
+	}
+
+	void LinearAllocator::Retire(UINT64 fence)
+	{
+		m_retiredFence = fence;
+	}
+
+	bool LinearAllocator::Reclaim(UINT64 completedFence)
+	{
+		if (completedFence < m_retiredFence)
+		{
+			return false;
+		}
+
+		m_page = 0;
+		m_offset = 0;
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "pch.h"
+
+namespace udsdx
+{
+	// Bump allocator over a chain of fixed size pages, only handing out offsets, so it does not depend on the memory it manages.
+	// An allocation which does not fit the rest of a page starts the next one. Everything is freed at once by Reclaim(),
+	// once the GPU completed the fence of the last frame which used the allocations.
+	class LinearAllocator
+	{
+	public:
+		struct Allocation
+		{
+			UINT Page;
+			UINT64 Offset;
+		};
+
+	public:
+		// The alignment must be a power of two, and at most the page size
+		LinearAllocator(UINT64 pageSize, UINT64 alignment);
+
+	public:
+		// Throws if the size exceeds a page
+		Allocation Allocate(UINT64 size);
+
+		// Marks the allocations made so far as in use until the fence is completed
+		void Retire(UINT64 fence);
+		// Frees every allocation if the fence they were retired with is completed, and fails otherwise
+		bool Reclaim(UINT64 completedFence);
+
+		UINT64 GetPageSize() const { return m_pageSize; }
+		// Number of pages used at most between two reclamations, which the owner has to provide memory for
+		UINT GetPageCount() const { return m_pageCount; }
+		// Bytes spanned by the allocations since the last reclamation, including the padding and the unused ends of the pages
+		UINT64 GetUsedSize() const { return m_page * m_pageSize + m_offset; }
+		UINT64 GetRetiredFence() const { return m_retiredFence; }
+
+	private:
+		UINT64 m_pageSize;
+		UINT64 m_alignment;
+
+		UINT m_page = 0;
+		UINT64 m_offset = 0;
+		UINT m_pageCount = 1;
+
+		UINT64 m_retiredFence = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#include "pch.h"
+#include "lod_selector.h"
+
+namespace udsdx
+{
+	float LodSelector::GetScreenSize(const Vector3& center, float radius, const Vector3& eyePosition, const Matrix4x4& projMatrix)
+	{
+		// The row of the projection scaling the height, over the view depth for a perspective projection
+		float scale = projMatrix._22;
+		if (projMatrix._34 == 0.0f)
+		{
+			return radius * scale;
+		}
+
+		// From inside the sphere, it covers the whole screen
+		float distance = std::max(Vector3::Distance(center, eyePosition), radius);
+		return radius * scale / distance;
+	}
+
+	UINT LodSelector::Select(std::span<const float> lodScreenSizes, float screenSize, UINT currentLod, float hysteresis)
+	{
+		// The coarsest level the size is clearly below, and the coarsest one it may still be drawn at
+		UINT coarserLod = 0;
+		UINT finerLod = 0;
+		for (float threshold : lodScreenSizes)
+		{
+			coarserLod += screenSize < threshold * (1.0f - hysteresis) ? 1 : 0;
+			finerLod += screenSize < threshold * (1.0f + hysteresis) ? 1 : 0;
+		}
+		return std::clamp(currentLod, coarserLod, finerLod);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "pch.h"
+
+namespace udsdx
+{
+	// Picks the level of detail of a mesh from the projected size of its bounding sphere
+	class LodSelector
+	{
+	public:
+		// Fraction of the screen height covered by the diameter of the sphere, for a perspective or an orthographic projection
+		static float GetScreenSize(const Vector3& center, float radius, const Vector3& eyePosition, const Matrix4x4& projMatrix);
+
+		// Level whose screen size range holds the size, given the sizes below which each level after the base one is drawn, in decreasing order.
+		// The current level is kept until the size passes a threshold by the hysteresis fraction, so a mesh resting near one does not switch back and forth.
+		static UINT Select(std::span<const float> lodScreenSizes, float screenSize, UINT currentLod, float hysteresis);
+	};
+}
\ No newline at end of file
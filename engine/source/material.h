@@ -22,6 +22,8 @@ namespace udsdx
 		UINT GetTextureCount() const;
 		Texture* GetSourceTexture(UINT index = 0) const;
 
+		bool operator==(const Material& rhs) const = default;
+
 	private:
 		Shader* m_shader = nullptr;
 		std::array<Texture*, NumTextureSlots> m_mainTex = {};
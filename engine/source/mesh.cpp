@@ -72,6 +72,8 @@ namespace udsdx
 			file.read(reinterpret_cast<char*>(&indices[i]), sizeof(UINT));
 		}
 
+		ReadLods(file);
+
 		CreateBuffers<Vertex>(vertices, indices);
 		BoundingBox::CreateFromPoints(m_bounds, vertices.size(), &vertices[0].position, sizeof(Vertex));
 	}
@@ -38,6 +38,43 @@ namespace udsdx
 		return m_bounds;
 	}
 
+	std::span<const BYTE> MeshBase::GetVertexData() const
+	{
+		return { static_cast<const BYTE*>(m_vertexBufferCPU->GetBufferPointer()), m_vertexBufferByteSize };
+	}
+
+	std::span<const UINT> MeshBase::GetIndexData() const
+	{
+		return { static_cast<const UINT*>(m_indexBufferCPU->GetBufferPointer()), m_indexBufferByteSize / sizeof(UINT) };
+	}
+
+	UINT MeshBase::GetVertexByteStride() const
+	{
+		return m_vertexByteStride;
+	}
+
+	void MeshBase::ReadLods(std::istream& stream)
+	{
+		// Files exported without levels of detail end here
+		size_t lodCount = 0;
+		if (!stream.read(reinterpret_cast<char*>(&lodCount), sizeof(size_t)))
+		{
+			return;
+		}
+
+		m_lodScreenSizes.resize(lodCount);
+		stream.read(reinterpret_cast<char*>(m_lodScreenSizes.data()), lodCount * sizeof(float));
+		for (Submesh& submesh : m_submeshes)
+		{
+			submesh.Lods.resize(lodCount);
+			for (SubmeshLod& lod : submesh.Lods)
+			{
+				stream.read(reinterpret_cast<char*>(&lod.IndexCount), sizeof(UINT));
+				stream.read(reinterpret_cast<char*>(&lod.StartIndexLocation), sizeof(UINT));
+			}
+		}
+	}
+
 	void MeshBase::UploadBuffers(ID3D12Device* device, ID3D12GraphicsCommandList* commandList)
 	{
 		// Make sure buffers are uploaded to the CPU.
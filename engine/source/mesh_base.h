@@ -5,6 +5,12 @@
 
 namespace udsdx
 {
+	struct SubmeshLod
+	{
+		UINT IndexCount = 0;
+		UINT StartIndexLocation = 0;
+	};
+
 	struct Submesh
 	{
 		// For Regular Mesh
@@ -12,6 +18,8 @@ namespace udsdx
 		UINT IndexCount = 0;
 		UINT StartIndexLocation = 0;
 		UINT BaseVertexLocation = 0;
+		// Index ranges of the coarser levels of detail, over the same vertices
+		std::vector<SubmeshLod> Lods;
 
 		// For Rigged Mesh
 		UINT NodeID = 0;
@@ -21,6 +29,12 @@ namespace udsdx
 		// Metadata
 		std::string DiffuseTexturePath = {};
 		std::string NormalTexturePath = {};
+
+		// Index range of the level of detail, level 0 being the full submesh. Levels past the coarsest one are clamped to it.
+		SubmeshLod GetLod(UINT lod) const
+		{
+			return lod == 0 || Lods.empty() ? SubmeshLod{ IndexCount, StartIndexLocation } : Lods[std::min<size_t>(lod, Lods.size()) - 1];
+		}
 	};
 
 	class MeshBase : public ResourceObject
@@ -37,11 +51,23 @@ namespace udsdx
 		const std::vector<Submesh>& GetSubmeshes() const;
 		const BoundingBox& GetBounds() const;
 
+		// System memory copies of the buffers, read on the CPU by the occlusion culling
+		std::span<const BYTE> GetVertexData() const;
+		std::span<const UINT> GetIndexData() const;
+		UINT GetVertexByteStride() const;
+
+		// Projected sizes of the bounding sphere, as fractions of the screen height, below which each level of detail after the base one is drawn
+		std::span<const float> GetLodScreenSizes() const { return m_lodScreenSizes; }
+
 	public:
 		template <typename TVertex>
 		void CreateBuffers(const std::vector<TVertex>& vertices, const std::vector<UINT>& indices);
 		void UploadBuffers(ID3D12Device* device, ID3D12GraphicsCommandList* commandList);
 
+	protected:
+		// Reads the levels of detail the files may end with, after the indices
+		void ReadLods(std::istream& stream);
+
 	protected:
 		std::vector<Submesh> m_submeshes;
 
@@ -50,6 +76,7 @@ namespace udsdx
 		UINT m_indexBufferByteSize = 0;
 
 		BoundingBox m_bounds;
+		std::vector<float> m_lodScreenSizes;
 
 		// System memory copies.  Use Blobs because the vertex/index format can be generic.
 		// It is up to the client to cast appropriately.  
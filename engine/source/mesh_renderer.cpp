@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "frame_resource.h"
+#include "state_tracking_command_list.h"
 #include "mesh_renderer.h"
 #include "scene_object.h"
 #include "transform.h"
@@ -12,6 +13,20 @@
 
 namespace udsdx
 {
+	MeshRenderer::MeshRenderer()
+	{
+		m_instancing = true;
+	}
+
+	void MeshRenderer::PostUpdateAll(std::span<MeshRenderer*> renderers, const Time& time, Scene& scene)
+	{ ZoneScoped;
+		// Qualified calls are resolved statically, so the loop runs without virtual dispatch
+		for (MeshRenderer* renderer : renderers)
+		{
+			renderer->MeshRenderer::PostUpdate(time, scene);
+		}
+	}
+
 	void MeshRenderer::PostUpdate(const Time& time, Scene& scene)
 	{
 		RendererBase::PostUpdate(time, scene);
@@ -19,47 +34,74 @@ namespace udsdx
 		int submeshCount = m_mesh ? static_cast<int>(std::min(m_mesh->GetSubmeshes().size(), m_materials.size())) : 0;
 		for (int i = 0; i < submeshCount; ++i)
 		{
-			scene.EnqueueRenderObject(this, m_renderGroup, m_materials[i].GetShader()->DefaultPipelineState(), m_materials[i].GetShader()->DeferredPipelineState(), i);
+			scene.EnqueueRenderObject(this, m_renderGroup, m_materials[i], m_materials[i].GetShader()->DefaultPipelineState(), m_mesh, i);
 			if (m_castShadow == true)
 			{
-				scene.EnqueueRenderShadowObject(this, m_materials[i].GetShader()->ShadowPipelineState(), i);
+				scene.EnqueueRenderShadowObject(this, m_materials[i], m_materials[i].GetShader()->ShadowPipelineState(), m_mesh, i);
 			}
 		}
 	}
 
 	void MeshRenderer::Render(RenderParam& param, int parameter)
 	{
-		if (param.UseFrustumCulling)
-		{
-			// Perform frustum culling
-			BoundingBox boundsWorld;
-			m_mesh->GetBounds().Transform(boundsWorld, m_transformCache);
-			if (param.ViewFrustumWorld->Contains(boundsWorld) == ContainmentType::DISJOINT)
-			{
-				return;
-			}
-		}
-
 		ObjectConstants objectConstants;
 		objectConstants.World = m_transformCache.Transpose();
 		objectConstants.PrevWorld = m_prevTransformCache.Transpose();
 
 		param.CommandList->SetGraphicsRoot32BitConstants(RootParam::PerObjectCBV, sizeof(ObjectConstants) / 4, &objectConstants, 0);
+		RecordDraw(param, parameter, 1);
+	}
+
+	void MeshRenderer::RenderInstanced(RenderParam& param, int parameter, UINT instanceCount)
+	{
+		// The transforms come from the instance stream bound by the scene
+		ObjectConstants objectConstants;
+		objectConstants.Instanced = 1;
+
+		param.CommandList->SetGraphicsRoot32BitConstants(RootParam::PerObjectCBV, sizeof(ObjectConstants) / 4, &objectConstants, 0);
+		RecordDraw(param, parameter, instanceCount);
+	}
 
-		param.CommandList->IASetVertexBuffers(0, 1, &m_mesh->VertexBufferView());
-		param.CommandList->IASetIndexBuffer(&m_mesh->IndexBufferView());
-		param.CommandList->IASetPrimitiveTopology(m_topology);
+	void MeshRenderer::PrepareRender(int frameResourceIndex, ConstantAllocator& constantAllocator)
+	{
+		RendererBase::PrepareRender(frameResourceIndex, constantAllocator);
+
+		m_renderMesh = m_mesh;
+	}
 
-		for (UINT textureSrcIndex = 0; textureSrcIndex < m_materials[parameter].GetTextureCount(); ++textureSrcIndex)
+	void MeshRenderer::RecordDraw(RenderParam& param, int parameter, UINT instanceCount)
+	{
+		param.TrackedCommandList->IASetVertexBuffers(0, 1, &m_renderMesh->VertexBufferView());
+		param.TrackedCommandList->IASetIndexBuffer(&m_renderMesh->IndexBufferView());
+		param.TrackedCommandList->IASetPrimitiveTopology(m_renderTopology);
+
+		const Material& material = m_renderMaterials[parameter];
+		for (UINT textureSrcIndex = 0; textureSrcIndex < material.GetTextureCount(); ++textureSrcIndex)
 		{
-			const Texture* texture = m_materials[parameter].GetSourceTexture(textureSrcIndex);
+			const Texture* texture = material.GetSourceTexture(textureSrcIndex);
 			if (texture != nullptr)
 			{
-				param.CommandList->SetGraphicsRootDescriptorTable(RootParam::SrcTexSRV_0 + textureSrcIndex, texture->GetSrvGpu());
+				param.TrackedCommandList->SetGraphicsRootDescriptorTable(RootParam::SrcTexSRV_0 + textureSrcIndex, texture->GetSrvGpu());
 			}
 		}
-		const auto& submesh = m_mesh->GetSubmeshes()[parameter];
-		param.CommandList->DrawIndexedInstanced(submesh.IndexCount, 1, submesh.StartIndexLocation, submesh.BaseVertexLocation, 0);
+		const auto& submesh = m_renderMesh->GetSubmeshes()[parameter];
+		SubmeshLod lod = submesh.GetLod(m_lod);
+		param.CommandList->DrawIndexedInstanced(lod.IndexCount, instanceCount, lod.StartIndexLocation, submesh.BaseVertexLocation, 0);
+	}
+
+	const BoundingBox* MeshRenderer::GetLocalBounds() const
+	{
+		return m_mesh ? &m_mesh->GetBounds() : nullptr;
+	}
+
+	const MeshBase* MeshRenderer::GetOccluderMesh() const
+	{
+		return m_occluder ? m_mesh : nullptr;
+	}
+
+	const MeshBase* MeshRenderer::GetLodMesh() const
+	{
+		return m_mesh;
 	}
 
 	void MeshRenderer::OnDrawGizmos(const Camera* target)
@@ -9,16 +9,38 @@ namespace udsdx
 
 	class MeshRenderer : public RendererBase
 	{
+	public:
+		// Batch entry point picked up by the ComponentRegistry, replacing the per-object PostUpdate() calls of this type
+		static void PostUpdateAll(std::span<MeshRenderer*> renderers, const Time& time, Scene& scene);
+
+	public:
+		MeshRenderer();
+
 	public:
 		virtual void PostUpdate(const Time& time, Scene& scene) override;
 		virtual void Render(RenderParam& param, int instances = 1) override;
+		virtual void RenderInstanced(RenderParam& param, int parameter, UINT instanceCount) override;
+		virtual void PrepareRender(int frameResourceIndex, ConstantAllocator& constantAllocator) override;
+		virtual const BoundingBox* GetLocalBounds() const override;
+		virtual const MeshBase* GetOccluderMesh() const override;
+		virtual const MeshBase* GetLodMesh() const override;
 		virtual void OnDrawGizmos(const Camera* target) override;
 
 	public:
 		void SetMesh(Mesh* mesh);
 		Mesh* GetMesh() const;
 
+		// Large opaque meshes, such as walls and terrain chunks, are worth flagging as occluders
+		void SetOccluder(bool value) { m_occluder = value; }
+		bool GetOccluder() const { return m_occluder; }
+
+	protected:
+		void RecordDraw(RenderParam& param, int parameter, UINT instanceCount);
+
 	protected:
 		Mesh* m_mesh = nullptr;
+		// Mesh read by Render(), copied from the live one when the frame is published
+		Mesh* m_renderMesh = nullptr;
+		bool m_occluder = false;
 	};
 }
\ No newline at end of file
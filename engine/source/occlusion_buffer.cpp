@@ -0,0 +1,274 @@
+#include "pch.h"
+#include "occlusion_buffer.h"
+#include "job_system.h"
+
+namespace udsdx
+{
+	OcclusionBuffer::OcclusionBuffer()
+	{
+		size_t size = 0;
+		for (UINT level = 0; level < LevelCount; ++level)
+		{
+			m_levelOffsets[level] = size;
+			size += static_cast<size_t>(GetLevelWidth(level)) * GetLevelHeight(level);
+		}
+		m_depth.resize(size, 1.0f);
+	}
+
+	void OcclusionBuffer::Reset(const Matrix4x4& viewProjMatrix)
+	{
+		m_viewProjMatrix = viewProjMatrix;
+		m_occluders.clear();
+	}
+
+	void OcclusionBuffer::AddOccluder(std::span<const BYTE> vertices, UINT vertexByteStride, std::span<const UINT> indices, UINT baseVertexLocation, const Matrix4x4& world)
+	{
+		size_t firstTriangle = 0;
+		if (!m_occluders.empty())
+		{
+			const Occluder& last = m_occluders.back();
+			firstTriangle = last.FirstTriangle + last.Indices.size() / 3 * 2;
+		}
+		m_occluders.push_back({ vertices, vertexByteStride, indices, baseVertexLocation, world, firstTriangle, 0 });
+	}
+
+	void OcclusionBuffer::Rasterize()
+	{ ZoneScoped;
+		if (!m_occluders.empty())
+		{
+			const Occluder& last = m_occluders.back();
+			m_triangles.resize(last.FirstTriangle + last.Indices.size() / 3 * 2);
+		}
+
+		// Each occluder writes its own range of the triangles
+		JobSystem* jobSystem = INSTANCE(JobSystem);
+		jobSystem->ParallelFor(static_cast<UINT>(m_occluders.size()), [this](UINT begin, UINT end) {
+			for (UINT index = begin; index < end; ++index)
+			{
+				SetupTriangles(m_occluders[index]);
+			}
+			});
+
+		// Each band owns its rows, so the bands are rasterized without synchronization
+		jobSystem->ParallelFor(Height / BandHeight, [this](UINT begin, UINT end) {
+			for (UINT band = begin; band < end; ++band)
+			{
+				RasterizeBand(band);
+			}
+			}, 1);
+
+		BuildHierarchy();
+	}
+
+	bool OcclusionBuffer::IsOccluded(float minX, float minY, float maxX, float maxY, float minDepth) const
+	{
+		// Pixel coordinates with y pointing down
+		float left = (minX * 0.5f + 0.5f) * Width;
+		float right = (maxX * 0.5f + 0.5f) * Width;
+		float top = (0.5f - maxY * 0.5f) * Height;
+		float bottom = (0.5f - minY * 0.5f) * Height;
+		if (!(right >= 0.0f && left < Width && bottom >= 0.0f && top < Height))
+		{
+			return false;
+		}
+
+		// An occluder covers a texel if it covers its center, so it may overstate its coverage by half a texel.
+		// The rectangle is grown by as much, and the texels it touches are read at the finest level where it spans two of them at most.
+		UINT x0 = static_cast<UINT>(std::max(left - 0.5f, 0.0f));
+		UINT x1 = static_cast<UINT>(std::min(right + 0.5f, Width - 1.0f));
+		UINT y0 = static_cast<UINT>(std::max(top - 0.5f, 0.0f));
+		UINT y1 = static_cast<UINT>(std::min(bottom + 0.5f, Height - 1.0f));
+		UINT span = std::max(x1 - x0, y1 - y0);
+		UINT level = 0;
+		while (level + 1 < LevelCount && (span >> level) != 0)
+		{
+			++level;
+		}
+
+		const float* depth = m_depth.data() + m_levelOffsets[level];
+		UINT levelWidth = GetLevelWidth(level);
+		float farthest = 0.0f;
+		for (UINT y = y0 >> level; y <= y1 >> level; ++y)
+		{
+			for (UINT x = x0 >> level; x <= x1 >> level; ++x)
+			{
+				farthest = std::max(farthest, depth[y * levelWidth + x]);
+			}
+		}
+		return minDepth > farthest;
+	}
+
+	void OcclusionBuffer::SetupTriangles(Occluder& occluder)
+	{
+		std::span<const BYTE> vertices = occluder.Vertices;
+		std::span<const UINT> indices = occluder.Indices;
+		size_t stride = occluder.VertexByteStride;
+		XMMATRIX worldViewProj = XMMatrixMultiply(XMLoadFloat4x4(&occluder.World), XMLoadFloat4x4(&m_viewProjMatrix));
+
+		occluder.TriangleCount = 0;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			std::array<XMVECTOR, 3> clip;
+			for (size_t corner = 0; corner < clip.size(); ++corner)
+			{
+				size_t vertex = static_cast<size_t>(occluder.BaseVertexLocation) + indices[i + corner];
+				clip[corner] = XMVector3Transform(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(vertices.data() + vertex * stride)), worldViewProj);
+			}
+
+			// Clipped by the near plane, which leaves a polygon of four corners at most
+			std::array<XMVECTOR, 4> polygon;
+			size_t count = 0;
+			for (size_t corner = 0; corner < clip.size(); ++corner)
+			{
+				XMVECTOR from = clip[corner];
+				XMVECTOR to = clip[(corner + 1) % clip.size()];
+				float fromZ = XMVectorGetZ(from);
+				float toZ = XMVectorGetZ(to);
+				if (fromZ >= 0.0f)
+				{
+					polygon[count++] = from;
+				}
+				if ((fromZ >= 0.0f) != (toZ >= 0.0f))
+				{
+					polygon[count++] = XMVectorLerp(from, to, fromZ / (fromZ - toZ));
+				}
+			}
+			for (size_t corner = 2; corner < count; ++corner)
+			{
+				if (SetupTriangle(polygon[0], polygon[corner - 1], polygon[corner], m_triangles[occluder.FirstTriangle + occluder.TriangleCount]))
+				{
+					++occluder.TriangleCount;
+				}
+			}
+		}
+	}
+
+	bool OcclusionBuffer::SetupTriangle(FXMVECTOR clip0, FXMVECTOR clip1, FXMVECTOR clip2, Triangle& triangle)
+	{
+		XMVECTOR scale = XMVectorSet(Width * 0.5f, Height * -0.5f, 1.0f, 1.0f);
+		XMVECTOR offset = XMVectorSet(Width * 0.5f, Height * 0.5f, 0.0f, 0.0f);
+		std::array<XMFLOAT3, 3> v;
+		XMStoreFloat3(&v[0], XMVectorMultiplyAdd(XMVectorDivide(clip0, XMVectorSplatW(clip0)), scale, offset));
+		XMStoreFloat3(&v[1], XMVectorMultiplyAdd(XMVectorDivide(clip1, XMVectorSplatW(clip1)), scale, offset));
+		XMStoreFloat3(&v[2], XMVectorMultiplyAdd(XMVectorDivide(clip2, XMVectorSplatW(clip2)), scale, offset));
+
+		// Front faces are clockwise on the screen as in the default rasterizer state, the back faces are hidden behind them
+		float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+		if (!(area > 0.0f))
+		{
+			return false;
+		}
+
+		// The pixel centers within the bounds of the triangle
+		auto toPixel = [](float value, UINT size) { return static_cast<int>(std::clamp(value, -1.0f, static_cast<float>(size))); };
+		triangle.MinX = std::max(toPixel(std::ceil(std::min({ v[0].x, v[1].x, v[2].x }) - 0.5f), Width), 0);
+		triangle.MaxX = std::min(toPixel(std::floor(std::max({ v[0].x, v[1].x, v[2].x }) - 0.5f), Width), static_cast<int>(Width) - 1);
+		triangle.MinY = std::max(toPixel(std::ceil(std::min({ v[0].y, v[1].y, v[2].y }) - 0.5f), Height), 0);
+		triangle.MaxY = std::min(toPixel(std::floor(std::max({ v[0].y, v[1].y, v[2].y }) - 0.5f), Height), static_cast<int>(Height) - 1);
+		if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY)
+		{
+			return false;
+		}
+
+		// Edge i runs from corner i to the next one, and weights the corner opposite to it
+		triangle.DepthA = 0.0f;
+		triangle.DepthB = 0.0f;
+		triangle.DepthC = 0.0f;
+		for (size_t i = 0; i < 3; ++i)
+		{
+			const XMFLOAT3& from = v[i];
+			const XMFLOAT3& to = v[(i + 1) % 3];
+			float opposite = v[(i + 2) % 3].z / area;
+			triangle.EdgeA[i] = from.y - to.y;
+			triangle.EdgeB[i] = to.x - from.x;
+			triangle.EdgeC[i] = -(triangle.EdgeA[i] * from.x + triangle.EdgeB[i] * from.y);
+			triangle.DepthA += triangle.EdgeA[i] * opposite;
+			triangle.DepthB += triangle.EdgeB[i] * opposite;
+			triangle.DepthC += triangle.EdgeC[i] * opposite;
+		}
+		return true;
+	}
+
+	void OcclusionBuffer::RasterizeBand(UINT band)
+	{
+		int bandMinY = static_cast<int>(band * BandHeight);
+		int bandMaxY = bandMinY + static_cast<int>(BandHeight) - 1;
+		float* depth = m_depth.data();
+		std::fill(depth + bandMinY * Width, depth + (bandMaxY + 1) * Width, 1.0f);
+
+		XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+		XMVECTOR zero = XMVectorZero();
+		for (const Occluder& occluder : m_occluders)
+		{
+			for (size_t index = occluder.FirstTriangle; index < occluder.FirstTriangle + occluder.TriangleCount; ++index)
+			{
+				const Triangle& triangle = m_triangles[index];
+				int minY = std::max(triangle.MinY, bandMinY);
+				int maxY = std::min(triangle.MaxY, bandMaxY);
+				if (minY > maxY)
+				{
+					continue;
+				}
+
+				// Four pixels are tested at once from an aligned column, the lanes outside the triangle fail the edge test
+				int minX = triangle.MinX & ~3;
+				XMVECTOR pixelX = XMVectorAdd(XMVectorReplicate(static_cast<float>(minX)), laneOffsets);
+				std::array<XMVECTOR, 3> edgeStep;
+				for (size_t i = 0; i < 3; ++i)
+				{
+					edgeStep[i] = XMVectorReplicate(triangle.EdgeA[i] * 4.0f);
+				}
+				XMVECTOR depthStep = XMVectorReplicate(triangle.DepthA * 4.0f);
+
+				for (int y = minY; y <= maxY; ++y)
+				{
+					float pixelY = static_cast<float>(y) + 0.5f;
+					std::array<XMVECTOR, 3> edge;
+					for (size_t i = 0; i < 3; ++i)
+					{
+						edge[i] = XMVectorMultiplyAdd(XMVectorReplicate(triangle.EdgeA[i]), pixelX, XMVectorReplicate(triangle.EdgeB[i] * pixelY + triangle.EdgeC[i]));
+					}
+					XMVECTOR pixelDepth = XMVectorMultiplyAdd(XMVectorReplicate(triangle.DepthA), pixelX, XMVectorReplicate(triangle.DepthB * pixelY + triangle.DepthC));
+
+					float* row = depth + y * Width;
+					for (int x = minX; x <= triangle.MaxX; x += 4)
+					{
+						XMVECTOR inside = XMVectorAndInt(XMVectorGreaterOrEqual(edge[0], zero), XMVectorAndInt(XMVectorGreaterOrEqual(edge[1], zero), XMVectorGreaterOrEqual(edge[2], zero)));
+						XMFLOAT4* pixels = reinterpret_cast<XMFLOAT4*>(row + x);
+						XMVECTOR current = XMLoadFloat4(pixels);
+						XMStoreFloat4(pixels, XMVectorSelect(current, XMVectorMin(current, pixelDepth), inside));
+
+						edge[0] = XMVectorAdd(edge[0], edgeStep[0]);
+						edge[1] = XMVectorAdd(edge[1], edgeStep[1]);
+						edge[2] = XMVectorAdd(edge[2], edgeStep[2]);
+						pixelDepth = XMVectorAdd(pixelDepth, depthStep);
+					}
+				}
+			}
+		}
+	}
+
+	void OcclusionBuffer::BuildHierarchy()
+	{ ZoneScoped;
+		for (UINT level = 1; level < LevelCount; ++level)
+		{
+			const float* source = m_depth.data() + m_levelOffsets[level - 1];
+			float* target = m_depth.data() + m_levelOffsets[level];
+			UINT sourceWidth = GetLevelWidth(level - 1);
+			UINT sourceHeight = GetLevelHeight(level - 1);
+			UINT targetWidth = GetLevelWidth(level);
+			UINT targetHeight = GetLevelHeight(level);
+			for (UINT y = 0; y < targetHeight; ++y)
+			{
+				const float* row0 = source + std::min(y * 2, sourceHeight - 1) * sourceWidth;
+				const float* row1 = source + std::min(y * 2 + 1, sourceHeight - 1) * sourceWidth;
+				for (UINT x = 0; x < targetWidth; ++x)
+				{
+					UINT x0 = std::min(x * 2, sourceWidth - 1);
+					UINT x1 = std::min(x * 2 + 1, sourceWidth - 1);
+					target[y * targetWidth + x] = std::max({ row0[x0], row0[x1], row1[x0], row1[x1] });
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
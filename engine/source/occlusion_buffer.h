@@ -0,0 +1,77 @@
+#pragma once
+
+#include "pch.h"
+
+namespace udsdx
+{
+	// Low resolution depth buffer of the occluders of a view, rasterized on the CPU.
+	// A hierarchy keeping the farthest depth of every 2x2 texels is built on top of it, so a box is tested against four texels at most.
+	class OcclusionBuffer
+	{
+	public:
+		static constexpr UINT Width = 256;
+		static constexpr UINT Height = 128;
+
+	public:
+		OcclusionBuffer();
+
+	public:
+		// Clears the occluders, and sets the view the next ones are rasterized for
+		void Reset(const Matrix4x4& viewProjMatrix);
+		// Queues the triangles of the indices, which are offset by the base vertex. The positions are read from the start of each vertex.
+		// The data is read when rasterizing, such as the system memory copies of the mesh buffers.
+		void AddOccluder(std::span<const BYTE> vertices, UINT vertexByteStride, std::span<const UINT> indices, UINT baseVertexLocation, const Matrix4x4& world);
+		// Sets up the triangles of the occluders and rasterizes them in bands of rows across the job system, then builds the hierarchy
+		void Rasterize();
+
+		bool HasOccluders() const { return !m_occluders.empty(); }
+		const Matrix4x4& GetViewProjMatrix() const { return m_viewProjMatrix; }
+
+		// Whether the rectangle in normalized device coordinates lies behind the occluders everywhere, given its nearest depth
+		bool IsOccluded(float minX, float minY, float maxX, float maxY, float minDepth) const;
+
+	private:
+		static constexpr UINT BandHeight = 16;
+		static constexpr UINT LevelCount = 9;
+
+		struct Occluder
+		{
+			std::span<const BYTE> Vertices;
+			UINT VertexByteStride;
+			std::span<const UINT> Indices;
+			UINT BaseVertexLocation;
+			Matrix4x4 World;
+			// Two slots per source triangle, as clipping by the near plane may split it in two
+			size_t FirstTriangle;
+			size_t TriangleCount;
+		};
+
+		// Edge functions and depth plane over the pixel coordinates, positive inside the triangle
+		struct Triangle
+		{
+			float EdgeA[3];
+			float EdgeB[3];
+			float EdgeC[3];
+			float DepthA, DepthB, DepthC;
+			int MinX, MinY, MaxX, MaxY;
+		};
+
+		// Projects the clipped triangle to pixels. Fails if it faces away or covers no pixel center.
+		static bool SetupTriangle(FXMVECTOR clip0, FXMVECTOR clip1, FXMVECTOR clip2, Triangle& triangle);
+		void SetupTriangles(Occluder& occluder);
+		void RasterizeBand(UINT band);
+		void BuildHierarchy();
+
+		static UINT GetLevelWidth(UINT level) { return std::max(Width >> level, 1u); }
+		static UINT GetLevelHeight(UINT level) { return std::max(Height >> level, 1u); }
+
+	private:
+		Matrix4x4 m_viewProjMatrix = Matrix4x4::Identity;
+		std::vector<Occluder> m_occluders;
+		std::vector<Triangle> m_triangles;
+
+		// Every level of the hierarchy, starting with the full resolution depth
+		std::vector<float> m_depth;
+		std::array<size_t, LevelCount> m_levelOffsets = {};
+	};
+}
\ No newline at end of file
@@ -5,6 +5,8 @@
 // C++ Standard Library
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
 #include <chrono>
 #include <cmath>
@@ -21,9 +23,11 @@
 #include <set>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <queue>
 #include <random>
+#include <semaphore>
 #include <span>
 #include <sstream>
 #include <stack>
@@ -37,6 +41,18 @@
 #include <utility>
 #include <vector>
 
+#ifdef UDSDX_HEADLESS
+
+// Platform stand-ins of the headless test build, which only compiles the parts of the engine that do not touch the GPU
+#include "../tests/headless_platform.h"
+
+// In-Engine Library
+#include "define.h"
+#include "custom_math.h"
+#include "singleton.h"
+
+#else
+
 // Windows Library
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
@@ -102,4 +118,6 @@ using namespace DirectX;
 #pragma comment(lib, "dxgi.lib")
 #pragma comment(lib, "d3dcompiler.lib")
 #pragma comment(lib, "dxguid.lib")
-#pragma comment(lib, "runtimeobject.lib")
\ No newline at end of file
+#pragma comment(lib, "runtimeobject.lib")
+
+#endif
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include "pch.h"
+#include "pose_blender.h"
+#include "rigged_mesh.h"
+
+namespace udsdx
+{
+	static void DecomposeTransform(const Matrix4x4& transform, LocalTransform& out)
+	{
+		XMVECTOR s, q, p;
+		XMMatrixDecompose(&s, &q, &p, XMLoadFloat4x4(&transform));
+		XMStoreFloat3(&out.Position, p);
+		XMStoreFloat4(&out.Rotation, q);
+		XMStoreFloat3(&out.Scale, s);
+	}
+
+	// Whether the layer replaces every bone below it, so the layers below do not need to be sampled
+	static bool IsOpaque(const AnimationLayer& layer)
+	{
+		return layer.Weight >= 1.0f && layer.Mask.empty() && std::all_of(layer.BoneMap.begin(), layer.BoneMap.end(), [](int boneID) { return boneID >= 0; });
+	}
+
+	void PoseBlender::Reset(std::span<const Bone> bones, std::span<const int> boneParents)
+	{
+		assert(bones.size() == boneParents.size());
+		m_boneParents = boneParents;
+
+		m_restPose.resize(bones.size());
+		for (size_t i = 0; i < bones.size(); ++i)
+		{
+			DecomposeTransform(bones[i].Transform, m_restPose[i]);
+		}
+		m_pose.resize(m_restPose.size());
+		m_layerPose.resize(m_restPose.size());
+	}
+
+	void PoseBlender::Evaluate(std::span<const AnimationLayer> layers, std::span<const BoneModifier> modifiers, std::span<Matrix4x4> out)
+	{ ZoneScoped;
+		assert(out.size() == m_restPose.size());
+
+		size_t firstLayer = 0;
+		for (size_t index = layers.size(); index-- > 0;)
+		{
+			if (IsOpaque(layers[index]))
+			{
+				firstLayer = index;
+				break;
+			}
+		}
+
+		std::copy(m_restPose.begin(), m_restPose.end(), m_pose.begin());
+		for (size_t index = firstLayer; index < layers.size(); ++index)
+		{
+			const AnimationLayer& layer = layers[index];
+			if (layer.Source == nullptr || layer.Weight <= 0.0f)
+			{
+				continue;
+			}
+
+			// A layer at full weight is sampled straight into the pose
+			if (layer.Weight >= 1.0f && layer.Mask.empty())
+			{
+				layer.Source->PopulateLocalPose(layer.Time, *layer.Cursor, layer.BoneMap, m_pose);
+				continue;
+			}
+
+			layer.Source->PopulateLocalPose(layer.Time, *layer.Cursor, layer.BoneMap, m_layerPose);
+			for (size_t bone = 0; bone < m_pose.size(); ++bone)
+			{
+				float weight = layer.Mask.empty() ? layer.Weight : layer.Weight * layer.Mask[bone];
+				if (layer.BoneMap[bone] < 0 || weight <= 0.0f)
+				{
+					continue;
+				}
+
+				LocalTransform& target = m_pose[bone];
+				const LocalTransform& source = m_layerPose[bone];
+				XMStoreFloat3(&target.Position, XMVectorLerp(XMLoadFloat3(&target.Position), XMLoadFloat3(&source.Position), weight));
+				XMStoreFloat4(&target.Rotation, XMQuaternionSlerp(XMLoadFloat4(&target.Rotation), XMLoadFloat4(&source.Rotation), weight));
+				XMStoreFloat3(&target.Scale, XMVectorLerp(XMLoadFloat3(&target.Scale), XMLoadFloat3(&source.Scale), weight));
+			}
+		}
+
+		// The bones are ordered depth first, so the parents are resolved before their children
+		auto modifier = modifiers.begin();
+		for (size_t bone = 0; bone < m_pose.size(); ++bone)
+		{
+			const LocalTransform& local = m_pose[bone];
+			XMMATRIX tLocal = XMMatrixAffineTransformation(XMLoadFloat3(&local.Scale), XMVectorZero(), XMLoadFloat4(&local.Rotation), XMLoadFloat3(&local.Position));
+			if (modifier != modifiers.end() && modifier->Bone == bone)
+			{
+				tLocal = tLocal * XMLoadFloat4x4(&modifier->Transform);
+				++modifier;
+			}
+
+			XMMATRIX tParent = m_boneParents[bone] < 0 ? XMMatrixIdentity() : XMLoadFloat4x4(&out[m_boneParents[bone]]);
+			XMStoreFloat4x4(&out[bone], tLocal * tParent);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "pch.h"
+#include "animation_clip.h"
+
+namespace udsdx
+{
+	struct Bone;
+
+	// Animation sampled at a time over the bones of a mesh
+	struct AnimationLayer
+	{
+		const Animation* Source = nullptr;
+		float Time = 0.0f;
+		float Weight = 1.0f;
+		// Bone of the clip for every bone of the mesh, or -1 for the bones the layer leaves to the ones below
+		std::span<const int> BoneMap;
+		// Weight of every bone of the mesh, multiplied with the one of the layer. Empty to weigh all of them fully.
+		std::span<const float> Mask;
+		AnimationCursor* Cursor = nullptr;
+	};
+
+	// Blends layers of animations in the local space of the bones of a mesh, then applies the hierarchy once for all of them.
+	// Each layer is blended over the pose of the layers below it by its weight, starting from the rest pose of the mesh.
+	// The clips are expected to share the node hierarchy of the mesh, as the exporter writes both from the same rig.
+	class PoseBlender
+	{
+	public:
+		// Caches the rest pose of the bones of the mesh, which are ordered depth first
+		void Reset(std::span<const Bone> bones, std::span<const int> boneParents);
+
+		// Writes the model space transform of every bone of the mesh. The modifiers are indexed by the bones of the mesh, and multiply their local transforms after blending.
+		void Evaluate(std::span<const AnimationLayer> layers, std::span<const BoneModifier> modifiers, std::span<Matrix4x4> out);
+
+	private:
+		// Parents of the bones, kept by the mesh
+		std::span<const int> m_boneParents;
+		std::vector<LocalTransform> m_restPose;
+		// Blended pose, and the samples of the layer being blended into it
+		std::vector<LocalTransform> m_pose;
+		std::vector<LocalTransform> m_layerPose;
+	};
+}
\ No newline at end of file
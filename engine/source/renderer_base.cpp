@@ -7,6 +7,8 @@
 #include "texture.h"
 #include "shader.h"
 #include "scene.h"
+#include "mesh_base.h"
+#include "lod_selector.h"
 
 namespace udsdx
 {
@@ -63,6 +65,37 @@ namespace udsdx
 		}
 	}
 
+	void RendererBase::PrepareRender(int frameResourceIndex, ConstantAllocator& constantAllocator)
+	{
+		ValidateTransformCache();
+
+		// Called for every queued submesh, assigning over the same size keeps the copies the earlier items point to
+		m_renderMaterials = m_materials;
+		m_renderTopology = m_topology;
+	}
+
+	void RendererBase::SelectLod(const Vector3& eyePosition, const Matrix4x4& projMatrix, float hysteresis)
+	{
+		const MeshBase* mesh = GetLodMesh();
+		const BoundingBox* bounds = GetLocalBounds();
+		if (mesh == nullptr || bounds == nullptr || mesh->GetLodScreenSizes().empty())
+		{
+			m_lod = 0;
+			return;
+		}
+
+		// Sphere around the box, scaled by the largest axis of the transform
+		Vector3 center = Vector3::Transform(bounds->Center, m_transformCache);
+		float scale = std::max({
+			Vector3(m_transformCache._11, m_transformCache._12, m_transformCache._13).Length(),
+			Vector3(m_transformCache._21, m_transformCache._22, m_transformCache._23).Length(),
+			Vector3(m_transformCache._31, m_transformCache._32, m_transformCache._33).Length() });
+		float radius = Vector3(bounds->Extents).Length() * scale;
+
+		float screenSize = LodSelector::GetScreenSize(center, radius, eyePosition, projMatrix);
+		m_lod = LodSelector::Select(mesh->GetLodScreenSizes(), screenSize, m_lod, hysteresis);
+	}
+
 	void RendererBase::UpdateTransformCache()
 	{
 		m_prevTransformCache = std::move(m_transformCache);
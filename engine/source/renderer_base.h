@@ -8,6 +8,7 @@ namespace udsdx
 {
 	class Scene;
 	class Shader;
+	class MeshBase;
 
 	class RendererBase : public Component
 	{
@@ -24,19 +25,54 @@ namespace udsdx
 
 		D3D_PRIMITIVE_TOPOLOGY GetTopology() const;
 		Material GetMaterial(int index = 0) const;
+		// Copy of the material taken by PrepareRender(), which the published draw items point to
+		const Material& GetRenderMaterial(int index) const { return m_renderMaterials[index]; }
 
 		bool GetCastShadow() const;
 		bool GetDrawOutline() const { return m_drawOutline; }
 
+		const Matrix4x4& GetTransformCache() const { return m_transformCache; }
+		const Matrix4x4& GetPrevTransformCache() const { return m_prevTransformCache; }
 		void ValidateTransformCache();
 		virtual void UpdateTransformCache();
 
+		// Called when the frame is published, before the renderer is recorded with the same frame resource.
+		// Everything Render() reads from the live state must be cached here, and the constants it binds uploaded to the allocator of the frame.
+		// The render thread may record the frame during the next Update(), so the setters must not change what Render() reads.
+		virtual void PrepareRender(int frameResourceIndex, ConstantAllocator& constantAllocator);
+
+		// Bounds of the drawn geometry in object space, which the scene culls against the views.
+		// Renderers without bounds are never culled.
+		virtual const BoundingBox* GetLocalBounds() const { return nullptr; }
+
+		// Mesh whose submesh of the drawn parameter is rasterized on the CPU to occlude the other renderers.
+		// Renderers without one never occlude, but are still occluded.
+		virtual const MeshBase* GetOccluderMesh() const { return nullptr; }
+
+		// Mesh whose level of detail chain the renderer draws from, picked by the projected size of the bounds.
+		// Renderers without one always draw the base level.
+		virtual const MeshBase* GetLodMesh() const { return nullptr; }
+		// Picks the level of detail for the view, keeping the current one within the hysteresis fraction of the thresholds
+		void SelectLod(const Vector3& eyePosition, const Matrix4x4& projMatrix, float hysteresis);
+		void ResetLod() { m_lod = 0; }
+		UINT GetLod() const { return m_lod; }
+
+		// Whether the draws of the renderer can be merged with compatible draws of other renderers.
+		// The merged draws are recorded by RenderInstanced() of the first renderer, with the instance stream bound to slot 1.
+		bool GetInstancing() const { return m_instancing; }
+		virtual void RenderInstanced(RenderParam& param, int parameter, UINT instanceCount) {}
+
 	protected:
 		std::vector<Material> m_materials;
+		// Materials and topology read by Render(), copied from the live ones when the frame is published
+		std::vector<Material> m_renderMaterials;
+		D3D_PRIMITIVE_TOPOLOGY m_renderTopology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
 		D3D_PRIMITIVE_TOPOLOGY m_topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		bool m_castShadow = true;
 		bool m_drawOutline = false;
+		bool m_instancing = false;
+		UINT m_lod = 0;
 		RenderGroup m_renderGroup = RenderGroup::Deferred;
 
 		bool m_transformCacheDirty = true;
@@ -3,11 +3,13 @@
 
 namespace udsdx
 {
-	ResourceObject::ResourceObject()
+	std::atomic<UINT> ResourceObject::m_nextResourceID = 1;
+
+	ResourceObject::ResourceObject() : m_resourceID(m_nextResourceID.fetch_add(1, std::memory_order_relaxed))
 	{
 	}
 
-	ResourceObject::ResourceObject(std::wstring_view path)
+	ResourceObject::ResourceObject(std::wstring_view path) : m_resourceID(m_nextResourceID.fetch_add(1, std::memory_order_relaxed))
 	{
 
 	}
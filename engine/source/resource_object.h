@@ -10,5 +10,14 @@ namespace udsdx
 		ResourceObject();
 		ResourceObject(std::wstring_view path);
 		virtual ~ResourceObject();
+
+	public:
+		// Unique in the process and never reused, starting from 1
+		UINT GetResourceID() const { return m_resourceID; }
+
+	private:
+		static std::atomic<UINT> m_nextResourceID;
+
+		UINT m_resourceID = 0;
 	};
 }
\ No newline at end of file
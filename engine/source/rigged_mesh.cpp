@@ -100,6 +100,8 @@ namespace udsdx
 			file.read(reinterpret_cast<char*>(&indices[i]), sizeof(UINT));
 		}
 
+		ReadLods(file);
+
 		MeshBase::CreateBuffers<RiggedVertex>(vertices, indices);
 		BoundingBox::CreateFromPoints(m_bounds, vertices.size(), &vertices[0].position, sizeof(RiggedVertex));
 	}
@@ -119,7 +121,8 @@ namespace udsdx
 
 	int RiggedMesh::GetBoneIndex(std::string_view boneName) const
 	{
-		auto iter = m_boneIndexMap.find(boneName.data());
+		// The view is not null terminated in general, so the key is copied out of it
+		auto iter = m_boneIndexMap.find(std::string(boneName));
 		if (iter == m_boneIndexMap.end())
 			return -1;
 		return iter->second;
@@ -145,4 +148,9 @@ namespace udsdx
 	{
 		return m_boneParents;
 	}
+
+	const Bone& RiggedMesh::GetBone(UINT index) const
+	{
+		return m_bones[index];
+	}
 }
\ No newline at end of file
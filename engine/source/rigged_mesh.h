@@ -24,6 +24,8 @@ namespace udsdx
 		UINT GetBoneCount() const;
 		std::vector<std::string> GetBoneNames() const;
 		const std::vector<int>& GetBoneParents() const;
+		const Bone& GetBone(UINT index) const;
+		const std::vector<Bone>& GetBones() const { return m_bones; }
 
 	protected:
 		std::vector<Bone> m_bones;
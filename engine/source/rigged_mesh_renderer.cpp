@@ -3,6 +3,7 @@
 #include "animation_clip.h"
 #include "renderer_base.h"
 #include "frame_resource.h"
+#include "state_tracking_command_list.h"
 #include "scene_object.h"
 #include "transform.h"
 #include "material.h"
@@ -12,22 +13,105 @@
 #include "rigged_mesh.h"
 #include "camera.h"
 #include "core.h"
+#include "job_system.h"
+#include "debug_console.h"
+#include "animation_lod.h"
+#include "lod_selector.h"
+#include "culling.h"
 
 namespace udsdx
 {
+	unsigned long long g_animationEvaluationCounter = 0;
+
+	void RiggedMeshRenderer::UpdateAll(std::span<RiggedMeshRenderer*> renderers, const Time& time, Scene& scene)
+	{ ZoneScoped;
+		// Qualified calls are resolved statically, so the loop runs without virtual dispatch
+		for (RiggedMeshRenderer* renderer : renderers)
+		{
+			renderer->RiggedMeshRenderer::Update(time, scene);
+		}
+	}
+
+	void RiggedMeshRenderer::PostUpdateAll(std::span<RiggedMeshRenderer*> renderers, const Time& time, Scene& scene)
+	{ ZoneScoped;
+		static UINT64 frame = 0;
+		++frame;
+
+		// The intervals are picked from the bounds of the last frame, as the world transforms are updated after this pass.
+		// The phase of a renderer is its index in the batch, which spreads the renderers of an interval over its frames.
+		Camera* camera = scene.GetMainCamera();
+		const RenderOptions& options = INSTANCE(Core)->GetRenderOptionsRef();
+		UINT evaluationCount = 0;
+		if (options.UseAnimationLod && camera != nullptr)
+		{
+			float aspectRatio = INSTANCE(Core)->GetAspectRatio();
+			Vector3 eyePosition = camera->GetTransform()->GetWorldPosition();
+			Matrix4x4 projMatrix = camera->GetProjMatrix(aspectRatio);
+			ViewVolume viewFrustum = camera->GetViewFrustumWorld(aspectRatio);
+			for (UINT index = 0; index < renderers.size(); ++index)
+			{
+				RiggedMeshRenderer* renderer = renderers[index];
+				renderer->SelectAnimationInterval(eyePosition, projMatrix, viewFrustum, options.LodHysteresis);
+
+				// A renderer which was never sampled, or whose mesh changed, has no pose to keep
+				bool poseValid = renderer->m_boneTransformCache.size() == renderer->m_riggedMesh->GetBoneCount();
+				renderer->m_animationDue = !poseValid || AnimationLod::IsDue(frame, index, renderer->m_animationInterval, renderer->m_skippedAnimationFrames);
+				renderer->m_skippedAnimationFrames = renderer->m_animationDue ? 0 : renderer->m_skippedAnimationFrames + 1;
+				evaluationCount += renderer->m_animationDue ? 1 : 0;
+			}
+		}
+		else
+		{
+			for (RiggedMeshRenderer* renderer : renderers)
+			{
+				renderer->m_animationInterval = 1;
+				renderer->m_skippedAnimationFrames = 0;
+				renderer->m_animationDue = true;
+			}
+			evaluationCount = static_cast<UINT>(renderers.size());
+		}
+		g_animationEvaluationCounter += evaluationCount;
+		TracyPlot("Animation Evaluations", static_cast<int64_t>(evaluationCount));
+
+		// Sampling a renderer only writes its own pose buffers and cursors, and reads the clips and meshes which are shared,
+		// so the renderers are sampled across the workers. Every pose goes through the same code as in the serial path,
+		// so the results do not depend on how the renderers are split.
+		INSTANCE(JobSystem)->ParallelFor(static_cast<UINT>(renderers.size()), [renderers](UINT begin, UINT end) {
+			for (UINT index = begin; index < end; ++index)
+			{
+				if (renderers[index]->m_animationDue)
+				{
+					renderers[index]->CacheBoneTransforms();
+				}
+			}
+		});
+
+		// Queueing the draws touches the scene, and stays on the calling thread in order
+		for (RiggedMeshRenderer* renderer : renderers)
+		{
+			renderer->RendererBase::PostUpdate(time, scene);
+			renderer->EnqueueDraws(scene);
+		}
+	}
+
 	void RiggedMeshRenderer::PostUpdate(const Time& time, Scene& scene)
 	{
 		RendererBase::PostUpdate(time, scene);
 
 		CacheBoneTransforms();
+		++g_animationEvaluationCounter;
+		EnqueueDraws(scene);
+	}
 
+	void RiggedMeshRenderer::EnqueueDraws(Scene& scene)
+	{
 		int submeshCount = m_riggedMesh ? static_cast<int>(std::min(m_riggedMesh->GetSubmeshes().size(), m_materials.size())) : 0;
 		for (int i = 0; i < submeshCount; ++i)
 		{
-			scene.EnqueueRenderObject(this, m_renderGroup, m_materials[i].GetShader()->RiggedPipelineState(), m_materials[i].GetShader()->DeferredPipelineState(), i);
+			scene.EnqueueRenderObject(this, m_renderGroup, m_materials[i], m_materials[i].GetShader()->RiggedPipelineState(), m_riggedMesh, i);
 			if (m_castShadow == true)
 			{
-				scene.EnqueueRenderShadowObject(this, m_materials[i].GetShader()->RiggedShadowPipelineState(), i);
+				scene.EnqueueRenderShadowObject(this, m_materials[i], m_materials[i].GetShader()->RiggedShadowPipelineState(), m_riggedMesh, i);
 			}
 		}
 	}
@@ -37,6 +121,10 @@ namespace udsdx
 		m_animationTime += time.deltaTime;
 		m_prevAnimationTime += time.deltaTime;
 		m_transitionFactor += time.deltaTime / 0.2f;
+		for (Layer& layer : m_layers)
+		{
+			layer.Time += time.deltaTime;
+		}
 		m_constantBuffersDirty = true;
 
 		RendererBase::Update(time, scene);
@@ -50,7 +138,7 @@ namespace udsdx
 		// Perform frustum culling
 		BoundingBox boundsWorld;
 		m_riggedMesh->GetBounds().Transform(boundsWorld, m_transformCache);
-		if (nullptr == m_animation || target->GetViewFrustumWorld(screenRatio)->Contains(boundsWorld) == ContainmentType::DISJOINT)
+		if (nullptr == m_animation || !target->GetViewFrustumWorld(screenRatio).Intersects(boundsWorld))
 		{
 			return;
 		}
@@ -141,66 +229,89 @@ namespace udsdx
 
 	void RiggedMeshRenderer::Render(RenderParam& param, int parameter)
 	{
-		if (param.UseFrustumCulling)
-		{
-			// Perform frustum culling
-			BoundingBox boundsWorld;
-			m_riggedMesh->GetBounds().Transform(boundsWorld, m_transformCache);
-			if (param.ViewFrustumWorld->Contains(boundsWorld) == ContainmentType::DISJOINT)
-			{
-				return;
-			}
-		}
-
-		const auto& submeshes = m_riggedMesh->GetSubmeshes();
+		const auto& submeshes = m_renderMesh->GetSubmeshes();
 		ObjectConstants objectConstants;
 		objectConstants.World = m_transformCache.Transpose();
 		objectConstants.PrevWorld = m_prevTransformCache.Transpose();
 
 		param.CommandList->SetGraphicsRoot32BitConstants(RootParam::PerObjectCBV, sizeof(ObjectConstants) / 4, &objectConstants, 0);
-		param.CommandList->IASetVertexBuffers(0, 1, &m_riggedMesh->VertexBufferView());
-		param.CommandList->IASetIndexBuffer(&m_riggedMesh->IndexBufferView());
-		param.CommandList->IASetPrimitiveTopology(m_topology);
+		param.TrackedCommandList->IASetVertexBuffers(0, 1, &m_renderMesh->VertexBufferView());
+		param.TrackedCommandList->IASetIndexBuffer(&m_renderMesh->IndexBufferView());
+		param.TrackedCommandList->IASetPrimitiveTopology(m_renderTopology);
 
-		auto& uploaders = m_constantBuffers[param.FrameResourceIndex];
-		auto& prevUploaders = m_prevConstantBuffers[param.FrameResourceIndex];
+		param.CommandList->SetGraphicsRootConstantBufferView(RootParam::BonesCBV, m_constantBuffers[param.FrameResourceIndex][parameter]);
+		param.CommandList->SetGraphicsRootConstantBufferView(RootParam::PrevBonesCBV, m_prevConstantBuffers[param.FrameResourceIndex][parameter]);
 
-		if (m_constantBuffersDirty)
+		const Material& material = m_renderMaterials[parameter];
+		for (UINT textureSrcIndex = 0; textureSrcIndex < material.GetTextureCount(); ++textureSrcIndex)
 		{
-			// Update bone constants
-			for (size_t index = 0; index < submeshes.size(); ++index)
+			const Texture* texture = material.GetSourceTexture(textureSrcIndex);
+			if (texture != nullptr)
 			{
-				std::vector<Matrix4x4> boneTransforms;
-				for (size_t boneIndex = 0; boneIndex < m_submeshBoneMapCache[index].size(); ++boneIndex)
-				{
-					Matrix4x4 boneTransform = m_boneTransformCache[m_submeshBoneMapCache[index][boneIndex]];
-					Matrix4x4 finalTransform = submeshes[index].BoneOffsets[boneIndex] * boneTransform;
-					boneTransforms.emplace_back(finalTransform.Transpose());
-				}
-
-				BoneConstants boneConstants;
-				memcpy(boneConstants.BoneTransforms, boneTransforms.data(), boneTransforms.size() * sizeof(Matrix4x4));
-				uploaders[index]->CopyData(0, boneConstants);
-				prevUploaders[index]->CopyData(0, m_boneConstantsCache[index]);
-				memcpy(&m_boneConstantsCache[index], &boneConstants, sizeof(BoneConstants));
+				param.TrackedCommandList->SetGraphicsRootDescriptorTable(RootParam::SrcTexSRV_0 + textureSrcIndex, texture->GetSrvGpu());
 			}
-			m_constantBuffersDirty = false;
 		}
 
-		param.CommandList->SetGraphicsRootConstantBufferView(RootParam::BonesCBV, uploaders[parameter]->Resource()->GetGPUVirtualAddress());
-		param.CommandList->SetGraphicsRootConstantBufferView(RootParam::PrevBonesCBV, prevUploaders[parameter]->Resource()->GetGPUVirtualAddress());
+		const auto& submesh = submeshes[parameter];
+		SubmeshLod lod = submesh.GetLod(m_lod);
+		param.CommandList->DrawIndexedInstanced(lod.IndexCount, 1, lod.StartIndexLocation, submesh.BaseVertexLocation, 0);
+	}
+
+	void RiggedMeshRenderer::PrepareRender(int frameResourceIndex, ConstantAllocator& constantAllocator)
+	{
+		RendererBase::PrepareRender(frameResourceIndex, constantAllocator);
 
-		for (UINT textureSrcIndex = 0; textureSrcIndex < m_materials[parameter].GetTextureCount(); ++textureSrcIndex)
+		// Called for every queued submesh, but the palettes are uploaded once per frame
+		if (m_riggedMesh == nullptr || !m_constantBuffersDirty)
 		{
-			const Texture* texture = m_materials[parameter].GetSourceTexture(textureSrcIndex);
-			if (texture != nullptr)
+			return;
+		}
+		m_renderMesh = m_riggedMesh;
+
+		// Sized here rather than in SetMesh(), as the addresses of the other frame resource may still be read by the render thread
+		const auto& submeshes = m_riggedMesh->GetSubmeshes();
+		auto& constantBuffers = m_constantBuffers[frameResourceIndex];
+		auto& prevConstantBuffers = m_prevConstantBuffers[frameResourceIndex];
+		constantBuffers.resize(submeshes.size());
+		prevConstantBuffers.resize(submeshes.size());
+
+		// Only the bones used by each submesh are uploaded, the shaders never index past them.
+		// A pose kept from an earlier frame uploads its palettes again as both the current and the previous ones, so it has no motion.
+		if (m_bonePaletteDirty)
+		{
+			m_bonePalette.Swap();
+		}
+		for (size_t index = 0; index < submeshes.size(); ++index)
+		{
+			UINT64 paletteSize = m_bonePalette.GetBoneCount(index) * sizeof(Matrix4x4);
+
+			ConstantAllocator::Allocation allocation = constantAllocator.Allocate(paletteSize);
+			if (m_bonePaletteDirty)
 			{
-				param.CommandList->SetGraphicsRootDescriptorTable(RootParam::SrcTexSRV_0 + textureSrcIndex, texture->GetSrvGpu());
+				m_bonePalette.Build(index, submeshes[index], m_submeshBoneMapCache[index], m_boneTransformCache, static_cast<Matrix4x4*>(allocation.CpuAddress));
 			}
+			else
+			{
+				memcpy(allocation.CpuAddress, m_bonePalette.GetPalette(index).data(), paletteSize);
+			}
+			constantBuffers[index] = allocation.GpuAddress;
+
+			ConstantAllocator::Allocation prevAllocation = constantAllocator.Allocate(paletteSize);
+			memcpy(prevAllocation.CpuAddress, (m_bonePaletteDirty ? m_bonePalette.GetPrevPalette(index) : m_bonePalette.GetPalette(index)).data(), paletteSize);
+			prevConstantBuffers[index] = prevAllocation.GpuAddress;
 		}
+		m_constantBuffersDirty = false;
+		m_bonePaletteDirty = false;
+	}
 
-		const auto& submesh = submeshes[parameter];
-		param.CommandList->DrawIndexedInstanced(submesh.IndexCount, 1, submesh.StartIndexLocation, submesh.BaseVertexLocation, 0);
+	const BoundingBox* RiggedMeshRenderer::GetLocalBounds() const
+	{
+		return m_riggedMesh ? &m_riggedMesh->GetBounds() : nullptr;
+	}
+
+	const MeshBase* RiggedMeshRenderer::GetLodMesh() const
+	{
+		return m_riggedMesh;
 	}
 
 	RiggedMesh* RiggedMeshRenderer::GetMesh() const
@@ -210,6 +321,11 @@ namespace udsdx
 
 	void RiggedMeshRenderer::SetMesh(RiggedMesh* mesh)
 	{
+		// The modifiers are indexed by the bones of the previous mesh
+		if (m_riggedMesh != mesh)
+		{
+			m_boneModifiers.clear();
+		}
 		m_riggedMesh = mesh;
 
 		const auto& submeshes = mesh->GetSubmeshes();
@@ -223,6 +339,19 @@ namespace udsdx
 		{
 			m_prevAnimation->GetAnimationClip()->PopulateBoneMap(m_riggedMesh->GetBoneNames(), m_prevBoneMapCache);
 		}
+		for (Layer& layer : m_layers)
+		{
+			if (layer.Source != nullptr)
+			{
+				layer.Source->GetAnimationClip()->PopulateBoneMap(m_riggedMesh->GetBoneNames(), layer.BoneMap);
+			}
+			// Masks are laid out over the bones of the previous mesh
+			if (layer.Mask.size() != m_riggedMesh->GetBoneCount())
+			{
+				layer.Mask.clear();
+			}
+		}
+		m_poseBlender.Reset(m_riggedMesh->GetBones(), m_riggedMesh->GetBoneParents());
 
 		for (size_t index = 0; index < numSubmeshes; ++index)
 		{
@@ -234,17 +363,9 @@ namespace udsdx
 			}
 		}
 
-		for (size_t index = 0; index < FrameResourceCount; ++index)
-		{
-			m_constantBuffers[index].resize(numSubmeshes);
-			m_prevConstantBuffers[index].resize(numSubmeshes);
-			for (size_t subIndex = 0; subIndex < numSubmeshes; ++subIndex)
-			{
-				m_constantBuffers[index][subIndex] = std::make_unique<UploadBuffer<BoneConstants>>(INSTANCE(Core)->GetDevice(), 1, true);
-				m_prevConstantBuffers[index][subIndex] = std::make_unique<UploadBuffer<BoneConstants>>(INSTANCE(Core)->GetDevice(), 1, true);
-			}
-		}
-		m_boneConstantsCache.resize(numSubmeshes);
+		// The palettes of the new mesh are uploaded on the next publish, along with the addresses Render() reads
+		m_bonePalette.Reset(submeshes);
+		m_constantBuffersDirty = true;
 	}
 
 	void RiggedMeshRenderer::SetAnimation(const AnimationClip* animationClip, bool loop, bool forcePlay)
@@ -272,6 +393,7 @@ namespace udsdx
 			m_animationTime = 0.0f;
 			m_transitionFactor = 0.0f;
 			m_prevBoneMapCache = m_boneMapCache;
+			std::swap(m_animationCursor, m_prevAnimationCursor);
 			animation->GetAnimationClip()->PopulateBoneMap(m_riggedMesh->GetBoneNames(), m_boneMapCache);
 		}
 		// If the animation is blending, but the new animation is previous one
@@ -281,6 +403,7 @@ namespace udsdx
 			m_transitionFactor = 1.0f - m_transitionFactor;
 			std::swap(m_animationTime, m_prevAnimationTime);
 			std::swap(m_boneMapCache, m_prevBoneMapCache);
+			std::swap(m_animationCursor, m_prevAnimationCursor);
 		}
 		// If the animation is blending, but the new animation is different from previous one
 		else
@@ -298,9 +421,29 @@ namespace udsdx
 		m_transitionFactor = factor;
 	}
 
+	void RiggedMeshRenderer::SetBoneModifier(UINT boneIndex, const Matrix4x4& transform)
+	{
+		assert(m_riggedMesh != nullptr && boneIndex < m_riggedMesh->GetBoneCount());
+		auto iter = std::lower_bound(m_boneModifiers.begin(), m_boneModifiers.end(), boneIndex, [](const BoneModifier& modifier, UINT bone) { return modifier.Bone < bone; });
+		if (iter != m_boneModifiers.end() && iter->Bone == boneIndex)
+		{
+			iter->Transform = transform;
+		}
+		else
+		{
+			m_boneModifiers.insert(iter, BoneModifier{ boneIndex, transform });
+		}
+	}
+
 	void RiggedMeshRenderer::SetBoneModifier(std::string_view boneName, const Matrix4x4& transform)
 	{
-		m_boneModifiers[boneName] = transform;
+		int boneIndex = m_riggedMesh != nullptr ? m_riggedMesh->GetBoneIndex(boneName) : -1;
+		if (boneIndex < 0)
+		{
+			DebugConsole::LogWarning("Bone modifier ignored, bone not found: " + std::string(boneName));
+			return;
+		}
+		SetBoneModifier(static_cast<UINT>(boneIndex), transform);
 	}
 
 	const Matrix4x4& RiggedMeshRenderer::GetBoneTransform(std::string_view boneName) const
@@ -319,27 +462,118 @@ namespace udsdx
 		m_boneModifiers.clear();
 	}
 
+	void RiggedMeshRenderer::SetLayerAnimation(UINT layer, const Animation* animation, bool loop)
+	{
+		Layer& target = GetLayer(layer);
+		if (target.Source != animation)
+		{
+			target.Source = animation;
+			target.Time = 0.0f;
+			target.BoneMap.clear();
+			if (animation != nullptr && m_riggedMesh != nullptr)
+			{
+				animation->GetAnimationClip()->PopulateBoneMap(m_riggedMesh->GetBoneNames(), target.BoneMap);
+			}
+		}
+		target.Loop = loop;
+	}
+
+	void RiggedMeshRenderer::SetLayerWeight(UINT layer, float weight)
+	{
+		GetLayer(layer).Weight = std::clamp(weight, 0.0f, 1.0f);
+	}
+
+	void RiggedMeshRenderer::SetLayerMask(UINT layer, std::vector<float> mask)
+	{
+		assert(mask.empty() || (m_riggedMesh != nullptr && mask.size() == m_riggedMesh->GetBoneCount()));
+		GetLayer(layer).Mask = std::move(mask);
+	}
+
+	void RiggedMeshRenderer::SetLayerMask(UINT layer, std::string_view rootBoneName)
+	{
+		int rootIndex = m_riggedMesh->GetBoneIndex(rootBoneName);
+		if (rootIndex < 0)
+		{
+			DebugConsole::LogError("Bone not found: " + std::string(rootBoneName));
+			throw std::runtime_error("Bone not found");
+		}
+
+		// The parents precede their children, so a single pass marks the whole subtree
+		const auto& boneParents = m_riggedMesh->GetBoneParents();
+		std::vector<float> mask(boneParents.size(), 0.0f);
+		mask[rootIndex] = 1.0f;
+		for (size_t index = rootIndex + 1; index < boneParents.size(); ++index)
+		{
+			if (boneParents[index] >= 0 && mask[boneParents[index]] > 0.0f)
+			{
+				mask[index] = 1.0f;
+			}
+		}
+		GetLayer(layer).Mask = std::move(mask);
+	}
+
+	void RiggedMeshRenderer::ClearLayers()
+	{
+		m_layers.clear();
+	}
+
+	RiggedMeshRenderer::Layer& RiggedMeshRenderer::GetLayer(UINT layer)
+	{
+		if (layer >= m_layers.size())
+		{
+			m_layers.resize(layer + 1);
+		}
+		return m_layers[layer];
+	}
+
+	void RiggedMeshRenderer::SelectAnimationInterval(const Vector3& eyePosition, const Matrix4x4& projMatrix, const ViewVolume& viewFrustum, float hysteresis)
+	{
+		BoundingBox boundsWorld;
+		m_riggedMesh->GetBounds().Transform(boundsWorld, m_transformCache);
+		if (!viewFrustum.Intersects(boundsWorld))
+		{
+			m_animationInterval = AnimationLod::Paused;
+			return;
+		}
+
+		float screenSize = LodSelector::GetScreenSize(boundsWorld.Center, Vector3(boundsWorld.Extents).Length(), eyePosition, projMatrix);
+		m_animationInterval = AnimationLod::SelectInterval(screenSize, m_animationInterval, hysteresis);
+	}
+
 	void RiggedMeshRenderer::CacheBoneTransforms()
 	{
-		if (m_animation == nullptr)
+		m_bonePaletteDirty = true;
+		if (m_animation == nullptr && m_layers.empty())
 		{
 			m_riggedMesh->PopulateTransforms(m_boneTransformCache);
+			return;
 		}
-		else
+
+		// While blending, the current animation is weighed over the previous one at full weight
+		m_layerStack.clear();
+		bool blending = m_transitionFactor < 1.0f && m_prevAnimation != nullptr;
+		if (blending)
+		{
+			m_layerStack.push_back({ m_prevAnimation, m_prevAnimationTime, 1.0f, m_prevBoneMapCache, {}, &m_prevAnimationCursor });
+		}
+		if (m_animation != nullptr)
 		{
 			float animationTime = m_loop ? fmodf(m_animationTime, m_animation->GetAnimationDuration()) : m_animationTime;
-			m_animation->PopulateTransforms(animationTime, m_boneMapCache, m_boneTransformCache, m_boneModifiers);
+			float weight = blending ? SmoothStep(std::clamp(m_transitionFactor, 0.0f, 1.0f)) : 1.0f;
+			m_layerStack.push_back({ m_animation, animationTime, weight, m_boneMapCache, {}, &m_animationCursor });
 		}
-		if (m_transitionFactor < 1.0f && m_prevAnimation != nullptr)
+		for (Layer& layer : m_layers)
 		{
-			std::vector<Matrix4x4> prevTransforms;
-			m_prevAnimation->PopulateTransforms(m_prevAnimationTime, m_prevBoneMapCache, prevTransforms, m_boneModifiers);
-			float t = SmoothStep(std::clamp(m_transitionFactor, 0.0f, 1.0f));
-			for (size_t i = 0; i < m_boneTransformCache.size(); ++i)
+			if (layer.Source != nullptr && layer.Weight > 0.0f)
 			{
-				m_boneTransformCache[i] = Matrix4x4::Lerp(prevTransforms[i], m_boneTransformCache[i], t);
+				float layerTime = layer.Loop ? fmodf(layer.Time, layer.Source->GetAnimationDuration()) : layer.Time;
+				m_layerStack.push_back({ layer.Source, layerTime, layer.Weight, layer.BoneMap, layer.Mask, &layer.Cursor });
 			}
 		}
+
+		// The buffers keep their sizes across frames, so sampling does not allocate in steady state
+		m_boneTransformCache.resize(m_riggedMesh->GetBoneCount());
+		m_poseBlender.Evaluate(m_layerStack, m_boneModifiers, m_boneTransformCache);
 	}
 
 	bool RiggedMeshRenderer::IsAnimationPlaying() const
@@ -2,26 +2,32 @@
 
 #include "pch.h"
 #include "renderer_base.h"
+#include "bone_palette.h"
+#include "animation_clip.h"
+#include "pose_blender.h"
 
 namespace udsdx
 {
 	class RiggedMesh;
-	class AnimationClip;
-	class Animation;
+	class ViewVolume;
 
 	class RiggedMeshRenderer : public RendererBase
 	{
 	public:
-		struct BoneConstants
-		{
-			Matrix4x4 BoneTransforms[256];
-		};
+		// Batch entry points picked up by the ComponentRegistry, replacing the per-object Update() and PostUpdate() calls of this type.
+		// PostUpdateAll() samples the poses of all the renderers across the job system before queueing their draws.
+		// With the animation level of detail, only the renderers due on the frame are sampled, and the others keep their last pose.
+		static void UpdateAll(std::span<RiggedMeshRenderer*> renderers, const Time& time, Scene& scene);
+		static void PostUpdateAll(std::span<RiggedMeshRenderer*> renderers, const Time& time, Scene& scene);
 
 	public:
 		virtual void PostUpdate(const Time& time, Scene& scene) override;
 		virtual void Update(const Time& time, Scene& scene) override;
 		virtual void OnDrawGizmos(const Camera* target) override;
 		virtual void Render(RenderParam& param, int parameter);
+		virtual void PrepareRender(int frameResourceIndex, ConstantAllocator& constantAllocator) override;
+		virtual const BoundingBox* GetLocalBounds() const override;
+		virtual const MeshBase* GetLodMesh() const override;
 
 	public:
 		RiggedMesh* GetMesh() const;
@@ -30,14 +36,52 @@ namespace udsdx
 		void SetAnimation(const AnimationClip* animationClip, std::string_view animationName, bool loop = false, bool forcePlay = false);
 		void SetAnimation(const Animation* animation, bool loop = false, bool forcePlay = false);
 		void SetTransitionFactor(float factor);
+		// Multiplies the transform into the local transform of the bone of the mesh after the animations are blended.
+		// The modifiers are indexed by the bones of the mesh, so the ones set by name resolve the bone once, and are cleared along with the mesh.
+		void SetBoneModifier(UINT boneIndex, const Matrix4x4& transform);
 		void SetBoneModifier(std::string_view boneName, const Matrix4x4& transform);
 		const Matrix4x4& GetBoneTransform(std::string_view boneName) const;
 		void ClearBoneModifiers();
+
+		// Layers are blended in order over the animation set by SetAnimation(), each by its weight.
+		// The layers are created up to the index on demand, and start at full weight over every bone.
+		void SetLayerAnimation(UINT layer, const Animation* animation, bool loop = true);
+		void SetLayerWeight(UINT layer, float weight);
+		// Weighs the layer per bone of the mesh, or over every bone if the mask is empty
+		void SetLayerMask(UINT layer, std::vector<float> mask);
+		// Limits the layer to the bone and its descendants
+		void SetLayerMask(UINT layer, std::string_view rootBoneName);
+		void ClearLayers();
+
 		void CacheBoneTransforms();
 		bool IsAnimationPlaying() const;
 
+	protected:
+		// Queues a draw of every submesh with a material, after the pose was cached
+		void EnqueueDraws(Scene& scene);
+
+	protected:
+		struct Layer
+		{
+			const Animation* Source = nullptr;
+			float Time = 0.0f;
+			float Weight = 1.0f;
+			bool Loop = true;
+			// (Rigged Mesh Bone Index -> Animation Clip Bone Index)
+			std::vector<int> BoneMap;
+			std::vector<float> Mask;
+			AnimationCursor Cursor;
+		};
+
+		Layer& GetLayer(UINT layer);
+
+		// Picks the evaluation interval from the bounds of the last frame in the main view
+		void SelectAnimationInterval(const Vector3& eyePosition, const Matrix4x4& projMatrix, const ViewVolume& viewFrustum, float hysteresis);
+
 	protected:
 		RiggedMesh* m_riggedMesh = nullptr;
+		// Mesh read by Render(), copied from the live one along with the palettes when the frame is published
+		RiggedMesh* m_renderMesh = nullptr;
 
 		const Animation* m_animation = nullptr;
 		const Animation* m_prevAnimation = nullptr;
@@ -57,19 +101,37 @@ namespace udsdx
 		// indexed by bone index of bones of RiggedMesh.
 		// (Rigged Mesh Bone Index -> Bone Transform)
 		std::vector<Matrix4x4> m_boneTransformCache;
+		// Blends the previous animation, the current one and the layers in local space, rebuilt every frame into the stack
+		PoseBlender m_poseBlender;
+		std::vector<AnimationLayer> m_layerStack;
+		std::vector<Layer> m_layers;
+
+		// Keys both animations were last sampled at, swapped along with the animations
+		AnimationCursor m_animationCursor;
+		AnimationCursor m_prevAnimationCursor;
 
 		float m_animationTime = 0.0f;
 		float m_prevAnimationTime = 0.0f;
 
-		std::map<std::string_view, Matrix4x4> m_boneModifiers;
+		// Sorted by bone index of RiggedMesh
+		std::vector<BoneModifier> m_boneModifiers;
 
 		bool m_loop = false;
 		float m_transitionFactor = 0.0f;
 
-		std::array<std::vector<std::unique_ptr<UploadBuffer<BoneConstants>>>, FrameResourceCount> m_constantBuffers;
-		std::array<std::vector<std::unique_ptr<UploadBuffer<BoneConstants>>>, FrameResourceCount> m_prevConstantBuffers;
-		std::vector<BoneConstants> m_boneConstantsCache;
+		// Addresses of the bone palettes of each submesh uploaded when the frame was published
+		std::array<std::vector<D3D12_GPU_VIRTUAL_ADDRESS>, FrameResourceCount> m_constantBuffers;
+		std::array<std::vector<D3D12_GPU_VIRTUAL_ADDRESS>, FrameResourceCount> m_prevConstantBuffers;
+		// Skinning matrices of the submeshes built last and the ones before, the latter being uploaded as the previous palettes
+		BonePalette m_bonePalette;
 
 		bool m_constantBuffersDirty = true;
+		// Whether the pose was sampled since the palettes were last built, otherwise the last ones are uploaded again
+		bool m_bonePaletteDirty = true;
+
+		// Frames between two evaluations of the pose, the frames it was kept for since, and whether it is evaluated on this frame
+		UINT m_animationInterval = 1;
+		UINT m_skippedAnimationFrames = 0;
+		bool m_animationDue = true;
 	};
 }
\ No newline at end of file
@@ -4,12 +4,18 @@
 #include "shadow_map.h"
 #include "screen_space_ao.h"
 #include "renderer_base.h"
+#include "mesh_base.h"
 #include "frame_resource.h"
+#include "state_tracking_command_list.h"
 #include "scene_object.h"
+#include "component.h"
 #include "transform.h"
+#include "transform_system.h"
 #include "time_measure.h"
 #include "camera.h"
 #include "shader.h"
+#include "texture.h"
+#include "material.h"
 #include "core.h"
 #include "input.h"
 #include "deferred_renderer.h"
@@ -25,6 +31,25 @@ namespace udsdx
 {
 	extern unsigned long long g_localMatrixRecalculateCounter;
 	extern unsigned long long g_worldMatrixRecalculateCounter;
+	extern unsigned long long g_animationEvaluationCounter;
+
+	static void GatherBounds(const DrawList& list, CullingBounds& bounds)
+	{
+		std::span<const DrawItem> items = list.GetItems();
+		bounds.Resize(items.size());
+		for (size_t index = 0; index < items.size(); ++index)
+		{
+			const RendererBase* object = items[index].Object;
+			if (const BoundingBox* localBounds = object->GetLocalBounds())
+			{
+				bounds.Set(index, *localBounds, object->GetTransformCache());
+			}
+			else
+			{
+				bounds.SetUnbounded(index);
+			}
+		}
+	}
 
 	Scene::Scene()
 	{
@@ -45,22 +70,24 @@ namespace udsdx
 	void Scene::Update(const Time& time)
 	{ ZoneScoped;
 	    UpdateGUIElementEvent(time);
-		SceneObject::Enumerate(m_rootObjectSub, [&time, this](const std::shared_ptr<SceneObject>& sceneObject) { sceneObject->Update(time, *this); });
+		BeginPendingComponents();
+
+		DispatchComponentList(m_updateList, &Component::m_updateIndex, &Component::Update, time);
+		UpdateBatches(&ComponentRegistry::Systems::Update, time);
 	}
 
 	void Scene::PostUpdate(const Time& time)
 	{
 		m_renderCameraQueue.clear();
 		m_renderLightQueue.clear();
-		for (auto& queue : m_renderObjectQueues)
-		{
-			queue.clear();
-		}
-		m_renderShadowObjectQueue.clear();
+		m_renderObjectList.Clear();
+		m_renderShadowObjectList.Clear();
 		m_renderGUIObjectQueue.clear();
 
-		SceneObject::Enumerate(m_rootObjectSub, [&time, this](const std::shared_ptr<SceneObject>& sceneObject) { sceneObject->PostUpdate(time, *this); });
-		SceneObject::Enumerate(m_rootObjectSub, [&time, this](const std::shared_ptr<SceneObject>& sceneObject) { sceneObject->GetTransform()->ValidateSRTMatrices(); });
+		BeginPendingComponents();
+		DispatchComponentList(m_postUpdateList, &Component::m_postUpdateIndex, &Component::PostUpdate, time);
+		UpdateBatches(&ComponentRegistry::Systems::PostUpdate, time);
+		INSTANCE(TransformSystem)->UpdateWorldMatrices();
 	}
 
 	void Scene::OnDrawGizmos()
@@ -71,7 +98,7 @@ namespace udsdx
 
 		unsigned int activeObjectsCount = 0;
 		Camera* renderCamera = m_renderCameraQueue[0];
-		SceneObject::Enumerate(m_rootObjectSub, [&activeObjectsCount, renderCamera](const std::shared_ptr<SceneObject>& object) {
+		SceneObject::ForEachInHierarchy(m_rootObjectSub.get(), [&activeObjectsCount, renderCamera](SceneObject* object) {
 			activeObjectsCount++;
 			object->OnDrawGizmos(renderCamera);
 			});
@@ -81,27 +108,25 @@ namespace udsdx
 		ImGui::Text("Active Objects Count: %u", activeObjectsCount);
 		ImGui::Text("Local Matrix Recalculation Count: %zu", g_localMatrixRecalculateCounter);
 		ImGui::Text("World Matrix Recalculation Count: %zu", g_worldMatrixRecalculateCounter);
+		ImGui::Text("Transform Work Items: %zu", INSTANCE(TransformSystem)->GetWorkItemCount());
+		ImGui::Text("Animation Evaluation Count: %zu", g_animationEvaluationCounter);
+		size_t batchedComponentsCount = 0;
+		for (const auto& list : m_batchLists)
+		{
+			batchedComponentsCount += list.size();
+		}
+		ImGui::Text("Batched Components Count: %zu", batchedComponentsCount);
+		ImGui::Text("Update Components Count: %zu", m_updateList.size());
+		ImGui::Text("Post Update Components Count: %zu", m_postUpdateList.size());
 		g_localMatrixRecalculateCounter = 0;
 		g_worldMatrixRecalculateCounter = 0;
+		g_animationEvaluationCounter = 0;
 		if (ImGui::TreeNode("Draw Calls"))
 		{
 			ImGui::Text("Render Camera Count: %zu", m_renderCameraQueue.size());
 			ImGui::Text("Render Light Count: %zu", m_renderLightQueue.size());
-			ImGui::Text("Render Shadow Object Count: %zu", m_renderShadowObjectQueue.size());
-
-			for (size_t i = 0; i < m_renderObjectQueues.size(); ++i)
-			{
-				const auto& group = m_renderObjectQueues[i];
-				ImGui::Text("Render Group %zu:", i);
-				for (const auto& [defferedPipelineState, objectGroups] : group)
-				{
-					ImGui::Text("  Deferred Pipeline State: %p", defferedPipelineState);
-					for (const auto& [pipelineState, objects] : objectGroups)
-					{
-						ImGui::Text("    Object Count: %zu", objects.size());
-					}
-				}
-			}
+			ImGui::Text("Render Shadow Object Count: %zu", m_renderShadowObjectList.GetSize());
+			ImGui::Text("Render Object Count: %zu", m_renderObjectList.GetSize());
 			ImGui::TreePop();
 		}
 
@@ -136,34 +161,136 @@ namespace udsdx
 		ImGui::End();
 	}
 
-	void Scene::Render(RenderParam& param)
+	void Scene::PublishRenderSnapshot(RenderParam& param)
 	{ ZoneScoped;
-		std::vector<D3D12_GPU_VIRTUAL_ADDRESS> cameraCbvs(m_renderCameraQueue.size());
-		for (size_t i = 0; i < m_renderCameraQueue.size(); ++i)
+		RenderSnapshot& snapshot = m_renderSnapshots[param.FrameResourceIndex];
+
+		// Swapping keeps the capacity of both sides, the live lists are cleared on the next PostUpdate()
+		std::swap(snapshot.Objects, m_renderObjectList);
+		std::swap(snapshot.ShadowObjects, m_renderShadowObjectList);
+
+		// Resizing keeps the visibility sets of the views, so they are not reallocated every frame
+		snapshot.Cameras.resize(m_renderCameraQueue.size());
+		for (size_t index = 0; index < m_renderCameraQueue.size(); ++index)
 		{
-			cameraCbvs[i] = m_renderCameraQueue[i]->UpdateConstantBuffer(param.FrameResourceIndex, param.Viewport.Width, param.Viewport.Height);
+			Camera* camera = m_renderCameraQueue[index];
+			Transform* transform = camera->GetTransform();
+			RenderSnapshot::CameraView& view = snapshot.Cameras[index];
+			view.Target = camera;
+			view.ConstantBuffer = camera->UpdateConstantBuffer(*param.ConstantAllocator, param.Viewport.Width, param.Viewport.Height);
+			view.Position = transform->GetWorldPosition();
+			view.Rotation = transform->GetWorldRotation();
+			view.ViewMatrix = camera->GetViewMatrix(false);
+			view.ProjMatrix = camera->GetProjMatrix(param.AspectRatio);
+			view.ViewFrustumWorld = camera->GetViewFrustumWorld(param.AspectRatio);
 		}
 
-		param.CommandList->SetGraphicsRootSignature(param.RootSignature);
+		snapshot.LightDirections.clear();
+		for (LightDirectional* light : m_renderLightQueue)
+		{
+			snapshot.LightDirections.emplace_back(light->GetLightDirection());
+		}
+
+		// The shadow pass is drawn for the first light around the first camera
+		if (!snapshot.LightDirections.empty() && !snapshot.Cameras.empty())
+		{
+			param.RenderShadowMap->PrepareCascades(param.FrameResourceIndex, *param.ConstantAllocator, snapshot.Cameras[0].Position, snapshot.Cameras[0].Rotation, snapshot.LightDirections[0], snapshot.ShadowCascades);
+		}
+		else
+		{
+			param.RenderShadowMap->ClearCascades(param.FrameResourceIndex, *param.ConstantAllocator);
+		}
+
+		// Renderers write their transform caches and bone palettes here, which are only read while recording.
+		// The depth bucket and the level of detail are filled in afterwards, as they need the validated transform cache.
+		// The levels are picked for the first camera, and the shadow casters draw the same ones so they match their receivers.
+		Vector3 eyePosition = snapshot.Cameras.empty() ? Vector3::Zero : snapshot.Cameras[0].Position;
+		bool useMeshLod = param.RenderOptions->UseMeshLod && !snapshot.Cameras.empty();
+		auto prepareItem = [&](DrawItem& item)
+		{
+			item.Object->PrepareRender(param.FrameResourceIndex, *param.ConstantAllocator);
+			// The live material may be changed or reallocated by the next Update() while the items are recorded
+			item.Material = &item.Object->GetRenderMaterial(item.Parameter);
+			if (useMeshLod)
+			{
+				item.Object->SelectLod(eyePosition, snapshot.Cameras[0].ProjMatrix, param.RenderOptions->LodHysteresis);
+			}
+			else
+			{
+				item.Object->ResetLod();
+			}
+			item.Lod = item.Object->GetLod();
+		};
+		for (DrawItem& item : snapshot.Objects.GetItems())
+		{
+			prepareItem(item);
+			item.SortKey |= DrawList::MakeDepthBucket(Vector3::Distance(eyePosition, item.Object->GetTransformCache().Translation()));
+		}
+		for (DrawItem& item : snapshot.ShadowObjects.GetItems())
+		{
+			prepareItem(item);
+		}
+		snapshot.Objects.Sort();
+		snapshot.ShadowObjects.Sort();
+
+		// The batches of a group are offset to index the whole list, which the visibility sets are indexed by
+		for (RenderGroup group : { RenderGroup::Forward, RenderGroup::Deferred })
+		{
+			std::span<const DrawItem> items = snapshot.Objects.GetGroup(group);
+			std::vector<DrawBatch>& batches = snapshot.ObjectBatches[group];
+			DrawList::BuildBatches(items, batches);
+
+			UINT offset = static_cast<UINT>(items.data() - snapshot.Objects.GetItems().data());
+			for (DrawBatch& batch : batches)
+			{
+				batch.First += offset;
+			}
+		}
+		DrawList::BuildBatches(snapshot.ShadowObjects.GetItems(), snapshot.ShadowObjectBatches);
+
+		CullRenderSnapshot(snapshot, *param.RenderOptions);
+
+		snapshot.DeferredPipelineStates.clear();
+		for (const DrawItem& item : snapshot.Objects.GetGroup(RenderGroup::Deferred))
+		{
+			if (snapshot.DeferredPipelineStates.empty() || snapshot.DeferredPipelineStates.back() != item.DeferredPipelineState)
+			{
+				snapshot.DeferredPipelineStates.emplace_back(item.DeferredPipelineState);
+			}
+		}
 
-		if (!m_renderCameraQueue.empty())
+		if (!snapshot.Cameras.empty())
 		{
-			Transform* listenerTransform = m_renderCameraQueue[0]->GetTransform();
-			INSTANCE(Audio)->UpdateAudioListener(listenerTransform->GetWorldPosition(), listenerTransform->GetWorldRotation());
+			INSTANCE(Audio)->UpdateAudioListener(snapshot.Cameras[0].Position, snapshot.Cameras[0].Rotation);
 		}
 
+		// The sprite batch only queues the sprites until End(), which records them in PassRenderHUD()
+		param.SpriteBatchNonPremultipliedAlpha->SetViewport(param.Viewport);
+		param.SpriteBatchPreMultipliedAlpha->SetViewport(param.Viewport);
+		param.SpriteBatchNonPremultipliedAlpha->Begin(param.CommandList);
+		//param.SpriteBatchPreMultipliedAlpha->Begin(param.CommandList);
+
+		RenderGUIObjects(param, 1);
+	}
+
+	void Scene::Render(RenderParam& param)
+	{ ZoneScoped;
+		const RenderSnapshot& snapshot = m_renderSnapshots[param.FrameResourceIndex];
+
+		param.CommandList->SetGraphicsRootSignature(param.RootSignature);
+
 		// Shadow map rendering pass
-		if (!m_renderLightQueue.empty() && !m_renderCameraQueue.empty())
+		if (!snapshot.LightDirections.empty() && !snapshot.Cameras.empty())
 		{
-			param.CommandList->SetGraphicsRootConstantBufferView(RootParam::PerCameraCBV, cameraCbvs[0]);
-			PassRenderShadow(param, m_renderCameraQueue.front(), m_renderLightQueue[0]);
+			param.CommandList->SetGraphicsRootConstantBufferView(RootParam::PerCameraCBV, snapshot.Cameras[0].ConstantBuffer);
+			PassRenderShadow(param, snapshot.ShadowVisibility);
 		}
 
-		for (size_t i = 0; i < m_renderCameraQueue.size(); ++i)
+		for (const auto& camera : snapshot.Cameras)
 		{
-			param.TargetCamera = m_renderCameraQueue[i];
-			param.CommandList->SetGraphicsRootConstantBufferView(RootParam::PerCameraCBV, cameraCbvs[i]);
-			PassRenderMain(param, m_renderCameraQueue[i], cameraCbvs[i]);
+			param.TargetCamera = camera.Target;
+			param.CommandList->SetGraphicsRootConstantBufferView(RootParam::PerCameraCBV, camera.ConstantBuffer);
+			PassRenderMain(param, camera);
 		}
 
 		PassRenderHUD(param);
@@ -214,6 +341,164 @@ namespace udsdx
 		m_rootObjectSub->RemoveFromParent();
 	}
 
+	void Scene::RegisterComponent(Component* component)
+	{
+		if (m_componentPools.size() <= component->m_typeID)
+		{
+			m_componentPools.resize(component->m_typeID + 1);
+		}
+		AddToDenseList(m_componentPools[component->m_typeID], component, &Component::m_poolIndex);
+	}
+
+	void Scene::UnregisterComponent(Component* component)
+	{
+		RemoveFromDenseList(m_componentPools[component->m_typeID], component, &Component::m_poolIndex);
+	}
+
+	void Scene::RegisterActiveComponent(Component* component)
+	{
+		const ComponentRegistry::Systems& systems = INSTANCE(ComponentRegistry)->GetSystems(component->m_typeID);
+		if (component->m_isBegin)
+		{
+			if (systems.OverridesBegin)
+			{
+				m_pendingBegin.emplace_back(component);
+			}
+			else
+			{
+				component->m_isBegin = false;
+			}
+		}
+		if (systems.HasAny())
+		{
+			if (m_batchLists.size() <= component->m_typeID)
+			{
+				m_batchLists.resize(component->m_typeID + 1);
+			}
+			AddToDenseList(m_batchLists[component->m_typeID], component, &Component::m_batchIndex);
+		}
+		if (systems.OverridesUpdate && systems.Update == nullptr)
+		{
+			AddToDenseList(m_updateList, component, &Component::m_updateIndex);
+		}
+		if (systems.OverridesPostUpdate && systems.PostUpdate == nullptr)
+		{
+			AddToDenseList(m_postUpdateList, component, &Component::m_postUpdateIndex);
+		}
+	}
+
+	void Scene::UnregisterActiveComponent(Component* component)
+	{
+		const ComponentRegistry::Systems& systems = INSTANCE(ComponentRegistry)->GetSystems(component->m_typeID);
+		if (component->m_isBegin)
+		{
+			auto pending = std::find(m_pendingBegin.begin() + m_pendingBeginHead, m_pendingBegin.end(), component);
+			if (pending != m_pendingBegin.end())
+			{
+				m_pendingBegin.erase(pending);
+			}
+		}
+		if (systems.HasAny())
+		{
+			RemoveFromDenseList(m_batchLists[component->m_typeID], component, &Component::m_batchIndex);
+		}
+		if (systems.OverridesUpdate && systems.Update == nullptr)
+		{
+			RemoveFromComponentList(m_updateList, component, &Component::m_updateIndex);
+		}
+		if (systems.OverridesPostUpdate && systems.PostUpdate == nullptr)
+		{
+			RemoveFromComponentList(m_postUpdateList, component, &Component::m_postUpdateIndex);
+		}
+	}
+
+	void Scene::AddToDenseList(std::vector<Component*>& list, Component* component, UINT Component::* index)
+	{
+		component->*index = static_cast<UINT>(list.size());
+		list.emplace_back(component);
+	}
+
+	void Scene::RemoveFromDenseList(std::vector<Component*>& list, Component* component, UINT Component::* index)
+	{
+		// Swap with the last component to keep the list dense
+		Component* last = list.back();
+		last->*index = component->*index;
+		list[component->*index] = last;
+		list.pop_back();
+	}
+
+	void Scene::RemoveFromComponentList(std::vector<Component*>& list, Component* component, UINT Component::* index)
+	{
+		if (&list != m_dispatchedList)
+		{
+			RemoveFromDenseList(list, component, index);
+			return;
+		}
+		// Swapping would move a component not visited yet into a visited slot, so the slot is vacated and compacted after the dispatch
+		list[component->*index] = nullptr;
+		m_dispatchedListVacated = true;
+	}
+
+	void Scene::DispatchComponentList(std::vector<Component*>& list, UINT Component::* index, void (Component::* hook)(const Time&, Scene&), const Time& time)
+	{ ZoneScoped;
+		// Indexed rather than iterated, since the hooks may activate components, which appends to the list
+		m_dispatchedList = &list;
+		for (size_t i = 0; i < list.size(); ++i)
+		{
+			if (!m_pendingBegin.empty())
+			{
+				BeginPendingComponents();
+			}
+			if (Component* component = list[i])
+			{
+				(component->*hook)(time, *this);
+			}
+		}
+		m_dispatchedList = nullptr;
+
+		if (m_dispatchedListVacated)
+		{
+			m_dispatchedListVacated = false;
+			auto vacated = std::remove(list.begin(), list.end(), nullptr);
+			list.erase(vacated, list.end());
+			for (size_t i = 0; i < list.size(); ++i)
+			{
+				list[i]->*index = static_cast<UINT>(i);
+			}
+		}
+	}
+
+	void Scene::BeginPendingComponents()
+	{ ZoneScoped;
+		// Begin() may activate or deactivate other components, which appends to or erases from the rest of the queue
+		while (m_pendingBeginHead < m_pendingBegin.size())
+		{
+			Component* component = m_pendingBegin[m_pendingBeginHead++];
+			component->m_isBegin = false;
+			component->Begin();
+		}
+		m_pendingBegin.clear();
+		m_pendingBeginHead = 0;
+	}
+
+	void Scene::UpdateBatches(ComponentRegistry::BatchFunction ComponentRegistry::Systems::* phase, const Time& time)
+	{ ZoneScoped;
+		ComponentRegistry* registry = INSTANCE(ComponentRegistry);
+		for (ComponentRegistry::TypeID typeID = 0; typeID < m_batchLists.size(); ++typeID)
+		{
+			ComponentRegistry::BatchFunction function = registry->GetSystems(typeID).*phase;
+			if (function == nullptr || m_batchLists[typeID].empty())
+			{
+				continue;
+			}
+			if (!m_pendingBegin.empty())
+			{
+				BeginPendingComponents();
+			}
+			function(m_batchLists[typeID], time, *this);
+		}
+	}
+
 	void Scene::EnqueueRenderCamera(Camera* camera)
 	{
 		m_renderCameraQueue.emplace_back(camera);
@@ -224,14 +509,55 @@ namespace udsdx
 		m_renderLightQueue.emplace_back(light);
 	}
 
-	void Scene::EnqueueRenderObject(RendererBase* object, RenderGroup group, ID3D12PipelineState* pipelineState, ID3D12PipelineState* deferredPipelineState, int parameter)
+	void Scene::EnqueueRenderObject(RendererBase* object, RenderGroup group, const Material& material, ID3D12PipelineState* pipelineState, const ResourceObject* mesh, int parameter)
 	{
-		m_renderObjectQueues[group][deferredPipelineState][pipelineState].emplace_back(object, parameter);
+		const Shader* shader = material.GetShader();
+		const Texture* texture = material.GetSourceTexture();
+
+		DrawItem item;
+		item.SortKey = DrawList::MakeSortKey(
+			group,
+			shader->GetResourceID(),
+			pipelineState == shader->DefaultPipelineState() ? 0 : 1,
+			texture ? texture->GetResourceID() : 0,
+			mesh ? mesh->GetResourceID() : 0,
+			parameter
+		);
+		item.Object = object;
+		item.PipelineState = pipelineState;
+		item.DeferredPipelineState = shader->DeferredPipelineState();
+		item.Mesh = mesh;
+		item.Material = &material;
+		item.Parameter = parameter;
+		item.Topology = object->GetTopology();
+		item.DrawOutline = object->GetDrawOutline();
+		item.Instancing = object->GetInstancing();
+		m_renderObjectList.Add(item);
 	}
 
-	void Scene::EnqueueRenderShadowObject(RendererBase* object, ID3D12PipelineState* pipelineState, int parameter)
+	void Scene::EnqueueRenderShadowObject(RendererBase* object, const Material& material, ID3D12PipelineState* pipelineState, const ResourceObject* mesh, int parameter)
 	{
-		m_renderShadowObjectQueue[pipelineState].emplace_back(object, parameter);
+		// The deferred pipeline state does not take part in the shadow pass
+		const Shader* shader = material.GetShader();
+		const Texture* texture = material.GetSourceTexture();
+
+		DrawItem item;
+		item.SortKey = DrawList::MakeSortKey(
+			0,
+			shader->GetResourceID(),
+			pipelineState == shader->ShadowPipelineState() ? 0 : 1,
+			texture ? texture->GetResourceID() : 0,
+			mesh ? mesh->GetResourceID() : 0,
+			parameter
+		);
+		item.Object = object;
+		item.PipelineState = pipelineState;
+		item.Mesh = mesh;
+		item.Material = &material;
+		item.Parameter = parameter;
+		item.Topology = object->GetTopology();
+		item.Instancing = object->GetInstancing();
+		m_renderShadowObjectList.Add(item);
 	}
 
 	void Scene::EnqueueRenderGUIObject(GUIElement* object)
@@ -239,44 +565,40 @@ namespace udsdx
 		m_renderGUIObjectQueue.emplace_back(object);
 	}
 
-	void Scene::PassRenderShadow(RenderParam& param, Camera* camera, LightDirectional* light)
+	void Scene::PassRenderShadow(RenderParam& param, std::span<const VisibilitySet, ShadowMap::CascadeCount> casterVisibility)
 	{
 		ZoneScopedN("Shadow Render Pass");
 		TracyD3D12Zone(*param.TracyQueueContext, param.CommandList, "Shadow Render Pass");
-		param.RenderShadowMap->Pass(param, this, camera, light);
+		param.RenderShadowMap->Pass(param, this, casterVisibility);
 	}
 
-	void Scene::PassRenderSSAO(RenderParam& param, Camera* camera)
+	void Scene::PassRenderSSAO(RenderParam& param, const RenderSnapshot::CameraView& camera)
 	{
 		ZoneScopedN("SSAO Render Pass");
 		TracyD3D12Zone(*param.TracyQueueContext, param.CommandList, "SSAO Render Pass");
 		if (param.RenderOptions->DrawSSAO)
 		{
-			param.RenderScreenSpaceAO->UpdateSSAOConstants(param, camera);
+			param.RenderScreenSpaceAO->UpdateSSAOConstants(param, camera.ProjMatrix);
 			param.RenderScreenSpaceAO->PassSSAO(param);
 			param.RenderScreenSpaceAO->PassBlur(param);
 		}
 	}
 
-	void Scene::PassRenderMain(RenderParam& param, Camera* camera, D3D12_GPU_VIRTUAL_ADDRESS cameraCbv)
+	void Scene::PassRenderMain(RenderParam& param, const RenderSnapshot::CameraView& camera)
 	{
 		ZoneScopedN("Main Pass");
 		TracyD3D12Zone(*param.TracyQueueContext, param.CommandList, "Main Pass");
 
 		auto pCommandList = param.CommandList;
+		D3D12_GPU_VIRTUAL_ADDRESS cameraCbv = camera.ConstantBuffer;
 
-		std::vector<ID3D12PipelineState*> defferedPipelineStates;
-		for (const auto& [defferedPipelineState, objectGroups] : m_renderObjectQueues[RenderGroup::Deferred])
-		{
-			defferedPipelineStates.push_back(defferedPipelineState);
-		}
+		const std::vector<ID3D12PipelineState*>& defferedPipelineStates = m_renderSnapshots[param.FrameResourceIndex].DeferredPipelineStates;
 
 		// Deferred rendering pass
 		param.Renderer->PassBufferPreparation(param);
 		param.Renderer->ClearRenderTargets(pCommandList);
 
-		std::unique_ptr<BoundingCamera> boundingCamera = camera->GetViewFrustumWorld(param.AspectRatio);
-		param.ViewFrustumWorld = boundingCamera.get();
+		param.Visibility = &camera.Visibility;
 
 		RenderSceneObjects(param, RenderGroup::Deferred, 1);
 
@@ -327,58 +649,162 @@ namespace udsdx
 
 	void Scene::PassRenderHUD(RenderParam& param)
 	{
-		param.SpriteBatchNonPremultipliedAlpha->SetViewport(param.Viewport);
-		param.SpriteBatchPreMultipliedAlpha->SetViewport(param.Viewport);
-		param.SpriteBatchNonPremultipliedAlpha->Begin(param.CommandList);
-		//param.SpriteBatchPreMultipliedAlpha->Begin(param.CommandList);
-
-		RenderGUIObjects(param, 1);
-
+		// The sprites were queued in PublishRenderSnapshot()
 		param.SpriteBatchNonPremultipliedAlpha->End();
 		//param.SpriteBatchPreMultipliedAlpha->End();
 	}
 
 	void Scene::RenderShadowSceneObjects(RenderParam& param, int instances)
 	{
-		for (const auto& [pipelineState, objects] : m_renderShadowObjectQueue)
+		const RenderSnapshot& snapshot = m_renderSnapshots[param.FrameResourceIndex];
+		std::span<const DrawItem> items = snapshot.ShadowObjects.GetItems();
+
+		// The pass set up the command list directly before the loop
+		param.TrackedCommandList->Invalidate();
+		for (const DrawBatch& batch : snapshot.ShadowObjectBatches)
 		{
-			param.CommandList->SetPipelineState(pipelineState);
-			for (const auto& [object, parameter] : objects)
-			{
-				object->ValidateTransformCache();
-				object->Render(param, parameter);
-			}
+			param.TrackedCommandList->SetPipelineState(items[batch.First].PipelineState);
+			RenderBatch(param, items, batch);
 		}
 		param.RenderStageIndex++;
 	}
 	
 	void Scene::RenderSceneObjects(RenderParam& param, RenderGroup group, int instances)
 	{
+		const RenderSnapshot& snapshot = m_renderSnapshots[param.FrameResourceIndex];
+		std::span<const DrawItem> items = snapshot.Objects.GetItems();
+
+		// The items are sorted by their deferred pipeline state first, and each run of them takes the next stencil value.
+		// A batch shares the material, so it never spans two runs.
 		UINT pipelineCount = 0;
-		for (const auto& [defferedPipelineState, objectGroups] : m_renderObjectQueues[group])
+		ID3D12PipelineState* defferedPipelineState = nullptr;
+		param.TrackedCommandList->Invalidate();
+		for (const DrawBatch& batch : snapshot.ObjectBatches[group])
 		{
-			if (pipelineCount >= 128)
+			const DrawItem& item = items[batch.First];
+			if (item.DeferredPipelineState != defferedPipelineState)
 			{
-				DebugConsole::LogWarning("Too many deffered pipeline states in render stage: " + std::to_string(group) + ". Limit is 128.");
-				break;
+				if (defferedPipelineState != nullptr)
+				{
+					pipelineCount++;
+				}
+				if (pipelineCount >= 128)
+				{
+					DebugConsole::LogWarning("Too many deffered pipeline states in render stage: " + std::to_string(group) + ". Limit is 128.");
+					break;
+				}
+				defferedPipelineState = item.DeferredPipelineState;
 			}
+			param.TrackedCommandList->SetPipelineState(item.PipelineState);
+			param.TrackedCommandList->OMSetStencilRef(pipelineCount | (static_cast<UINT>(item.DrawOutline) << 7));
+			RenderBatch(param, items, batch);
+		}
 
-			for (const auto& [pipelineState, objects] : objectGroups)
-			{
-				param.CommandList->SetPipelineState(pipelineState);
+		param.RenderStageIndex++;
+	}
 
-				for (const auto& [object, parameter] : objects)
+	void Scene::CullRenderSnapshot(RenderSnapshot& snapshot, const RenderOptions& options)
+	{ ZoneScoped;
+		GatherBounds(snapshot.Objects, snapshot.ObjectBounds);
+		for (RenderSnapshot::CameraView& camera : snapshot.Cameras)
+		{
+			snapshot.ObjectBounds.Cull(camera.ViewFrustumWorld, camera.Visibility);
+		}
+
+		m_occluderItems.clear();
+		if (options.UseOcclusionCulling)
+		{
+			std::span<const DrawItem> items = snapshot.Objects.GetItems();
+			for (UINT index = 0; index < static_cast<UINT>(items.size()); ++index)
+			{
+				if (items[index].Object->GetOccluderMesh() != nullptr)
 				{
-					param.CommandList->OMSetStencilRef(pipelineCount | (static_cast<UINT>(object->GetDrawOutline()) << 7));
-					object->ValidateTransformCache();
-					object->Render(param, parameter);
+					m_occluderItems.emplace_back(index);
 				}
 			}
+		}
+		if (!m_occluderItems.empty())
+		{
+			for (RenderSnapshot::CameraView& camera : snapshot.Cameras)
+			{
+				OccludeRenderSnapshot(snapshot, camera);
+			}
+		}
 
-			pipelineCount++;
+		// All cascades are culled in a single pass over the casters
+		if (!snapshot.LightDirections.empty() && !snapshot.Cameras.empty())
+		{
+			GatherBounds(snapshot.ShadowObjects, snapshot.ShadowObjectBounds);
+			snapshot.ShadowObjectBounds.Cull(snapshot.ShadowCascades, snapshot.ShadowVisibility);
 		}
+	}
 
-		param.RenderStageIndex++;
+	void Scene::OccludeRenderSnapshot(RenderSnapshot& snapshot, RenderSnapshot::CameraView& camera)
+	{ ZoneScoped;
+		std::span<const DrawItem> items = snapshot.Objects.GetItems();
+		m_occlusionBuffer.Reset(camera.ViewMatrix * camera.ProjMatrix);
+		for (UINT index : m_occluderItems)
+		{
+			if (camera.Visibility.IsVisible(index))
+			{
+				const RendererBase* object = items[index].Object;
+				const MeshBase* mesh = object->GetOccluderMesh();
+				const Submesh& submesh = mesh->GetSubmeshes()[items[index].Parameter];
+				m_occlusionBuffer.AddOccluder(mesh->GetVertexData(), mesh->GetVertexByteStride(),
+					mesh->GetIndexData().subspan(submesh.StartIndexLocation, submesh.IndexCount), submesh.BaseVertexLocation, object->GetTransformCache());
+			}
+		}
+		if (!m_occlusionBuffer.HasOccluders())
+		{
+			return;
+		}
+
+		m_occlusionBuffer.Rasterize();
+		snapshot.ObjectBounds.Occlude(m_occlusionBuffer, camera.Visibility);
+	}
+
+	void Scene::RenderBatch(RenderParam& param, std::span<const DrawItem> items, const DrawBatch& batch)
+	{
+		// Culled items are skipped by their bits, without touching the renderers
+		const VisibilitySet* visibility = param.UseFrustumCulling ? param.Visibility : nullptr;
+		auto isVisible = [visibility](UINT index) { return visibility == nullptr || visibility->IsVisible(index); };
+
+		const DrawItem& first = items[batch.First];
+		if (batch.Count == 1)
+		{
+			if (isVisible(batch.First))
+			{
+				first.Object->Render(param, first.Parameter);
+			}
+			return;
+		}
+
+		// The memory is recycled by GraphicsMemory once the GPU has finished the frame
+		GraphicsResource instanceMemory = GraphicsMemory::Get().Allocate(sizeof(InstanceData) * batch.Count, 16);
+		InstanceData* instances = static_cast<InstanceData*>(instanceMemory.Memory());
+		UINT instanceCount = 0;
+		for (UINT index = batch.First; index < batch.First + batch.Count; ++index)
+		{
+			const RendererBase* object = items[index].Object;
+			if (isVisible(index))
+			{
+				instances[instanceCount].World = object->GetTransformCache();
+				instances[instanceCount].PrevWorld = object->GetPrevTransformCache();
+				++instanceCount;
+			}
+		}
+		if (instanceCount == 0)
+		{
+			return;
+		}
+
+		D3D12_VERTEX_BUFFER_VIEW instanceView;
+		instanceView.BufferLocation = instanceMemory.GpuAddress();
+		instanceView.SizeInBytes = sizeof(InstanceData) * instanceCount;
+		instanceView.StrideInBytes = sizeof(InstanceData);
+		param.TrackedCommandList->IASetVertexBuffers(1, 1, &instanceView);
+
+		first.Object->RenderInstanced(param, first.Parameter, instanceCount);
 	}
 
 	void Scene::RenderGUIObjects(RenderParam& param, int instances)
@@ -1,6 +1,11 @@
 #pragma once
 
 #include "pch.h"
+#include "component_registry.h"
+#include "draw_list.h"
+#include "culling.h"
+#include "shadow_map.h"
+#include "occlusion_buffer.h"
 
 namespace udsdx
 {
@@ -9,11 +14,46 @@ namespace udsdx
 	class GUIElement;
 	class Camera;
 	class LightDirectional;
+	class Component;
+	class ResourceObject;
+	struct Material;
 
 	class Scene
 	{
 	private:
-		using RendererGroup = std::unordered_map<ID3D12PipelineState*, std::unordered_map<ID3D12PipelineState*, std::vector<std::pair<RendererBase*, int>>>>;
+		// Everything the render passes read from the scene, captured when a frame is published.
+		// Recording from it does not touch the live scene, so the next frame can be updated meanwhile.
+		struct RenderSnapshot
+		{
+			struct CameraView
+			{
+				Camera* Target = nullptr;
+				D3D12_GPU_VIRTUAL_ADDRESS ConstantBuffer = 0;
+				Vector3 Position;
+				Quaternion Rotation;
+				Matrix4x4 ViewMatrix;
+				Matrix4x4 ProjMatrix;
+				ViewVolume ViewFrustumWorld;
+				// Visibility of the items of the object list in the view, after the frustum and the occluders
+				VisibilitySet Visibility;
+			};
+
+			std::vector<CameraView> Cameras;
+			std::vector<Vector3> LightDirections;
+			DrawList Objects;
+			DrawList ShadowObjects;
+			// World bounds of the items of both lists, in the sorted order
+			CullingBounds ObjectBounds;
+			CullingBounds ShadowObjectBounds;
+			// Light space boxes of the shadow cascades, and the visibility of the items of the shadow list in each of them
+			std::array<ViewVolume, ShadowMap::CascadeCount> ShadowCascades;
+			std::array<VisibilitySet, ShadowMap::CascadeCount> ShadowVisibility;
+			// Instanced draws, indexed into the items of the object list and of the shadow list
+			std::array<std::vector<DrawBatch>, 2> ObjectBatches;
+			std::vector<DrawBatch> ShadowObjectBatches;
+			// Distinct deferred pipeline states of the deferred group, in the order they are drawn
+			std::vector<ID3D12PipelineState*> DeferredPipelineStates;
+		};
 
 	public:
 		Scene();
@@ -32,6 +72,10 @@ namespace udsdx
 		// Called when the component needs to draw ImGUI primitives
 		virtual void OnDrawGizmos();
 
+		// Called before Render() to capture the render queues of the frame, along with the transform caches, bone palettes and sprites.
+		// The main thread is blocked during the call, but may run the next Update() while Render() records from the snapshot.
+		virtual void PublishRenderSnapshot(RenderParam& param);
+
 		// Called when the scene needs to draw primitives. The command list already called Reset() and is ready to use.
 		virtual void Render(RenderParam& param);
 
@@ -44,21 +88,76 @@ namespace udsdx
 		void HandleAttach();
 		void HandleDetach();
 
+	public:
+		// Called when a component is attached to or detached from the scene
+		void RegisterComponent(Component* component);
+		void UnregisterComponent(Component* component);
+
+		// Called when a component becomes hierarchically active or inactive in the scene.
+		// Adds the component to the dispatch lists of the hooks its type overrides, and queues Begin() if it has not begun yet.
+		void RegisterActiveComponent(Component* component);
+		void UnregisterActiveComponent(Component* component);
+
+		// Visits every component attached to the scene which is of the given type, or derives from it
+		template <typename Component_T, typename Function_T>
+		void ForEachComponent(Function_T&& callback) const
+		{
+			ComponentRegistry* registry = INSTANCE(ComponentRegistry);
+			ComponentRegistry::TypeID typeID = ComponentRegistry::GetTypeID<Component_T>();
+			for (const auto& pool : m_componentPools)
+			{
+				if (pool.empty() || !registry->IsA(pool.front(), typeID))
+				{
+					continue;
+				}
+				for (Component* component : pool)
+				{
+					callback(static_cast<Component_T*>(component));
+				}
+			}
+		}
+
 	public:
 		void EnqueueRenderCamera(Camera* camera);
 		void EnqueueRenderLight(LightDirectional* light);
-		void EnqueueRenderObject(RendererBase* object, RenderGroup group, ID3D12PipelineState* pipelineState, ID3D12PipelineState* deferredPipelineState, int parameter);
-		void EnqueueRenderShadowObject(RendererBase* object, ID3D12PipelineState* pipelineState, int parameter);
+		// The material and the mesh only feed the sort key, which groups the draws by their states
+		void EnqueueRenderObject(RendererBase* object, RenderGroup group, const Material& material, ID3D12PipelineState* pipelineState, const ResourceObject* mesh, int parameter);
+		void EnqueueRenderShadowObject(RendererBase* object, const Material& material, ID3D12PipelineState* pipelineState, const ResourceObject* mesh, int parameter);
 		void EnqueueRenderGUIObject(GUIElement* object);
 
+		// First camera queued this frame, which the levels of detail are picked for.
+		// The cameras are queued by the per-object pass, so it is known to the batch functions of PostUpdate().
+		Camera* GetMainCamera() const { return m_renderCameraQueue.empty() ? nullptr : m_renderCameraQueue.front(); }
+
 		void RenderShadowSceneObjects(RenderParam& param, int instances = 1);
 		void RenderSceneObjects(RenderParam& param, RenderGroup group, int instances = 1);
 		void RenderGUIObjects(RenderParam& param, int instances = 1);
 
 	private:
-		void PassRenderShadow(RenderParam& param, Camera* camera, LightDirectional* light);
-		void PassRenderSSAO(RenderParam& param, Camera* camera);
-		void PassRenderMain(RenderParam& param, Camera* camera, D3D12_GPU_VIRTUAL_ADDRESS cameraCbv);
+		// Gathers the world bounds of the sorted lists, and culls the objects against every camera and the shadow casters against every cascade
+		void CullRenderSnapshot(RenderSnapshot& snapshot, const RenderOptions& options);
+		// Rasterizes the occluders visible in the camera, and clears the visibility of the objects hidden behind them
+		void OccludeRenderSnapshot(RenderSnapshot& snapshot, RenderSnapshot::CameraView& camera);
+		// Records the batch as one instanced draw with the transforms of its visible renderers, or the renderer itself if it is alone
+		void RenderBatch(RenderParam& param, std::span<const DrawItem> items, const DrawBatch& batch);
+
+	private:
+		static void AddToDenseList(std::vector<Component*>& list, Component* component, UINT Component::* index);
+		static void RemoveFromDenseList(std::vector<Component*>& list, Component* component, UINT Component::* index);
+		// Removes the component from a per-object hook list, or vacates its slot if the list is being dispatched
+		void RemoveFromComponentList(std::vector<Component*>& list, Component* component, UINT Component::* index);
+		// Calls the hook of every component in the list, then compacts the slots vacated by the hooks in place
+		void DispatchComponentList(std::vector<Component*>& list, UINT Component::* index, void (Component::* hook)(const Time&, Scene&), const Time& time);
+
+		// Calls Begin() of the queued components in activation order, including the ones queued meanwhile
+		void BeginPendingComponents();
+		// Runs the batch function of the phase for every type which has one, after the per-object pass
+		void UpdateBatches(ComponentRegistry::BatchFunction ComponentRegistry::Systems::* phase, const Time& time);
+
+	private:
+		void PassRenderShadow(RenderParam& param, std::span<const VisibilitySet, ShadowMap::CascadeCount> casterVisibility);
+		void PassRenderSSAO(RenderParam& param, const RenderSnapshot::CameraView& camera);
+		void PassRenderMain(RenderParam& param, const RenderSnapshot::CameraView& camera);
 		void PassRenderHUD(RenderParam& param);
 
 	protected:
@@ -67,9 +166,32 @@ namespace udsdx
 
 		std::vector<Camera*> m_renderCameraQueue;
 		std::vector<LightDirectional*> m_renderLightQueue;
-		std::array<RendererGroup, 2> m_renderObjectQueues;
-		std::unordered_map<ID3D12PipelineState*, std::vector<std::pair<RendererBase*, int>>> m_renderShadowObjectQueue;
+		DrawList m_renderObjectList;
+		DrawList m_renderShadowObjectList;
 		std::vector<GUIElement*> m_renderGUIObjectQueue;
+
+		// Published snapshots, one per frame resource
+		std::array<RenderSnapshot, FrameResourceCount> m_renderSnapshots;
+
+		// Only used while a snapshot is culled, shared by the cameras
+		OcclusionBuffer m_occlusionBuffer;
+		// Items of the object list with occluder meshes, gathered once for all cameras
+		std::vector<UINT> m_occluderItems;
+
+		// Attached components, densely packed per concrete type ID
+		std::vector<std::vector<Component*>> m_componentPools;
+		// Active components of the types with batch functions, densely packed per concrete type ID
+		std::vector<std::vector<Component*>> m_batchLists;
+		// Active components whose type overrides the hook and does not batch it.
+		// Dispatched in activation order rather than hierarchy order, so a parent is not guaranteed to update before its children.
+		std::vector<Component*> m_updateList;
+		std::vector<Component*> m_postUpdateList;
+		// List whose hooks are being called, which only vacates the slots of the components deactivated meanwhile
+		std::vector<Component*>* m_dispatchedList = nullptr;
+		bool m_dispatchedListVacated = false;
+		// Active components waiting for Begin(), consumed from m_pendingBeginHead
+		std::vector<Component*> m_pendingBegin;
+		size_t m_pendingBeginHead = 0;
 	};
 }
 
@@ -2,6 +2,7 @@
 #include "scene_object.h"
 #include "transform.h"
 #include "component.h"
+#include "scene.h"
 #include "camera.h"
 #include "core.h"
 
@@ -11,65 +12,103 @@ namespace udsdx
 
 	int SceneObject::GarbageCollector::m_currentFrameResourceIndex = 1;
 	std::array<std::vector<SceneObject*>, FrameResourceCount + 1> SceneObject::GarbageCollector::m_garbage;
+	std::array<std::vector<Component*>, FrameResourceCount + 1> SceneObject::GarbageCollector::m_componentGarbage;
+
+	std::vector<std::unique_ptr<std::byte[]>> SceneObject::Pool::m_chunks;
+	std::vector<SceneObject*> SceneObject::Pool::m_objects;
+	std::vector<UINT> SceneObject::Pool::m_generations;
+	std::vector<UINT> SceneObject::Pool::m_freeIndices;
 
 	void SceneObject::GarbageCollector::Stash(SceneObject* object)
 	{
 		m_garbage[m_currentFrameResourceIndex].emplace_back(object);
 	}
 
+	void SceneObject::GarbageCollector::Stash(Component* component)
+	{
+		m_componentGarbage[m_currentFrameResourceIndex].emplace_back(component);
+	}
+
 	void SceneObject::GarbageCollector::Collect(int frameResourceIndex)
 	{
 		m_currentFrameResourceIndex = FrameResourceCount;
 		for (SceneObject* object : m_garbage[frameResourceIndex])
 		{
 			// Caution: This operation will stash other objects into the garbage collector
-			delete object;
+			Pool::Destroy(object);
+		}
+		// The components of the objects destroyed above are stashed into the spare slot, and deleted in a later frame
+		for (Component* component : m_componentGarbage[frameResourceIndex])
+		{
+			delete component;
 		}
 		m_garbage[frameResourceIndex] = m_garbage[FrameResourceCount];
 		m_garbage[FrameResourceCount].clear();
+		m_componentGarbage[frameResourceIndex] = m_componentGarbage[FrameResourceCount];
+		m_componentGarbage[FrameResourceCount].clear();
 		m_currentFrameResourceIndex = frameResourceIndex;
 	}
 
-	void SceneObject::Enumerate(const std::shared_ptr<SceneObject>& root, std::function<void(const std::shared_ptr<SceneObject>&)> callback, bool onlyActive)
+	SceneObject* SceneObject::Pool::Create()
 	{
-		static std::stack<std::shared_ptr<SceneObject>> s;
-		size_t sBase = s.size();
-		std::shared_ptr<SceneObject> node = root->m_child;
-		if (!onlyActive || root->m_active)
-		{
-			callback(root);
+		static_assert(alignof(SceneObject) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
 
-			// Perform in-order traversal (sibiling-node-child)
-			// Since the order of the siblings is reversed, it needs to visit the siblings first
-			while (s.size() > sBase || node != nullptr)
+		UINT index;
+		if (m_freeIndices.empty())
+		{
+			index = static_cast<UINT>(m_objects.size());
+			if (index % ChunkSize == 0)
 			{
-				if (node != nullptr)
-				{
-					s.emplace(node);
-					node = node->m_sibling;
-				}
-				else
-				{
-					// node is guaranteed to have an instance
-					node = s.top();
-					s.pop();
-					if (!onlyActive || node->m_active)
-					{
-						callback(node);
-						node = node->m_child;
-					}
-					else
-					{
-						node = nullptr;
-					}
-				}
+				m_chunks.emplace_back(std::make_unique<std::byte[]>(sizeof(SceneObject) * ChunkSize));
 			}
+			m_objects.emplace_back(nullptr);
+			m_generations.emplace_back(0);
 		}
+		else
+		{
+			index = m_freeIndices.back();
+			m_freeIndices.pop_back();
+		}
+
+		std::byte* memory = m_chunks[index / ChunkSize].get() + sizeof(SceneObject) * (index % ChunkSize);
+		SceneObject* object = new (memory) SceneObject();
+		object->m_index = index;
+		m_objects[index] = object;
+		return object;
+	}
+
+	void SceneObject::Pool::Invalidate(SceneObject* object)
+	{
+		m_generations[object->m_index]++;
+	}
+
+	void SceneObject::Pool::Destroy(SceneObject* object)
+	{
+		UINT index = object->m_index;
+		object->~SceneObject();
+		m_objects[index] = nullptr;
+		m_freeIndices.emplace_back(index);
+	}
+
+	std::vector<SceneObject*>& SceneObject::GetTraversalStack()
+	{
+		thread_local std::vector<SceneObject*> stack;
+		return stack;
 	}
 
 	std::shared_ptr<SceneObject> SceneObject::MakeShared()
 	{
-		return std::shared_ptr<SceneObject>(new SceneObject(), SceneObjectDeleter());
+		return std::shared_ptr<SceneObject>(Pool::Create(), SceneObjectDeleter(), ControlBlockAllocator<SceneObject>());
+	}
+
+	SceneObject* SceneObject::Resolve(SceneObjectHandle handle)
+	{
+		SceneObject* object = Pool::Get(handle.Index);
+		if (object == nullptr || Pool::GetGeneration(handle.Index) != handle.Generation)
+		{
+			return nullptr;
+		}
+		return object;
 	}
 
 	SceneObject::SceneObject()
@@ -79,6 +118,19 @@ namespace udsdx
 
 	SceneObject::~SceneObject()
 	{
+		// The children are only kept alive by being attached to this object
+		SceneObject* child = Pool::Get(m_child);
+		while (child != nullptr)
+		{
+			SceneObject* sibling = Pool::Get(child->m_sibling);
+			child->m_parent = Pool::InvalidIndex;
+			child->m_back = Pool::InvalidIndex;
+			child->m_sibling = Pool::InvalidIndex;
+			child->m_transform.SetParent(nullptr);
+			child->m_attachedRef.reset();
+			child = sibling;
+		}
+
 		--g_sceneObjectCount;
 	}
 
@@ -87,21 +139,71 @@ namespace udsdx
 		return &m_transform;
 	}
 
+	SceneObjectHandle SceneObject::GetHandle() const
+	{
+		return { m_index, Pool::GetGeneration(m_index) };
+	}
+
+	void SceneObject::BuildComponentTable() const
+	{
+		ComponentRegistry* registry = INSTANCE(ComponentRegistry);
+		m_componentTable.assign(registry->GetTypeCount(), 0);
+
+		assert(m_components.size() < std::numeric_limits<UINT8>::max());
+		for (ComponentRegistry::TypeID typeID = 0; typeID < m_componentTable.size(); ++typeID)
+		{
+			for (size_t index = 0; index < m_components.size(); ++index)
+			{
+				if (registry->IsA(m_components[index].get(), typeID))
+				{
+					m_componentTable[typeID] = static_cast<UINT8>(index + 1);
+					break;
+				}
+			}
+		}
+	}
+
+	void SceneObject::AttachComponent(Component* component, Scene* scene)
+	{
+		scene->RegisterComponent(component);
+		component->OnAttach();
+	}
+
+	void SceneObject::DetachComponent(Component* component, Scene* scene)
+	{
+		component->OnDetach();
+		scene->UnregisterComponent(component);
+	}
+
+	void SceneObject::ActivateComponent(Component* component, Scene* scene)
+	{
+		scene->RegisterActiveComponent(component);
+		component->OnActive();
+	}
+
+	void SceneObject::DeactivateComponent(Component* component, Scene* scene)
+	{
+		component->OnInactive();
+		scene->UnregisterActiveComponent(component);
+	}
+
 	void SceneObject::RemoveAllComponents()
 	{
 		decltype(m_components) componentsToDelete;
 		componentsToDelete.swap(m_components);
+		m_componentTable.clear();
 
 		bool activeInScene = GetActiveInScene();
 		bool attachedInScene = GetAttachedInScene();
 
+		Scene* scene = GetScene();
 		if (activeInScene)
 		{
 			for (auto& component : componentsToDelete)
 			{
 				if (component->GetActive())
 				{
-					component->OnInactive();
+					DeactivateComponent(component.get(), scene);
 				}
 			}
 		}
@@ -109,41 +211,7 @@ namespace udsdx
 		{
 			for (auto& component : componentsToDelete)
 			{
-				component->OnDetach();
-			}
-		}
-	}
-
-	void SceneObject::Update(const Time& time, Scene& scene)
-	{
-		// Update components
-		for (const auto& component : m_components)
-		{
-			if (component->GetActive())
-			{
-				if (component->m_isBegin)
-				{
-					component->Begin();
-					component->m_isBegin = false;
-				}
-				component->Update(time, scene);
-			}
-		}
-	}
-
-	void SceneObject::PostUpdate(const Time& time, Scene& scene)
-	{
-		// Update components
-		for (const auto& component : m_components)
-		{
-			if (component->GetActive())
-			{
-				if (component->m_isBegin)
-				{
-					component->Begin();
-					component->m_isBegin = false;
-				}
-				component->PostUpdate(time, scene);
+				DetachComponent(component.get(), scene);
 			}
 		}
 	}
@@ -258,25 +326,25 @@ namespace udsdx
 
 	void SceneObject::AddChild(std::shared_ptr<SceneObject> child)
 	{
-		if (m_child != nullptr)
+		if (SceneObject* first = Pool::Get(m_child))
 		{
-			m_child->m_back = child.get();
+			first->m_back = child->m_index;
 		}
 
 		child->m_sibling = m_child;
-		child->m_parent = this;
-		child->m_back = this;
-		m_child = child;
+		child->m_parent = m_index;
+		child->m_back = m_index;
+		child->m_attachedRef = child;
+		m_child = child->m_index;
 
-		m_transform.m_children.emplace_back(&child->m_transform);
-		child->m_transform.m_parent = &m_transform;
+		child->m_transform.SetParent(&m_transform);
 
 		std::vector<Component*> componentsToAttach;
 		std::vector<Component*> componentsToActive;
 
 		if (child->GetAttachedInScene())
 		{
-			Enumerate(child, [&componentsToAttach](const auto& object) {
+			ForEachInHierarchy(child.get(), [&componentsToAttach](const auto& object) {
 				for (auto& component : object->m_components)
 				{
 					componentsToAttach.emplace_back(component.get());
@@ -285,7 +353,7 @@ namespace udsdx
 		}
 		if (child->GetActiveInScene())
 		{
-			Enumerate(child, [&componentsToActive](const auto& object) {
+			ForEachInHierarchy(child.get(), [&componentsToActive](const auto& object) {
 				for (auto& component : object->m_components)
 				{
 					if (component->GetActive())
@@ -296,29 +364,31 @@ namespace udsdx
 			}, true);
 		}
 
+		Scene* scene = child->GetScene();
 		for (auto& component : componentsToAttach)
 		{
-			component->OnAttach();
+			AttachComponent(component, scene);
 		}
 		for (auto& component : componentsToActive)
 		{
-			component->OnActive();
+			ActivateComponent(component, scene);
 		}
 	}
 
 	void SceneObject::RemoveFromParent()
 	{
-		if (m_parent == nullptr)
+		if (m_parent == Pool::InvalidIndex)
 		{
 			return;
 		}
 
 		std::vector<Component*> componentsToDetach;
 		std::vector<Component*> componentsToInactive;
+		Scene* scene = GetScene();
 
 		if (GetAttachedInScene())
 		{
-			Enumerate(shared_from_this(), [&componentsToDetach](const auto& object) {
+			ForEachInHierarchy(this, [&componentsToDetach](const auto& object) {
 				for (auto& component : object->m_components)
 				{
 					componentsToDetach.emplace_back(component.get());
@@ -327,7 +397,7 @@ namespace udsdx
 		}
 		if (GetActiveInScene())
 		{
-			Enumerate(shared_from_this(), [&componentsToInactive](const auto& object) {
+			ForEachInHierarchy(this, [&componentsToInactive](const auto& object) {
 				for (auto& component : object->m_components)
 				{
 					if (component->GetActive())
@@ -338,47 +408,42 @@ namespace udsdx
 				}, true);
 		}
 
-		m_transform.m_parent = nullptr;
-		if (m_parent != nullptr)
-		{
-			auto childrenContainer = m_parent->m_transform.m_children;
-			auto it = std::find(childrenContainer.begin(), childrenContainer.end(), &m_transform);
-			if (it != childrenContainer.end())
-			{
-				childrenContainer.erase(it);
-			}
-		}
+		m_transform.SetParent(nullptr);
 
-		if (m_sibling != nullptr)
+		SceneObject* back = Pool::Get(m_back);
+		if (SceneObject* sibling = Pool::Get(m_sibling))
 		{
-			m_sibling->m_back = m_back;
+			sibling->m_back = m_back;
 		}
-		if (m_back->m_sibling.get() == this)
+		if (back->m_sibling == m_index)
 		{
-			m_back->m_sibling = m_sibling;
+			back->m_sibling = m_sibling;
 		}
-		if (m_back->m_child.get() == this)
+		if (back->m_child == m_index)
 		{
-			m_back->m_child = m_sibling;
+			back->m_child = m_sibling;
 		}
 
-		m_parent = nullptr;
-		m_back = nullptr;
-		m_sibling = nullptr;
+		m_parent = Pool::InvalidIndex;
+		m_back = Pool::InvalidIndex;
+		m_sibling = Pool::InvalidIndex;
+
+		// The object is released after the callbacks, if it is not referenced elsewhere
+		std::shared_ptr<SceneObject> attachedRef = std::move(m_attachedRef);
 
 		for (auto& component : componentsToInactive)
 		{
-			component->OnInactive();
+			DeactivateComponent(component, scene);
 		}
 		for (auto& component : componentsToDetach)
 		{
-			component->OnDetach();
+			DetachComponent(component, scene);
 		}
 	}
 
 	const SceneObject* SceneObject::GetParent() const
 	{
-		return m_parent;
+		return Pool::Get(m_parent);
 	}
 
 	bool SceneObject::GetActive() const
@@ -389,13 +454,13 @@ namespace udsdx
 	bool SceneObject::GetActiveInHierarchy() const
 	{
 		const SceneObject* node = this;
-		while (node->m_parent != nullptr)
+		while (node->m_parent != Pool::InvalidIndex)
 		{
 			if (!node->m_active)
 			{
 				return false;
 			}
-			node = node->m_parent;
+			node = Pool::Get(node->m_parent);
 		}
 		return node->m_active;
 	}
@@ -403,13 +468,13 @@ namespace udsdx
 	bool SceneObject::GetActiveInScene() const
 	{
 		const SceneObject* node = this;
-		while (node->m_parent != nullptr)
+		while (node->m_parent != Pool::InvalidIndex)
 		{
 			if (!node->m_active)
 			{
 				return false;
 			}
-			node = node->m_parent;
+			node = Pool::Get(node->m_parent);
 		}
 		return node->m_active && node->m_sceneRoot != nullptr;
 	}
@@ -417,9 +482,9 @@ namespace udsdx
 	Scene* SceneObject::GetScene() const
 	{
 		const SceneObject* node = this;
-		while (node->m_parent != nullptr)
+		while (node->m_parent != Pool::InvalidIndex)
 		{
-			node = node->m_parent;
+			node = Pool::Get(node->m_parent);
 		}
 		return node->m_sceneRoot;
 	}
@@ -442,7 +507,7 @@ namespace udsdx
 			if (GetActiveInScene())
 			{
 				std::vector<Component*> componentsToActive;
-				Enumerate(shared_from_this(), [&componentsToActive](const std::shared_ptr<SceneObject>& object) {
+				ForEachInHierarchy(this, [&componentsToActive](SceneObject* object) {
 					for (auto& component : object->m_components)
 					{
 						if (component->GetActive())
@@ -451,9 +516,10 @@ namespace udsdx
 						}
 					}
 				}, true);
+				Scene* scene = GetScene();
 				for (auto& component : componentsToActive)
 				{
-					component->OnActive();
+					ActivateComponent(component, scene);
 				}
 			}
 		}
@@ -461,9 +527,10 @@ namespace udsdx
 		else
 		{
 			std::vector<Component*> componentsToInactive;
+			Scene* scene = GetScene();
 			if (GetActiveInScene())
 			{
-				Enumerate(shared_from_this(), [&componentsToInactive](const std::shared_ptr<SceneObject>& object) {
+				ForEachInHierarchy(this, [&componentsToInactive](SceneObject* object) {
 					for (auto& component : object->m_components)
 					{
 						if (component->GetActive())
@@ -477,18 +544,19 @@ namespace udsdx
 			m_active = active;
 			for (auto& component : componentsToInactive)
 			{
-				component->OnInactive();
+				DeactivateComponent(component, scene);
 			}
 		}
 	}
 
 	void SceneObject::SceneObjectDeleter::operator()(SceneObject* object) const
 	{
+		SceneObject::Pool::Invalidate(object);
 		SceneObject::GarbageCollector::Stash(object);
 	}
 
 	void SceneObject::ComponentDeleter::operator()(Component* component) const
 	{
-		delete component;
+		SceneObject::GarbageCollector::Stash(component);
 	}
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "pch.h"
 #include "transform.h"
+#include "component_registry.h"
 
 namespace udsdx
 {
@@ -9,6 +10,15 @@ namespace udsdx
 	class Scene;
 	class Camera;
 
+	// A weak reference to a SceneObject, which resolves to null once the object has been released.
+	struct SceneObjectHandle
+	{
+		UINT Index = std::numeric_limits<UINT>::max();
+		UINT Generation = 0;
+
+		bool operator==(const SceneObjectHandle& rhs) const = default;
+	};
+
 	class SceneObject : public std::enable_shared_from_this<SceneObject>
 	{
 		friend class Scene;
@@ -18,27 +28,160 @@ namespace udsdx
 		{
 		public:
 			static void Stash(SceneObject* object);
+			// Removed components may still be recorded by the render thread, so they are deleted along with the objects
+			static void Stash(Component* component);
 			static void Collect(int frameResourceIndex);
 
 		private:
 			static int m_currentFrameResourceIndex;
 			static std::array<std::vector<SceneObject*>, FrameResourceCount + 1> m_garbage;
+			static std::array<std::vector<Component*>, FrameResourceCount + 1> m_componentGarbage;
 		};
 
 	private:
+		// Slab storage of every SceneObject, which recycles the slots through a free list.
+		// The generation of a slot is increased when the object in it is released, invalidating its handles.
+		class Pool
+		{
+		public:
+			static constexpr UINT InvalidIndex = std::numeric_limits<UINT>::max();
+
+			static SceneObject* Create();
+			static void Invalidate(SceneObject* object);
+			static void Destroy(SceneObject* object);
+			static SceneObject* Get(UINT index) { return index == InvalidIndex ? nullptr : m_objects[index]; }
+			static UINT GetGeneration(UINT index) { return m_generations[index]; }
+
+		private:
+			static constexpr UINT ChunkSize = 256;
+
+			static std::vector<std::unique_ptr<std::byte[]>> m_chunks;
+			static std::vector<SceneObject*> m_objects;
+			static std::vector<UINT> m_generations;
+			static std::vector<UINT> m_freeIndices;
+		};
+
 		struct SceneObjectDeleter
 		{
 			void operator()(SceneObject* object) const;
 		};
 
+		// Allocator of the shared_ptr control blocks, which come from fixed-size chunks recycled through a free list like the objects.
+		// The last weak reference of a component may be released off the main thread, so the free list is locked.
+		template <typename T>
+		struct ControlBlockAllocator
+		{
+			using value_type = T;
+
+			ControlBlockAllocator() = default;
+			template <typename U>
+			ControlBlockAllocator(const ControlBlockAllocator<U>&) {}
+
+			T* allocate(size_t count)
+			{
+				static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+				if (count != 1)
+				{
+					return std::allocator<T>().allocate(count);
+				}
+
+				std::lock_guard lock(m_mutex);
+				if (m_freeBlocks.empty())
+				{
+					std::byte* chunk = m_chunks.emplace_back(std::make_unique<std::byte[]>(sizeof(T) * ChunkSize)).get();
+					for (UINT i = ChunkSize; i > 0; --i)
+					{
+						m_freeBlocks.emplace_back(chunk + sizeof(T) * (i - 1));
+					}
+				}
+				std::byte* block = m_freeBlocks.back();
+				m_freeBlocks.pop_back();
+				return reinterpret_cast<T*>(block);
+			}
+
+			void deallocate(T* block, size_t count)
+			{
+				if (count != 1)
+				{
+					std::allocator<T>().deallocate(block, count);
+					return;
+				}
+
+				std::lock_guard lock(m_mutex);
+				m_freeBlocks.emplace_back(reinterpret_cast<std::byte*>(block));
+			}
+
+			template <typename U>
+			bool operator==(const ControlBlockAllocator<U>&) const { return true; }
+
+		private:
+			static constexpr UINT ChunkSize = 256;
+
+			static inline std::mutex m_mutex;
+			static inline std::vector<std::unique_ptr<std::byte[]>> m_chunks;
+			static inline std::vector<std::byte*> m_freeBlocks;
+		};
+
 		struct ComponentDeleter
 		{
 			void operator()(Component* component) const;
 		};
 		
 	public:
-		static void Enumerate(const std::shared_ptr<SceneObject>& root, std::function<void(const std::shared_ptr<SceneObject>&)> callback, bool onlyActive = true);
+		// Visits the root and its descendants in in-order (sibling-node-child) traversal.
+		// Uses a thread-local scratch stack that only grows, so no allocation happens in steady state.
+		// The callback may start another traversal, as each call only uses the stack above its own base.
+		template <typename Function_T>
+		static void ForEachInHierarchy(SceneObject* root, Function_T&& callback, bool onlyActive = true)
+		{
+			ForEachInHierarchy(root, std::forward<Function_T>(callback), GetTraversalStack(), onlyActive);
+		}
+
+		// Same as above, with a caller-provided scratch stack.
+		// Raw pointers are safe to keep during the traversal since released objects are deferred to the GarbageCollector.
+		template <typename Function_T>
+		static void ForEachInHierarchy(SceneObject* root, Function_T&& callback, std::vector<SceneObject*>& stack, bool onlyActive = true)
+		{
+			if (onlyActive && !root->m_active)
+			{
+				return;
+			}
+
+			const size_t stackBase = stack.size();
+			SceneObject* node = Pool::Get(root->m_child);
+			callback(root);
+
+			// Since the order of the siblings is reversed, it needs to visit the siblings first
+			while (stack.size() > stackBase || node != nullptr)
+			{
+				if (node != nullptr)
+				{
+					stack.emplace_back(node);
+					node = Pool::Get(node->m_sibling);
+				}
+				else
+				{
+					// node is guaranteed to have an instance
+					node = stack.back();
+					stack.pop_back();
+					if (!onlyActive || node->m_active)
+					{
+						callback(node);
+						node = Pool::Get(node->m_child);
+					}
+					else
+					{
+						node = nullptr;
+					}
+				}
+			}
+		}
+
 		static std::shared_ptr<SceneObject> MakeShared();
+		static SceneObject* Resolve(SceneObjectHandle handle);
+
+	private:
+		static std::vector<SceneObject*>& GetTraversalStack();
 
 	private:
 		SceneObject();
@@ -48,8 +191,7 @@ namespace udsdx
 
 	public:
 		Transform* GetTransform();
-		void Update(const Time& time, Scene& scene);
-		void PostUpdate(const Time& time, Scene& scene);
+		SceneObjectHandle GetHandle() const;
 		void OnDrawGizmos(const Camera* target);
 
 	public:
@@ -72,17 +214,19 @@ namespace udsdx
 			std::unique_ptr<Component_T, ComponentDeleter> component = std::unique_ptr<Component_T, ComponentDeleter>(new Component_T());
 			Component_T* componentPtr = component.get();
 			componentPtr->m_object = shared_from_this();
+			ComponentRegistry::AssignTypeID(*componentPtr);
 			m_components.emplace_back(std::move(component));
+			m_componentTable.clear();
 			componentPtr->OnInitialize();
 			bool attachedInScene = GetAttachedInScene();
 			bool activeInScene = GetActiveInScene();
 			if (attachedInScene)
 			{
-				componentPtr->OnAttach();
+				AttachComponent(componentPtr, GetScene());
 			}
 			if (activeInScene)
 			{
-				componentPtr->OnActive();
+				ActivateComponent(componentPtr, GetScene());
 			}
 			return componentPtr;
 		}
@@ -90,22 +234,20 @@ namespace udsdx
 		template <typename Component_T>
 		Component_T* GetComponent() const
 		{
-			for (auto& component : m_components)
+			ComponentRegistry::TypeID typeID = ComponentRegistry::GetTypeID<Component_T>();
+			if (typeID >= m_componentTable.size())
 			{
-				Component_T* castedComponent = dynamic_cast<Component_T*>(component.get());
-				if (castedComponent)
-				{
-					return castedComponent;
-				}
+				BuildComponentTable();
 			}
-			return nullptr;
+			UINT8 index = m_componentTable[typeID];
+			return index == 0 ? nullptr : static_cast<Component_T*>(m_components[index - 1].get());
 		}
 
 		template <typename Component_T>
 		std::vector<Component_T*> GetComponentsInChildren() const
 		{
 			std::vector<Component_T*> components;
-			Enumerate(std::const_pointer_cast<SceneObject>(shared_from_this()), [&](const std::shared_ptr<SceneObject>& node) {
+			ForEachInHierarchy(const_cast<SceneObject*>(this), [&](const SceneObject* node) {
 				if (Component_T* component = node->GetComponent<Component_T>())
 				{
 					components.emplace_back(component);
@@ -147,17 +289,32 @@ namespace udsdx
 
 		void RemoveAllComponents();
 
+	private:
+		void BuildComponentTable() const;
+		static void AttachComponent(Component* component, Scene* scene);
+		static void DetachComponent(Component* component, Scene* scene);
+		static void ActivateComponent(Component* component, Scene* scene);
+		static void DeactivateComponent(Component* component, Scene* scene);
+
 	protected:
 		bool m_active = true;
 		// Only has an instance for the root SceneObject of a Scene
 		Scene* m_sceneRoot = nullptr;
 		Transform m_transform = Transform();
 		std::vector<std::unique_ptr<Component, ComponentDeleter>> m_components;
+		// For each component type ID, 1 + the index of the first component of that type, or 0 if there is none.
+		// Cleared when the components change, and rebuilt on the next lookup.
+		mutable std::vector<UINT8> m_componentTable;
 
 	protected:
-		SceneObject* m_parent = nullptr;
-		SceneObject* m_back = nullptr;
-		std::shared_ptr<SceneObject> m_sibling = nullptr;
-		std::shared_ptr<SceneObject> m_child = nullptr;
+		// Links to the other objects in the hierarchy, as indices into the Pool
+		UINT m_index = Pool::InvalidIndex;
+		UINT m_parent = Pool::InvalidIndex;
+		UINT m_back = Pool::InvalidIndex;
+		UINT m_sibling = Pool::InvalidIndex;
+		UINT m_child = Pool::InvalidIndex;
+
+		// Keeps the object alive while it is attached to a parent
+		std::shared_ptr<SceneObject> m_attachedRef = nullptr;
 	};
 }
\ No newline at end of file
@@ -21,20 +21,16 @@ namespace udsdx
 		BuildBlurWeights();
 		BuildRootSignature(device);
 
-		for (auto& buffer : m_constantBuffers)
-		{
-			buffer = std::make_unique<UploadBuffer<SSAOConstants>>(device, 1, true);
-		}
 		m_blurConstantBuffer = std::make_unique<UploadBuffer<BlurConstants>>(device, 1, true);
 
 		UpdateBlurConstants();
 	}
 
-	void ScreenSpaceAO::UpdateSSAOConstants(RenderParam& param, Camera* pCamera)
+	void ScreenSpaceAO::UpdateSSAOConstants(RenderParam& param, const Matrix4x4& projMatrix)
 	{
 		SSAOConstants ssaoCB;
 
-		XMMATRIX P = pCamera->GetProjMatrix(param.AspectRatio);
+		XMMATRIX P = projMatrix;
 
 		// Transform NDC space [-1,+1]^2 to texture space [0,1]^2
 		XMMATRIX T(
@@ -55,7 +51,7 @@ namespace udsdx
 		ssaoCB.OcclusionFadeEnd = 1.0f;
 		ssaoCB.SurfaceEpsilon = 0.25f;
 
-		m_constantBuffers[param.FrameResourceIndex]->CopyData(0, ssaoCB);
+		m_constantBuffer = param.ConstantAllocator->Upload(ssaoCB);
 	}
 
 	void ScreenSpaceAO::UpdateBlurConstants()
@@ -102,7 +98,7 @@ namespace udsdx
 		pCommandList->OMSetRenderTargets(1, &m_ssaomapCpuRtv, true, nullptr);
 
 		pCommandList->SetGraphicsRootSignature(m_ssaoRootSignature.Get());
-		pCommandList->SetGraphicsRootConstantBufferView(0, m_constantBuffers[param.FrameResourceIndex]->Resource()->GetGPUVirtualAddress());
+		pCommandList->SetGraphicsRootConstantBufferView(0, m_constantBuffer);
 		pCommandList->SetGraphicsRootDescriptorTable(1, param.Renderer->GetGBufferSrv(1));
 		pCommandList->SetGraphicsRootDescriptorTable(2, param.Renderer->GetDepthBufferSrv());
 
@@ -136,7 +132,7 @@ namespace udsdx
 				D3D12_RESOURCE_STATE_GENERIC_READ,
 				D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 
-		pCommandList->SetComputeRootConstantBufferView(0, m_constantBuffers[param.FrameResourceIndex]->Resource()->GetGPUVirtualAddress());
+		pCommandList->SetComputeRootConstantBufferView(0, m_constantBuffer);
 		pCommandList->SetComputeRoot32BitConstant(1, 0, 0);
 		pCommandList->SetComputeRootConstantBufferView(2, m_blurConstantBuffer->Resource()->GetGPUVirtualAddress());
 		pCommandList->SetComputeRootDescriptorTable(3, m_ssaomapGpuSrv);
@@ -160,7 +156,7 @@ namespace udsdx
 				D3D12_RESOURCE_STATE_GENERIC_READ,
 				D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 
-		pCommandList->SetComputeRootConstantBufferView(0, m_constantBuffers[param.FrameResourceIndex]->Resource()->GetGPUVirtualAddress());
+		pCommandList->SetComputeRootConstantBufferView(0, m_constantBuffer);
 		pCommandList->SetComputeRoot32BitConstant(1, 1, 0);
 		pCommandList->SetComputeRootConstantBufferView(2, m_blurConstantBuffer->Resource()->GetGPUVirtualAddress());
 		pCommandList->SetComputeRootDescriptorTable(3, m_blurMapGpuSrv);
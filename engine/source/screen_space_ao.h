@@ -39,7 +39,7 @@ namespace udsdx
 		ScreenSpaceAO& operator=(const ScreenSpaceAO& rhs) = delete;
 		~ScreenSpaceAO() = default;
 
-		void UpdateSSAOConstants(RenderParam& param, Camera* pCamera);
+		void UpdateSSAOConstants(RenderParam& param, const Matrix4x4& projMatrix);
 		void UpdateBlurConstants();
 
 		void ClearSSAOMap(ID3D12GraphicsCommandList* pCommandList);
@@ -96,7 +96,8 @@ namespace udsdx
 		XMFLOAT4 m_offsets[KERNEL_SIZE];
 		FLOAT m_blurWeights[BLUR_SMAPLE];
 
-		std::array<std::unique_ptr<UploadBuffer<SSAOConstants>>, FrameResourceCount> m_constantBuffers;
+		// Address of the constants of the view being recorded, uploaded by UpdateSSAOConstants()
+		D3D12_GPU_VIRTUAL_ADDRESS m_constantBuffer = 0;
 		std::unique_ptr<UploadBuffer<BlurConstants>> m_blurConstantBuffer;
 	};
 }
\ No newline at end of file
@@ -12,18 +12,6 @@ namespace udsdx
 	ShadowMap::ShadowMap(UINT mapWidth, UINT mapHeight, ID3D12Device* device)
 	{
 		OnResize(mapWidth, mapHeight, device);
-
-		for (auto& buffer : m_constantBuffers)
-		{
-			buffer = std::make_unique<UploadBuffer<ShadowConstants>>(device, 1, true);
-		}
-		for (auto& bufferSet : m_lightCameraBuffers)
-		{
-			for (auto& buffer : bufferSet)
-			{
-				buffer = std::make_unique<UploadBuffer<CameraConstants>>(device, 1, true);
-			}
-		}
 	}
 
 	ShadowMap::~ShadowMap()
@@ -102,29 +90,13 @@ namespace udsdx
 		device->CreateDepthStencilView(m_shadowMap.Get(), &dsvDesc, m_dsvCpu);
 	}
 
-	void ShadowMap::Pass(RenderParam& param, Scene* target, Camera* camera, LightDirectional* light)
+	void ShadowMap::PrepareCascades(int frameResourceIndex, ConstantAllocator& constantAllocator, const Vector3& cameraPosition, const Quaternion& cameraRotation, const Vector3& lightDirection, std::span<ViewVolume, CascadeCount> casterVolumes)
 	{
-		auto pCommandList = param.CommandList;
-
-		pCommandList->RSSetViewports(1, &m_viewport);
-		pCommandList->RSSetScissorRects(1, &m_scissorRect);
-
-		pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_shadowMap.Get(),
-			D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_DEPTH_WRITE));
-
-		pCommandList->ClearDepthStencilView(m_dsvCpu, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr); 
-		pCommandList->OMSetRenderTargets(0, nullptr, false, &m_dsvCpu);
-
-		pCommandList->SetGraphicsRootConstantBufferView(RootParam::PerShadowCBV, GetConstantBuffer(param.FrameResourceIndex));
-		pCommandList->SetGraphicsRootConstantBufferView(RootParam::PerFrameCBV, param.ConstantBufferView);
-
 		ShadowConstants shadowConstants;
-		Vector3 lightDirection = light->GetLightDirection();
-		std::array<std::unique_ptr<BoundingCamera>, 4> cameraBounds;
-		Vector3 cameraPos = camera->GetTransform()->GetWorldPosition();
-		Vector3 cameraLook = Vector3::TransformNormal(Vector3::Backward, Matrix4x4::CreateFromQuaternion(camera->GetTransform()->GetWorldRotation()));
+		Vector3 cameraPos = cameraPosition;
+		Vector3 cameraLook = Vector3::TransformNormal(Vector3::Backward, Matrix4x4::CreateFromQuaternion(cameraRotation));
 
-		for (int i = 0; i < 4; ++i)
+		for (int i = 0; i < CascadeCount; ++i)
 		{
 			float f = m_shadowRanges[i];
 			Vector3 lightPos = cameraPos + cameraLook * f * 0.5f;
@@ -143,22 +115,42 @@ namespace udsdx
 			XMStoreFloat4x4(&cameraConstants.View, XMMatrixTranspose(lightView));
 			XMStoreFloat4x4(&cameraConstants.Proj, XMMatrixTranspose(lightProj));
 			XMStoreFloat4x4(&cameraConstants.ViewProj, XMMatrixTranspose(lightViewProj));
-			m_lightCameraBuffers[param.FrameResourceIndex][i]->CopyData(0, cameraConstants);
+			m_lightCameraBuffers[frameResourceIndex][i] = constantAllocator.Upload(cameraConstants);
 
+			// The box of the light projection. Toward the light it reaches the near plane, so the casters outside the cascade
+			// which still shade it are kept, and the ones beyond the near plane would be clipped by the rasterizer anyway.
 			Matrix4x4 mView;
-			XMStoreFloat4x4(&mView, lightView);	
-			cameraBounds[i] = std::make_unique<BoundingCameraOrthographic>(mView, f, f, -f * 10.0f, f * 10.0f);
+			XMStoreFloat4x4(&mView, lightView);
+			casterVolumes[i] = ViewVolume::CreateOrientedBox(mView, f, f, -f * 10.0f, f * 10.0f);
 		}
 		shadowConstants.LightDirection = lightDirection;
 
-		m_constantBuffers[param.FrameResourceIndex]->CopyData(0, shadowConstants);
+		m_constantBuffers[frameResourceIndex] = constantAllocator.Upload(shadowConstants);
+	}
+
+	void ShadowMap::ClearCascades(int frameResourceIndex, ConstantAllocator& constantAllocator)
+	{
+		m_constantBuffers[frameResourceIndex] = constantAllocator.Upload(ShadowConstants{});
+	}
+
+	void ShadowMap::Pass(RenderParam& param, Scene* target, std::span<const VisibilitySet, CascadeCount> casterVisibility)
+	{
+		auto pCommandList = param.CommandList;
 
-		param.CommandList->SetGraphicsRootConstantBufferView(RootParam::PerShadowCBV, m_constantBuffers[param.FrameResourceIndex]->Resource()->GetGPUVirtualAddress());
+		pCommandList->RSSetViewports(1, &m_viewport);
+		pCommandList->RSSetScissorRects(1, &m_scissorRect);
+
+		pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_shadowMap.Get(),
+			D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+
+		pCommandList->ClearDepthStencilView(m_dsvCpu, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr); 
+		pCommandList->OMSetRenderTargets(0, nullptr, false, &m_dsvCpu);
+
+		pCommandList->SetGraphicsRootConstantBufferView(RootParam::PerShadowCBV, GetConstantBuffer(param.FrameResourceIndex));
+		pCommandList->SetGraphicsRootConstantBufferView(RootParam::PerFrameCBV, param.ConstantBufferView);
 
 		if (param.RenderOptions->DrawShadowMap)
 		{
-			param.UseFrustumCulling = false;
-
 			D3D12_VIEWPORT tempViewport{};
 			D3D12_RECT tempScissorRect{};
 
@@ -168,40 +160,40 @@ namespace udsdx
 			tempViewport = { 0.0f, (float)halfHeight, (float)halfWidth, (float)halfHeight, 0.0f, 1.0f };
 			tempScissorRect = { 0, halfHeight, halfWidth, halfHeight * 2 };
 
-			param.ViewFrustumWorld = cameraBounds[0].get();
 			param.CommandList->RSSetViewports(1, &tempViewport);
 			param.CommandList->RSSetScissorRects(1, &tempScissorRect);
-			param.CommandList->SetGraphicsRootConstantBufferView(RootParam::PerCameraCBV, m_lightCameraBuffers[param.FrameResourceIndex][0]->Resource()->GetGPUVirtualAddress());
+			param.CommandList->SetGraphicsRootConstantBufferView(RootParam::PerCameraCBV, m_lightCameraBuffers[param.FrameResourceIndex][0]);
+			param.Visibility = &casterVisibility[0];
 			target->RenderShadowSceneObjects(param, 1);
 
 			tempViewport = { (float)halfWidth, (float)halfHeight, (float)halfWidth, (float)halfHeight, 0.0f, 1.0f };
 			tempScissorRect = { halfWidth, halfHeight, halfWidth * 2, halfHeight * 2 };
 
-			param.ViewFrustumWorld = cameraBounds[1].get();
 			param.CommandList->RSSetViewports(1, &tempViewport);
 			param.CommandList->RSSetScissorRects(1, &tempScissorRect);
-			param.CommandList->SetGraphicsRootConstantBufferView(RootParam::PerCameraCBV, m_lightCameraBuffers[param.FrameResourceIndex][1]->Resource()->GetGPUVirtualAddress());
+			param.CommandList->SetGraphicsRootConstantBufferView(RootParam::PerCameraCBV, m_lightCameraBuffers[param.FrameResourceIndex][1]);
+			param.Visibility = &casterVisibility[1];
 			target->RenderShadowSceneObjects(param, 1);
 
 			tempViewport = { 0.0f, 0.0f, (float)halfWidth, (float)halfHeight, 0.0f, 1.0f };
 			tempScissorRect = { 0, 0, halfWidth, halfHeight };
 
-			param.ViewFrustumWorld = cameraBounds[2].get();
 			param.CommandList->RSSetViewports(1, &tempViewport);
 			param.CommandList->RSSetScissorRects(1, &tempScissorRect);
-			param.CommandList->SetGraphicsRootConstantBufferView(RootParam::PerCameraCBV, m_lightCameraBuffers[param.FrameResourceIndex][2]->Resource()->GetGPUVirtualAddress());
+			param.CommandList->SetGraphicsRootConstantBufferView(RootParam::PerCameraCBV, m_lightCameraBuffers[param.FrameResourceIndex][2]);
+			param.Visibility = &casterVisibility[2];
 			target->RenderShadowSceneObjects(param, 1);
 
 			tempViewport = { (float)halfWidth, 0.0f, (float)halfWidth, (float)halfHeight, 0.0f, 1.0f };
 			tempScissorRect = { halfWidth, 0, halfWidth * 2, halfHeight };
 
-			param.ViewFrustumWorld = cameraBounds[3].get();
 			param.CommandList->RSSetViewports(1, &tempViewport);
 			param.CommandList->RSSetScissorRects(1, &tempScissorRect);
-			param.CommandList->SetGraphicsRootConstantBufferView(RootParam::PerCameraCBV, m_lightCameraBuffers[param.FrameResourceIndex][3]->Resource()->GetGPUVirtualAddress());
+			param.CommandList->SetGraphicsRootConstantBufferView(RootParam::PerCameraCBV, m_lightCameraBuffers[param.FrameResourceIndex][3]);
+			param.Visibility = &casterVisibility[3];
 			target->RenderShadowSceneObjects(param, 1);
 
-			param.UseFrustumCulling = true;
+			param.Visibility = nullptr;
 		}
 
 		pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_shadowMap.Get(),
@@ -210,7 +202,7 @@ namespace udsdx
 
 	D3D12_GPU_VIRTUAL_ADDRESS ShadowMap::GetConstantBuffer(int frameResourceIndex) const
 	{
-		return m_constantBuffers[frameResourceIndex]->Resource()->GetGPUVirtualAddress();
+		return m_constantBuffers[frameResourceIndex];
 	}
 
 	D3D12_GPU_DESCRIPTOR_HANDLE ShadowMap::GetSrvGpu() const
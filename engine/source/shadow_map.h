@@ -2,6 +2,7 @@
 
 #include "pch.h"
 #include "frame_resource.h"
+#include "culling.h"
 
 namespace udsdx
 {
@@ -11,6 +12,9 @@ namespace udsdx
 
 	class ShadowMap
 	{
+	public:
+		static constexpr int CascadeCount = 4;
+
 	public:
 		ShadowMap(UINT mapWidth, UINT mapHeight, ID3D12Device* device);
 		~ShadowMap();
@@ -20,7 +24,13 @@ namespace udsdx
 		void BuildDescriptors(DescriptorParam& descriptorParam, ID3D12Device* device);
 		void RebuildDescriptors(ID3D12Device* device);
 
-		void Pass(RenderParam& param, Scene* target, Camera* camera, LightDirectional* light);
+		// Called when the frame is published. Fits the cascades around the camera, writes their constants to the frame resource,
+		// and fills the volumes of the cascades which the shadow casters are culled against.
+		void PrepareCascades(int frameResourceIndex, ConstantAllocator& constantAllocator, const Vector3& cameraPosition, const Quaternion& cameraRotation, const Vector3& lightDirection, std::span<ViewVolume, CascadeCount> casterVolumes);
+		// Called instead of PrepareCascades() when there is no shadow light, as the lighting pass still reads the constants
+		void ClearCascades(int frameResourceIndex, ConstantAllocator& constantAllocator);
+		// Draws each cascade with the casters visible in it
+		void Pass(RenderParam& param, Scene* target, std::span<const VisibilitySet, CascadeCount> casterVisibility);
 
 	public:
 		D3D12_GPU_VIRTUAL_ADDRESS GetConstantBuffer(int frameResourceIndex) const;
@@ -38,7 +48,7 @@ namespace udsdx
 		UINT m_mapWidth;
 		UINT m_mapHeight;
 
-		float m_shadowRanges[4] = { 16.0f, 64.0f, 256.0f, 512.0f };
+		float m_shadowRanges[CascadeCount] = { 16.0f, 64.0f, 256.0f, 512.0f };
 
 		D3D12_VIEWPORT m_viewport;
 		D3D12_RECT m_scissorRect;
@@ -49,7 +59,8 @@ namespace udsdx
 
 		ComPtr<ID3D12Resource> m_shadowMap;
 
-		std::array<std::unique_ptr<UploadBuffer<ShadowConstants>>, FrameResourceCount> m_constantBuffers;
-		std::array<std::array<std::unique_ptr<UploadBuffer<CameraConstants>>, 4>, FrameResourceCount> m_lightCameraBuffers;
+		// Addresses of the constants uploaded when the frame was published
+		std::array<D3D12_GPU_VIRTUAL_ADDRESS, FrameResourceCount> m_constantBuffers = {};
+		std::array<std::array<D3D12_GPU_VIRTUAL_ADDRESS, CascadeCount>, FrameResourceCount> m_lightCameraBuffers = {};
 	};
 }
\ No newline at end of file
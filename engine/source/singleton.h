@@ -21,10 +21,10 @@ namespace udsdx
 			return instance.get();
 		}
 
-		template <typename Derived_T = T> requires std::derived_from<Derived_T, T>
-		static T* CreateInstance()
+		template <typename Derived_T = T, typename... Args_T> requires std::derived_from<Derived_T, T>
+		static T* CreateInstance(Args_T&&... args)
 		{
-			instance = std::make_unique<Derived_T>();
+			instance = std::make_unique<Derived_T>(std::forward<Args_T>(args)...);
 			return instance.get();
 		}
 
@@ -0,0 +1,153 @@
+#include "pch.h"
+#include "state_tracking_command_list.h"
+
+namespace udsdx
+{
+	static bool IsSameView(const D3D12_VERTEX_BUFFER_VIEW& lhs, const D3D12_VERTEX_BUFFER_VIEW& rhs)
+	{
+		return lhs.BufferLocation == rhs.BufferLocation && lhs.SizeInBytes == rhs.SizeInBytes && lhs.StrideInBytes == rhs.StrideInBytes;
+	}
+
+	static bool IsSameView(const D3D12_INDEX_BUFFER_VIEW& lhs, const D3D12_INDEX_BUFFER_VIEW& rhs)
+	{
+		return lhs.BufferLocation == rhs.BufferLocation && lhs.SizeInBytes == rhs.SizeInBytes && lhs.Format == rhs.Format;
+	}
+
+	D3D12CommandList::D3D12CommandList(ID3D12GraphicsCommandList* commandList) : m_commandList(commandList)
+	{
+	}
+
+	void D3D12CommandList::IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views)
+	{
+		m_commandList->IASetVertexBuffers(startSlot, numViews, views);
+	}
+
+	void D3D12CommandList::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view)
+	{
+		m_commandList->IASetIndexBuffer(view);
+	}
+
+	void D3D12CommandList::IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY topology)
+	{
+		m_commandList->IASetPrimitiveTopology(topology);
+	}
+
+	void D3D12CommandList::OMSetStencilRef(UINT stencilRef)
+	{
+		m_commandList->OMSetStencilRef(stencilRef);
+	}
+
+	void D3D12CommandList::SetPipelineState(ID3D12PipelineState* pipelineState)
+	{
+		m_commandList->SetPipelineState(pipelineState);
+	}
+
+	void D3D12CommandList::SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+	{
+		m_commandList->SetGraphicsRootDescriptorTable(rootParameterIndex, baseDescriptor);
+	}
+
+	StateTrackingCommandList::StateTrackingCommandList(CommandListBase* target) : m_target(target)
+	{
+	}
+
+	void StateTrackingCommandList::IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views)
+	{
+		// Only the slots known to hold every given view are skipped, the others are bound and remembered
+		bool bound = views != nullptr && numViews > 0 && startSlot + numViews <= VertexBufferSlotCount;
+		for (UINT i = 0; bound && i < numViews; ++i)
+		{
+			const std::optional<D3D12_VERTEX_BUFFER_VIEW>& current = m_vertexBuffers[startSlot + i];
+			bound = current.has_value() && IsSameView(*current, views[i]);
+		}
+		if (Skip(bound))
+		{
+			return;
+		}
+
+		m_target->IASetVertexBuffers(startSlot, numViews, views);
+		for (UINT slot = startSlot; slot < std::min(startSlot + numViews, VertexBufferSlotCount); ++slot)
+		{
+			m_vertexBuffers[slot] = views ? std::optional(views[slot - startSlot]) : std::nullopt;
+		}
+	}
+
+	void StateTrackingCommandList::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view)
+	{
+		// Unbinding is remembered as an empty view
+		D3D12_INDEX_BUFFER_VIEW value = view ? *view : D3D12_INDEX_BUFFER_VIEW{};
+		if (Skip(m_indexBuffer.has_value() && IsSameView(*m_indexBuffer, value)))
+		{
+			return;
+		}
+
+		m_target->IASetIndexBuffer(view);
+		m_indexBuffer = value;
+	}
+
+	void StateTrackingCommandList::IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY topology)
+	{
+		if (Skip(m_topology == topology))
+		{
+			return;
+		}
+
+		m_target->IASetPrimitiveTopology(topology);
+		m_topology = topology;
+	}
+
+	void StateTrackingCommandList::OMSetStencilRef(UINT stencilRef)
+	{
+		if (Skip(m_stencilRef == stencilRef))
+		{
+			return;
+		}
+
+		m_target->OMSetStencilRef(stencilRef);
+		m_stencilRef = stencilRef;
+	}
+
+	void StateTrackingCommandList::SetPipelineState(ID3D12PipelineState* pipelineState)
+	{
+		if (Skip(m_pipelineState == pipelineState))
+		{
+			return;
+		}
+
+		m_target->SetPipelineState(pipelineState);
+		m_pipelineState = pipelineState;
+	}
+
+	void StateTrackingCommandList::SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+	{
+		assert(rootParameterIndex < RootParameterCount);
+		if (Skip(m_descriptorTables[rootParameterIndex] == baseDescriptor.ptr))
+		{
+			return;
+		}
+
+		m_target->SetGraphicsRootDescriptorTable(rootParameterIndex, baseDescriptor);
+		m_descriptorTables[rootParameterIndex] = baseDescriptor.ptr;
+	}
+
+	void StateTrackingCommandList::Invalidate()
+	{
+		m_vertexBuffers.fill(std::nullopt);
+		m_indexBuffer.reset();
+		m_topology.reset();
+		m_stencilRef.reset();
+		m_pipelineState.reset();
+		m_descriptorTables.fill(std::nullopt);
+	}
+
+	bool StateTrackingCommandList::Skip(bool bound)
+	{
+		if (bound)
+		{
+			++m_statistics.Skipped;
+			return true;
+		}
+		++m_statistics.Issued;
+		return false;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "pch.h"
+
+namespace udsdx
+{
+	// The state setting calls of the draw loops.
+	// Implemented by the D3D12 command list, and by anything standing in for it, such as a recorder of the calls.
+	class CommandListBase
+	{
+	public:
+		virtual ~CommandListBase() = default;
+
+	public:
+		virtual void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views) = 0;
+		virtual void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) = 0;
+		virtual void IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY topology) = 0;
+		virtual void OMSetStencilRef(UINT stencilRef) = 0;
+		virtual void SetPipelineState(ID3D12PipelineState* pipelineState) = 0;
+		virtual void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) = 0;
+	};
+
+	class D3D12CommandList : public CommandListBase
+	{
+	public:
+		D3D12CommandList(ID3D12GraphicsCommandList* commandList);
+
+	public:
+		virtual void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views) override;
+		virtual void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) override;
+		virtual void IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY topology) override;
+		virtual void OMSetStencilRef(UINT stencilRef) override;
+		virtual void SetPipelineState(ID3D12PipelineState* pipelineState) override;
+		virtual void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) override;
+
+	private:
+		ID3D12GraphicsCommandList* m_commandList;
+	};
+
+	// Remembers the state bound through it, and drops the calls which would bind the same state again.
+	// State bound on the command list directly is not seen, so the tracker must be invalidated after it.
+	class StateTrackingCommandList
+	{
+	public:
+		struct Statistics
+		{
+			UINT Issued = 0;
+			UINT Skipped = 0;
+		};
+
+	public:
+		StateTrackingCommandList(CommandListBase* target);
+
+	public:
+		void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views);
+		void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view);
+		void IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY topology);
+		void OMSetStencilRef(UINT stencilRef);
+		void SetPipelineState(ID3D12PipelineState* pipelineState);
+		void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor);
+
+		// Forgets the bound state, so the next call of every kind is issued
+		void Invalidate();
+
+		const Statistics& GetStatistics() const { return m_statistics; }
+		void ResetStatistics() { m_statistics = {}; }
+
+	private:
+		static constexpr UINT VertexBufferSlotCount = 2;
+		static constexpr UINT RootParameterCount = RootParam::SrcTexSRV_15 + 1;
+
+		// Counts the call, and returns whether it is dropped
+		bool Skip(bool bound);
+
+	private:
+		CommandListBase* m_target;
+		Statistics m_statistics;
+
+		// Empty while the bound state is not known
+		std::array<std::optional<D3D12_VERTEX_BUFFER_VIEW>, VertexBufferSlotCount> m_vertexBuffers;
+		std::optional<D3D12_INDEX_BUFFER_VIEW> m_indexBuffer;
+		std::optional<D3D_PRIMITIVE_TOPOLOGY> m_topology;
+		std::optional<UINT> m_stencilRef;
+		std::optional<ID3D12PipelineState*> m_pipelineState;
+		std::array<std::optional<UINT64>, RootParameterCount> m_descriptorTables;
+	};
+}
\ No newline at end of file
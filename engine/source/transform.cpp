@@ -1,113 +1,127 @@
 #include "pch.h"
 #include "transform.h"
+#include "transform_system.h"
 
 namespace udsdx
 {
 	unsigned long long g_localMatrixRecalculateCounter = 0;
 	unsigned long long g_worldMatrixRecalculateCounter = 0;
 
+	Transform::Transform() : m_system(INSTANCE(TransformSystem))
+	{
+		m_handle = m_system->Allocate();
+	}
+
+	Transform::~Transform()
+	{
+		m_system->Release(m_handle);
+	}
+
 	void Transform::SetLocalPosition(const Vector3& position)
 	{
-		m_position = position;
-		m_isLocalMatrixDirty = true;
+		m_system->m_positions[GetSlot()] = position;
+		SetLocalDirty();
 	}
 
 	void Transform::SetLocalPosition(float x, float y, float z)
 	{
-		m_position.x = x;
-		m_position.y = y;
-		m_position.z = z;
-		m_isLocalMatrixDirty = true;
+		Vector3& position = m_system->m_positions[GetSlot()];
+		position.x = x;
+		position.y = y;
+		position.z = z;
+		SetLocalDirty();
 	}
 
 	void Transform::SetLocalRotation(const Quaternion& rotation)
 	{
-		m_rotation = rotation;
-		m_isLocalMatrixDirty = true;
+		m_system->m_rotations[GetSlot()] = rotation;
+		SetLocalDirty();
 	}
 
 	void Transform::SetLocalScale(const Vector3& scale)
 	{
-		m_scale = scale;
-		m_isLocalMatrixDirty = true;
+		m_system->m_scales[GetSlot()] = scale;
+		SetLocalDirty();
 	}
 
 	void Transform::SetLocalScale(float x, float y, float z)
 	{
-		m_scale.x = x;
-		m_scale.y = y;
-		m_scale.z = z;
-		m_isLocalMatrixDirty = true;
+		Vector3& scale = m_system->m_scales[GetSlot()];
+		scale.x = x;
+		scale.y = y;
+		scale.z = z;
+		SetLocalDirty();
 	}
 
 	void Transform::SetLocalScale(float scale)
 	{
-		m_scale.x = scale;
-		m_scale.y = scale;
-		m_scale.z = scale;
-		m_isLocalMatrixDirty = true;
+		m_system->m_scales[GetSlot()] = Vector3(scale, scale, scale);
+		SetLocalDirty();
 	}
 
 	void Transform::SetLocalPositionX(float x)
 	{
-		m_position.x = x;
-		m_isLocalMatrixDirty = true;
+		m_system->m_positions[GetSlot()].x = x;
+		SetLocalDirty();
 	}
 
 	void Transform::SetLocalPositionY(float y)
 	{
-		m_position.y = y;
-		m_isLocalMatrixDirty = true;
+		m_system->m_positions[GetSlot()].y = y;
+		SetLocalDirty();
 	}
 
 	void Transform::SetLocalPositionZ(float z)
 	{
-		m_position.z = z;
-		m_isLocalMatrixDirty = true;
+		m_system->m_positions[GetSlot()].z = z;
+		SetLocalDirty();
 	}
 
 	void Transform::Translate(const Vector3& translation)
 	{
-		m_position += translation;
-		m_isLocalMatrixDirty = true;
+		m_system->m_positions[GetSlot()] += translation;
+		SetLocalDirty();
 	}
 
 	void Transform::Rotate(const Quaternion& rotation)
 	{
-		m_rotation = Quaternion::Concatenate(m_rotation, rotation);
-		m_rotation.Normalize();
-		m_isLocalMatrixDirty = true;
+		Quaternion& current = m_system->m_rotations[GetSlot()];
+		current = Quaternion::Concatenate(current, rotation);
+		current.Normalize();
+		SetLocalDirty();
 	}
 
 	Vector3 Transform::GetLocalPosition() const
 	{
-		return m_position;
+		return m_system->m_positions[GetSlot()];
 	}
 
 	Quaternion Transform::GetLocalRotation() const
 	{
-		return m_rotation;
+		return m_system->m_rotations[GetSlot()];
 	}
 
 	Vector3 Transform::GetLocalScale() const
 	{
-		return m_scale;
+		return m_system->m_scales[GetSlot()];
 	}
 
 	Vector3 Transform::GetWorldPosition()
 	{
 		ValidateMatrixRecursive();
 		// Get the translation part of the world matrix.
-		return Vector3(m_worldSRTMatrix._41, m_worldSRTMatrix._42, m_worldSRTMatrix._43);
+		const XMFLOAT4X4A& worldSRTMatrix = m_system->m_worldMatrices[GetSlot()];
+		return Vector3(worldSRTMatrix._41, worldSRTMatrix._42, worldSRTMatrix._43);
 	}
 
 	Quaternion Transform::GetWorldRotation()
 	{
 		ValidateMatrixRecursive();
 		// Caution: The matrix must be orthogonal to get the correct quaternion.
-		Vector3 xBasis(m_worldSRTMatrix._11, m_worldSRTMatrix._12, m_worldSRTMatrix._13);
-		Vector3 yBasis(m_worldSRTMatrix._21, m_worldSRTMatrix._22, m_worldSRTMatrix._23);
-		Vector3 zBasis(m_worldSRTMatrix._31, m_worldSRTMatrix._32, m_worldSRTMatrix._33);
+		const XMFLOAT4X4A& worldSRTMatrix = m_system->m_worldMatrices[GetSlot()];
+		Vector3 xBasis(worldSRTMatrix._11, worldSRTMatrix._12, worldSRTMatrix._13);
+		Vector3 yBasis(worldSRTMatrix._21, worldSRTMatrix._22, worldSRTMatrix._23);
+		Vector3 zBasis(worldSRTMatrix._31, worldSRTMatrix._32, worldSRTMatrix._33);
 		xBasis.Normalize();
 		yBasis.Normalize();
 		zBasis.Normalize();
@@ -117,13 +131,17 @@ namespace udsdx
 
 	Matrix4x4 Transform::GetLocalSRTMatrix()
 	{
-		if (m_isLocalMatrixDirty)
+		int slot = GetSlot();
+		UINT8& flags = m_system->m_flags[slot];
+		if (flags & TransformSystem::LocalDirty)
 		{
 			RecalculateLocalSRTMatrix();
-			m_isLocalMatrixDirty = false;
-			m_isWorldMatrixDirty = true;
+			flags &= ~TransformSystem::LocalDirty;
+			flags |= TransformSystem::WorldDirty;
 		}
-		return m_localSRTMatrix;
+		Matrix4x4 m;
+		XMStoreFloat4x4(&m, XMLoadFloat4x4A(&m_system->m_localMatrices[slot]));
+		return m;
 	}
 
 	Matrix4x4 Transform::GetWorldSRTMatrix(bool forceValidate)
@@ -132,81 +150,37 @@ namespace udsdx
 		{
 			ValidateMatrixRecursive();
 		}
-		return m_worldSRTMatrix;
+		Matrix4x4 m;
+		XMStoreFloat4x4(&m, XMLoadFloat4x4A(&m_system->m_worldMatrices[GetSlot()]));
+		return m;
 	}
 
 	void Transform::RecalculateLocalSRTMatrix()
 	{
 		g_localMatrixRecalculateCounter++;
-
-		// All properties of the transform are converted to XMVECTOR without an explicit conversion.
-		XMVECTOR t = XMLoadFloat3(&m_position);
-		XMVECTOR r = XMLoadFloat4(&m_rotation);
-		XMVECTOR s = XMLoadFloat3(&m_scale);
-		XMMATRIX m = XMMatrixAffineTransformation(s, XMVectorZero(), r, t);
-
-		// Apply the local SRT matrix.
-		XMStoreFloat4x4(&m_localSRTMatrix, m);
+		m_system->RecalculateLocalMatrix(GetSlot());
 	}
 
 	void Transform::RecalculateWorldSRTMatrix()
 	{
 		g_worldMatrixRecalculateCounter++;
-
-		// If the parent is null, the transform is the root of the hierarchy.
-		// This can be either the root of the scene or the root of the pre-constructed hierarchy.
-		if (m_parent == nullptr)
-		{
-			m_worldSRTMatrix = m_localSRTMatrix;
-			return;
-		}
-
-		XMMATRIX ml = XMLoadFloat4x4(&m_localSRTMatrix);
-		XMMATRIX mp = XMLoadFloat4x4(&m_parent->m_worldSRTMatrix);
-		XMMATRIX m = XMMatrixMultiply(ml, mp);
-
-		// Apply the world SRT matrix.
-		XMStoreFloat4x4(&m_worldSRTMatrix, m);
+		m_system->RecalculateWorldMatrix(GetSlot());
 	}
 
 	void Transform::ValidateSRTMatrices()
 	{
-		if (m_isLocalMatrixDirty)
-		{
-			RecalculateLocalSRTMatrix();
-			m_isLocalMatrixDirty = false;
-			m_isWorldMatrixDirty = true;
-		}
-
-		if (m_isWorldMatrixDirty)
-		{
-			RecalculateWorldSRTMatrix();
-			m_isWorldMatrixDirty = false;
-			for (Transform* child : m_children)
-			{
-				// Mark all children as dirty.
-				child->m_isWorldMatrixDirty = true;
-			}
-		}
+		// Marking the children dirty requires the child ranges of the current order.
+		m_system->ValidateOrder();
+		m_system->ValidateSlot(GetSlot());
 	}
 
 	void Transform::ValidateMatrixRecursive()
 	{
-		static std::stack<Transform*> stack;
-		Transform* current = this;
-		while (current != nullptr)
-		{
-			stack.emplace(current);
-			current = current->m_parent;
-		}
-
-		while (!stack.empty())
-		{
-			current = stack.top();
-			stack.pop();
+		m_system->ValidateRecursive(m_handle);
+	}
 
-			// Validate the SRT matrices of the current transform.
-			ValidateSRTMatrices();
-		}
+	void Transform::SetParent(Transform* parent)
+	{
+		m_system->SetParent(m_handle, parent == nullptr ? TransformSystem::InvalidHandle : parent->m_handle);
 	}
 }
\ No newline at end of file
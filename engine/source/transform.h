@@ -1,16 +1,20 @@
 #pragma once
 
 #include "pch.h"
+#include "transform_system.h"
 
 namespace udsdx
 {
+	// A handle to the transform data stored in the TransformSystem.
 	class Transform
 	{
 		friend class SceneObject;
 
 	public:
-		Transform() = default;
-		~Transform() = default;
+		Transform();
+		Transform(const Transform& rhs) = delete;
+		Transform& operator=(const Transform& rhs) = delete;
+		~Transform();
 
 	public:
 		void SetLocalPosition(const Vector3& position);
@@ -52,18 +56,13 @@ namespace udsdx
 		// It is recommended to use this function only when you want to know the world transform of the other Transform once.
 		void ValidateMatrixRecursive();
 
-	protected:
-		Transform*	m_parent = nullptr;
-		std::vector<Transform*> m_children;
-
-		Vector3		m_position = Vector3::Zero;
-		Quaternion	m_rotation = Quaternion::Identity;
-		Vector3		m_scale = Vector3::One;
+	private:
+		void SetParent(Transform* parent);
+		int GetSlot() const { return m_system->GetSlot(m_handle); }
+		void SetLocalDirty() { m_system->MarkDirty(GetSlot(), TransformSystem::LocalDirty); }
 
-		Matrix4x4	m_localSRTMatrix = Matrix4x4::Identity;
-		Matrix4x4	m_worldSRTMatrix = Matrix4x4::Identity;
-
-		bool        m_isLocalMatrixDirty = true;
-		bool        m_isWorldMatrixDirty = true;
+	protected:
+		TransformSystem* m_system = nullptr;
+		TransformSystem::Handle m_handle = TransformSystem::InvalidHandle;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,446 @@
+#include "pch.h"
+#include "transform_system.h"
+#include "job_system.h"
+
+namespace udsdx
+{
+	extern unsigned long long g_localMatrixRecalculateCounter;
+	extern unsigned long long g_worldMatrixRecalculateCounter;
+
+	template <typename T>
+	static void PermuteSlots(std::vector<T>& values, const std::vector<int>& order)
+	{
+		std::vector<T> result;
+		result.reserve(order.size());
+		for (int slot : order)
+		{
+			result.emplace_back(values[slot]);
+		}
+		values.swap(result);
+	}
+
+	TransformSystem::Handle TransformSystem::Allocate()
+	{
+		Handle handle;
+		if (m_freeHandles.empty())
+		{
+			handle = static_cast<Handle>(m_handleToSlot.size());
+			m_handleToSlot.emplace_back(InvalidSlot);
+		}
+		else
+		{
+			handle = m_freeHandles.back();
+			m_freeHandles.pop_back();
+		}
+
+		// A new slot is a root without children, appending it keeps the parents ahead of their children.
+		// It lies past the subtrees until the next reorder, so the parallel update resolves the slots after them separately.
+		int slot = static_cast<int>(m_parents.size());
+		m_handleToSlot[handle] = slot;
+
+		m_positions.emplace_back(Vector3::Zero);
+		m_rotations.emplace_back(Quaternion::Identity);
+		m_scales.emplace_back(Vector3::One);
+		XMStoreFloat4x4A(&m_localMatrices.emplace_back(), XMMatrixIdentity());
+		XMStoreFloat4x4A(&m_worldMatrices.emplace_back(), XMMatrixIdentity());
+		m_parents.emplace_back(InvalidSlot);
+		m_firstChildren.emplace_back(0);
+		m_childCounts.emplace_back(0);
+		m_flags.emplace_back(LocalDirty | WorldDirty);
+		m_slotToHandle.emplace_back(handle);
+		m_dirtyHandles.emplace_back(handle);
+
+		return handle;
+	}
+
+	void TransformSystem::Release(Handle handle)
+	{
+		// The slot stays in the arrays until the next ValidateOrder() compacts them.
+		int slot = m_handleToSlot[handle];
+		m_slotToHandle[slot] = InvalidHandle;
+		m_handleToSlot[handle] = InvalidSlot;
+		m_freeHandles.emplace_back(handle);
+		m_orderDirty = true;
+	}
+
+	void TransformSystem::SetParent(Handle handle, Handle parent)
+	{
+		int slot = m_handleToSlot[handle];
+		m_parents[slot] = parent == InvalidHandle ? InvalidSlot : m_handleToSlot[parent];
+		MarkDirty(slot, WorldDirty);
+		m_orderDirty = true;
+	}
+
+	void TransformSystem::UpdateWorldMatrices()
+	{ ZoneScoped;
+		ValidateOrder();
+
+		UpdateCounter counter;
+		const int count = static_cast<int>(m_parents.size());
+		if (m_dirtyHandles.size() * FullUpdateRatio < static_cast<size_t>(count))
+		{
+			UpdateDirtySubtrees(counter);
+		}
+		else if (m_workItems.size() <= 1)
+		{
+			UpdateSlots(0, count, counter);
+		}
+		else
+		{
+			// The trunk has to be resolved first, as every subtree depends on it.
+			UpdateSlots(0, m_subtreeHeadBegin, counter);
+
+			// Subtrees only read the world matrices of their own slots and of the trunk,
+			// and the per-slot math is the same as in the serial path, so the results are identical.
+			INSTANCE(JobSystem)->ParallelFor(static_cast<UINT>(m_workItems.size()), [this](UINT begin, UINT end) {
+				for (UINT index = begin; index < end; ++index)
+				{
+					WorkItem& item = m_workItems[index];
+					item.Counter = UpdateCounter();
+					UpdateSlots(item.HeadBegin, item.HeadEnd, item.Counter);
+					UpdateSlots(item.Begin, item.End, item.Counter);
+				}
+			}, 1);
+
+			for (const WorkItem& item : m_workItems)
+			{
+				counter.Local += item.Counter.Local;
+				counter.World += item.Counter.World;
+			}
+
+			// Roots allocated since the last reorder are appended after the last subtree
+			UpdateSlots(m_subtreeEnds.back(), count, counter);
+		}
+
+		// Every slot has been resolved by either path
+		m_dirtyHandles.clear();
+
+		g_localMatrixRecalculateCounter += counter.Local;
+		g_worldMatrixRecalculateCounter += counter.World;
+	}
+
+	void TransformSystem::SetConcurrency(UINT concurrency)
+	{
+		m_concurrency = std::max(concurrency, 1u);
+		if (!m_orderDirty)
+		{
+			BuildWorkItems();
+		}
+	}
+
+	void TransformSystem::UpdateSlots(int begin, int end, UpdateCounter& counter)
+	{
+		// Parents always precede their children, so a single pass is enough to propagate the changes.
+		for (int slot = begin; slot < end; ++slot)
+		{
+			UINT8 flags = m_flags[slot];
+			if (flags & LocalDirty)
+			{
+				RecalculateLocalMatrix(slot);
+				counter.Local++;
+				flags |= WorldDirty;
+			}
+			if (flags & WorldDirty)
+			{
+				RecalculateWorldMatrix(slot);
+				counter.World++;
+				MarkChildrenDirty(slot);
+			}
+			m_flags[slot] = 0;
+		}
+	}
+
+	void TransformSystem::UpdateDirtySubtrees(UpdateCounter& counter)
+	{
+		m_dirtySlots.clear();
+		for (Handle handle : m_dirtyHandles)
+		{
+			int slot = m_handleToSlot[handle];
+			if (slot != InvalidSlot)
+			{
+				m_dirtySlots.emplace_back(slot);
+			}
+		}
+
+		// Parents precede their children, so sorting the slots visits the ancestors first.
+		std::sort(m_dirtySlots.begin(), m_dirtySlots.end());
+
+		for (int root : m_dirtySlots)
+		{
+			// Already resolved as a descendant of a previous dirty slot
+			if (m_flags[root] == 0)
+			{
+				continue;
+			}
+
+			// The ancestors are clean, so the world matrix of the whole subtree depends on the dirty root.
+			// Visits the subtree breadth-first, which keeps the parents ahead of their children.
+			m_subtree.clear();
+			m_subtree.emplace_back(root);
+			for (size_t head = 0; head < m_subtree.size(); ++head)
+			{
+				int slot = m_subtree[head];
+				if (m_flags[slot] & LocalDirty)
+				{
+					RecalculateLocalMatrix(slot);
+					counter.Local++;
+				}
+				RecalculateWorldMatrix(slot);
+				counter.World++;
+				m_flags[slot] = 0;
+
+				int first = m_firstChildren[slot];
+				int last = first + m_childCounts[slot];
+				for (int child = first; child < last; ++child)
+				{
+					m_subtree.emplace_back(child);
+				}
+			}
+		}
+	}
+
+	void TransformSystem::BuildWorkItems()
+	{
+		m_workItems.clear();
+
+		const int headCount = static_cast<int>(m_subtreeEnds.size());
+		if (headCount == 0 || m_concurrency <= 1)
+		{
+			return;
+		}
+
+		// Greedily group adjacent subtrees until each group holds about an equal share of the slots.
+		const int headEnd = m_subtreeHeadBegin + headCount;
+		const int totalCount = static_cast<int>(m_parents.size()) - m_subtreeHeadBegin;
+		const int targetCount = (totalCount + m_concurrency - 1) / m_concurrency;
+
+		WorkItem item = { m_subtreeHeadBegin, m_subtreeHeadBegin, headEnd, headEnd };
+		for (int head = 0; head < headCount; ++head)
+		{
+			item.HeadEnd++;
+			item.End = m_subtreeEnds[head];
+			if ((item.HeadEnd - item.HeadBegin) + (item.End - item.Begin) >= targetCount || head == headCount - 1)
+			{
+				m_workItems.emplace_back(item);
+				item = { item.HeadEnd, item.HeadEnd, item.End, item.End };
+			}
+		}
+	}
+
+	void TransformSystem::ValidateOrder()
+	{
+		if (!m_orderDirty)
+		{
+			return;
+		}
+
+		ZoneScoped;
+		const int count = static_cast<int>(m_parents.size());
+
+		// Count the children of each live slot.
+		// Children of a released slot become roots, as their parent no longer exists.
+		std::vector<int> offsets(count + 1, 0);
+		for (int slot = 0; slot < count; ++slot)
+		{
+			if (m_slotToHandle[slot] == InvalidHandle)
+			{
+				continue;
+			}
+			int parent = m_parents[slot];
+			if (parent != InvalidSlot && m_slotToHandle[parent] == InvalidHandle)
+			{
+				m_parents[slot] = InvalidSlot;
+				MarkDirty(slot, WorldDirty);
+				parent = InvalidSlot;
+			}
+			if (parent != InvalidSlot)
+			{
+				offsets[parent + 1]++;
+			}
+		}
+		for (int slot = 0; slot < count; ++slot)
+		{
+			offsets[slot + 1] += offsets[slot];
+		}
+
+		// Gather the children of each slot, preserving their relative order.
+		std::vector<int> children(offsets[count]);
+		std::vector<int> cursors(offsets.begin(), offsets.end() - 1);
+		for (int slot = 0; slot < count; ++slot)
+		{
+			if (m_slotToHandle[slot] != InvalidHandle && m_parents[slot] != InvalidSlot)
+			{
+				children[cursors[m_parents[slot]]++] = slot;
+			}
+		}
+
+		// Breadth-first traversal starting from all roots at once, one level at a time.
+		// The resulting order is sorted by depth, and the children of a slot are adjacent.
+		std::vector<int> order;
+		order.reserve(count);
+		for (int slot = 0; slot < count; ++slot)
+		{
+			if (m_slotToHandle[slot] != InvalidHandle && m_parents[slot] == InvalidSlot)
+			{
+				order.emplace_back(slot);
+			}
+		}
+		auto appendChildren = [&order, &offsets, &children](int slot) {
+			order.insert(order.end(), children.begin() + offsets[slot], children.begin() + offsets[slot + 1]);
+		};
+
+		size_t levelBegin = 0;
+		while (levelBegin < order.size() && order.size() - levelBegin < static_cast<size_t>(SubtreeSplitWidth))
+		{
+			size_t levelEnd = order.size();
+			for (size_t head = levelBegin; head < levelEnd; ++head)
+			{
+				appendChildren(order[head]);
+			}
+			levelBegin = levelEnd;
+		}
+
+		// Once a level is wide enough, each slot of it becomes the head of an independent subtree.
+		// The descendants of a head are traversed breadth-first on their own, so that every subtree
+		// occupies a contiguous range and can be updated without touching the others.
+		size_t headEnd = order.size();
+		m_subtreeHeadBegin = static_cast<int>(levelBegin);
+		m_subtreeEnds.clear();
+		for (size_t head = levelBegin; head < headEnd; ++head)
+		{
+			size_t subtreeBegin = order.size();
+			appendChildren(order[head]);
+			for (size_t node = subtreeBegin; node < order.size(); ++node)
+			{
+				appendChildren(order[node]);
+			}
+			m_subtreeEnds.emplace_back(static_cast<int>(order.size()));
+		}
+
+		std::vector<int> oldToNew(count, InvalidSlot);
+		for (int slot = 0; slot < static_cast<int>(order.size()); ++slot)
+		{
+			oldToNew[order[slot]] = slot;
+		}
+
+		std::vector<int> parents(order.size());
+		std::vector<int> firstChildren(order.size());
+		std::vector<int> childCounts(order.size());
+		for (int slot = 0; slot < static_cast<int>(order.size()); ++slot)
+		{
+			int oldSlot = order[slot];
+			int oldParent = m_parents[oldSlot];
+			parents[slot] = oldParent == InvalidSlot ? InvalidSlot : oldToNew[oldParent];
+			childCounts[slot] = offsets[oldSlot + 1] - offsets[oldSlot];
+			firstChildren[slot] = childCounts[slot] > 0 ? oldToNew[children[offsets[oldSlot]]] : 0;
+		}
+
+		PermuteSlots(m_positions, order);
+		PermuteSlots(m_rotations, order);
+		PermuteSlots(m_scales, order);
+		PermuteSlots(m_localMatrices, order);
+		PermuteSlots(m_worldMatrices, order);
+		PermuteSlots(m_flags, order);
+		PermuteSlots(m_slotToHandle, order);
+		m_parents.swap(parents);
+		m_firstChildren.swap(firstChildren);
+		m_childCounts.swap(childCounts);
+
+		for (int slot = 0; slot < static_cast<int>(m_slotToHandle.size()); ++slot)
+		{
+			m_handleToSlot[m_slotToHandle[slot]] = slot;
+		}
+
+		m_orderDirty = false;
+
+		BuildWorkItems();
+	}
+
+	void TransformSystem::RecalculateLocalMatrix(int slot)
+	{
+		XMVECTOR t = XMLoadFloat3(&m_positions[slot]);
+		XMVECTOR r = XMLoadFloat4(&m_rotations[slot]);
+		XMVECTOR s = XMLoadFloat3(&m_scales[slot]);
+		XMMATRIX m = XMMatrixAffineTransformation(s, XMVectorZero(), r, t);
+
+		XMStoreFloat4x4A(&m_localMatrices[slot], m);
+	}
+
+	void TransformSystem::RecalculateWorldMatrix(int slot)
+	{
+		// If the parent is null, the transform is the root of the hierarchy.
+		// This can be either the root of the scene or the root of the pre-constructed hierarchy.
+		int parent = m_parents[slot];
+		if (parent == InvalidSlot)
+		{
+			m_worldMatrices[slot] = m_localMatrices[slot];
+			return;
+		}
+
+		XMMATRIX ml = XMLoadFloat4x4A(&m_localMatrices[slot]);
+		XMMATRIX mp = XMLoadFloat4x4A(&m_worldMatrices[parent]);
+		XMStoreFloat4x4A(&m_worldMatrices[slot], XMMatrixMultiply(ml, mp));
+	}
+
+	void TransformSystem::MarkDirty(int slot, UINT8 flags)
+	{
+		if (m_flags[slot] == 0)
+		{
+			m_dirtyHandles.emplace_back(m_slotToHandle[slot]);
+		}
+		m_flags[slot] |= flags;
+	}
+
+	void TransformSystem::MarkChildrenDirty(int slot)
+	{
+		int first = m_firstChildren[slot];
+		int last = first + m_childCounts[slot];
+		for (int child = first; child < last; ++child)
+		{
+			m_flags[child] |= WorldDirty;
+		}
+	}
+
+	void TransformSystem::ValidateSlot(int slot)
+	{
+		UINT8& flags = m_flags[slot];
+		if (flags & LocalDirty)
+		{
+			RecalculateLocalMatrix(slot);
+			g_localMatrixRecalculateCounter++;
+			flags &= ~LocalDirty;
+			flags |= WorldDirty;
+		}
+		if (flags & WorldDirty)
+		{
+			RecalculateWorldMatrix(slot);
+			g_worldMatrixRecalculateCounter++;
+			flags &= ~WorldDirty;
+
+			// The children are resolved later, so they have to be registered as dirty.
+			int first = m_firstChildren[slot];
+			int last = first + m_childCounts[slot];
+			for (int child = first; child < last; ++child)
+			{
+				MarkDirty(child, WorldDirty);
+			}
+		}
+	}
+
+	void TransformSystem::ValidateRecursive(Handle handle)
+	{
+		// The child ranges are required to mark the children dirty.
+		// Reordering moves the slots, so the slot is resolved after it.
+		ValidateOrder();
+
+		m_chain.clear();
+		for (int current = m_handleToSlot[handle]; current != InvalidSlot; current = m_parents[current])
+		{
+			m_chain.emplace_back(current);
+		}
+		for (auto it = m_chain.rbegin(); it != m_chain.rend(); ++it)
+		{
+			ValidateSlot(*it);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "pch.h"
+
+namespace udsdx
+{
+	class Transform;
+
+	// Owns the data of every Transform in structure-of-arrays form.
+	// Slots are kept in breadth-first order: the parent slot always precedes its children,
+	// and the children of a slot are contiguous. This allows the world matrices to be resolved
+	// with a single linear pass over the arrays instead of chasing pointers through the hierarchy.
+	class TransformSystem
+	{
+		friend class Transform;
+
+	public:
+		using Handle = UINT;
+		static constexpr Handle InvalidHandle = std::numeric_limits<Handle>::max();
+		static constexpr int InvalidSlot = -1;
+
+	public:
+		TransformSystem() = default;
+		TransformSystem(const TransformSystem& rhs) = delete;
+		TransformSystem& operator=(const TransformSystem& rhs) = delete;
+		~TransformSystem() = default;
+
+	public:
+		Handle Allocate();
+		void Release(Handle handle);
+		void SetParent(Handle handle, Handle parent);
+
+		// Recalculate every dirty local matrix and every world matrix depending on it, in slot order.
+		// Only the subtrees of the dirty slots are visited, unless a large part of the hierarchy is dirty;
+		// then the whole arrays are scanned, and independent subtrees are updated in parallel.
+		void UpdateWorldMatrices();
+
+		// Number of work items the subtrees are split into. 1 disables the parallel update.
+		void SetConcurrency(UINT concurrency);
+		UINT GetConcurrency() const { return m_concurrency; }
+		size_t GetWorkItemCount() const { return m_workItems.size(); }
+
+		// Rebuild the breadth-first slot order if the hierarchy has changed since the last call.
+		// Handles stay valid, only the slots they point to are moved.
+		void ValidateOrder();
+
+		size_t GetCount() const { return m_parents.size(); }
+
+	private:
+		enum DirtyFlag : UINT8
+		{
+			LocalDirty = 1 << 0,
+			WorldDirty = 1 << 1,
+		};
+
+		// The first level of the hierarchy with at least this many slots is split into subtrees.
+		static constexpr int SubtreeSplitWidth = 32;
+		// When more than 1 / FullUpdateRatio of the slots are dirty, the whole arrays are scanned instead of the dirty list.
+		static constexpr int FullUpdateRatio = 4;
+
+		struct UpdateCounter
+		{
+			unsigned long long Local = 0;
+			unsigned long long World = 0;
+		};
+
+		// A group of adjacent subtrees, balanced by slot count.
+		// The heads and their descendants are two separate contiguous ranges.
+		struct WorkItem
+		{
+			int HeadBegin;
+			int HeadEnd;
+			int Begin;
+			int End;
+			UpdateCounter Counter;
+		};
+
+		int GetSlot(Handle handle) const { return m_handleToSlot[handle]; }
+
+		void RecalculateLocalMatrix(int slot);
+		void RecalculateWorldMatrix(int slot);
+		// Sets the flags and registers the slot in the dirty list if it was clean.
+		void MarkDirty(int slot, UINT8 flags);
+		// Sets the children dirty without registering them, only for passes that resolve them right away.
+		void MarkChildrenDirty(int slot);
+		void UpdateSlots(int begin, int end, UpdateCounter& counter);
+		void UpdateDirtySubtrees(UpdateCounter& counter);
+		void BuildWorkItems();
+
+		// Same as Transform::ValidateSRTMatrices(), assumes the parent slot is already valid.
+		void ValidateSlot(int slot);
+		// Validates the slot of the handle and all of its ancestors, from the root down.
+		void ValidateRecursive(Handle handle);
+
+	private:
+		// Per-slot data, indexed in breadth-first order
+		std::vector<Vector3> m_positions;
+		std::vector<Quaternion> m_rotations;
+		std::vector<Vector3> m_scales;
+		std::vector<XMFLOAT4X4A> m_localMatrices;
+		std::vector<XMFLOAT4X4A> m_worldMatrices;
+		std::vector<int> m_parents;
+		std::vector<int> m_firstChildren;
+		std::vector<int> m_childCounts;
+		std::vector<UINT8> m_flags;
+		std::vector<Handle> m_slotToHandle;
+
+		// Indirection from the stable handle to the current slot
+		std::vector<int> m_handleToSlot;
+		std::vector<Handle> m_freeHandles;
+
+		// Slots before m_subtreeHeadBegin form the trunk of the hierarchy and are updated serially.
+		// Each head in [m_subtreeHeadBegin, m_subtreeHeadBegin + m_subtreeEnds.size()) is followed
+		// by its descendants, laid out after all heads and ending at m_subtreeEnds of the head.
+		// Roots allocated since the last reorder follow the last subtree, and are updated serially after them.
+		int m_subtreeHeadBegin = 0;
+		std::vector<int> m_subtreeEnds;
+		std::vector<WorkItem> m_workItems;
+		UINT m_concurrency = std::max(std::thread::hardware_concurrency(), 1u);
+
+		// Handles of the slots which became dirty since the last update, in no particular order.
+		// Handles are stored instead of slots since reordering may happen in between.
+		std::vector<Handle> m_dirtyHandles;
+
+		// Scratch buffers for UpdateDirtySubtrees() and ValidateRecursive()
+		std::vector<int> m_dirtySlots;
+		std::vector<int> m_subtree;
+		std::vector<int> m_chain;
+
+		// Set when a parent has changed or a slot has been released.
+		// The child ranges are not valid until ValidateOrder() is called.
+		bool m_orderDirty = false;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,321 @@
+#pragma once
+
+#include "pch.h"
+#include "animation.h"
+#include "animation_compression.h"
+#include "pose_blender.h"
+
+namespace udsdx::test
+{
+	// Bones of a clip as the exporter writes them, each with its bind transform relative to its parent
+	struct TestSkeleton
+	{
+		std::vector<std::string> Names;
+		std::vector<Matrix4x4> Transforms;
+		std::vector<int> Parents;
+	};
+
+	// Bones in a binary tree, offset from their parents
+	inline TestSkeleton CreateTestSkeleton(size_t boneCount)
+	{
+		TestSkeleton skeleton;
+		for (size_t i = 0; i < boneCount; ++i)
+		{
+			skeleton.Names.push_back("bone" + std::to_string(i));
+			skeleton.Transforms.push_back(Matrix4x4::CreateTranslation(0.0f, i == 0 ? 0.0f : 0.3f, 0.05f * static_cast<float>(i % 3)));
+			skeleton.Parents.push_back(i == 0 ? -1 : static_cast<int>(i - 1) / 2);
+		}
+		return skeleton;
+	}
+
+	// Walk of the skeleton, the keys in ticks at 30 ticks per second:
+	// - every bone swings about its own axis, with a rotation key every 1 to 4 ticks depending on the bone,
+	// - the root moves forward with a position key per tick, the other bones keep a single position key,
+	// - the scales keep a key per tick of the same value,
+	// - every tenth bone has no channel, and holds its bind transform.
+	inline ::Animation CreateTestAnimation(const TestSkeleton& skeleton, std::string name, float duration, UINT seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+		::Animation animation;
+		animation.Name = std::move(name);
+		animation.TicksPerSecond = 30.0f;
+		animation.Duration = duration;
+		animation.Channels.resize(skeleton.Names.size());
+		for (size_t bone = 0; bone < skeleton.Names.size(); ++bone)
+		{
+			float frequency = value(random) * 3.0f + 4.0f;
+			float phase = value(random) * 3.0f;
+			float amplitude = value(random) * 0.8f;
+			Vector3 axis(value(random), value(random), value(random) + 2.0f);
+			axis.Normalize();
+			if (bone % 10 == 9)
+			{
+				continue;
+			}
+
+			::Animation::Channel& channel = animation.Channels[bone];
+			channel.Name = skeleton.Names[bone];
+			const int rotationStep = 1 + static_cast<int>(bone % 4);
+			for (int tick = 0; tick <= static_cast<int>(duration); ++tick)
+			{
+				float time = static_cast<float>(tick);
+				float seconds = time / animation.TicksPerSecond;
+				if (tick % rotationStep == 0 || tick == static_cast<int>(duration))
+				{
+					Quaternion rotation = Quaternion::CreateFromAxisAngle(axis, amplitude * std::sin(frequency * seconds + phase));
+					channel.RotationTimestamps.push_back(time);
+					channel.Rotations.emplace_back(rotation.x, rotation.y, rotation.z, rotation.w);
+				}
+				if (bone == 0)
+				{
+					channel.PositionTimestamps.push_back(time);
+					channel.Positions.emplace_back(seconds * 1.5f, 0.9f + 0.05f * std::sin(seconds * 12.0f), 0.0f);
+				}
+				channel.ScaleTimestamps.push_back(time);
+				channel.Scales.emplace_back(1.0f, 1.0f, 1.0f);
+			}
+			if (bone != 0)
+			{
+				Vector3 offset = skeleton.Transforms[bone].Translation();
+				channel.PositionTimestamps.push_back(0.0f);
+				channel.Positions.emplace_back(offset.x, offset.y, offset.z);
+			}
+		}
+		return animation;
+	}
+
+	template <typename T>
+	void WriteValue(std::ofstream& file, const T& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	inline void WriteName(std::ofstream& file, const std::string& name)
+	{
+		WriteValue(file, name.size());
+		file.write(name.data(), name.size());
+	}
+
+	template <typename Key_T>
+	void WriteKeys(std::ofstream& file, const std::vector<float>& timestamps, const std::vector<Key_T>& keys)
+	{
+		WriteValue(file, keys.size());
+		for (size_t i = 0; i < keys.size(); ++i)
+		{
+			WriteValue(file, timestamps[i]);
+			WriteValue(file, keys[i]);
+		}
+	}
+
+	inline void WriteSkeleton(std::ofstream& file, const TestSkeleton& skeleton)
+	{
+		WriteValue(file, skeleton.Names.size());
+		for (size_t i = 0; i < skeleton.Names.size(); ++i)
+		{
+			WriteName(file, skeleton.Names[i]);
+			WriteValue(file, skeleton.Transforms[i]);
+		}
+		for (int parent : skeleton.Parents)
+		{
+			WriteValue(file, parent);
+		}
+	}
+
+	// Writes a .yac file with the raw keys of the animations, in the format the exporter wrote before the compression
+	inline std::filesystem::path WriteRawClip(std::string_view fileName, const TestSkeleton& skeleton, std::span<const ::Animation> animations)
+	{
+		std::filesystem::path path = std::filesystem::temp_directory_path() / fileName;
+		std::ofstream file(path, std::ios::binary);
+		WriteSkeleton(file, skeleton);
+		WriteValue(file, animations.size());
+		for (const ::Animation& animation : animations)
+		{
+			WriteName(file, animation.Name);
+			WriteValue(file, animation.TicksPerSecond);
+			WriteValue(file, animation.Duration);
+			WriteValue(file, animation.Channels.size());
+			for (const ::Animation::Channel& channel : animation.Channels)
+			{
+				WriteName(file, channel.Name);
+				WriteKeys(file, channel.PositionTimestamps, channel.Positions);
+				WriteKeys(file, channel.RotationTimestamps, channel.Rotations);
+				WriteKeys(file, channel.ScaleTimestamps, channel.Scales);
+			}
+		}
+		return path;
+	}
+
+	// Writes a compressed .yac file of the animations, as the exporter does
+	inline std::filesystem::path WriteCompressedClip(std::string_view fileName, const TestSkeleton& skeleton, std::span<const ::Animation> animations)
+	{
+		std::filesystem::path path = std::filesystem::temp_directory_path() / fileName;
+		std::ofstream file(path, std::ios::binary);
+		WriteValue(file, CompressedAnimationTag);
+		WriteSkeleton(file, skeleton);
+		WriteValue(file, animations.size());
+		for (const ::Animation& animation : animations)
+		{
+			WriteName(file, animation.Name);
+			WriteValue(file, animation.TicksPerSecond);
+			WriteValue(file, animation.Duration);
+
+			CompressedAnimation compressed = CompressAnimation(animation, 30.0f, AnimationTolerance());
+			WriteValue(file, compressed.SampleInterval);
+			WriteValue(file, compressed.Tracks.size());
+			file.write(reinterpret_cast<const char*>(compressed.Tracks.data()), compressed.Tracks.size() * sizeof(::CompressedTrack));
+			WriteValue(file, compressed.Keys.size());
+			file.write(reinterpret_cast<const char*>(compressed.Keys.data()), compressed.Keys.size() * sizeof(uint16_t));
+		}
+		return path;
+	}
+
+	// Interpolates the source keys around the time, holding the first and the last ones outside of them
+	template <typename Key_T>
+	XMVECTOR SampleSourceKeys(const std::vector<float>& timestamps, const std::vector<Key_T>& keys, float time)
+	{
+		size_t next = std::distance(timestamps.begin(), std::lower_bound(timestamps.begin(), timestamps.end(), time));
+		size_t first = next == 0 ? 0 : std::min(next, keys.size()) - 1;
+		size_t second = std::min(next, keys.size() - 1);
+		float fraction = first == second ? 0.0f : (time - timestamps[first]) / (timestamps[second] - timestamps[first]);
+		if constexpr (std::is_same_v<Key_T, XMFLOAT4>)
+		{
+			return XMQuaternionSlerp(XMLoadFloat4(&keys[first]), XMLoadFloat4(&keys[second]), fraction);
+		}
+		else
+		{
+			return XMVectorLerp(XMLoadFloat3(&keys[first]), XMLoadFloat3(&keys[second]), fraction);
+		}
+	}
+
+	// Model space transforms of every bone at the time in seconds, composed recursively from the source keys
+	inline std::vector<Matrix4x4> ComputeReferencePose(const TestSkeleton& skeleton, const ::Animation& animation, float time)
+	{
+		float ticks = time * animation.TicksPerSecond;
+		std::vector<Matrix4x4> pose(skeleton.Names.size());
+		for (size_t bone = 0; bone < pose.size(); ++bone)
+		{
+			const ::Animation::Channel& channel = animation.Channels[bone];
+			XMMATRIX local = XMLoadFloat4x4(&skeleton.Transforms[bone]);
+			if (!channel.Name.empty())
+			{
+				local = XMMatrixAffineTransformation(
+					SampleSourceKeys(channel.ScaleTimestamps, channel.Scales, ticks), XMVectorZero(),
+					SampleSourceKeys(channel.RotationTimestamps, channel.Rotations, ticks),
+					SampleSourceKeys(channel.PositionTimestamps, channel.Positions, ticks));
+			}
+			int parent = skeleton.Parents[bone];
+			XMStoreFloat4x4(&pose[bone], parent < 0 ? local : XMMatrixMultiply(local, XMLoadFloat4x4(&pose[parent])));
+		}
+		return pose;
+	}
+
+	// Segment of the keys around the time, as the sampler before the packed tracks searched it
+	inline std::tuple<size_t, size_t, float> ToPreviousTimeFraction(const std::vector<float>& timeStamps, float time)
+	{
+		auto size = timeStamps.size();
+		auto seg = std::distance(timeStamps.begin(), std::lower_bound(timeStamps.begin(), timeStamps.end(), time));
+		if (seg == 0)
+		{
+			return { 0, size - 1, 0.0f };
+		}
+		if (seg == size)
+		{
+			return { 0, size - 1, 1.0f };
+		}
+		float begin = timeStamps[seg - 1];
+		float end = timeStamps[seg];
+		float fraction = (time - begin) / (end - begin);
+		return { seg - 1, seg, fraction };
+	}
+
+	// Copy of the sampler before the packed tracks: the channels own their keys, every track is searched
+	// with a binary search, and the pose of the clip is allocated on every call.
+	inline void PopulatePreviousTransforms(const TestSkeleton& skeleton, const ::Animation& animation, float animationTime, const std::vector<int>& boneMap, std::vector<Matrix4x4>& out, const std::map<std::string_view, Matrix4x4>& modifiers = {})
+	{
+		UINT boneCount = static_cast<UINT>(skeleton.Names.size());
+
+		float animationTicks = animationTime * animation.TicksPerSecond;
+		std::vector<Matrix4x4> in(boneCount);
+
+		for (UINT i = 0; i < boneCount; ++i)
+		{
+			const ::Animation::Channel& channel = animation.Channels[i];
+
+			XMMATRIX tParent = XMMatrixIdentity();
+			if (skeleton.Parents.at(i) != -1)
+			{
+				tParent = XMLoadFloat4x4(&in[skeleton.Parents.at(i)]);
+			}
+
+			XMMATRIX tLocal;
+			if (channel.Name.empty())
+				tLocal = XMLoadFloat4x4(&skeleton.Transforms[i]);
+			else
+			{
+				auto [ps1, ps2, pf] = ToPreviousTimeFraction(channel.PositionTimestamps, animationTicks);
+				auto [rs1, rs2, rf] = ToPreviousTimeFraction(channel.RotationTimestamps, animationTicks);
+				auto [ss1, ss2, sf] = ToPreviousTimeFraction(channel.ScaleTimestamps, animationTicks);
+
+				XMVECTOR p = XMVectorLerp(XMLoadFloat3(&channel.Positions[ps1]), XMLoadFloat3(&channel.Positions[ps2]), pf);
+				XMVECTOR q = XMQuaternionSlerp(XMLoadFloat4(&channel.Rotations[rs1]), XMLoadFloat4(&channel.Rotations[rs2]), rf);
+				XMVECTOR s = XMVectorLerp(XMLoadFloat3(&channel.Scales[ss1]), XMLoadFloat3(&channel.Scales[ss2]), sf);
+
+				tLocal = XMMatrixAffineTransformation(s, XMVectorZero(), q, p);
+				if (modifiers.find(skeleton.Names[i]) != modifiers.end())
+				{
+					tLocal = tLocal * XMLoadFloat4x4(&modifiers.at(skeleton.Names[i]));
+				}
+			}
+
+			XMStoreFloat4x4(&in[i], tLocal * tParent);
+		}
+
+		out.resize(boneMap.size());
+		for (UINT i = 0; i < out.size(); ++i)
+		{
+			int boneID = boneMap[i];
+			XMMATRIX boneTransform = boneID >= 0 ? XMLoadFloat4x4(&in[boneID]) : XMMatrixIdentity();
+			XMStoreFloat4x4(&out[i], boneTransform);
+		}
+	}
+
+	// Renderer of a crowd, cross-fading between the animations the way RiggedMeshRenderer does
+	struct TestCharacter
+	{
+		PoseBlender Blender;
+		std::array<AnimationCursor, 2> Cursors;
+		std::vector<AnimationLayer> Layers;
+		std::vector<Matrix4x4> Pose;
+		float Time = 0.0f;
+		float TransitionFactor = 0.0f;
+	};
+
+	inline std::vector<TestCharacter> CreateTestCrowd(const AnimationClip& clip, size_t count)
+	{
+		std::vector<TestCharacter> characters(count);
+		for (size_t index = 0; index < count; ++index)
+		{
+			TestCharacter& character = characters[index];
+			character.Blender.Reset(clip.GetBones(), clip.GetBoneParents());
+			character.Pose.resize(clip.GetBoneCount());
+			character.Time = 0.1f * static_cast<float>(index);
+			// A third of the crowd is cross-fading
+			character.TransitionFactor = index % 3 == 0 ? 0.0f : 1.0f;
+		}
+		return characters;
+	}
+
+	inline void SampleTestCharacter(TestCharacter& character, const Animation& previous, const Animation& current, std::span<const int> boneMap)
+	{
+		character.Layers.clear();
+		if (character.TransitionFactor < 1.0f)
+		{
+			character.Layers.push_back({ &previous, std::fmod(character.Time, previous.GetAnimationDuration()), 1.0f, boneMap, {}, &character.Cursors[0] });
+		}
+		float weight = std::min(character.TransitionFactor, 1.0f);
+		character.Layers.push_back({ &current, std::fmod(character.Time, current.GetAnimationDuration()), weight, boneMap, {}, &character.Cursors[1] });
+		character.Blender.Evaluate(character.Layers, {}, character.Pose);
+	}
+}
\ No newline at end of file
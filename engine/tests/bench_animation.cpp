@@ -0,0 +1,117 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "animation_clip.h"
+#include "animation_test_clips.h"
+#include "rigged_mesh.h"
+#include "job_system.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+BENCHMARK(Animation, CrowdSampling)
+{
+	// 300 instances of a 64 bone walk at staggered times, moving forward by a frame per run
+	constexpr size_t InstanceCount = 300;
+	TestSkeleton skeleton = CreateTestSkeleton(64);
+	std::vector<::Animation> animations = { CreateTestAnimation(skeleton, "walk", 120.0f, 20) };
+	AnimationClip clip(WriteRawClip("udsdx_bench_raw.yac", skeleton, animations));
+	const udsdx::Animation& animation = clip.GetAnimation();
+
+	std::vector<int> boneMap(clip.GetBoneCount());
+	std::iota(boneMap.begin(), boneMap.end(), 0);
+	std::vector<Matrix4x4> scratch(boneMap.size());
+	std::vector<Matrix4x4> output(InstanceCount * boneMap.size());
+	std::vector<AnimationCursor> cursors(InstanceCount);
+	int frame = 0;
+	auto sampleCrowd = [&](bool keepCursors) {
+		for (size_t instance = 0; instance < InstanceCount; ++instance)
+		{
+			if (!keepCursors)
+			{
+				cursors[instance].Reset();
+			}
+			float time = std::fmod((frame + instance * 7) / 60.0f, animation.GetAnimationDuration());
+			std::span<Matrix4x4> pose(output.data() + instance * boneMap.size(), boneMap.size());
+			animation.PopulateTransforms(time, cursors[instance], boneMap, scratch, pose);
+		}
+		++frame;
+		DoNotOptimize(output);
+	};
+
+	// Before the packed tracks: the channels searched with three binary searches per bone, into a fresh pose per call
+	std::vector<Matrix4x4> previousPose;
+	Measure("Previous sampler, 300 instances of 64 bones", 50, [&]() {
+		for (size_t instance = 0; instance < InstanceCount; ++instance)
+		{
+			float time = std::fmod((frame + instance * 7) / 60.0f, animation.GetAnimationDuration());
+			PopulatePreviousTransforms(skeleton, animations[0], time, boneMap, previousPose);
+			std::copy(previousPose.begin(), previousPose.end(), output.begin() + instance * boneMap.size());
+		}
+		++frame;
+		DoNotOptimize(output);
+	});
+	Measure("Searching the keys of every track, 300 instances of 64 bones", 50, [&]() { sampleCrowd(false); });
+	Measure("Stepping the per-instance cursors, 300 instances of 64 bones", 50, [&]() { sampleCrowd(true); });
+}
+
+BENCHMARK(Animation, Compression)
+{
+	// 5 s of a 60 bone walk, sampled by 300 instances from the raw and the compressed keys
+	constexpr size_t InstanceCount = 300;
+	TestSkeleton skeleton = CreateTestSkeleton(60);
+	std::vector<::Animation> animations = { CreateTestAnimation(skeleton, "walk", 150.0f, 21) };
+	Measure("CompressAnimation, 60 bones over 150 ticks", 10, [&]() {
+		DoNotOptimize(CompressAnimation(animations[0], 30.0f, AnimationTolerance()));
+	});
+
+	AnimationClip rawClip(WriteRawClip("udsdx_bench_raw.yac", skeleton, animations));
+	AnimationClip compressedClip(WriteCompressedClip("udsdx_bench_compressed.yac", skeleton, animations));
+	std::vector<int> boneMap(rawClip.GetBoneCount());
+	std::iota(boneMap.begin(), boneMap.end(), 0);
+	std::vector<Matrix4x4> scratch(boneMap.size());
+	std::vector<Matrix4x4> output(InstanceCount * boneMap.size());
+	std::vector<AnimationCursor> cursors(InstanceCount);
+	int frame = 0;
+	auto sampleCrowd = [&](const udsdx::Animation& animation) {
+		for (size_t instance = 0; instance < InstanceCount; ++instance)
+		{
+			float time = std::fmod((frame + instance * 7) / 60.0f, animation.GetAnimationDuration());
+			std::span<Matrix4x4> pose(output.data() + instance * boneMap.size(), boneMap.size());
+			animation.PopulateTransforms(time, cursors[instance], boneMap, scratch, pose);
+		}
+		++frame;
+		DoNotOptimize(output);
+	};
+
+	Measure("Raw keys with the per-instance cursors, 300 instances of 60 bones", 50, [&]() { sampleCrowd(rawClip.GetAnimation()); });
+	Measure("Compressed keys, 300 instances of 60 bones", 50, [&]() { sampleCrowd(compressedClip.GetAnimation()); });
+}
+
+BENCHMARK(Animation, ParallelCrowdSampling)
+{
+	// 200 characters of 64 bones, a third of them cross-fading, sampled serially and across the workers
+	TestSkeleton skeleton = CreateTestSkeleton(64);
+	std::vector<::Animation> animations = { CreateTestAnimation(skeleton, "walk", 150.0f, 20), CreateTestAnimation(skeleton, "run", 90.0f, 21) };
+	AnimationClip clip(WriteRawClip("udsdx_bench_raw.yac", skeleton, animations));
+	const udsdx::Animation& walk = clip.GetAnimation("walk");
+	const udsdx::Animation& run = clip.GetAnimation("run");
+	std::vector<int> boneMap(clip.GetBoneCount());
+	std::iota(boneMap.begin(), boneMap.end(), 0);
+	std::vector<TestCharacter> characters = CreateTestCrowd(clip, 200);
+	auto sample = [&](UINT begin, UINT end) {
+		for (UINT index = begin; index < end; ++index)
+		{
+			characters[index].Time += 1.0f / 60.0f;
+			SampleTestCharacter(characters[index], run, walk, boneMap);
+		}
+	};
+
+	Measure("Serial loop, 200 characters", 20, [&]() { sample(0, static_cast<UINT>(characters.size())); });
+	for (UINT workerCount : { 1u, 2u, 4u, 8u })
+	{
+		JobSystem jobSystem(workerCount);
+		std::string label = "ParallelFor, 200 characters, " + std::to_string(workerCount) + " workers";
+		Measure(label, 20, [&]() { jobSystem.ParallelFor(static_cast<UINT>(characters.size()), sample); });
+	}
+	DoNotOptimize(characters);
+}
\ No newline at end of file
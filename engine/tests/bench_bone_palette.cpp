@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "bone_palette.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+BENCHMARK(BonePalette, Crowd)
+{
+	// 500 characters of a single submesh with 60 bones
+	constexpr size_t CharacterCount = 500;
+	constexpr size_t BoneCount = 60;
+	std::mt19937 random(18);
+	std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+	auto randomMatrix = [&]() {
+		return Matrix4x4::CreateFromQuaternion(Quaternion::CreateFromYawPitchRoll(value(random), value(random), value(random))) *
+			Matrix4x4::CreateTranslation(value(random), value(random), value(random));
+	};
+
+	std::vector<Submesh> submeshes(1);
+	std::vector<int> boneMap;
+	for (size_t i = 0; i < BoneCount; ++i)
+	{
+		submeshes[0].BoneOffsets.push_back(randomMatrix());
+		boneMap.push_back(static_cast<int>(i));
+	}
+	std::vector<std::vector<Matrix4x4>> boneTransforms(CharacterCount);
+	for (std::vector<Matrix4x4>& transforms : boneTransforms)
+	{
+		for (size_t i = 0; i < BoneCount; ++i)
+		{
+			transforms.push_back(randomMatrix());
+		}
+	}
+
+	// Before the palette: a full array of the shader constants per character, uploaded for the previous and current frames
+	struct BoneConstants
+	{
+		std::array<Matrix4x4, BonePalette::MaxBoneCount> BoneTransforms;
+	};
+	std::vector<BoneConstants> caches(CharacterCount);
+	std::vector<BoneConstants> uploads(CharacterCount * 2);
+	Measure("Scalar products into full bone constants, 500 characters", 20, [&]() {
+		for (size_t character = 0; character < CharacterCount; ++character)
+		{
+			BoneConstants& constants = caches[character];
+			uploads[character * 2] = constants;
+			for (size_t i = 0; i < BoneCount; ++i)
+			{
+				constants.BoneTransforms[i] = (submeshes[0].BoneOffsets[i] * boneTransforms[character][boneMap[i]]).Transpose();
+			}
+			uploads[character * 2 + 1] = constants;
+		}
+		DoNotOptimize(uploads);
+	});
+
+	std::vector<BonePalette> palettes(CharacterCount);
+	for (BonePalette& palette : palettes)
+	{
+		palette.Reset(submeshes);
+	}
+	std::vector<Matrix4x4> destination(CharacterCount * BoneCount * 2);
+	Measure("BonePalette::Build and the previous palette, 500 characters", 20, [&]() {
+		for (size_t character = 0; character < CharacterCount; ++character)
+		{
+			BonePalette& palette = palettes[character];
+			Matrix4x4* current = destination.data() + character * BoneCount * 2;
+			palette.Swap();
+			palette.Build(0, submeshes[0], boneMap, boneTransforms[character], current);
+			memcpy(current + BoneCount, palette.GetPrevPalette(0).data(), BoneCount * sizeof(Matrix4x4));
+		}
+		DoNotOptimize(destination);
+	});
+}
\ No newline at end of file
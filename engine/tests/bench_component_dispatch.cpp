@@ -0,0 +1,145 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "component.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+// The scene and the renderers need the device, so this benchmark registers stand-in renderers with the ComponentRegistry
+// and fills the dispatch lists the way Scene::RegisterActiveComponent does. The two paths of Scene::Update/PostUpdate
+// are then timed: one virtual call per component and phase, against the batch functions of the registry over the
+// dense list of each type, including the copy of Downcast.
+namespace
+{
+	// Like MeshRenderer: only invalidates its transform cache after the update
+	class StaticRenderer : public Component
+	{
+	public:
+		static void PostUpdateAll(std::span<StaticRenderer*> renderers, const Time& time, Scene& scene)
+		{
+			for (StaticRenderer* renderer : renderers)
+			{
+				renderer->StaticRenderer::PostUpdate(time, scene);
+			}
+		}
+
+		void PostUpdate(const Time& time, Scene& scene) override { m_transformCacheDirty = true; }
+
+	private:
+		bool m_transformCacheDirty = false;
+		std::array<std::byte, 96> m_rendererPayload;
+	};
+
+	// Like RiggedMeshRenderer: advances its animation time in the update
+	class AnimatedRenderer : public Component
+	{
+	public:
+		static void UpdateAll(std::span<AnimatedRenderer*> renderers, const Time& time, Scene& scene)
+		{
+			for (AnimatedRenderer* renderer : renderers)
+			{
+				renderer->AnimatedRenderer::Update(time, scene);
+			}
+		}
+
+		static void PostUpdateAll(std::span<AnimatedRenderer*> renderers, const Time& time, Scene& scene)
+		{
+			for (AnimatedRenderer* renderer : renderers)
+			{
+				renderer->AnimatedRenderer::PostUpdate(time, scene);
+			}
+		}
+
+		void Update(const Time& time, Scene& scene) override { m_animationTime += time.deltaTime; }
+		void PostUpdate(const Time& time, Scene& scene) override { m_transformCacheDirty = true; }
+
+	private:
+		float m_animationTime = 0.0f;
+		bool m_transformCacheDirty = false;
+		std::array<std::byte, 256> m_rendererPayload;
+	};
+
+	// The stand-in renderers never touch the scene
+	Scene& GetPlaceholderScene()
+	{
+		alignas(std::max_align_t) static std::byte storage[1];
+		return *reinterpret_cast<Scene*>(storage);
+	}
+}
+
+BENCHMARK(ComponentDispatch, BatchedAgainstVirtualCalls)
+{
+	constexpr UINT staticCount = 10000;
+	constexpr UINT animatedCount = 1000;
+
+	// One component per object, the animated ones spread among the static ones like characters among props.
+	// Before the batches, every component overriding a hook was in the list of that phase, in hierarchy order.
+	ComponentRegistry* registry = INSTANCE(ComponentRegistry);
+	std::vector<std::unique_ptr<StaticRenderer>> staticRenderers;
+	std::vector<std::unique_ptr<AnimatedRenderer>> animatedRenderers;
+	std::vector<Component*> updateList;
+	std::vector<Component*> postUpdateList;
+	std::vector<std::vector<Component*>> batchLists;
+	auto addComponent = [&]<typename Component_T>(std::vector<std::unique_ptr<Component_T>>& renderers) {
+		Component_T* component = renderers.emplace_back(std::make_unique<Component_T>()).get();
+		ComponentRegistry::AssignTypeID(*component);
+		ComponentRegistry::TypeID typeID = ComponentRegistry::GetTypeID<Component_T>();
+		const ComponentRegistry::Systems& systems = registry->GetSystems(typeID);
+		if (systems.OverridesUpdate)
+		{
+			updateList.emplace_back(component);
+		}
+		if (systems.OverridesPostUpdate)
+		{
+			postUpdateList.emplace_back(component);
+		}
+		batchLists.resize(std::max<size_t>(batchLists.size(), typeID + 1));
+		batchLists[typeID].emplace_back(component);
+	};
+	for (UINT i = 0; i < staticCount + animatedCount; ++i)
+	{
+		if (i % (staticCount / animatedCount + 1) == 0 && animatedRenderers.size() < animatedCount)
+		{
+			addComponent(animatedRenderers);
+		}
+		else
+		{
+			addComponent(staticRenderers);
+		}
+	}
+
+	Time time = { 1.0f / 60.0f, 0.0f };
+	Scene& scene = GetPlaceholderScene();
+	auto dispatchList = [&](const std::vector<Component*>& list, void (Component::* hook)(const Time&, Scene&)) {
+		for (size_t i = 0; i < list.size(); ++i)
+		{
+			if (Component* component = list[i])
+			{
+				(component->*hook)(time, scene);
+			}
+		}
+	};
+	Measure("per-object virtual Update and PostUpdate, 10k + 1k renderers", 200, [&]() {
+		dispatchList(updateList, &Component::Update);
+		dispatchList(postUpdateList, &Component::PostUpdate);
+	});
+
+	// As Scene::UpdateBatches, through the batch functions of the registry
+	auto updateBatches = [&](ComponentRegistry::BatchFunction ComponentRegistry::Systems::* phase) {
+		for (ComponentRegistry::TypeID typeID = 0; typeID < batchLists.size(); ++typeID)
+		{
+			ComponentRegistry::BatchFunction function = registry->GetSystems(typeID).*phase;
+			if (function == nullptr || batchLists[typeID].empty())
+			{
+				continue;
+			}
+			function(batchLists[typeID], time, scene);
+		}
+	};
+	Measure("per-type batches from the registry, 10k + 1k renderers", 200, [&]() {
+		updateBatches(&ComponentRegistry::Systems::Update);
+		updateBatches(&ComponentRegistry::Systems::PostUpdate);
+	});
+	DoNotOptimize(staticRenderers);
+	DoNotOptimize(animatedRenderers);
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "culling.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+BENCHMARK(Culling, Frustum)
+{
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+	std::uniform_real_distribution<float> extent(0.1f, 5.0f);
+	Matrix4x4 view(XMMatrixLookToLH(Vector3(3.0f, 10.0f, -20.0f), Vector3(0.4f, -0.1f, 1.0f), Vector3::Up));
+	Matrix4x4 proj(XMMatrixPerspectiveFovLH(PI / 3.0f, 16.0f / 9.0f, 0.1f, 150.0f));
+	ViewVolume volume = ViewVolume::CreateFrustum(view, proj);
+
+	for (size_t count : { 10000u, 100000u, 1000000u })
+	{
+		std::vector<BoundingBox> boxes;
+		CullingBounds bounds;
+		bounds.Resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			boxes.emplace_back(XMFLOAT3(position(random), position(random) * 0.2f, position(random)), XMFLOAT3(extent(random), extent(random), extent(random)));
+			bounds.Set(i, boxes.back(), Matrix4x4::Identity);
+		}
+
+		std::string suffix = ", " + std::to_string(count) + " boxes";
+		VisibilitySet visibility;
+		Measure("CullingBounds::Cull" + suffix, 50, [&]() {
+			bounds.Cull(volume, visibility);
+		});
+
+		// The scalar test of every box, as a loop over the bounds of the items would do it
+		std::vector<bool> visible(count);
+		Measure("ViewVolume::Intersects per box" + suffix, 10, [&]() {
+			for (size_t i = 0; i < count; ++i)
+			{
+				visible[i] = volume.Intersects(boxes[i]);
+			}
+		});
+	}
+}
+
+BENCHMARK(Culling, ShadowCascades)
+{
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+	std::uniform_real_distribution<float> extent(0.1f, 5.0f);
+	Vector3 lightDirection(0.3f, -1.0f, 0.2f);
+	lightDirection.Normalize();
+	std::array<ViewVolume, 4> volumes;
+	for (size_t i = 0; i < volumes.size(); ++i)
+	{
+		float size = 20.0f * static_cast<float>(1 << i);
+		Matrix4x4 lightView(XMMatrixLookToLH(Vector3(3.0f, 10.0f, -20.0f) - lightDirection * size, lightDirection, Vector3::UnitZ));
+		volumes[i] = ViewVolume::CreateOrientedBox(lightView, size, size, -size * 10.0f, size * 10.0f);
+	}
+
+	for (size_t count : { 10000u, 100000u, 1000000u })
+	{
+		CullingBounds bounds;
+		bounds.Resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			bounds.Set(i, BoundingBox(XMFLOAT3(position(random), position(random) * 0.2f, position(random)), XMFLOAT3(extent(random), extent(random), extent(random))), Matrix4x4::Identity);
+		}
+
+		std::string suffix = ", " + std::to_string(count) + " boxes";
+		std::array<VisibilitySet, 4> visibilities;
+		Measure("CullingBounds::Cull of 4 cascades in one pass" + suffix, 50, [&]() {
+			bounds.Cull(volumes, visibilities);
+		});
+		Measure("CullingBounds::Cull of 4 cascades in separate passes" + suffix, 50, [&]() {
+			for (size_t i = 0; i < volumes.size(); ++i)
+			{
+				bounds.Cull(volumes[i], visibilities[i]);
+			}
+		});
+	}
+}
\ No newline at end of file
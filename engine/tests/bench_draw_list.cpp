@@ -0,0 +1,39 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "draw_list.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+BENCHMARK(DrawList, Sort)
+{
+	std::mt19937 random(1);
+	std::uniform_int_distribution<UINT> id(0, 200);
+	std::uniform_real_distribution<float> depth(0.0f, 500.0f);
+
+	for (UINT count : { 1000u, 10000u, 100000u })
+	{
+		std::vector<DrawItem> items(count);
+		for (DrawItem& item : items)
+		{
+			item.SortKey = DrawList::MakeSortKey(id(random) % 2, id(random), id(random) % 2, id(random), id(random), id(random) % 8) | DrawList::MakeDepthBucket(depth(random));
+		}
+
+		DrawList drawList;
+		std::string suffix = ", " + std::to_string(count) + " items";
+		Measure("DrawList::Sort" + suffix, 50, [&]() {
+			drawList.Clear();
+			for (const DrawItem& item : items)
+			{
+				drawList.Add(item);
+			}
+			drawList.Sort();
+		});
+
+		std::vector<DrawItem> sorted;
+		Measure("std::sort of the items" + suffix, 50, [&]() {
+			sorted.assign(items.begin(), items.end());
+			std::sort(sorted.begin(), sorted.end(), [](const DrawItem& lhs, const DrawItem& rhs) { return lhs.SortKey < rhs.SortKey; });
+		});
+	}
+}
\ No newline at end of file
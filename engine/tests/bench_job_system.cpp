@@ -0,0 +1,43 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "job_system.h"
+
+using namespace udsdx;
+
+BENCHMARK(JobSystem, DispatchOverhead)
+{
+	JobSystem jobSystem;
+	std::cout << "  " << jobSystem.GetWorkerCount() << " workers\n";
+
+	constexpr UINT jobCount = 4000;
+	std::atomic<UINT> sink = 0;
+	test::Measure("dispatch and wait, 4000 empty jobs", 50, [&]() {
+		JobCounter counter;
+		for (UINT i = 0; i < jobCount; ++i)
+		{
+			jobSystem.Dispatch(counter, [&sink]() { sink.fetch_add(1, std::memory_order_relaxed); });
+		}
+		jobSystem.Wait(counter);
+	});
+}
+
+BENCHMARK(JobSystem, ParallelForScaling)
+{
+	constexpr UINT elementCount = 1 << 20;
+	std::vector<float> values(elementCount, 1.0f);
+	auto kernel = [&values](UINT begin, UINT end) {
+		for (UINT i = begin; i < end; ++i)
+		{
+			values[i] = std::sqrt(values[i] * 1.0001f + 0.5f);
+		}
+	};
+
+	test::Measure("serial loop, 1M elements", 20, [&]() { kernel(0, elementCount); });
+	for (UINT workerCount : { 1u, 2u, 4u, 8u })
+	{
+		JobSystem jobSystem(workerCount);
+		std::string label = "ParallelFor, 1M elements, " + std::to_string(workerCount) + " workers";
+		test::Measure(label, 20, [&]() { jobSystem.ParallelFor(elementCount, kernel); });
+	}
+	test::DoNotOptimize(values);
+}
\ No newline at end of file
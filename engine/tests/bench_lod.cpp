@@ -0,0 +1,26 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "lod_test_meshes.h"
+#include "mesh_simplifier.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+BENCHMARK(Lod, SimplifySphere)
+{
+	TestMesh sphere = CreateSphereMesh(64, 128);
+	std::string suffix = ", " + std::to_string(sphere.Indices.size() / 3) + " triangles";
+	Measure("SimplifyMesh to half of the triangles" + suffix, 10, [&]() {
+		float error = 0.0f;
+		DoNotOptimize(SimplifyMesh(sphere.Positions, sphere.Indices, sphere.Indices.size() / 2, error));
+	});
+	Measure("SimplifyMesh to 1/2, 1/4 and 1/8 of the triangles" + suffix, 10, [&]() {
+		std::vector<unsigned int> indices = sphere.Indices;
+		for (size_t level = 1; level <= 3; ++level)
+		{
+			float error = 0.0f;
+			indices = SimplifyMesh(sphere.Positions, indices, sphere.Indices.size() >> level, error);
+		}
+		DoNotOptimize(indices);
+	});
+}
\ No newline at end of file
@@ -0,0 +1,7 @@
+#include "pch.h"
+#include "test_framework.h"
+
+int main(int argc, char** argv)
+{
+	return udsdx::test::RunTestCases(udsdx::test::GetBenchmarks(), argc, argv);
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "city_test_scene.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+BENCHMARK(OcclusionBuffer, City)
+{
+	std::mt19937 random(11);
+	TestCubeMesh cube;
+	CityScene scene(100000, random);
+	const TestCamera cameras[] = {
+		{ Vector3(0.5f, 2.0f, -200.0f), 0.05f, 0.0f },
+		{ Vector3(0.5f, 60.0f, -300.0f), 0.3f, -0.25f },
+	};
+
+	for (size_t index = 0; index < std::size(cameras); ++index)
+	{
+		Matrix4x4 view = cameras[index].GetViewMatrix();
+		Matrix4x4 proj = cameras[index].GetProjMatrix();
+		VisibilitySet frustumVisibility;
+		scene.Bounds.Cull(ViewVolume::CreateFrustum(view, proj), frustumVisibility);
+
+		OcclusionBuffer buffer;
+		VisibilitySet visibility;
+		std::string suffix = ", camera " + std::to_string(index);
+		Measure("OcclusionBuffer rasterizing the buildings" + suffix, 50, [&]() {
+			buffer.Reset(view * proj);
+			scene.AddOccluders(buffer, cube, frustumVisibility);
+			buffer.Rasterize();
+		});
+		Measure("CullingBounds::Occlude of " + std::to_string(scene.Objects.size()) + " items" + suffix, 50, [&]() {
+			visibility = frustumVisibility;
+			scene.Bounds.Occlude(buffer, visibility);
+		});
+		std::cout << "  " << frustumVisibility.GetVisibleCount() << " items in the frustum, " << visibility.GetVisibleCount() << " after occlusion\n";
+	}
+}
\ No newline at end of file
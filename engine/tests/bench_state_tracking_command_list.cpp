@@ -0,0 +1,52 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "state_tracking_command_list.h"
+#include "recording_command_list.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+BENCHMARK(StateTracking, SortedDraws)
+{
+	// Sorted draws of a few meshes and materials, each binding its buffers, pipeline and three textures
+	std::mt19937 random(16);
+	std::uniform_int_distribution<UINT> id(0, 31);
+	std::vector<std::pair<UINT, UINT>> draws(10000);
+	for (auto& draw : draws)
+	{
+		draw = { id(random), id(random) };
+	}
+	std::sort(draws.begin(), draws.end());
+
+	auto bind = [&draws](auto& commandList) {
+		for (const auto& [material, mesh] : draws)
+		{
+			D3D12_VERTEX_BUFFER_VIEW vertexBuffer = { 0x10000ull * (mesh + 1), 4096, 32 };
+			D3D12_INDEX_BUFFER_VIEW indexBuffer = { 0x20000000ull + 0x10000ull * mesh, 1024, DXGI_FORMAT_R32_UINT };
+			commandList.IASetVertexBuffers(0, 1, &vertexBuffer);
+			commandList.IASetIndexBuffer(&indexBuffer);
+			commandList.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			commandList.OMSetStencilRef(0);
+			commandList.SetPipelineState(reinterpret_cast<ID3D12PipelineState*>(static_cast<uintptr_t>(0x1000 + (material % 4) * 0x100)));
+			for (UINT texture = 0; texture < 3; ++texture)
+			{
+				commandList.SetGraphicsRootDescriptorTable(RootParam::SrcTexSRV_0 + texture, { 0x40000000ull + material * 0x100 + texture * 0x20 });
+			}
+		}
+	};
+
+	// The recorder only stores the state, so this is the cost of the tracking itself rather than the driver calls it saves
+	// Read through a volatile pointer, so the calls stay virtual as they are to the D3D12 command list
+	RecordingCommandList recorder;
+	CommandListBase* volatile target = &recorder;
+	Measure("Every call to the command list, 10000 draws", 50, [&]() {
+		bind(*target);
+	});
+	StateTrackingCommandList commandList(target);
+	Measure("Calls through StateTrackingCommandList, 10000 draws", 50, [&]() {
+		commandList.Invalidate();
+		commandList.ResetStatistics();
+		bind(commandList);
+	});
+	std::cout << "  " << commandList.GetStatistics().Issued << " calls issued, " << commandList.GetStatistics().Skipped << " skipped\n";
+}
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "transform_test_util.h"
+#include "job_system.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+namespace
+{
+	// The transform before the TransformSystem: a node of its own, with the children reached through pointers
+	struct PointerTransform
+	{
+		Vector3 Position;
+		Quaternion Rotation;
+		Vector3 Scale = Vector3::One;
+		Matrix4x4 LocalMatrix;
+		Matrix4x4 WorldMatrix;
+		bool IsLocalMatrixDirty = true;
+		bool IsWorldMatrixDirty = true;
+		PointerTransform* Parent = nullptr;
+		std::vector<PointerTransform*> Children;
+		// Stands for the rest of the scene object the transform was embedded in
+		std::array<std::byte, 128> Payload;
+
+		void ValidateSRTMatrices()
+		{
+			if (IsLocalMatrixDirty)
+			{
+				XMMATRIX m = XMMatrixAffineTransformation(XMLoadFloat3(&Scale), XMVectorZero(), XMLoadFloat4(&Rotation), XMLoadFloat3(&Position));
+				XMStoreFloat4x4(&LocalMatrix, m);
+				IsLocalMatrixDirty = false;
+				IsWorldMatrixDirty = true;
+			}
+			if (IsWorldMatrixDirty)
+			{
+				if (Parent == nullptr)
+				{
+					WorldMatrix = LocalMatrix;
+				}
+				else
+				{
+					XMStoreFloat4x4(&WorldMatrix, XMMatrixMultiply(XMLoadFloat4x4(&LocalMatrix), XMLoadFloat4x4(&Parent->WorldMatrix)));
+				}
+				IsWorldMatrixDirty = false;
+				for (PointerTransform* child : Children)
+				{
+					child->IsWorldMatrixDirty = true;
+				}
+			}
+		}
+
+		void ValidateRecursive()
+		{
+			ValidateSRTMatrices();
+			for (PointerTransform* child : Children)
+			{
+				child->ValidateRecursive();
+			}
+		}
+	};
+}
+
+BENCHMARK(TransformSystem, HierarchyUpdate)
+{
+	std::vector<UINT> counts = { 10000, 100000, 1000000 };
+	if (IsQuickRun())
+	{
+		counts.resize(1);
+	}
+
+	for (UINT count : counts)
+	{
+		std::mt19937 random(1);
+		std::vector<int> parents(count);
+		for (UINT i = 1; i < count; ++i)
+		{
+			parents[i] = static_cast<int>(std::uniform_int_distribution<UINT>(0, i - 1)(random));
+		}
+		std::string suffix = ", " + std::to_string(count) + " moving transforms";
+
+		{
+			// Separate allocations, like the scene objects holding the transforms
+			std::vector<std::unique_ptr<PointerTransform>> nodes;
+			for (UINT i = 0; i < count; ++i)
+			{
+				nodes.emplace_back(std::make_unique<PointerTransform>());
+			}
+			for (UINT i = 1; i < count; ++i)
+			{
+				nodes[i]->Parent = nodes[parents[i]].get();
+				nodes[parents[i]]->Children.emplace_back(nodes[i].get());
+			}
+			UINT frame = 0;
+			Measure("per-node validation" + suffix, 10, [&]() {
+				float offset = static_cast<float>(++frame);
+				for (auto& node : nodes)
+				{
+					node->Position.x = offset;
+					node->IsLocalMatrixDirty = true;
+				}
+				nodes[0]->ValidateRecursive();
+			});
+		}
+
+		{
+			Singleton<TransformSystem>::CreateInstance();
+			TransformSystem* system = INSTANCE(TransformSystem);
+			system->SetConcurrency(1);
+			std::vector<std::unique_ptr<TestTransform>> transforms;
+			for (UINT i = 0; i < count; ++i)
+			{
+				transforms.emplace_back(std::make_unique<TestTransform>());
+			}
+			for (UINT i = 1; i < count; ++i)
+			{
+				transforms[i]->SetParent(transforms[parents[i]].get());
+			}
+			system->UpdateWorldMatrices();
+
+			UINT frame = 0;
+			Measure("UpdateWorldMatrices" + suffix, 10, [&]() {
+				float offset = static_cast<float>(++frame);
+				for (auto& transform : transforms)
+				{
+					transform->SetLocalPositionX(offset);
+				}
+				system->UpdateWorldMatrices();
+			});
+		}
+	}
+}
+
+BENCHMARK(TransformSystem, ParallelScaling)
+{
+	const UINT count = IsQuickRun() ? 10000 : 200000;
+	std::vector<UINT> workerCounts = { 1, 2, 4, 8 };
+	if (std::thread::hardware_concurrency() > workerCounts.back())
+	{
+		workerCounts.emplace_back(std::thread::hardware_concurrency());
+	}
+
+	Singleton<TransformSystem>::CreateInstance();
+	TransformSystem* system = INSTANCE(TransformSystem);
+	std::mt19937 random(1);
+	std::vector<std::unique_ptr<TestTransform>> transforms;
+	for (UINT i = 0; i < count; ++i)
+	{
+		auto& transform = transforms.emplace_back(std::make_unique<TestTransform>());
+		if (i > 0)
+		{
+			transform->SetParent(transforms[std::uniform_int_distribution<UINT>(0, i - 1)(random)].get());
+		}
+	}
+
+	for (UINT workerCount : workerCounts)
+	{
+		Singleton<JobSystem>::CreateInstance(workerCount);
+		system->SetConcurrency(workerCount);
+		system->UpdateWorldMatrices();
+
+		UINT frame = 0;
+		std::string label = "UpdateWorldMatrices, " + std::to_string(count) + " moving transforms, " + std::to_string(workerCount) + " workers";
+		Measure(label, 20, [&]() {
+			float offset = static_cast<float>(++frame);
+			for (auto& transform : transforms)
+			{
+				transform->SetLocalPositionX(offset);
+			}
+			system->UpdateWorldMatrices();
+		});
+	}
+	Singleton<JobSystem>::CreateInstance();
+}
+
+BENCHMARK(TransformSystem, DirtyListUpdate)
+{
+	const UINT count = IsQuickRun() ? 10000 : 100000;
+
+	// Flat scene like the voxel demo: static roots with a few children each, some of which move
+	Singleton<TransformSystem>::CreateInstance();
+	TransformSystem* system = INSTANCE(TransformSystem);
+	std::vector<std::unique_ptr<TestTransform>> transforms;
+	for (UINT i = 0; i < count; ++i)
+	{
+		auto& transform = transforms.emplace_back(std::make_unique<TestTransform>());
+		if (i % 4 != 0)
+		{
+			transform->SetParent(transforms[i - i % 4].get());
+		}
+	}
+	system->UpdateWorldMatrices();
+
+	for (UINT movedCount : { 0u, 10u, 100u, 1000u, 10000u })
+	{
+		const UINT stride = movedCount == 0 ? count : count / movedCount;
+		UINT frame = 0;
+		std::string label = "UpdateWorldMatrices, " + std::to_string(movedCount) + " of " + std::to_string(count) + " moving";
+		Measure(label, 50, [&]() {
+			float offset = static_cast<float>(++frame);
+			for (UINT i = 0; i < movedCount; ++i)
+			{
+				transforms[i * stride]->SetLocalPositionX(offset);
+			}
+			system->UpdateWorldMatrices();
+		});
+	}
+}
\ No newline at end of file
@@ -0,0 +1,198 @@
+#pragma once
+
+#include "pch.h"
+#include "culling.h"
+#include "occlusion_buffer.h"
+
+namespace udsdx::test
+{
+	struct TestBox
+	{
+		Vector3 Center;
+		Vector3 Extents;
+
+		// Scales the cube spanning [-1, 1] to the box
+		Matrix4x4 GetWorld() const { return Matrix4x4::CreateScale(Extents) * Matrix4x4::CreateTranslation(Center); }
+	};
+
+	// The cube spanning [-1, 1], with the faces clockwise seen from the outside like the front faces of the rasterizer
+	struct TestCubeMesh
+	{
+		std::vector<XMFLOAT3> Vertices;
+		std::vector<UINT> Indices;
+
+		TestCubeMesh()
+		{
+			for (int i = 0; i < 8; ++i)
+			{
+				Vertices.emplace_back((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+			}
+			constexpr int quads[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+			for (const auto& quad : quads)
+			{
+				for (int half = 0; half < 2; ++half)
+				{
+					UINT a = quad[0];
+					UINT b = quad[half + 1];
+					UINT c = quad[half + 2];
+					Vector3 pa = Vertices[a];
+					Vector3 pb = Vertices[b];
+					Vector3 pc = Vertices[c];
+					if ((pb - pa).Cross(pc - pa).Dot(pa + pb + pc) < 0.0f)
+					{
+						std::swap(b, c);
+					}
+					Indices.insert(Indices.end(), { a, b, c });
+				}
+			}
+		}
+
+		std::span<const BYTE> GetVertexData() const { return { reinterpret_cast<const BYTE*>(Vertices.data()), Vertices.size() * sizeof(XMFLOAT3) }; }
+	};
+
+	struct TestCamera
+	{
+		Vector3 Eye;
+		float Yaw;
+		float Pitch;
+
+		static constexpr float NearPlane = 0.1f;
+		static constexpr float FarPlane = 1000.0f;
+
+		Matrix4x4 GetViewMatrix() const
+		{
+			Vector3 forward(std::cos(Pitch) * std::sin(Yaw), std::sin(Pitch), std::cos(Pitch) * std::cos(Yaw));
+			return Matrix4x4(XMMatrixLookToLH(Eye, forward, Vector3::Up));
+		}
+
+		Matrix4x4 GetProjMatrix() const
+		{
+			return Matrix4x4(XMMatrixPerspectiveFovLH(PI / 3.0f, 16.0f / 9.0f, NearPlane, FarPlane));
+		}
+	};
+
+	// Blocks of buildings on a grid, and props scattered over the streets and the roofs.
+	// The buildings come first in the objects, so they are occluders and occludees at once.
+	struct CityScene
+	{
+		std::vector<TestBox> Buildings;
+		std::vector<TestBox> Objects;
+		CullingBounds Bounds;
+
+		CityScene(size_t propCount, std::mt19937& random)
+		{
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			for (int x = -12; x < 12; ++x)
+			{
+				for (int z = -12; z < 12; ++z)
+				{
+					float height = 5.0f + unit(random) * 30.0f;
+					Vector3 extents(9.0f + unit(random) * 3.0f, height, 9.0f + unit(random) * 3.0f);
+					Buildings.push_back({ Vector3(x * 30.0f + 15.0f, height, z * 30.0f + 15.0f), extents });
+				}
+			}
+
+			Objects = Buildings;
+			for (size_t i = 0; i < propCount; ++i)
+			{
+				Vector3 extents(0.3f + unit(random) * 1.5f, 0.3f + unit(random) * 2.0f, 0.3f + unit(random) * 1.5f);
+				Vector3 center(unit(random) * 720.0f - 360.0f, extents.y + unit(random) * 3.0f, unit(random) * 720.0f - 360.0f);
+				Objects.push_back({ center, extents });
+			}
+
+			BoundingBox unitBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+			Bounds.Resize(Objects.size());
+			for (size_t i = 0; i < Objects.size(); ++i)
+			{
+				Bounds.Set(i, unitBox, Objects[i].GetWorld());
+			}
+		}
+
+		// Queues the buildings visible in the frustum, as the scene queues the visible occluders
+		void AddOccluders(OcclusionBuffer& buffer, const TestCubeMesh& cube, const VisibilitySet& visibility) const
+		{
+			for (size_t i = 0; i < Buildings.size(); ++i)
+			{
+				if (visibility.IsVisible(i))
+				{
+					buffer.AddOccluder(cube.GetVertexData(), sizeof(XMFLOAT3), cube.Indices, 0, Buildings[i].GetWorld());
+				}
+			}
+		}
+	};
+
+	inline bool SegmentHitsBox(const Vector3& from, const Vector3& to, const TestBox& box)
+	{
+		float enter = 0.0f;
+		float exit = 1.0f;
+		std::array<float, 3> origin = { from.x, from.y, from.z };
+		std::array<float, 3> direction = { to.x - from.x, to.y - from.y, to.z - from.z };
+		std::array<float, 3> center = { box.Center.x, box.Center.y, box.Center.z };
+		std::array<float, 3> extents = { box.Extents.x, box.Extents.y, box.Extents.z };
+		for (size_t i = 0; i < 3; ++i)
+		{
+			float low = center[i] - extents[i];
+			float high = center[i] + extents[i];
+			if (std::abs(direction[i]) < 1e-9f)
+			{
+				if (origin[i] < low || origin[i] > high)
+				{
+					return false;
+				}
+				continue;
+			}
+			float a = (low - origin[i]) / direction[i];
+			float b = (high - origin[i]) / direction[i];
+			enter = std::max(enter, std::min(a, b));
+			exit = std::min(exit, std::max(a, b));
+			if (enter > exit)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	enum class SampledVisibility
+	{
+		OutsideView,
+		Hidden,
+		Visible,
+	};
+
+	// Ground truth by ray casting for the props: points on the faces of the box inside the view are traced to the eye past the buildings
+	inline SampledVisibility SampleVisibility(const CityScene& scene, const TestBox& box, const TestCamera& camera, std::mt19937& random, int sampleCount)
+	{
+		Matrix4x4 view = camera.GetViewMatrix();
+		Matrix4x4 proj = camera.GetProjMatrix();
+		std::uniform_real_distribution<float> signedUnit(-1.0f, 1.0f);
+		bool inView = false;
+		for (int sample = 0; sample < sampleCount; ++sample)
+		{
+			int face = sample % 6;
+			int axis = face / 2;
+			std::array<float, 3> offset;
+			offset[axis] = (face & 1) ? 1.0f : -1.0f;
+			offset[(axis + 1) % 3] = signedUnit(random);
+			offset[(axis + 2) % 3] = signedUnit(random);
+			Vector3 point = box.Center + Vector3(offset[0], offset[1], offset[2]) * box.Extents;
+
+			Vector3 viewPoint = Vector3::Transform(point, view);
+			if (viewPoint.z < TestCamera::NearPlane || viewPoint.z > TestCamera::FarPlane ||
+				std::abs(viewPoint.x * proj._11 / viewPoint.z) > 1.0f || std::abs(viewPoint.y * proj._22 / viewPoint.z) > 1.0f)
+			{
+				continue;
+			}
+			inView = true;
+
+			bool blocked = std::any_of(scene.Buildings.begin(), scene.Buildings.end(), [&](const TestBox& building) {
+				return SegmentHitsBox(camera.Eye, point, building);
+			});
+			if (!blocked)
+			{
+				return SampledVisibility::Visible;
+			}
+		}
+		return inView ? SampledVisibility::Hidden : SampledVisibility::OutsideView;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "pch.h"
+#include "component.h"
+
+// Definitions of Component for the headless build, which leaves out the scene and its objects.
+// The hooks do nothing, as in component.cpp; SetActive() and GetTransform() need the scene and are left out.
+namespace udsdx
+{
+	Component::Component()
+	{
+	}
+
+	Component::~Component()
+	{
+	}
+
+	void Component::OnInitialize()
+	{
+	}
+
+	void Component::OnAttach()
+	{
+	}
+
+	void Component::OnActive()
+	{
+	}
+
+	void Component::Begin()
+	{
+	}
+
+	void Component::Update(const Time& time, Scene& scene)
+	{
+	}
+
+	void Component::PostUpdate(const Time& time, Scene& scene)
+	{
+	}
+
+	void Component::OnDrawGizmos(const Camera* target)
+	{
+	}
+
+	void Component::OnInactive()
+	{
+	}
+
+	void Component::OnDetach()
+	{
+	}
+
+	std::shared_ptr<SceneObject> Component::GetSceneObject() const
+	{
+		return m_object.lock();
+	}
+}
\ No newline at end of file
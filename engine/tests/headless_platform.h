@@ -0,0 +1,239 @@
+#pragma once
+
+// Stand-ins of the Windows, Direct3D 12, Tracy and ImGui declarations the engine headers refer to.
+// Included by pch.h instead of the platform headers when UDSDX_HEADLESS is defined, so the pure C++ parts
+// of the engine (job system, transforms, draw list, culling, animation...) build and run on any platform.
+// Nothing here talks to a GPU: the types only exist so the engine headers parse.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#define __cdecl
+#endif
+
+// DirectXMath
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <DirectXPackedVector.h>
+
+#ifndef _WIN32
+// Win32 types
+using UINT = unsigned int;
+using UINT8 = std::uint8_t;
+using UINT16 = std::uint16_t;
+using UINT32 = std::uint32_t;
+using UINT64 = std::uint64_t;
+using INT8 = std::int8_t;
+using INT16 = std::int16_t;
+using INT32 = std::int32_t;
+using INT64 = std::int64_t;
+using BYTE = unsigned char;
+using WORD = unsigned short;
+using DWORD = std::uint32_t;
+using SIZE_T = std::size_t;
+using LONG = std::int32_t;
+using HRESULT = std::int32_t;
+using BOOL = int;
+
+struct RECT
+{
+	LONG left;
+	LONG top;
+	LONG right;
+	LONG bottom;
+};
+
+enum DXGI_SCALING
+{
+	DXGI_SCALING_STRETCH = 0,
+	DXGI_SCALING_NONE = 1,
+	DXGI_SCALING_ASPECT_RATIO_STRETCH = 2
+};
+#endif
+
+// DirectXTK
+#include <SimpleMath.h>
+
+using namespace DirectX;
+
+// COM
+namespace Microsoft::WRL
+{
+	// Pointer without reference counting, which never releases the blobs, the only COM objects the headless build creates
+	template <typename T>
+	class ComPtr
+	{
+	public:
+		ComPtr() = default;
+		ComPtr(std::nullptr_t) {}
+
+		T* Get() const { return m_ptr; }
+		T* operator->() const { return m_ptr; }
+		T** GetAddressOf() { return &m_ptr; }
+		T** operator&() { return &m_ptr; }
+		T** ReleaseAndGetAddressOf() { m_ptr = nullptr; return &m_ptr; }
+		void Reset() { m_ptr = nullptr; }
+		explicit operator bool() const { return m_ptr != nullptr; }
+
+	private:
+		T* m_ptr = nullptr;
+	};
+}
+
+using namespace Microsoft::WRL;
+
+// Direct3D 12
+struct ID3D12Device;
+struct ID3D12PipelineState;
+struct ID3D12RootSignature;
+struct ID3D12DescriptorHeap;
+struct ID3D12Resource;
+
+namespace DirectX
+{
+	class SpriteBatch;
+}
+
+using D3D12_GPU_VIRTUAL_ADDRESS = UINT64;
+
+struct D3D12_VIEWPORT
+{
+	float TopLeftX;
+	float TopLeftY;
+	float Width;
+	float Height;
+	float MinDepth;
+	float MaxDepth;
+};
+
+using D3D12_RECT = RECT;
+
+struct D3D12_CPU_DESCRIPTOR_HANDLE
+{
+	SIZE_T ptr;
+};
+
+struct D3D12_GPU_DESCRIPTOR_HANDLE
+{
+	UINT64 ptr;
+};
+
+struct CD3DX12_CPU_DESCRIPTOR_HANDLE : D3D12_CPU_DESCRIPTOR_HANDLE {};
+struct CD3DX12_GPU_DESCRIPTOR_HANDLE : D3D12_GPU_DESCRIPTOR_HANDLE {};
+
+struct D3D12_VERTEX_BUFFER_VIEW
+{
+	D3D12_GPU_VIRTUAL_ADDRESS BufferLocation;
+	UINT SizeInBytes;
+	UINT StrideInBytes;
+};
+
+#ifndef __dxgiformat_h__
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R32_UINT = 42,
+	DXGI_FORMAT_R16_UINT = 57
+};
+#endif
+
+struct D3D12_INDEX_BUFFER_VIEW
+{
+	D3D12_GPU_VIRTUAL_ADDRESS BufferLocation;
+	UINT SizeInBytes;
+	DXGI_FORMAT Format;
+};
+
+enum D3D_PRIMITIVE_TOPOLOGY
+{
+	D3D_PRIMITIVE_TOPOLOGY_UNDEFINED = 0,
+	D3D_PRIMITIVE_TOPOLOGY_POINTLIST = 1,
+	D3D_PRIMITIVE_TOPOLOGY_LINELIST = 2,
+	D3D_PRIMITIVE_TOPOLOGY_LINESTRIP = 3,
+	D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST = 4,
+	D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP = 5
+};
+
+// Blobs in system memory, which the meshes keep copies of their buffers in
+struct ID3DBlob
+{
+	std::vector<BYTE> Buffer;
+
+	void* GetBufferPointer() { return Buffer.data(); }
+	SIZE_T GetBufferSize() const { return Buffer.size(); }
+};
+
+inline HRESULT D3DCreateBlob(SIZE_T size, ID3DBlob** blob)
+{
+	*blob = new ID3DBlob{ std::vector<BYTE>(size) };
+	return 0;
+}
+
+#define ThrowIfFailed(x) do { if ((x) < 0) { throw std::runtime_error(#x); } } while (false)
+
+// The calls of the command list the engine wraps, never implemented since no command list is ever created
+struct ID3D12GraphicsCommandList
+{
+	virtual void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views) = 0;
+	virtual void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) = 0;
+	virtual void IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY topology) = 0;
+	virtual void OMSetStencilRef(UINT stencilRef) = 0;
+	virtual void SetPipelineState(ID3D12PipelineState* pipelineState) = 0;
+	virtual void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) = 0;
+};
+
+// Tracy
+namespace tracy
+{
+	class D3D12QueueCtx;
+
+	inline void SetThreadName(const char*) {}
+}
+
+using TracyD3D12Ctx = tracy::D3D12QueueCtx*;
+
+#define ZoneScoped
+#define ZoneScopedN(name)
+#define ZoneScopedC(color)
+#define ZoneScopedNC(name, color)
+#define ZoneName(text, size)
+#define ZoneText(text, size)
+#define TracyPlot(name, value)
+#define TracyMessageCS(text, size, color, depth)
+#define TracyAllocS(ptr, size, depth)
+#define TracyFreeS(ptr, depth)
+#define FrameMark
+#define FrameMarkNamed(name)
+
+#ifndef _WIN32
+#define CopyMemory(destination, source, length) memcpy((destination), (source), (length))
+
+// Debug output
+inline void OutputDebugStringA(const char*) {}
+inline void OutputDebugStringW(const wchar_t*) {}
+
+inline int wcstombs_s(size_t* converted, char* destination, size_t destinationSize, const wchar_t* source, size_t count)
+{
+	size_t result = std::wcstombs(destination, source, std::min(count, destinationSize - 1));
+	if (result == static_cast<size_t>(-1))
+	{
+		result = 0;
+	}
+	destination[result] = '\0';
+	if (converted != nullptr)
+	{
+		*converted = result + 1;
+	}
+	return 0;
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "pch.h"
+
+namespace udsdx::test
+{
+	struct TestMesh
+	{
+		std::vector<XMFLOAT3> Positions;
+		std::vector<unsigned int> Indices;
+	};
+
+	// Unit sphere of stacks and slices without a seam, 2 * slices * (stacks - 1) triangles wound the same way
+	inline TestMesh CreateSphereMesh(unsigned int stacks, unsigned int slices)
+	{
+		TestMesh mesh;
+		mesh.Positions.emplace_back(0.0f, 1.0f, 0.0f);
+		for (unsigned int stack = 1; stack < stacks; ++stack)
+		{
+			float phi = PI * stack / stacks;
+			for (unsigned int slice = 0; slice < slices; ++slice)
+			{
+				float theta = 2.0f * PI * slice / slices;
+				mesh.Positions.emplace_back(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+			}
+		}
+		mesh.Positions.emplace_back(0.0f, -1.0f, 0.0f);
+
+		auto ring = [slices](unsigned int stack, unsigned int slice) { return 1 + (stack - 1) * slices + slice % slices; };
+		unsigned int bottom = static_cast<unsigned int>(mesh.Positions.size()) - 1;
+		for (unsigned int slice = 0; slice < slices; ++slice)
+		{
+			mesh.Indices.insert(mesh.Indices.end(), { 0, ring(1, slice + 1), ring(1, slice) });
+			mesh.Indices.insert(mesh.Indices.end(), { bottom, ring(stacks - 1, slice), ring(stacks - 1, slice + 1) });
+			for (unsigned int stack = 1; stack + 1 < stacks; ++stack)
+			{
+				unsigned int a = ring(stack, slice);
+				unsigned int b = ring(stack, slice + 1);
+				unsigned int c = ring(stack + 1, slice);
+				unsigned int d = ring(stack + 1, slice + 1);
+				mesh.Indices.insert(mesh.Indices.end(), { a, b, c, b, d, c });
+			}
+		}
+		return mesh;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "pch.h"
+#include "state_tracking_command_list.h"
+
+namespace udsdx::test
+{
+	// Stands in for the D3D12 command list: counts the calls made to it, and keeps the state they bound
+	class RecordingCommandList : public CommandListBase
+	{
+	public:
+		static constexpr UINT VertexBufferSlotCount = 2;
+		static constexpr UINT RootParameterCount = RootParam::SrcTexSRV_15 + 1;
+
+		struct BoundState
+		{
+			std::array<D3D12_VERTEX_BUFFER_VIEW, VertexBufferSlotCount> VertexBuffers = {};
+			D3D12_INDEX_BUFFER_VIEW IndexBuffer = {};
+			D3D_PRIMITIVE_TOPOLOGY Topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+			UINT StencilRef = 0;
+			ID3D12PipelineState* PipelineState = nullptr;
+			std::array<UINT64, RootParameterCount> DescriptorTables = {};
+		};
+
+	public:
+		void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views) override
+		{
+			++m_callCount;
+			for (UINT i = 0; i < numViews && startSlot + i < VertexBufferSlotCount; ++i)
+			{
+				m_state.VertexBuffers[startSlot + i] = views != nullptr ? views[i] : D3D12_VERTEX_BUFFER_VIEW{};
+			}
+		}
+
+		void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) override
+		{
+			++m_callCount;
+			m_state.IndexBuffer = view != nullptr ? *view : D3D12_INDEX_BUFFER_VIEW{};
+		}
+
+		void IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY topology) override
+		{
+			++m_callCount;
+			m_state.Topology = topology;
+		}
+
+		void OMSetStencilRef(UINT stencilRef) override
+		{
+			++m_callCount;
+			m_state.StencilRef = stencilRef;
+		}
+
+		void SetPipelineState(ID3D12PipelineState* pipelineState) override
+		{
+			++m_callCount;
+			m_state.PipelineState = pipelineState;
+		}
+
+		void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) override
+		{
+			++m_callCount;
+			m_state.DescriptorTables[rootParameterIndex] = baseDescriptor.ptr;
+		}
+
+		// Draws are not part of CommandListBase, the loops under test record them here
+		void DrawIndexedInstanced(UINT indexCount, UINT instanceCount)
+		{
+			++m_drawCount;
+			m_instanceCount += instanceCount;
+		}
+
+		const BoundState& GetState() const { return m_state; }
+		UINT GetCallCount() const { return m_callCount; }
+		UINT GetDrawCount() const { return m_drawCount; }
+		UINT GetInstanceCount() const { return m_instanceCount; }
+
+	private:
+		BoundState m_state;
+		UINT m_callCount = 0;
+		UINT m_drawCount = 0;
+		UINT m_instanceCount = 0;
+	};
+}
\ No newline at end of file
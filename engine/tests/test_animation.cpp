@@ -0,0 +1,383 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "animation_clip.h"
+#include "job_system.h"
+#include "animation_test_clips.h"
+#include "rigged_mesh.h"
+#include "transform_test_util.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+// Clip of a walk and a run over the same skeleton, with the source animations kept for the references
+struct TestClip
+{
+	TestSkeleton Skeleton;
+	std::vector<::Animation> Animations;
+	std::unique_ptr<AnimationClip> Clip;
+};
+
+static TestClip CreateRawTestClip(size_t boneCount)
+{
+	TestClip clip;
+	clip.Skeleton = CreateTestSkeleton(boneCount);
+	clip.Animations.push_back(CreateTestAnimation(clip.Skeleton, "walk", 150.0f, 20));
+	clip.Animations.push_back(CreateTestAnimation(clip.Skeleton, "run", 90.0f, 21));
+	clip.Clip = std::make_unique<AnimationClip>(WriteRawClip("udsdx_test_raw.yac", clip.Skeleton, clip.Animations));
+	return clip;
+}
+
+TEST_CASE(Animation, CursorSamplingMatchesAFreshSearch)
+{
+	TestClip clip = CreateRawTestClip(40);
+	const UINT boneCount = clip.Clip->GetBoneCount();
+	CHECK_EQUAL(boneCount, 40u);
+
+	std::vector<int> boneMap(boneCount);
+	std::iota(boneMap.begin(), boneMap.end(), 0);
+	std::vector<Matrix4x4> scratch(boneCount);
+	std::vector<Matrix4x4> freshScratch(boneCount);
+	std::vector<Matrix4x4> output(boneCount);
+	std::vector<Matrix4x4> freshOutput(boneCount);
+
+	// Forward frames with wraps, seeks back and ahead, then a switch to the other animation and back, all on one cursor
+	std::vector<std::pair<const udsdx::Animation*, float>> samples;
+	const udsdx::Animation& walk = clip.Clip->GetAnimation("walk");
+	const udsdx::Animation& run = clip.Clip->GetAnimation("run");
+	for (int frame = 0; frame < 400; ++frame)
+	{
+		samples.emplace_back(&walk, std::fmod(frame / 60.0f, walk.GetAnimationDuration()));
+	}
+	for (float time : { 3.7f, 0.4f, 0.0f, 4.9f, 1.25f, 1.2f, 5.0f, 6.0f })
+	{
+		samples.emplace_back(&walk, time);
+	}
+	for (int frame = 0; frame < 200; ++frame)
+	{
+		samples.emplace_back(frame < 100 ? &run : &walk, std::fmod(frame / 45.0f, 3.0f));
+	}
+
+	AnimationCursor cursor;
+	size_t mismatches = 0;
+	for (const auto& [animation, time] : samples)
+	{
+		animation->PopulateTransforms(time, cursor, boneMap, scratch, output);
+
+		AnimationCursor freshCursor;
+		animation->PopulateTransforms(time, freshCursor, boneMap, freshScratch, freshOutput);
+		mismatches += memcmp(output.data(), freshOutput.data(), output.size() * sizeof(Matrix4x4)) == 0 ? 0 : 1;
+	}
+	CHECK_EQUAL(mismatches, 0u);
+
+	// The vector overload samples with a cursor of its own
+	std::vector<Matrix4x4> vectorOutput;
+	walk.PopulateTransforms(2.5f, boneMap, vectorOutput);
+	walk.PopulateTransforms(2.5f, cursor, boneMap, scratch, output);
+	CHECK(memcmp(output.data(), vectorOutput.data(), output.size() * sizeof(Matrix4x4)) == 0);
+}
+
+TEST_CASE(Animation, PackedSamplingMatchesThePreviousSampler)
+{
+	TestClip clip = CreateRawTestClip(64);
+	const ::Animation& source = clip.Animations[0];
+	const udsdx::Animation& animation = clip.Clip->GetAnimation(source.Name);
+	std::vector<int> boneMap(clip.Clip->GetBoneCount());
+	std::iota(boneMap.begin(), boneMap.end(), 0);
+	std::vector<Matrix4x4> scratch(boneMap.size());
+	std::vector<Matrix4x4> output(boneMap.size());
+	std::vector<Matrix4x4> previousOutput;
+
+	// Forward frames over the whole animation, stepping the cursor as a playing instance does
+	AnimationCursor cursor;
+	size_t mismatches = 0;
+	for (int frame = 0; frame < 300; ++frame)
+	{
+		float time = std::fmod(frame / 60.0f, animation.GetAnimationDuration());
+		animation.PopulateTransforms(time, cursor, boneMap, scratch, output);
+		PopulatePreviousTransforms(clip.Skeleton, source, time, boneMap, previousOutput);
+		mismatches += memcmp(output.data(), previousOutput.data(), output.size() * sizeof(Matrix4x4)) == 0 ? 0 : 1;
+	}
+	CHECK_EQUAL(mismatches, 0u);
+}
+
+TEST_CASE(Animation, SamplingMatchesTheSourceKeys)
+{
+	TestClip clip = CreateRawTestClip(40);
+	const UINT boneCount = clip.Clip->GetBoneCount();
+
+	// The map reorders the bones, and its last entry is mapped to no bone of the clip
+	std::vector<int> boneMap(boneCount);
+	std::iota(boneMap.rbegin(), boneMap.rend(), 0);
+	boneMap.push_back(-1);
+	std::vector<Matrix4x4> scratch(boneCount);
+	std::vector<Matrix4x4> output(boneMap.size());
+
+	for (size_t index = 0; index < clip.Animations.size(); ++index)
+	{
+		const ::Animation& source = clip.Animations[index];
+		const udsdx::Animation& animation = clip.Clip->GetAnimation(source.Name);
+		CHECK_NEAR(animation.GetAnimationDuration(), source.Duration / source.TicksPerSecond, 1e-6f);
+
+		AnimationCursor cursor;
+		float difference = 0.0f;
+		for (float time = 0.0f; time < animation.GetAnimationDuration() + 0.5f; time += 0.013f)
+		{
+			animation.PopulateTransforms(time, cursor, boneMap, scratch, output);
+			std::vector<Matrix4x4> reference = ComputeReferencePose(clip.Skeleton, source, time);
+			for (UINT i = 0; i < boneCount; ++i)
+			{
+				difference = std::max(difference, MaxDifference(output[i], reference[boneMap[i]]));
+			}
+			CHECK(output.back() == Matrix4x4::Identity);
+		}
+		CHECK(difference < 1e-4f);
+	}
+}
+
+TEST_CASE(Animation, LocalPoseMatchesTheSourceKeys)
+{
+	TestClip clip = CreateRawTestClip(40);
+	const ::Animation& source = clip.Animations[0];
+	const udsdx::Animation& animation = clip.Clip->GetAnimation(source.Name);
+
+	std::vector<int> boneMap(clip.Clip->GetBoneCount());
+	std::iota(boneMap.begin(), boneMap.end(), 0);
+	boneMap.push_back(-1);
+	std::vector<LocalTransform> pose(boneMap.size());
+	pose.back().Position = Vector3(7.0f, 8.0f, 9.0f);
+
+	AnimationCursor cursor;
+	float difference = 0.0f;
+	for (float time = 0.0f; time < animation.GetAnimationDuration(); time += 0.1f)
+	{
+		animation.PopulateLocalPose(time, cursor, boneMap, pose);
+		for (size_t bone = 0; bone + 1 < pose.size(); ++bone)
+		{
+			const ::Animation::Channel& channel = source.Channels[bone];
+			XMMATRIX reference = XMLoadFloat4x4(&clip.Skeleton.Transforms[bone]);
+			if (!channel.Name.empty())
+			{
+				float ticks = time * source.TicksPerSecond;
+				reference = XMMatrixAffineTransformation(
+					SampleSourceKeys(channel.ScaleTimestamps, channel.Scales, ticks), XMVectorZero(),
+					SampleSourceKeys(channel.RotationTimestamps, channel.Rotations, ticks),
+					SampleSourceKeys(channel.PositionTimestamps, channel.Positions, ticks));
+			}
+			Matrix4x4 local = Matrix4x4::CreateScale(pose[bone].Scale) * Matrix4x4::CreateFromQuaternion(pose[bone].Rotation) * Matrix4x4::CreateTranslation(pose[bone].Position);
+			difference = std::max(difference, MaxDifference(local, Matrix4x4(reference)));
+		}
+	}
+	CHECK(difference < 1e-4f);
+
+	// The entries mapped to no bone are left as they are
+	CHECK(pose.back().Position == Vector3(7.0f, 8.0f, 9.0f));
+}
+
+TEST_CASE(Animation, CompressionKeepsTheTracksWithinTolerance)
+{
+	// 5 s of a 60 bone walk, each rotation track keyed every 1 to 4 ticks
+	TestSkeleton skeleton = CreateTestSkeleton(60);
+	std::vector<::Animation> animations = { CreateTestAnimation(skeleton, "walk", 150.0f, 21) };
+	const ::Animation& source = animations[0];
+	CompressedAnimation compressed = CompressAnimation(source, 30.0f, AnimationTolerance());
+	CHECK_EQUAL(compressed.Tracks.size(), skeleton.Names.size() * 3);
+	CHECK_NEAR(compressed.SampleInterval, 1.0f, 1e-6f);
+
+	// Bones without a channel have no keys, and the constant tracks a single one
+	size_t mismatchedTracks = 0;
+	for (size_t bone = 0; bone < skeleton.Names.size(); ++bone)
+	{
+		const ::CompressedTrack* tracks = &compressed.Tracks[bone * 3];
+		if (source.Channels[bone].Name.empty())
+		{
+			mismatchedTracks += tracks[0].KeyCount + tracks[1].KeyCount + tracks[2].KeyCount == 0 ? 0 : 1;
+			continue;
+		}
+		mismatchedTracks += (tracks[0].KeyCount == 1) == (bone != 0) ? 0 : 1;
+		mismatchedTracks += tracks[1].KeyCount > 1 && std::has_single_bit(tracks[1].FrameStride) && tracks[1].FrameStride <= 16 ? 0 : 1;
+		mismatchedTracks += tracks[2].KeyCount == 1 ? 0 : 1;
+	}
+	CHECK_EQUAL(mismatchedTracks, 0u);
+
+	// The keys shrink to under a quarter of the source keys
+	size_t rawSize = 0;
+	for (const ::Animation::Channel& channel : source.Channels)
+	{
+		rawSize += channel.Positions.size() * (sizeof(float) + sizeof(XMFLOAT3));
+		rawSize += channel.Rotations.size() * (sizeof(float) + sizeof(XMFLOAT4));
+		rawSize += channel.Scales.size() * (sizeof(float) + sizeof(XMFLOAT3));
+	}
+	size_t compressedSize = compressed.Tracks.size() * sizeof(::CompressedTrack) + compressed.Keys.size() * sizeof(uint16_t);
+	CHECK(compressedSize * 4 < rawSize);
+
+	AnimationTolerance tolerance;
+	CHECK(compressed.MaxPositionError <= tolerance.Position);
+	CHECK(compressed.MaxRotationError <= tolerance.Rotation);
+	CHECK(compressed.MaxScaleError <= tolerance.Scale);
+
+	// Decoded by the engine from the written file, at the source keys and between them
+	AnimationClip clip(WriteCompressedClip("udsdx_test_compressed.yac", skeleton, animations));
+	const udsdx::Animation& animation = clip.GetAnimation();
+	std::vector<int> boneMap(clip.GetBoneCount());
+	std::iota(boneMap.begin(), boneMap.end(), 0);
+	std::vector<LocalTransform> pose(boneMap.size());
+	AnimationCursor cursor;
+	float positionError = 0.0f;
+	float rotationError = 0.0f;
+	float scaleError = 0.0f;
+	for (float time = 0.0f; time <= animation.GetAnimationDuration(); time += 0.37f / source.TicksPerSecond)
+	{
+		animation.PopulateLocalPose(time, cursor, boneMap, pose);
+		float ticks = time * source.TicksPerSecond;
+		for (size_t bone = 0; bone < pose.size(); ++bone)
+		{
+			const ::Animation::Channel& channel = source.Channels[bone];
+			if (channel.Name.empty())
+			{
+				positionError = std::max(positionError, (pose[bone].Position - skeleton.Transforms[bone].Translation()).Length());
+				continue;
+			}
+			Vector3 position = SampleSourceKeys(channel.PositionTimestamps, channel.Positions, ticks);
+			XMVECTOR rotation = SampleSourceKeys(channel.RotationTimestamps, channel.Rotations, ticks);
+			Vector3 scale = SampleSourceKeys(channel.ScaleTimestamps, channel.Scales, ticks);
+			positionError = std::max(positionError, (pose[bone].Position - position).Length());
+
+			// The angle from the chord between the unit quaternions, which keeps its precision for small angles
+			XMVECTOR decoded = XMLoadFloat4(&pose[bone].Rotation);
+			float chord = std::min(XMVectorGetX(XMVector4Length(decoded - rotation)), XMVectorGetX(XMVector4Length(decoded + rotation)));
+			rotationError = std::max(rotationError, 4.0f * std::asin(chord * 0.5f));
+			scaleError = std::max(scaleError, (pose[bone].Scale - scale).Length());
+		}
+	}
+	CHECK(positionError < 1e-3f);
+	CHECK(rotationError < 1e-3f);
+	CHECK(scaleError < 1e-3f);
+}
+
+TEST_CASE(Animation, CompressedAndRawClipsSampleTheSamePoses)
+{
+	TestSkeleton skeleton = CreateTestSkeleton(40);
+	std::vector<::Animation> animations = { CreateTestAnimation(skeleton, "walk", 150.0f, 20), CreateTestAnimation(skeleton, "run", 90.0f, 21) };
+	AnimationClip rawClip(WriteRawClip("udsdx_test_raw.yac", skeleton, animations));
+	AnimationClip compressedClip(WriteCompressedClip("udsdx_test_compressed.yac", skeleton, animations));
+	CHECK_EQUAL(compressedClip.GetBoneCount(), rawClip.GetBoneCount());
+	CHECK(compressedClip.GetBoneParents() == rawClip.GetBoneParents());
+
+	std::vector<int> boneMap(rawClip.GetBoneCount());
+	std::iota(boneMap.begin(), boneMap.end(), 0);
+	std::vector<Matrix4x4> scratch(boneMap.size());
+	std::vector<Matrix4x4> rawPose(boneMap.size());
+	std::vector<Matrix4x4> compressedPose(boneMap.size());
+	for (const ::Animation& source : animations)
+	{
+		const udsdx::Animation& raw = rawClip.GetAnimation(source.Name);
+		const udsdx::Animation& compressed = compressedClip.GetAnimation(source.Name);
+		CHECK_NEAR(compressed.GetAnimationDuration(), raw.GetAnimationDuration(), 1e-6f);
+
+		// The errors add up along the chains of the hierarchy
+		AnimationCursor rawCursor;
+		AnimationCursor compressedCursor;
+		float difference = 0.0f;
+		for (float time = 0.0f; time < raw.GetAnimationDuration() + 0.5f; time += 0.021f)
+		{
+			raw.PopulateTransforms(time, rawCursor, boneMap, scratch, rawPose);
+			compressed.PopulateTransforms(time, compressedCursor, boneMap, scratch, compressedPose);
+			for (size_t i = 0; i < boneMap.size(); ++i)
+			{
+				difference = std::max(difference, MaxDifference(rawPose[i], compressedPose[i]));
+			}
+		}
+		CHECK(difference < 1e-2f);
+	}
+}
+
+TEST_CASE(Animation, ParallelCrowdSamplingMatchesTheSerialLoop)
+{
+	TestClip clip = CreateRawTestClip(64);
+	const udsdx::Animation& walk = clip.Clip->GetAnimation("walk");
+	const udsdx::Animation& run = clip.Clip->GetAnimation("run");
+	std::vector<int> boneMap(clip.Clip->GetBoneCount());
+	std::iota(boneMap.begin(), boneMap.end(), 0);
+
+	for (UINT workerCount : { 1u, 2u, 4u, 8u })
+	{
+		JobSystem jobSystem(workerCount);
+		std::vector<TestCharacter> serial = CreateTestCrowd(*clip.Clip, 200);
+		std::vector<TestCharacter> parallel = CreateTestCrowd(*clip.Clip, 200);
+
+		size_t mismatches = 0;
+		for (int frame = 0; frame < 50; ++frame)
+		{
+			for (std::vector<TestCharacter>* crowd : { &serial, &parallel })
+			{
+				for (TestCharacter& character : *crowd)
+				{
+					character.Time += 1.0f / 60.0f;
+					character.TransitionFactor += 1.0f / 60.0f / 0.2f;
+				}
+			}
+
+			for (TestCharacter& character : serial)
+			{
+				SampleTestCharacter(character, run, walk, boneMap);
+			}
+			jobSystem.ParallelFor(static_cast<UINT>(parallel.size()), [&](UINT begin, UINT end) {
+				for (UINT index = begin; index < end; ++index)
+				{
+					SampleTestCharacter(parallel[index], run, walk, boneMap);
+				}
+			});
+
+			for (size_t index = 0; index < serial.size(); ++index)
+			{
+				mismatches += memcmp(serial[index].Pose.data(), parallel[index].Pose.data(), serial[index].Pose.size() * sizeof(Matrix4x4)) == 0 ? 0 : 1;
+			}
+		}
+		CHECK_EQUAL(mismatches, 0u);
+	}
+}
+
+TEST_CASE(Animation, ModifiersApplyToTheAnimatedBonesByIndex)
+{
+	TestClip clip = CreateRawTestClip(20);
+	const ::Animation& source = clip.Animations[0];
+	const udsdx::Animation& animation = clip.Clip->GetAnimation(source.Name);
+	std::vector<int> boneMap(clip.Clip->GetBoneCount());
+	std::iota(boneMap.begin(), boneMap.end(), 0);
+
+	// Bone 9 has no channel, so its modifier is skipped
+	std::array<BoneModifier, 3> modifiers = { {
+		{ 2, Matrix4x4(XMMatrixRotationY(0.7f)) },
+		{ 9, Matrix4x4::CreateTranslation(5.0f, 0.0f, 0.0f) },
+		{ 12, Matrix4x4::CreateScale(1.5f) } } };
+	std::vector<Matrix4x4> pose;
+	animation.PopulateTransforms(1.1f, boneMap, pose, modifiers);
+
+	float ticks = 1.1f * source.TicksPerSecond;
+	std::vector<Matrix4x4> reference(pose.size());
+	for (size_t bone = 0; bone < pose.size(); ++bone)
+	{
+		const ::Animation::Channel& channel = source.Channels[bone];
+		XMMATRIX local = XMLoadFloat4x4(&clip.Skeleton.Transforms[bone]);
+		if (!channel.Name.empty())
+		{
+			local = XMMatrixAffineTransformation(
+				SampleSourceKeys(channel.ScaleTimestamps, channel.Scales, ticks), XMVectorZero(),
+				SampleSourceKeys(channel.RotationTimestamps, channel.Rotations, ticks),
+				SampleSourceKeys(channel.PositionTimestamps, channel.Positions, ticks));
+			for (const BoneModifier& modifier : modifiers)
+			{
+				local = modifier.Bone == bone ? local * XMLoadFloat4x4(&modifier.Transform) : local;
+			}
+		}
+		int parent = clip.Skeleton.Parents[bone];
+		XMStoreFloat4x4(&reference[bone], parent < 0 ? local : XMMatrixMultiply(local, XMLoadFloat4x4(&reference[parent])));
+	}
+
+	float difference = 0.0f;
+	for (size_t bone = 0; bone < pose.size(); ++bone)
+	{
+		difference = std::max(difference, MaxDifference(pose[bone], reference[bone]));
+	}
+	CHECK(difference < 1e-4f);
+}
\ No newline at end of file
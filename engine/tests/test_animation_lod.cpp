@@ -0,0 +1,114 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "animation_lod.h"
+#include "city_test_scene.h"
+#include "culling.h"
+#include "lod_selector.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+TEST_CASE(AnimationLod, IntervalFollowsTheScreenSize)
+{
+	CHECK_EQUAL(AnimationLod::SelectInterval(0.3f, 1, 0.1f), 1u);
+	CHECK_EQUAL(AnimationLod::SelectInterval(0.15f, 1, 0.1f), 2u);
+	CHECK_EQUAL(AnimationLod::SelectInterval(0.07f, 1, 0.1f), 4u);
+	CHECK_EQUAL(AnimationLod::SelectInterval(0.01f, 1, 0.1f), 8u);
+
+	// Within the hysteresis band the interval is kept, and a paused renderer resumes from the size alone
+	CHECK_EQUAL(AnimationLod::SelectInterval(0.19f, 1, 0.1f), 1u);
+	CHECK_EQUAL(AnimationLod::SelectInterval(0.21f, 2, 0.1f), 2u);
+	CHECK_EQUAL(AnimationLod::SelectInterval(0.3f, AnimationLod::Paused, 0.1f), 1u);
+	CHECK_EQUAL(AnimationLod::SelectInterval(0.01f, AnimationLod::Paused, 0.1f), 8u);
+}
+
+TEST_CASE(AnimationLod, StaggeredPhasesSpreadTheEvaluations)
+{
+	// 800 renderers at every 8th frame are due 100 at a time, each once per interval
+	constexpr UINT RendererCount = 800;
+	std::vector<UINT> skippedFrames(RendererCount, 0);
+	std::vector<UINT> evaluations(RendererCount, 0);
+	size_t unevenFrames = 0;
+	for (UINT64 frame = 1; frame <= 64; ++frame)
+	{
+		UINT dueCount = 0;
+		for (UINT index = 0; index < RendererCount; ++index)
+		{
+			bool due = AnimationLod::IsDue(frame, index, 8, skippedFrames[index]);
+			skippedFrames[index] = due ? 0 : skippedFrames[index] + 1;
+			evaluations[index] += due ? 1 : 0;
+			dueCount += due ? 1 : 0;
+		}
+		unevenFrames += dueCount == RendererCount / 8 ? 0 : 1;
+	}
+	CHECK_EQUAL(unevenFrames, 0u);
+	CHECK(std::all_of(evaluations.begin(), evaluations.end(), [](UINT count) { return count == 8; }));
+
+	// Paused renderers are never due, and a renderer whose interval shrinks catches up at once
+	CHECK(!AnimationLod::IsDue(8, 0, AnimationLod::Paused, 100));
+	CHECK(AnimationLod::IsDue(3, 0, 2, 7));
+}
+
+TEST_CASE(AnimationLod, ScriptedCrowdKeepsVisiblePosesFresh)
+{
+	// 1000 characters walking back and forth along rows spreading away from a camera, which pans left and right.
+	// The intervals are picked as RiggedMeshRenderer::PostUpdateAll does, from the bounds in the frustum of the camera.
+	constexpr UINT CharacterCount = 1000;
+	constexpr UINT64 FrameCount = 2000;
+	struct Character
+	{
+		Vector3 Position;
+		float Speed = 0.0f;
+		UINT Interval = 1;
+		UINT SkippedFrames = 0;
+		bool PoseValid = false;
+	};
+	std::vector<Character> characters(CharacterCount);
+	for (UINT i = 0; i < CharacterCount; ++i)
+	{
+		characters[i].Position = Vector3(static_cast<float>(i % 50) * 2.0f - 50.0f, 0.0f, 3.0f + static_cast<float>(i / 50) * 6.0f);
+		characters[i].Speed = static_cast<float>(static_cast<int>(i * 7 % 5) - 2) * 0.02f;
+	}
+
+	size_t evaluationCount = 0;
+	size_t overdueCount = 0;
+	std::array<size_t, 4> intervalCounts = {};
+	size_t pausedCount = 0;
+	for (UINT64 frame = 1; frame <= FrameCount; ++frame)
+	{
+		TestCamera camera = { Vector3(0.0f, 1.7f, 0.0f), 0.6f * std::sin(static_cast<float>(frame) * 0.003f), 0.0f };
+		Matrix4x4 projMatrix = camera.GetProjMatrix();
+		ViewVolume viewFrustum = ViewVolume::CreateFrustum(camera.GetViewMatrix(), projMatrix);
+		for (UINT index = 0; index < CharacterCount; ++index)
+		{
+			Character& character = characters[index];
+			character.Position.z += character.Speed;
+			if (character.Position.z < 3.0f || character.Position.z > 130.0f)
+			{
+				character.Speed = -character.Speed;
+			}
+
+			BoundingBox bounds(character.Position + Vector3(0.0f, 0.9f, 0.0f), Vector3(0.4f, 0.9f, 0.3f));
+			character.Interval = !viewFrustum.Intersects(bounds) ? AnimationLod::Paused :
+				AnimationLod::SelectInterval(LodSelector::GetScreenSize(bounds.Center, Vector3(bounds.Extents).Length(), camera.Eye, projMatrix), character.Interval, 0.1f);
+			bool due = !character.PoseValid || AnimationLod::IsDue(frame, index, character.Interval, character.SkippedFrames);
+			character.SkippedFrames = due ? 0 : character.SkippedFrames + 1;
+			character.PoseValid = true;
+
+			evaluationCount += due ? 1 : 0;
+			if (character.Interval == AnimationLod::Paused)
+			{
+				++pausedCount;
+				continue;
+			}
+			++intervalCounts[std::countr_zero(character.Interval)];
+			overdueCount += character.SkippedFrames >= character.Interval ? 1 : 0;
+		}
+	}
+
+	// Every interval and the pause are used, no visible pose is kept past its interval, and most of the evaluations are saved
+	CHECK(std::all_of(intervalCounts.begin(), intervalCounts.end(), [](size_t count) { return count > 0; }));
+	CHECK(pausedCount > 0);
+	CHECK_EQUAL(overdueCount, 0u);
+	CHECK(evaluationCount * 5 < static_cast<size_t>(CharacterCount) * FrameCount);
+}
\ No newline at end of file
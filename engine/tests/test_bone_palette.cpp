@@ -0,0 +1,119 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "bone_palette.h"
+#include "transform_test_util.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+static Matrix4x4 RandomBoneMatrix(std::mt19937& random)
+{
+	std::uniform_real_distribution<float> position(-2.0f, 2.0f);
+	std::uniform_real_distribution<float> angle(-PI, PI);
+	return Matrix4x4::CreateFromQuaternion(Quaternion::CreateFromYawPitchRoll(angle(random), angle(random), angle(random))) *
+		Matrix4x4::CreateTranslation(position(random), position(random), position(random));
+}
+
+// Submeshes of a rig, each using a random subset of its bones
+static std::vector<Submesh> CreateRiggedSubmeshes(std::mt19937& random, std::vector<std::vector<int>>& boneMaps, size_t boneCount)
+{
+	std::vector<Submesh> submeshes(3);
+	boneMaps.assign(submeshes.size(), {});
+	std::uniform_int_distribution<int> bone(0, static_cast<int>(boneCount) - 1);
+	for (size_t index = 0; index < submeshes.size(); ++index)
+	{
+		for (size_t i = 0; i < 10 + index * 20; ++i)
+		{
+			submeshes[index].BoneOffsets.push_back(RandomBoneMatrix(random));
+			boneMaps[index].push_back(bone(random));
+		}
+	}
+	return submeshes;
+}
+
+// The scalar composition the renderer did before the palette
+static Matrix4x4 ComposeReference(const Matrix4x4& boneOffset, const Matrix4x4& boneTransform)
+{
+	return (boneOffset * boneTransform).Transpose();
+}
+
+TEST_CASE(BonePalette, ComposeMatchesTheScalarProduct)
+{
+	std::mt19937 random(18);
+	std::vector<Matrix4x4> offsets(60);
+	std::vector<Matrix4x4> transforms(80);
+	std::vector<int> boneMap(offsets.size());
+	std::uniform_int_distribution<int> bone(0, static_cast<int>(transforms.size()) - 1);
+	for (size_t i = 0; i < offsets.size(); ++i)
+	{
+		offsets[i] = RandomBoneMatrix(random);
+		boneMap[i] = bone(random);
+	}
+	for (Matrix4x4& transform : transforms)
+	{
+		transform = RandomBoneMatrix(random);
+	}
+
+	std::vector<Matrix4x4> output(offsets.size());
+	std::vector<Matrix4x4> secondOutput(offsets.size());
+	BonePalette::Compose(offsets, boneMap, transforms, output.data(), secondOutput.data());
+
+	float difference = 0.0f;
+	for (size_t i = 0; i < offsets.size(); ++i)
+	{
+		difference = std::max(difference, MaxDifference(output[i], ComposeReference(offsets[i], transforms[boneMap[i]])));
+	}
+	CHECK(difference < 1e-5f);
+	CHECK(memcmp(output.data(), secondOutput.data(), output.size() * sizeof(Matrix4x4)) == 0);
+}
+
+TEST_CASE(BonePalette, BuildsKeepThePreviousPalette)
+{
+	std::mt19937 random(18);
+	std::vector<std::vector<int>> boneMaps;
+	std::vector<Submesh> submeshes = CreateRiggedSubmeshes(random, boneMaps, 40);
+	BonePalette palette;
+	palette.Reset(submeshes);
+	for (size_t index = 0; index < submeshes.size(); ++index)
+	{
+		CHECK_EQUAL(palette.GetBoneCount(index), static_cast<UINT>(submeshes[index].BoneOffsets.size()));
+		for (const Matrix4x4& matrix : palette.GetPrevPalette(index))
+		{
+			CHECK(matrix == Matrix4x4::Identity);
+		}
+	}
+
+	// Two frames of animation, the second one must see the first one as its previous palette
+	std::vector<std::vector<Matrix4x4>> previous(submeshes.size());
+	for (int frame = 0; frame < 2; ++frame)
+	{
+		std::vector<Matrix4x4> transforms(40);
+		for (Matrix4x4& transform : transforms)
+		{
+			transform = RandomBoneMatrix(random);
+		}
+
+		palette.Swap();
+		for (size_t index = 0; index < submeshes.size(); ++index)
+		{
+			std::vector<Matrix4x4> destination(palette.GetBoneCount(index));
+			palette.Build(index, submeshes[index], boneMaps[index], transforms, destination.data());
+
+			std::span<const Matrix4x4> current = palette.GetPalette(index);
+			CHECK(memcmp(current.data(), destination.data(), current.size_bytes()) == 0);
+			if (frame > 0)
+			{
+				std::span<const Matrix4x4> prev = palette.GetPrevPalette(index);
+				CHECK(memcmp(prev.data(), previous[index].data(), prev.size_bytes()) == 0);
+			}
+
+			float difference = 0.0f;
+			for (size_t i = 0; i < destination.size(); ++i)
+			{
+				difference = std::max(difference, MaxDifference(destination[i], ComposeReference(submeshes[index].BoneOffsets[i], transforms[boneMaps[index][i]])));
+			}
+			CHECK(difference < 1e-5f);
+			previous[index] = destination;
+		}
+	}
+}
\ No newline at end of file
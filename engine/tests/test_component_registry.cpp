@@ -0,0 +1,150 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "component.h"
+
+using namespace udsdx;
+
+namespace
+{
+	// Opts in to both batch phases, like RiggedMeshRenderer
+	class BatchedComponent : public Component
+	{
+	public:
+		static void UpdateAll(std::span<BatchedComponent*> components, const Time& time, Scene& scene)
+		{
+			// Changing the list of the scene during the batch does not change the span
+			if (s_sourceList != nullptr)
+			{
+				s_sourceList->clear();
+			}
+			s_updated.assign(components.begin(), components.end());
+		}
+
+		static void PostUpdateAll(std::span<BatchedComponent*> components, const Time& time, Scene& scene)
+		{
+			s_postUpdated.assign(components.begin(), components.end());
+		}
+
+		void Update(const Time& time, Scene& scene) override {}
+		void PostUpdate(const Time& time, Scene& scene) override {}
+
+		static inline std::vector<Component*>* s_sourceList = nullptr;
+		static inline std::vector<BatchedComponent*> s_updated;
+		static inline std::vector<BatchedComponent*> s_postUpdated;
+	};
+
+	// Inherits the overrides of its base, but not its batch functions
+	class DerivedComponent : public BatchedComponent
+	{
+	};
+
+	// Only overrides some of the hooks, and is dispatched one by one
+	class HookComponent : public Component
+	{
+	public:
+		void Begin() override {}
+		void PostUpdate(const Time& time, Scene& scene) override {}
+	};
+
+	class PlainComponent : public Component
+	{
+	};
+
+	// Registered after the queries of the other types have been cached
+	class LateComponent : public DerivedComponent
+	{
+	};
+
+	// The scene needs the device; the batches of the types above never touch it
+	Scene& GetPlaceholderScene()
+	{
+		alignas(std::max_align_t) static std::byte storage[1];
+		return *reinterpret_cast<Scene*>(storage);
+	}
+}
+
+TEST_CASE(ComponentRegistry, SystemsFollowTheDeclaredHooks)
+{
+	ComponentRegistry* registry = INSTANCE(ComponentRegistry);
+	const ComponentRegistry::Systems& batched = registry->GetSystems(ComponentRegistry::GetTypeID<BatchedComponent>());
+	CHECK(batched.Update != nullptr && batched.PostUpdate != nullptr);
+	CHECK(!batched.OverridesBegin);
+	CHECK(batched.OverridesUpdate && batched.OverridesPostUpdate);
+
+	// The span of the base type does not match, so the derived type falls back to the per-object hooks it inherits
+	const ComponentRegistry::Systems& derived = registry->GetSystems(ComponentRegistry::GetTypeID<DerivedComponent>());
+	CHECK(!derived.HasAny());
+	CHECK(!derived.OverridesBegin);
+	CHECK(derived.OverridesUpdate && derived.OverridesPostUpdate);
+
+	const ComponentRegistry::Systems& hook = registry->GetSystems(ComponentRegistry::GetTypeID<HookComponent>());
+	CHECK(!hook.HasAny());
+	CHECK(hook.OverridesBegin && !hook.OverridesUpdate && hook.OverridesPostUpdate);
+
+	const ComponentRegistry::Systems& plain = registry->GetSystems(ComponentRegistry::GetTypeID<PlainComponent>());
+	CHECK(!plain.HasAny());
+	CHECK(!plain.OverridesBegin && !plain.OverridesUpdate && !plain.OverridesPostUpdate);
+}
+
+TEST_CASE(ComponentRegistry, BatchesSeeACopyOfTheList)
+{
+	std::vector<std::unique_ptr<BatchedComponent>> components;
+	std::vector<Component*> list;
+	for (size_t i = 0; i < 5; ++i)
+	{
+		list.emplace_back(components.emplace_back(std::make_unique<BatchedComponent>()).get());
+	}
+	std::vector<BatchedComponent*> expected;
+	for (auto& component : components)
+	{
+		expected.emplace_back(component.get());
+	}
+
+	const ComponentRegistry::Systems& systems = INSTANCE(ComponentRegistry)->GetSystems(ComponentRegistry::GetTypeID<BatchedComponent>());
+	Time time = { 1.0f / 60.0f, 0.0f };
+	BatchedComponent::s_sourceList = &list;
+	systems.Update(list, time, GetPlaceholderScene());
+	BatchedComponent::s_sourceList = nullptr;
+	CHECK(list.empty());
+	CHECK(BatchedComponent::s_updated == expected);
+
+	// A shorter list reuses the scratch buffer without keeping the pointers after its end
+	std::vector<Component*> shortList = { components[3].get(), components[1].get() };
+	systems.PostUpdate(shortList, time, GetPlaceholderScene());
+	CHECK(BatchedComponent::s_postUpdated == std::vector<BatchedComponent*>({ expected[3], expected[1] }));
+}
+
+TEST_CASE(ComponentRegistry, IsAFollowsTheHierarchy)
+{
+	ComponentRegistry* registry = INSTANCE(ComponentRegistry);
+	BatchedComponent batched;
+	DerivedComponent derived;
+	HookComponent hook;
+	ComponentRegistry::AssignTypeID(batched);
+	ComponentRegistry::AssignTypeID(derived);
+	ComponentRegistry::AssignTypeID(hook);
+	ComponentRegistry::TypeID batchedTypeID = ComponentRegistry::GetTypeID<BatchedComponent>();
+	ComponentRegistry::TypeID derivedTypeID = ComponentRegistry::GetTypeID<DerivedComponent>();
+	ComponentRegistry::TypeID hookTypeID = ComponentRegistry::GetTypeID<HookComponent>();
+
+	// Queried twice, the second time from the cache
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		CHECK(registry->IsA(&batched, batchedTypeID));
+		CHECK(!registry->IsA(&batched, derivedTypeID));
+		CHECK(registry->IsA(&derived, batchedTypeID));
+		CHECK(registry->IsA(&derived, derivedTypeID));
+		CHECK(!registry->IsA(&hook, batchedTypeID));
+		CHECK(registry->IsA(&hook, hookTypeID));
+	}
+
+	// A type registered after the rows were sized is resolved as well
+	LateComponent late;
+	ComponentRegistry::AssignTypeID(late);
+	ComponentRegistry::TypeID lateTypeID = ComponentRegistry::GetTypeID<LateComponent>();
+	CHECK_EQUAL(lateTypeID, static_cast<ComponentRegistry::TypeID>(registry->GetTypeCount() - 1));
+	CHECK(!registry->IsA(&derived, lateTypeID));
+	CHECK(registry->IsA(&late, derivedTypeID));
+	CHECK(registry->IsA(&late, batchedTypeID));
+	CHECK(registry->IsA(&late, lateTypeID));
+}
\ No newline at end of file
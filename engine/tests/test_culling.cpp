@@ -0,0 +1,207 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "culling.h"
+
+using namespace udsdx;
+
+// Boxes rotated about the vertical axis and scattered around the origin, every 997th of them unbounded
+struct RandomBoxes
+{
+	std::vector<BoundingBox> LocalBounds;
+	std::vector<Matrix4x4> Worlds;
+	CullingBounds Bounds;
+
+	RandomBoxes(size_t count, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> extent(0.1f, 5.0f);
+		std::uniform_real_distribution<float> angle(-PI, PI);
+		Bounds.Resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			LocalBounds.emplace_back(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(extent(random), extent(random), extent(random)));
+			Worlds.push_back(Matrix4x4(XMMatrixRotationY(angle(random))) * Matrix4x4::CreateTranslation(position(random), position(random) * 0.2f, position(random)));
+			if (IsUnbounded(i))
+			{
+				Bounds.SetUnbounded(i);
+			}
+			else
+			{
+				Bounds.Set(i, LocalBounds[i], Worlds[i]);
+			}
+		}
+	}
+
+	static bool IsUnbounded(size_t index) { return index % 997 == 0; }
+
+	// The world space box enclosing the transformed one, computed without the lanes of the blocks
+	BoundingBox GetWorldBounds(size_t index) const
+	{
+		if (IsUnbounded(index))
+		{
+			return BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1e30f, 1e30f, 1e30f));
+		}
+		BoundingBox worldBounds;
+		LocalBounds[index].Transform(worldBounds, Worlds[index]);
+		return worldBounds;
+	}
+};
+
+struct TestView
+{
+	Matrix4x4 View = Matrix4x4(XMMatrixLookToLH(Vector3(3.0f, 10.0f, -20.0f), Vector3(0.4f, -0.1f, 1.0f), Vector3::Up));
+	Matrix4x4 Proj = Matrix4x4(XMMatrixPerspectiveFovLH(PI / 3.0f, 16.0f / 9.0f, 0.1f, 150.0f));
+
+	// The oriented box spans 120 by 60 around the view axis, and from 40 behind the eye to 90 in front of it
+	ViewVolume GetVolume(ViewVolume::Type type) const
+	{
+		return type == ViewVolume::Type::Frustum ? ViewVolume::CreateFrustum(View, Proj) : ViewVolume::CreateOrientedBox(View, 120.0f, 60.0f, -40.0f, 90.0f);
+	}
+
+	// Brute force reference of the exact volume, in clip space for the frustum and in view space for the oriented box
+	bool Contains(ViewVolume::Type type, const Vector3& point) const
+	{
+		Vector3 viewPoint = Vector3::Transform(point, View);
+		if (type == ViewVolume::Type::OrientedBox)
+		{
+			return std::abs(viewPoint.x) <= 60.0f && std::abs(viewPoint.y) <= 30.0f && viewPoint.z >= -40.0f && viewPoint.z <= 90.0f;
+		}
+		Vector4 clip = Vector4::Transform(Vector4(viewPoint.x, viewPoint.y, viewPoint.z, 1.0f), Proj);
+		return clip.w > 0.0f && std::abs(clip.x) <= clip.w && std::abs(clip.y) <= clip.w && clip.z >= 0.0f && clip.z <= clip.w;
+	}
+};
+
+// Oriented boxes of growing cascades around the eye toward a directional light, built the way the shadow map builds them
+static std::vector<ViewVolume> CreateCascadeVolumes(size_t count)
+{
+	Vector3 lightDirection(0.3f, -1.0f, 0.2f);
+	lightDirection.Normalize();
+	std::vector<ViewVolume> volumes;
+	for (size_t i = 0; i < count; ++i)
+	{
+		float size = 20.0f * static_cast<float>(1 << i);
+		Matrix4x4 lightView(XMMatrixLookToLH(Vector3(3.0f, 10.0f, -20.0f) - lightDirection * size, lightDirection, Vector3::UnitZ));
+		volumes.push_back(ViewVolume::CreateOrientedBox(lightView, size, size, -size * 10.0f, size * 10.0f));
+	}
+	return volumes;
+}
+
+TEST_CASE(Culling, BatchedCullMatchesTheScalarTest)
+{
+	// Enough items for the cull to be split across several jobs, with a partial last word
+	std::mt19937 random(7);
+	RandomBoxes boxes(50000, random);
+	TestView view;
+	for (ViewVolume::Type type : { ViewVolume::Type::Frustum, ViewVolume::Type::OrientedBox })
+	{
+		ViewVolume volume = view.GetVolume(type);
+		VisibilitySet visibility;
+		boxes.Bounds.Cull(volume, visibility);
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < boxes.Worlds.size(); ++i)
+		{
+			mismatches += volume.Intersects(boxes.GetWorldBounds(i)) != visibility.IsVisible(i) ? 1 : 0;
+		}
+		CHECK_EQUAL(mismatches, 0u);
+		CHECK(visibility.GetVisibleCount() > 100);
+		CHECK(visibility.GetVisibleCount() < boxes.Worlds.size() / 2);
+
+		// The lanes after the last item are never visible
+		CHECK_EQUAL(visibility.GetWords().back() >> (boxes.Worlds.size() % 64), 0ull);
+	}
+}
+
+TEST_CASE(Culling, CulledBoxesAreOutsideTheVolume)
+{
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> signedUnit(-1.0f, 1.0f);
+	RandomBoxes boxes(20000, random);
+	TestView view;
+	for (ViewVolume::Type type : { ViewVolume::Type::Frustum, ViewVolume::Type::OrientedBox })
+	{
+		VisibilitySet visibility;
+		boxes.Bounds.Cull(view.GetVolume(type), visibility);
+
+		size_t unboundedCulled = 0;
+		size_t visibleCulled = 0;
+		for (size_t i = 0; i < boxes.Worlds.size(); ++i)
+		{
+			if (visibility.IsVisible(i))
+			{
+				continue;
+			}
+			if (RandomBoxes::IsUnbounded(i))
+			{
+				++unboundedCulled;
+				continue;
+			}
+
+			// The corners and random points of the rotated box, none of which may lie in the volume
+			const XMFLOAT3& extents = boxes.LocalBounds[i].Extents;
+			for (int sample = 0; sample < 64; ++sample)
+			{
+				Vector3 point = sample < 8 ?
+					Vector3((sample & 1) ? 1.0f : -1.0f, (sample & 2) ? 1.0f : -1.0f, (sample & 4) ? 1.0f : -1.0f) :
+					Vector3(signedUnit(random), signedUnit(random), signedUnit(random));
+				point = point * Vector3(extents);
+				if (view.Contains(type, Vector3::Transform(point, boxes.Worlds[i])))
+				{
+					++visibleCulled;
+					break;
+				}
+			}
+		}
+		CHECK_EQUAL(unboundedCulled, 0u);
+		CHECK_EQUAL(visibleCulled, 0u);
+	}
+}
+
+TEST_CASE(Culling, SmallListsAreMaskedToTheirCount)
+{
+	TestView view;
+	ViewVolume volume = view.GetVolume(ViewVolume::Type::OrientedBox);
+	for (size_t count : { 1u, 3u, 4u, 5u, 63u, 64u, 65u })
+	{
+		CullingBounds bounds;
+		bounds.Resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			bounds.SetUnbounded(i);
+		}
+		VisibilitySet visibility;
+		bounds.Cull(volume, visibility);
+		CHECK_EQUAL(visibility.GetVisibleCount(), count);
+		CHECK_EQUAL(visibility.GetWords().size(), (count + 63) / 64);
+	}
+}
+
+TEST_CASE(Culling, MultiVolumeCullMatchesSeparateCulls)
+{
+	// More volumes than a single pass tests, with the camera frustum among the cascades
+	std::mt19937 random(5);
+	RandomBoxes boxes(30000, random);
+	TestView view;
+	std::vector<ViewVolume> volumes = CreateCascadeVolumes(5);
+	volumes.insert(volumes.begin() + 2, view.GetVolume(ViewVolume::Type::Frustum));
+
+	std::vector<VisibilitySet> visibilities(volumes.size());
+	boxes.Bounds.Cull(volumes, visibilities);
+	for (size_t v = 0; v < volumes.size(); ++v)
+	{
+		VisibilitySet separate;
+		boxes.Bounds.Cull(volumes[v], separate);
+		CHECK(std::equal(separate.GetWords().begin(), separate.GetWords().end(), visibilities[v].GetWords().begin(), visibilities[v].GetWords().end()));
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < boxes.Worlds.size(); ++i)
+		{
+			mismatches += volumes[v].Intersects(boxes.GetWorldBounds(i)) != visibilities[v].IsVisible(i) ? 1 : 0;
+		}
+		CHECK_EQUAL(mismatches, 0u);
+	}
+
+	// The cascades grow, so the larger ones keep more of the boxes
+	CHECK(visibilities[0].GetVisibleCount() < visibilities[1].GetVisibleCount());
+	CHECK(visibilities[3].GetVisibleCount() < visibilities[5].GetVisibleCount());
+}
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "draw_list.h"
+#include "material.h"
+#include "recording_command_list.h"
+
+using namespace udsdx;
+
+// Items with random keys built the way the scene builds them, the parameter tells the item apart
+static void FillRandomItems(DrawList& drawList, UINT count, std::mt19937& random)
+{
+	std::uniform_int_distribution<UINT> id(0, 40);
+	std::uniform_real_distribution<float> depth(0.0f, 500.0f);
+	drawList.Clear();
+	for (UINT i = 0; i < count; ++i)
+	{
+		DrawItem item;
+		item.SortKey = DrawList::MakeSortKey(id(random) % 2, id(random), id(random) % 2, id(random), id(random), id(random) % 4) | DrawList::MakeDepthBucket(depth(random));
+		item.Parameter = static_cast<int>(i);
+		drawList.Add(item);
+	}
+}
+
+TEST_CASE(DrawList, SortKeyFieldsAreOrderedByPriority)
+{
+	UINT64 base = DrawList::MakeSortKey(0, 5, 0, 5, 5, 5);
+	CHECK(DrawList::MakeSortKey(1, 0, 0, 0, 0, 0) > DrawList::MakeSortKey(0, 4095, 1, 16383, 16383, 63));
+	CHECK(DrawList::MakeSortKey(0, 6, 0, 0, 0, 0) > DrawList::MakeSortKey(0, 5, 1, 16383, 16383, 63));
+	CHECK(DrawList::MakeSortKey(0, 5, 1, 0, 0, 0) > DrawList::MakeSortKey(0, 5, 0, 16383, 16383, 63));
+	CHECK(DrawList::MakeSortKey(0, 5, 0, 6, 0, 0) > DrawList::MakeSortKey(0, 5, 0, 5, 16383, 63));
+	CHECK(DrawList::MakeSortKey(0, 5, 0, 5, 6, 0) > DrawList::MakeSortKey(0, 5, 0, 5, 5, 63));
+	CHECK(DrawList::MakeSortKey(0, 5, 0, 5, 5, 6) > (base | DrawList::MakeDepthBucket(1e30f)));
+
+	// The IDs wrap around their fields instead of spilling into the next one
+	CHECK_EQUAL(DrawList::MakeSortKey(0, 4096 + 5, 0, 16384 + 5, 16384 + 5, 64 + 5), base);
+	CHECK_EQUAL(base & ((1ull << DrawList::DepthBits) - 1), 0ull);
+}
+
+TEST_CASE(DrawList, DepthBucketsAreMonotonic)
+{
+	UINT64 previous = DrawList::MakeDepthBucket(0.0f);
+	for (float depth = 0.01f; depth < 10000.0f; depth *= 1.01f)
+	{
+		UINT64 bucket = DrawList::MakeDepthBucket(depth);
+		CHECK(bucket >= previous);
+		CHECK(bucket < (1ull << DrawList::DepthBits));
+		previous = bucket;
+	}
+	CHECK_EQUAL(DrawList::MakeDepthBucket(-5.0f), DrawList::MakeDepthBucket(0.0f));
+	CHECK(DrawList::MakeDepthBucket(2.0f) > DrawList::MakeDepthBucket(1.0f));
+}
+
+TEST_CASE(DrawList, RadixSortMatchesStableSort)
+{
+	std::mt19937 random(11);
+	DrawList drawList;
+	for (UINT count : { 0u, 1u, 2u, 100u, 5000u })
+	{
+		FillRandomItems(drawList, count, random);
+		std::vector<DrawItem> expected(drawList.GetItems().begin(), drawList.GetItems().end());
+		std::stable_sort(expected.begin(), expected.end(), [](const DrawItem& lhs, const DrawItem& rhs) { return lhs.SortKey < rhs.SortKey; });
+
+		drawList.Sort();
+		CHECK_EQUAL(drawList.GetSize(), static_cast<size_t>(count));
+		CHECK(std::equal(expected.begin(), expected.end(), drawList.GetItems().begin(), drawList.GetItems().end(),
+			[](const DrawItem& lhs, const DrawItem& rhs) { return lhs.SortKey == rhs.SortKey && lhs.Parameter == rhs.Parameter; }));
+	}
+
+	// Keys sharing most digits, whose passes are skipped, keep their relative order
+	drawList.Clear();
+	for (UINT i = 0; i < 1000; ++i)
+	{
+		DrawItem item;
+		item.SortKey = DrawList::MakeSortKey(1, 7, 0, 3, 2, 1) | ((999 - i) / 10);
+		item.Parameter = static_cast<int>(i);
+		drawList.Add(item);
+	}
+	drawList.Sort();
+	std::span<DrawItem> items = drawList.GetItems();
+	CHECK(std::is_sorted(items.begin(), items.end(), [](const DrawItem& lhs, const DrawItem& rhs) {
+		return lhs.SortKey != rhs.SortKey ? lhs.SortKey < rhs.SortKey : lhs.Parameter < rhs.Parameter;
+	}));
+}
+
+TEST_CASE(DrawList, GroupsAreContiguousRanges)
+{
+	std::mt19937 random(12);
+	DrawList drawList;
+	FillRandomItems(drawList, 2000, random);
+	drawList.Sort();
+
+	std::span<const DrawItem> forward = drawList.GetGroup(RenderGroup::Forward);
+	std::span<const DrawItem> deferred = drawList.GetGroup(RenderGroup::Deferred);
+	CHECK_EQUAL(forward.size() + deferred.size(), drawList.GetSize());
+	CHECK(forward.data() == drawList.GetItems().data());
+	CHECK(std::all_of(forward.begin(), forward.end(), [](const DrawItem& item) { return (item.SortKey >> 63) == 0; }));
+	CHECK(std::all_of(deferred.begin(), deferred.end(), [](const DrawItem& item) { return (item.SortKey >> 63) == 1; }));
+
+	DrawList empty;
+	CHECK(empty.GetGroup(RenderGroup::Deferred).empty());
+}
+
+// Stand-ins for the resources, which are only compared by address
+template <typename T>
+static T* FakePointer(UINT id)
+{
+	return reinterpret_cast<T*>(static_cast<std::uintptr_t>(id + 1) * 64);
+}
+
+TEST_CASE(DrawList, BatchesOnlyMergeCompatibleItems)
+{
+	Material material(FakePointer<Shader>(0), FakePointer<Texture>(0));
+	Material sameMaterial(FakePointer<Shader>(0), FakePointer<Texture>(0));
+	Material otherMaterial(FakePointer<Shader>(0), FakePointer<Texture>(1));
+
+	DrawItem base;
+	base.Mesh = FakePointer<ResourceObject>(0);
+	base.PipelineState = FakePointer<ID3D12PipelineState>(0);
+	base.Material = &material;
+	base.Instancing = true;
+
+	auto batchCounts = [](std::initializer_list<DrawItem> items) {
+		std::vector<DrawBatch> batches;
+		DrawList::BuildBatches(std::span<const DrawItem>(items.begin(), items.end()), batches);
+		std::vector<UINT> counts;
+		UINT next = 0;
+		for (const DrawBatch& batch : batches)
+		{
+			CHECK_EQUAL(batch.First, next);
+			next += batch.Count;
+			counts.emplace_back(batch.Count);
+		}
+		CHECK_EQUAL(next, static_cast<UINT>(items.size()));
+		return counts;
+	};
+
+	DrawItem equalMaterial = base;
+	equalMaterial.Material = &sameMaterial;
+	CHECK(batchCounts({ base, base, equalMaterial }) == std::vector<UINT>({ 3 }));
+
+	auto changed = [&](auto&& change) {
+		DrawItem item = base;
+		change(item);
+		return batchCounts({ base, base, item, item }) == std::vector<UINT>({ 2, 2 });
+	};
+	CHECK(changed([](DrawItem& item) { item.Mesh = FakePointer<ResourceObject>(1); }));
+	CHECK(changed([](DrawItem& item) { item.Parameter = 1; }));
+	CHECK(changed([](DrawItem& item) { item.Lod = 1; }));
+	CHECK(changed([](DrawItem& item) { item.PipelineState = FakePointer<ID3D12PipelineState>(1); }));
+	CHECK(changed([](DrawItem& item) { item.Topology = D3D_PRIMITIVE_TOPOLOGY_LINELIST; }));
+	CHECK(changed([](DrawItem& item) { item.DrawOutline = true; }));
+	CHECK(changed([&](DrawItem& item) { item.Material = &otherMaterial; }));
+
+	// Items of the renderers which do not instance are drawn on their own
+	DrawItem single = base;
+	single.Instancing = false;
+	CHECK(batchCounts({ base, single, single, base, base }) == std::vector<UINT>({ 1, 1, 1, 2 }));
+	CHECK(batchCounts({}).empty());
+}
+
+TEST_CASE(DrawList, BatchedDrawsBindTheStateOfEveryItem)
+{
+	// A sorted scene of a few meshes and materials, drawn the way Scene::RenderSceneObjects draws the batches
+	std::mt19937 random(13);
+	std::vector<Material> materials;
+	for (UINT i = 0; i < 6; ++i)
+	{
+		materials.emplace_back(FakePointer<Shader>(i % 2), FakePointer<Texture>(i));
+	}
+
+	DrawList drawList;
+	for (UINT i = 0; i < 3000; ++i)
+	{
+		UINT mesh = std::uniform_int_distribution<UINT>(0, 7)(random);
+		UINT material = std::uniform_int_distribution<UINT>(0, 5)(random);
+		DrawItem item;
+		item.Mesh = FakePointer<ResourceObject>(mesh);
+		item.Material = &materials[material];
+		item.PipelineState = FakePointer<ID3D12PipelineState>(material % 2);
+		item.Parameter = static_cast<int>(mesh % 2);
+		item.DrawOutline = i % 50 == 0;
+		item.Instancing = i % 10 != 0;
+		item.SortKey = DrawList::MakeSortKey(RenderGroup::Deferred, material % 2, 0, material, mesh, item.Parameter);
+		drawList.Add(item);
+	}
+	drawList.Sort();
+
+	std::vector<DrawBatch> batches;
+	DrawList::BuildBatches(drawList.GetItems(), batches);
+
+	auto bufferView = [](const DrawItem& item) {
+		return D3D12_VERTEX_BUFFER_VIEW{ reinterpret_cast<std::uintptr_t>(item.Mesh), 1024, 32 };
+	};
+	auto textureTable = [](const DrawItem& item) {
+		return D3D12_GPU_DESCRIPTOR_HANDLE{ reinterpret_cast<std::uintptr_t>(item.Material->GetSourceTexture()) };
+	};
+
+	test::RecordingCommandList recorder;
+	StateTrackingCommandList tracked(&recorder);
+	std::span<const DrawItem> items = drawList.GetItems();
+	for (const DrawBatch& batch : batches)
+	{
+		const DrawItem& first = items[batch.First];
+		D3D12_VERTEX_BUFFER_VIEW vertexBuffer = bufferView(first);
+		tracked.SetPipelineState(first.PipelineState);
+		tracked.OMSetStencilRef(static_cast<UINT>(first.DrawOutline) << 7);
+		tracked.IASetVertexBuffers(0, 1, &vertexBuffer);
+		tracked.IASetPrimitiveTopology(first.Topology);
+		tracked.SetGraphicsRootDescriptorTable(RootParam::SrcTexSRV_0, textureTable(first));
+		recorder.DrawIndexedInstanced(36, batch.Count);
+
+		// Every instance of the draw would have bound the same state on its own
+		const test::RecordingCommandList::BoundState& state = recorder.GetState();
+		for (const DrawItem& item : items.subspan(batch.First, batch.Count))
+		{
+			CHECK(state.PipelineState == item.PipelineState);
+			CHECK(state.StencilRef == static_cast<UINT>(item.DrawOutline) << 7);
+			CHECK(state.VertexBuffers[0].BufferLocation == bufferView(item).BufferLocation);
+			CHECK(state.Topology == item.Topology);
+			CHECK(state.DescriptorTables[RootParam::SrcTexSRV_0] == textureTable(item).ptr);
+		}
+	}
+
+	CHECK_EQUAL(recorder.GetInstanceCount(), static_cast<UINT>(items.size()));
+	CHECK_EQUAL(recorder.GetDrawCount(), static_cast<UINT>(batches.size()));
+	CHECK(batches.size() * 4 < items.size());
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "pch.h"
+#include "test_framework.h"
+
+namespace udsdx::test
+{
+	static int s_failureCount = 0;
+	static bool s_quickRun = false;
+
+	std::vector<TestCase>& GetTestCases()
+	{
+		static std::vector<TestCase> testCases;
+		return testCases;
+	}
+
+	std::vector<TestCase>& GetBenchmarks()
+	{
+		static std::vector<TestCase> benchmarks;
+		return benchmarks;
+	}
+
+	void ReportFailure(const char* file, int line, const std::string& message)
+	{
+		++s_failureCount;
+		std::cout << "    " << std::filesystem::path(file).filename().string() << "(" << line << "): check failed: " << message << "\n";
+	}
+
+	int RunTestCases(std::vector<TestCase>& cases, int argc, char** argv)
+	{
+		std::string_view filter;
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string_view argument = argv[i];
+			if (argument == "--quick")
+			{
+				s_quickRun = true;
+			}
+			else
+			{
+				filter = argument;
+			}
+		}
+
+		std::sort(cases.begin(), cases.end(), [](const TestCase& lhs, const TestCase& rhs) { return lhs.Suite < rhs.Suite; });
+
+		int caseCount = 0;
+		int failedCaseCount = 0;
+		std::string_view currentSuite;
+		for (const TestCase& testCase : cases)
+		{
+			if (!filter.empty() && testCase.Suite != filter)
+			{
+				continue;
+			}
+			if (testCase.Suite != currentSuite)
+			{
+				currentSuite = testCase.Suite;
+				std::cout << "[" << currentSuite << "]\n";
+			}
+
+			std::cout << "  " << testCase.Name << "\n";
+			int failureCount = s_failureCount;
+			try
+			{
+				testCase.Function();
+			}
+			catch (const std::exception& e)
+			{
+				ReportFailure(__FILE__, __LINE__, std::string("unexpected exception: ") + e.what());
+			}
+
+			++caseCount;
+			if (s_failureCount != failureCount)
+			{
+				++failedCaseCount;
+			}
+		}
+
+		if (caseCount == 0)
+		{
+			std::cout << "No case matches '" << filter << "'\n";
+			return 1;
+		}
+
+		std::cout << caseCount - failedCaseCount << " of " << caseCount << " cases passed\n";
+		return failedCaseCount == 0 ? 0 : 1;
+	}
+
+	bool IsQuickRun()
+	{
+		return s_quickRun;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "pch.h"
+
+#include <iomanip>
+
+namespace udsdx::test
+{
+	using TestFunction = void (*)();
+
+	struct TestCase
+	{
+		std::string_view Suite;
+		std::string_view Name;
+		TestFunction Function;
+	};
+
+	// Test cases and benchmarks register themselves into separate lists at static initialization
+	std::vector<TestCase>& GetTestCases();
+	std::vector<TestCase>& GetBenchmarks();
+
+	struct Registrar
+	{
+		Registrar(std::vector<TestCase>& list, std::string_view suite, std::string_view name, TestFunction function)
+		{
+			list.push_back({ suite, name, function });
+		}
+	};
+
+	// Records a failed check of the running test case, which keeps running
+	void ReportFailure(const char* file, int line, const std::string& message);
+
+	// Runs the registered cases whose suite matches the first argument, or all of them without arguments.
+	// Returns the exit code of the executable.
+	int RunTestCases(std::vector<TestCase>& cases, int argc, char** argv);
+
+	// Benchmarks run a single repetition when the executable is started with --quick, which the smoke test does
+	bool IsQuickRun();
+
+	// Runs function a number of times after a warm-up, and prints the median and the fastest time of a run
+	template <typename Function_T>
+	void Measure(std::string_view label, UINT repetitions, Function_T&& function)
+	{
+		if (IsQuickRun())
+		{
+			repetitions = 1;
+		}
+
+		function();
+
+		std::vector<double> timings(repetitions);
+		for (double& timing : timings)
+		{
+			auto begin = std::chrono::steady_clock::now();
+			function();
+			auto end = std::chrono::steady_clock::now();
+			timing = std::chrono::duration<double, std::micro>(end - begin).count();
+		}
+
+		std::sort(timings.begin(), timings.end());
+		std::cout << "  " << std::left << std::setw(72) << label
+			<< " median " << std::right << std::setw(10) << std::fixed << std::setprecision(1) << timings[timings.size() / 2] << " us"
+			<< "  min " << std::setw(10) << timings.front() << " us\n";
+	}
+
+	// Keeps the optimizer from dropping a computation whose result is otherwise unused
+	template <typename T>
+	void DoNotOptimize(const T& value)
+	{
+		static std::atomic<const void*> sink;
+		sink.store(&value, std::memory_order_relaxed);
+	}
+}
+
+#define UDSDX_TEST_CONCAT_IMPL(a, b) a##b
+#define UDSDX_TEST_CONCAT(a, b) UDSDX_TEST_CONCAT_IMPL(a, b)
+
+#define UDSDX_TEST_REGISTER(list, suite, name) \
+	static void UDSDX_TEST_CONCAT(suite##_, name)(); \
+	static udsdx::test::Registrar UDSDX_TEST_CONCAT(suite##_##name, _registrar)(list, #suite, #name, &UDSDX_TEST_CONCAT(suite##_, name)); \
+	static void UDSDX_TEST_CONCAT(suite##_, name)()
+
+#define TEST_CASE(suite, name) UDSDX_TEST_REGISTER(udsdx::test::GetTestCases(), suite, name)
+#define BENCHMARK(suite, name) UDSDX_TEST_REGISTER(udsdx::test::GetBenchmarks(), suite, name)
+
+#define CHECK(expression) \
+	do { if (!(expression)) { udsdx::test::ReportFailure(__FILE__, __LINE__, #expression); } } while (false)
+
+#define CHECK_EQUAL(actual, expected) \
+	do { \
+		auto&& udsdxActual = (actual); \
+		auto&& udsdxExpected = (expected); \
+		if (!(udsdxActual == udsdxExpected)) \
+		{ \
+			std::ostringstream udsdxStream; \
+			udsdxStream << #actual " == " #expected " (" << udsdxActual << " != " << udsdxExpected << ")"; \
+			udsdx::test::ReportFailure(__FILE__, __LINE__, udsdxStream.str()); \
+		} \
+	} while (false)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+	do { \
+		double udsdxActual = static_cast<double>(actual); \
+		double udsdxExpected = static_cast<double>(expected); \
+		if (!(std::abs(udsdxActual - udsdxExpected) <= static_cast<double>(tolerance))) \
+		{ \
+			std::ostringstream udsdxStream; \
+			udsdxStream << #actual " ~ " #expected " (" << udsdxActual << " vs " << udsdxExpected << ", tolerance " << (tolerance) << ")"; \
+			udsdx::test::ReportFailure(__FILE__, __LINE__, udsdxStream.str()); \
+		} \
+	} while (false)
@@ -0,0 +1,205 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "job_system.h"
+
+#include <mutex>
+
+using namespace udsdx;
+
+TEST_CASE(JobSystem, DispatchRunsEveryJobOnce)
+{
+	JobSystem jobSystem(4);
+	constexpr UINT jobCount = 1000;
+	std::vector<std::atomic<UINT>> runCounts(jobCount);
+
+	JobCounter counter;
+	for (UINT i = 0; i < jobCount; ++i)
+	{
+		jobSystem.Dispatch(counter, [&runCounts, i]() { runCounts[i].fetch_add(1); });
+	}
+	jobSystem.Wait(counter);
+
+	CHECK_EQUAL(counter.Pending.load(), 0u);
+	CHECK(std::all_of(runCounts.begin(), runCounts.end(), [](const std::atomic<UINT>& count) { return count.load() == 1; }));
+}
+
+TEST_CASE(JobSystem, DispatchPastTheRingCapacityRunsInline)
+{
+	// More jobs in flight than a worker has slots, the ones which find their slot taken run on the caller
+	JobSystem jobSystem(2);
+	constexpr UINT jobCount = 10000;
+	std::atomic<UINT> sum = 0;
+
+	JobCounter counter;
+	for (UINT i = 0; i < jobCount; ++i)
+	{
+		jobSystem.Dispatch(counter, [&sum, i]() { sum.fetch_add(i); });
+	}
+	jobSystem.Wait(counter);
+
+	CHECK_EQUAL(sum.load(), jobCount * (jobCount - 1) / 2);
+}
+
+TEST_CASE(JobSystem, NestedJobsJoin)
+{
+	JobSystem jobSystem(4);
+	constexpr UINT parentCount = 16;
+	constexpr UINT childCount = 64;
+	std::atomic<UINT> childRuns = 0;
+	std::vector<UINT> parentResults(parentCount, 0);
+
+	JobCounter counter;
+	for (UINT i = 0; i < parentCount; ++i)
+	{
+		jobSystem.Dispatch(counter, [&jobSystem, &childRuns, &parentResults, i]() {
+			std::atomic<UINT> parentSum = 0;
+			JobCounter childCounter;
+			for (UINT j = 0; j < childCount; ++j)
+			{
+				jobSystem.Dispatch(childCounter, [&childRuns, &parentSum, j]() {
+					childRuns.fetch_add(1);
+					parentSum.fetch_add(j);
+				});
+			}
+			jobSystem.Wait(childCounter);
+			parentResults[i] = parentSum.load();
+		});
+	}
+	jobSystem.Wait(counter);
+
+	CHECK_EQUAL(childRuns.load(), parentCount * childCount);
+	CHECK(std::all_of(parentResults.begin(), parentResults.end(), [](UINT sum) { return sum == childCount * (childCount - 1) / 2; }));
+}
+
+TEST_CASE(JobSystem, ParallelForCoversTheRangeOnce)
+{
+	JobSystem jobSystem(4);
+	for (UINT count : { 0u, 1u, 7u, 64u, 1000u, 4097u })
+	{
+		for (UINT grainSize : { 0u, 1u, 3u, 256u })
+		{
+			std::vector<std::atomic<UINT>> visits(count);
+			std::atomic<bool> emptyRange = false;
+			jobSystem.ParallelFor(count, [&](UINT begin, UINT end) {
+				if (begin >= end)
+				{
+					emptyRange.store(true);
+				}
+				for (UINT i = begin; i < end; ++i)
+				{
+					visits[i].fetch_add(1);
+				}
+			}, grainSize);
+
+			CHECK(!emptyRange.load());
+			CHECK(std::all_of(visits.begin(), visits.end(), [](const std::atomic<UINT>& visit) { return visit.load() == 1; }));
+		}
+	}
+}
+
+TEST_CASE(JobSystem, JobsRunOnSeveralThreads)
+{
+	// The jobs block for a while, so the calling thread cannot drain the queue before the workers wake up
+	JobSystem jobSystem(4);
+	std::mutex mutex;
+	std::set<std::thread::id> threads;
+
+	JobCounter counter;
+	for (UINT i = 0; i < 16; ++i)
+	{
+		jobSystem.Dispatch(counter, [&]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			std::lock_guard lock(mutex);
+			threads.insert(std::this_thread::get_id());
+		});
+	}
+	jobSystem.Wait(counter);
+
+	CHECK(threads.size() > 1);
+}
+
+TEST_CASE(JobSystem, UnregisteredThreadsRunInline)
+{
+	JobSystem jobSystem(4);
+	std::thread::id callerThread;
+	std::thread::id jobThread;
+	bool ranBeforeWait = false;
+
+	std::thread thread([&]() {
+		callerThread = std::this_thread::get_id();
+		JobCounter counter;
+		jobSystem.Dispatch(counter, [&]() { jobThread = std::this_thread::get_id(); });
+		ranBeforeWait = counter.Pending.load() == 0;
+
+		std::vector<UINT> values(100, 0);
+		jobSystem.ParallelFor(static_cast<UINT>(values.size()), [&](UINT begin, UINT end) {
+			for (UINT i = begin; i < end; ++i)
+			{
+				values[i] = i;
+			}
+		}, 1);
+		CHECK(std::is_sorted(values.begin(), values.end()) && values.back() == 99);
+	});
+	thread.join();
+
+	CHECK(ranBeforeWait);
+	CHECK(jobThread == callerThread);
+}
+
+TEST_CASE(JobSystem, SingleWorkerRunsEverythingOnTheCaller)
+{
+	JobSystem jobSystem(1);
+	CHECK_EQUAL(jobSystem.GetWorkerCount(), 1u);
+
+	std::atomic<UINT> sum = 0;
+	jobSystem.ParallelFor(1000, [&](UINT begin, UINT end) {
+		for (UINT i = begin; i < end; ++i)
+		{
+			sum.fetch_add(i);
+		}
+	});
+	CHECK_EQUAL(sum.load(), 1000u * 999u / 2u);
+}
+
+TEST_CASE(JobSystem, PipelinedFramesPublishOnTheWorkers)
+{
+	// The frame is published on the main thread and recorded on a render thread, as Core::Render does.
+	// The ranges block for a while, so the publishing thread cannot take all of them before the workers wake up.
+	JobSystem jobSystem(4);
+	std::binary_semaphore renderRequested{ 0 };
+	std::binary_semaphore renderIdle{ 1 };
+	std::mutex mutex;
+	std::set<std::thread::id> publishThreads;
+	std::set<std::thread::id> recordThreads;
+	bool renderThreadRegistered = true;
+	auto run = [&](std::set<std::thread::id>& threads) {
+		jobSystem.ParallelFor(16, [&](UINT begin, UINT end) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			std::lock_guard lock(mutex);
+			threads.insert(std::this_thread::get_id());
+		}, 1);
+	};
+
+	constexpr UINT FrameCount = 4;
+	std::thread renderThread([&]() {
+		renderThreadRegistered = JobSystem::IsWorkerThread();
+		for (UINT frame = 0; frame < FrameCount; ++frame)
+		{
+			renderRequested.acquire();
+			run(recordThreads);
+			renderIdle.release();
+		}
+	});
+	for (UINT frame = 0; frame < FrameCount; ++frame)
+	{
+		renderIdle.acquire();
+		CHECK(JobSystem::IsWorkerThread());
+		run(publishThreads);
+		renderRequested.release();
+	}
+	renderThread.join();
+
+	CHECK(publishThreads.size() > 1);
+	CHECK(!renderThreadRegistered);
+	CHECK_EQUAL(recordThreads.size(), 1u);
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "linear_allocator.h"
+
+using namespace udsdx;
+
+TEST_CASE(LinearAllocator, AllocationsAreAlignedAndDisjoint)
+{
+	std::mt19937 random(17);
+	std::uniform_int_distribution<UINT64> size(1, 1000);
+	LinearAllocator allocator(4096, 256);
+
+	// The byte ranges of every page, sorted by offset since the allocator only moves forward
+	std::map<UINT, std::vector<std::pair<UINT64, UINT64>>> ranges;
+	for (int i = 0; i < 500; ++i)
+	{
+		UINT64 allocationSize = size(random);
+		LinearAllocator::Allocation allocation = allocator.Allocate(allocationSize);
+		CHECK_EQUAL(allocation.Offset % 256, 0ull);
+		CHECK(allocation.Offset + allocationSize <= allocator.GetPageSize());
+		ranges[allocation.Page].emplace_back(allocation.Offset, allocation.Offset + allocationSize);
+	}
+
+	size_t overlaps = 0;
+	for (const auto& [page, pageRanges] : ranges)
+	{
+		for (size_t i = 1; i < pageRanges.size(); ++i)
+		{
+			overlaps += pageRanges[i].first < pageRanges[i - 1].second ? 1 : 0;
+		}
+	}
+	CHECK_EQUAL(overlaps, 0u);
+	CHECK_EQUAL(static_cast<size_t>(allocator.GetPageCount()), ranges.size());
+	CHECK_EQUAL(ranges.rbegin()->first + 1, allocator.GetPageCount());
+}
+
+TEST_CASE(LinearAllocator, FullPagesStartTheNextOne)
+{
+	LinearAllocator allocator(1024, 256);
+	CHECK_EQUAL(allocator.Allocate(1000).Offset, 0ull);
+	LinearAllocator::Allocation next = allocator.Allocate(100);
+	CHECK_EQUAL(next.Page, 1u);
+	CHECK_EQUAL(next.Offset, 0ull);
+
+	// A page is filled exactly, and the padding before an allocation counts toward the used size
+	CHECK_EQUAL(allocator.Allocate(768).Offset, 256ull);
+	CHECK_EQUAL(allocator.GetUsedSize(), 2048ull);
+	CHECK_EQUAL(allocator.Allocate(1).Page, 2u);
+	CHECK_EQUAL(allocator.GetPageCount(), 3u);
+
+	bool threw = false;
+	try
+	{
+		allocator.Allocate(1025);
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+TEST_CASE(LinearAllocator, ReclaimWaitsForTheRetiredFence)
+{
+	LinearAllocator allocator(1024, 256);
+	allocator.Allocate(600);
+	allocator.Allocate(600);
+	allocator.Allocate(600);
+	allocator.Retire(5);
+
+	CHECK(!allocator.Reclaim(4));
+	CHECK_EQUAL(allocator.Allocate(1).Page, 2u);
+	CHECK(allocator.Reclaim(5));
+	CHECK_EQUAL(allocator.GetUsedSize(), 0ull);
+
+	// The pages are reused from the start, and the page count keeps the most used between two reclamations
+	LinearAllocator::Allocation first = allocator.Allocate(1);
+	CHECK_EQUAL(first.Page, 0u);
+	CHECK_EQUAL(first.Offset, 0ull);
+	CHECK_EQUAL(allocator.GetPageCount(), 3u);
+	allocator.Retire(6);
+	CHECK(allocator.Reclaim(7));
+}
\ No newline at end of file
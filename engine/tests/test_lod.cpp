@@ -0,0 +1,168 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "lod_selector.h"
+#include "lod_test_meshes.h"
+#include "mesh_simplifier.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+static Vector3 GetFaceNormal(const TestMesh& mesh, std::span<const unsigned int> triangle)
+{
+	Vector3 a = mesh.Positions[triangle[0]];
+	Vector3 b = mesh.Positions[triangle[1]];
+	Vector3 c = mesh.Positions[triangle[2]];
+	return (b - a).Cross(c - a);
+}
+
+TEST_CASE(Lod, ScreenSizeOfPerspectiveAndOrthographicViews)
+{
+	Matrix4x4 perspective(XMMatrixPerspectiveFovLH(PI / 2.0f, 1.0f, 0.1f, 100.0f));
+	CHECK_NEAR(LodSelector::GetScreenSize(Vector3(0.0f, 0.0f, 10.0f), 2.0f, Vector3::Zero, perspective), 0.2f, 1e-5f);
+	CHECK_NEAR(LodSelector::GetScreenSize(Vector3(0.0f, 0.0f, 20.0f), 2.0f, Vector3::Zero, perspective), 0.1f, 1e-5f);
+	CHECK_NEAR(LodSelector::GetScreenSize(Vector3(0.0f, 0.0f, 1.0f), 2.0f, Vector3::Zero, perspective), 1.0f, 1e-5f);
+
+	// The distance does not matter to an orthographic view 20 units high
+	Matrix4x4 orthographic(XMMatrixOrthographicLH(20.0f, 20.0f, 0.1f, 100.0f));
+	CHECK_NEAR(LodSelector::GetScreenSize(Vector3(0.0f, 0.0f, 10.0f), 2.0f, Vector3::Zero, orthographic), 0.2f, 1e-5f);
+	CHECK_NEAR(LodSelector::GetScreenSize(Vector3(0.0f, 0.0f, 90.0f), 2.0f, Vector3::Zero, orthographic), 0.2f, 1e-5f);
+}
+
+TEST_CASE(Lod, SelectionSweepIsMonotonic)
+{
+	const std::array<float, 3> thresholds = { 0.4f, 0.2f, 0.05f };
+	UINT lod = 0;
+	std::array<bool, 4> reached = {};
+	for (float size = 1.0f; size > 0.001f; size *= 0.98f)
+	{
+		UINT next = LodSelector::Select(thresholds, size, lod, 0.1f);
+		CHECK(next >= lod);
+		CHECK(next <= thresholds.size());
+		lod = next;
+		reached[lod] = true;
+	}
+	CHECK(std::all_of(reached.begin(), reached.end(), [](bool value) { return value; }));
+
+	// Growing back, the levels only get finer
+	for (float size = 0.001f; size < 1.0f; size *= 1.02f)
+	{
+		UINT next = LodSelector::Select(thresholds, size, lod, 0.1f);
+		CHECK(next <= lod);
+		lod = next;
+	}
+	CHECK_EQUAL(lod, 0u);
+}
+
+TEST_CASE(Lod, SizeJitteringAroundAThresholdKeepsTheLevel)
+{
+	const std::array<float, 2> thresholds = { 0.4f, 0.2f };
+	std::mt19937 random(19);
+	std::uniform_real_distribution<float> jitter(0.91f, 1.09f);
+	for (UINT start : { 0u, 1u })
+	{
+		UINT lod = start;
+		for (int frame = 0; frame < 1000; ++frame)
+		{
+			lod = LodSelector::Select(thresholds, 0.4f * jitter(random), lod, 0.1f);
+		}
+		CHECK_EQUAL(lod, start);
+	}
+
+	// Past the hysteresis band, the level follows the size
+	CHECK_EQUAL(LodSelector::Select(thresholds, 0.35f, 0, 0.1f), 1u);
+	CHECK_EQUAL(LodSelector::Select(thresholds, 0.45f, 1, 0.1f), 0u);
+}
+
+TEST_CASE(Lod, SimplifiedSphereHalvesTheTrianglesPerLevel)
+{
+	TestMesh sphere = CreateSphereMesh(64, 128);
+	CHECK_EQUAL(sphere.Indices.size(), 16128u * 3);
+	Vector3 firstNormal = GetFaceNormal(sphere, std::span<const unsigned int>(sphere.Indices.data(), 3));
+	bool outward = firstNormal.Dot(Vector3(sphere.Positions[sphere.Indices[1]])) > 0.0f;
+
+	// Each level is simplified from the previous one, as the exporter does
+	std::vector<unsigned int> indices = sphere.Indices;
+	float totalError = 0.0f;
+	for (size_t level = 1; level <= 3; ++level)
+	{
+		size_t target = sphere.Indices.size() >> level;
+		float error = 0.0f;
+		std::vector<unsigned int> simplified = SimplifyMesh(sphere.Positions, indices, target, error);
+		CHECK(simplified.size() <= target);
+		CHECK(simplified.size() > target * 9 / 10);
+		CHECK_EQUAL(simplified.size() % 3, 0u);
+		totalError += error;
+
+		size_t outOfRange = 0;
+		size_t degenerate = 0;
+		size_t flipped = 0;
+		for (size_t i = 0; i < simplified.size(); i += 3)
+		{
+			std::span<const unsigned int> triangle(simplified.data() + i, 3);
+			outOfRange += std::any_of(triangle.begin(), triangle.end(), [&](unsigned int index) { return index >= sphere.Positions.size(); }) ? 1 : 0;
+			degenerate += triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2] ? 1 : 0;
+
+			Vector3 center = (Vector3(sphere.Positions[triangle[0]]) + Vector3(sphere.Positions[triangle[1]]) + Vector3(sphere.Positions[triangle[2]])) / 3.0f;
+			flipped += (GetFaceNormal(sphere, triangle).Dot(center) > 0.0f) != outward ? 1 : 0;
+		}
+		CHECK_EQUAL(outOfRange, 0u);
+		CHECK_EQUAL(degenerate, 0u);
+		CHECK_EQUAL(flipped, 0u);
+		indices = simplified;
+	}
+
+	// The coarsest level keeps the shape to a few percent of the diameter
+	CHECK(totalError > 0.0f);
+	CHECK(totalError < 0.1f);
+}
+
+TEST_CASE(Lod, BordersAndSeamsStayInPlace)
+{
+	// A flat grid whose last column duplicates the positions of the one before, as an attribute seam does
+	constexpr unsigned int Size = 16;
+	TestMesh grid;
+	for (unsigned int z = 0; z <= Size; ++z)
+	{
+		for (unsigned int x = 0; x <= Size + 1; ++x)
+		{
+			grid.Positions.emplace_back(static_cast<float>(std::min(x, Size - 1 + x / (Size + 1))), 0.0f, static_cast<float>(z));
+		}
+	}
+	auto vertex = [](unsigned int x, unsigned int z) { return z * (Size + 2) + x; };
+	for (unsigned int z = 0; z < Size; ++z)
+	{
+		for (unsigned int x = 0; x < Size; ++x)
+		{
+			// The last column starts from the duplicated vertices
+			unsigned int left = x + 1 == Size ? Size : x;
+			unsigned int right = x + 1 == Size ? Size + 1 : x + 1;
+			grid.Indices.insert(grid.Indices.end(), { vertex(left, z), vertex(left, z + 1), vertex(right, z), vertex(right, z), vertex(left, z + 1), vertex(right, z + 1) });
+		}
+	}
+
+	float error = 0.0f;
+	std::vector<unsigned int> simplified = SimplifyMesh(grid.Positions, grid.Indices, grid.Indices.size() / 4, error);
+	CHECK(simplified.size() < grid.Indices.size() / 2);
+	CHECK_NEAR(error, 0.0f, 1e-4f);
+
+	// The grid still covers its square once, with every border and seam vertex in use
+	float area = 0.0f;
+	for (size_t i = 0; i < simplified.size(); i += 3)
+	{
+		area += GetFaceNormal(grid, std::span<const unsigned int>(simplified.data() + i, 3)).y * 0.5f;
+	}
+	CHECK_NEAR(std::abs(area), static_cast<float>(Size * Size), 1e-2f);
+
+	std::set<unsigned int> used(simplified.begin(), simplified.end());
+	size_t missing = 0;
+	for (unsigned int i = 0; i <= Size; ++i)
+	{
+		missing += used.contains(vertex(0, i)) ? 0 : 1;
+		missing += used.contains(vertex(Size - 1, i)) ? 0 : 1;
+		missing += used.contains(vertex(Size, i)) ? 0 : 1;
+		missing += used.contains(vertex(Size + 1, i)) ? 0 : 1;
+		missing += i < Size && !used.contains(vertex(i, 0)) ? 1 : 0;
+		missing += i < Size && !used.contains(vertex(i, Size)) ? 1 : 0;
+	}
+	CHECK_EQUAL(missing, 0u);
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "job_system.h"
+
+int main(int argc, char** argv)
+{
+	// A fixed worker count, so the parallel paths run on several threads even on single-core machines
+	udsdx::Singleton<udsdx::JobSystem>::CreateInstance(4u);
+	return udsdx::test::RunTestCases(udsdx::test::GetTestCases(), argc, argv);
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "city_test_scene.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+// Culls the boxes against the view of the camera, then against the occluders queued by the callback
+template <typename AddOccluders_T>
+static VisibilitySet CullAndOcclude(const std::vector<TestBox>& boxes, const TestCamera& camera, AddOccluders_T addOccluders)
+{
+	BoundingBox unitBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+	CullingBounds bounds;
+	bounds.Resize(boxes.size());
+	for (size_t i = 0; i < boxes.size(); ++i)
+	{
+		bounds.Set(i, unitBox, boxes[i].GetWorld());
+	}
+
+	Matrix4x4 view = camera.GetViewMatrix();
+	Matrix4x4 proj = camera.GetProjMatrix();
+	VisibilitySet visibility;
+	bounds.Cull(ViewVolume::CreateFrustum(view, proj), visibility);
+
+	OcclusionBuffer buffer;
+	buffer.Reset(view * proj);
+	addOccluders(buffer);
+	buffer.Rasterize();
+	bounds.Occlude(buffer, visibility);
+	return visibility;
+}
+
+TEST_CASE(OcclusionBuffer, WallHidesOnlyTheBoxesBehindIt)
+{
+	TestCubeMesh cube;
+	TestCamera camera = { Vector3(0.0f, 0.0f, -10.0f), 0.0f, 0.0f };
+	TestBox wall = { Vector3(0.0f, 0.0f, 0.0f), Vector3(5.0f, 5.0f, 0.5f) };
+	std::vector<TestBox> boxes = {
+		{ Vector3(0.0f, 0.0f, 10.0f), Vector3(1.0f, 1.0f, 1.0f) },	// Behind the wall
+		{ Vector3(0.0f, 0.0f, -5.0f), Vector3(1.0f, 1.0f, 1.0f) },	// In front of the wall
+		{ Vector3(12.0f, 0.0f, 10.0f), Vector3(1.0f, 1.0f, 1.0f) },	// Behind, but beside the wall
+		{ Vector3(10.0f, 0.0f, 10.0f), Vector3(1.0f, 1.0f, 1.0f) },	// Behind, across the edge of the wall
+		{ Vector3(0.0f, 0.0f, 0.0f), Vector3(0.4f, 0.4f, 0.4f) },	// Inside the wall
+	};
+
+	VisibilitySet empty = CullAndOcclude(boxes, camera, [](OcclusionBuffer&) {});
+	CHECK_EQUAL(empty.GetVisibleCount(), boxes.size());
+
+	VisibilitySet visibility = CullAndOcclude(boxes, camera, [&](OcclusionBuffer& buffer) {
+		buffer.AddOccluder(cube.GetVertexData(), sizeof(XMFLOAT3), cube.Indices, 0, wall.GetWorld());
+		});
+	CHECK(!visibility.IsVisible(0));
+	CHECK(visibility.IsVisible(1));
+	CHECK(visibility.IsVisible(2));
+	CHECK(visibility.IsVisible(3));
+	CHECK(!visibility.IsVisible(4));
+}
+
+TEST_CASE(OcclusionBuffer, BackFacesAreNotRasterized)
+{
+	TestCubeMesh cube;
+	TestCamera camera = { Vector3(0.0f, 0.0f, -10.0f), 0.0f, 0.0f };
+	TestBox wall = { Vector3(0.0f, 0.0f, 0.0f), Vector3(5.0f, 5.0f, 0.5f) };
+	std::vector<TestBox> boxes = { { Vector3(0.0f, 0.0f, 10.0f), Vector3(1.0f, 1.0f, 1.0f) } };
+
+	// The first two triangles of the cube are its face toward the camera
+	std::vector<UINT> front(cube.Indices.begin(), cube.Indices.begin() + 6);
+	std::vector<UINT> back = front;
+	std::swap(back[1], back[2]);
+	std::swap(back[4], back[5]);
+
+	VisibilitySet visibility = CullAndOcclude(boxes, camera, [&](OcclusionBuffer& buffer) {
+		buffer.AddOccluder(cube.GetVertexData(), sizeof(XMFLOAT3), front, 0, wall.GetWorld());
+		});
+	CHECK(!visibility.IsVisible(0));
+
+	visibility = CullAndOcclude(boxes, camera, [&](OcclusionBuffer& buffer) {
+		buffer.AddOccluder(cube.GetVertexData(), sizeof(XMFLOAT3), back, 0, wall.GetWorld());
+		});
+	CHECK(visibility.IsVisible(0));
+}
+
+TEST_CASE(OcclusionBuffer, OccludersCrossingTheNearPlaneAreClipped)
+{
+	// The camera stands just above the ground slab, so its top face crosses the near plane
+	TestCubeMesh cube;
+	TestCamera camera = { Vector3(0.0f, 0.0f, 0.0f), 0.0f, -0.3f };
+	TestBox ground = { Vector3(0.0f, -0.5f, 0.0f), Vector3(500.0f, 0.45f, 500.0f) };
+	std::vector<TestBox> boxes = {
+		{ Vector3(0.0f, -3.0f, 20.0f), Vector3(1.0f, 1.0f, 1.0f) },	// Under the ground
+		{ Vector3(0.0f, 2.0f, 20.0f), Vector3(1.0f, 1.0f, 1.0f) },	// Above the ground
+	};
+
+	VisibilitySet visibility = CullAndOcclude(boxes, camera, [&](OcclusionBuffer& buffer) {
+		buffer.AddOccluder(cube.GetVertexData(), sizeof(XMFLOAT3), cube.Indices, 0, ground.GetWorld());
+		});
+	CHECK(!visibility.IsVisible(0));
+	CHECK(visibility.IsVisible(1));
+}
+
+TEST_CASE(OcclusionBuffer, CityCullsMostHiddenPropsAndNoVisibleOnes)
+{
+	std::mt19937 random(11);
+	TestCubeMesh cube;
+	CityScene scene(4000, random);
+	const TestCamera cameras[] = {
+		{ Vector3(0.5f, 2.0f, -200.0f), 0.05f, 0.0f },
+		{ Vector3(0.5f, 60.0f, -300.0f), 0.3f, -0.25f },
+	};
+
+	for (const TestCamera& camera : cameras)
+	{
+		Matrix4x4 view = camera.GetViewMatrix();
+		Matrix4x4 proj = camera.GetProjMatrix();
+		VisibilitySet frustumVisibility;
+		scene.Bounds.Cull(ViewVolume::CreateFrustum(view, proj), frustumVisibility);
+
+		OcclusionBuffer buffer;
+		buffer.Reset(view * proj);
+		scene.AddOccluders(buffer, cube, frustumVisibility);
+		buffer.Rasterize();
+		VisibilitySet visibility = frustumVisibility;
+		scene.Bounds.Occlude(buffer, visibility);
+
+		size_t hidden = 0;
+		size_t hiddenCulled = 0;
+		size_t falseCulls = 0;
+		for (size_t i = scene.Buildings.size(); i < scene.Objects.size(); ++i)
+		{
+			if (!frustumVisibility.IsVisible(i))
+			{
+				continue;
+			}
+			SampledVisibility truth = SampleVisibility(scene, scene.Objects[i], camera, random, 60);
+			bool culled = !visibility.IsVisible(i);
+			if (truth == SampledVisibility::Visible && culled)
+			{
+				++falseCulls;
+			}
+			else if (truth == SampledVisibility::Hidden)
+			{
+				++hidden;
+				hiddenCulled += culled ? 1 : 0;
+			}
+		}
+
+		CHECK_EQUAL(falseCulls, 0u);
+		CHECK(hidden > 100);
+		// The sampled ground truth counts the boxes barely peeking out as hidden, so not all of them can be culled
+		CHECK(hiddenCulled >= hidden * 85 / 100);
+	}
+}
\ No newline at end of file
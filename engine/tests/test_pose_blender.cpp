@@ -0,0 +1,233 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "animation_clip.h"
+#include "animation_test_clips.h"
+#include "pose_blender.h"
+#include "rigged_mesh.h"
+#include "transform_test_util.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+// Two animations over a chain of bones, the worst case for the distortion of blended model space poses
+struct TestChainClip
+{
+	TestSkeleton Skeleton;
+	std::vector<::Animation> Animations;
+	std::unique_ptr<AnimationClip> Clip;
+};
+
+static TestChainClip CreateChainClip(size_t boneCount)
+{
+	TestChainClip clip;
+	clip.Skeleton = CreateTestSkeleton(boneCount);
+	std::iota(clip.Skeleton.Parents.begin(), clip.Skeleton.Parents.end(), -1);
+	clip.Animations.push_back(CreateTestAnimation(clip.Skeleton, "walk", 150.0f, 23));
+	clip.Animations.push_back(CreateTestAnimation(clip.Skeleton, "run", 90.0f, 24));
+	clip.Clip = std::make_unique<AnimationClip>(WriteRawClip("udsdx_test_chain.yac", clip.Skeleton, clip.Animations));
+	return clip;
+}
+
+// Largest difference of the length of the axes of the transforms from one
+static float MaxScaleError(std::span<const Matrix4x4> transforms)
+{
+	float error = 0.0f;
+	for (const Matrix4x4& transform : transforms)
+	{
+		error = std::max(error, std::abs(Vector3(transform._11, transform._12, transform._13).Length() - 1.0f));
+		error = std::max(error, std::abs(Vector3(transform._21, transform._22, transform._23).Length() - 1.0f));
+		error = std::max(error, std::abs(Vector3(transform._31, transform._32, transform._33).Length() - 1.0f));
+	}
+	return error;
+}
+
+TEST_CASE(PoseBlender, CrossFadeBlendsTheLocalTransforms)
+{
+	TestChainClip clip = CreateChainClip(64);
+	const udsdx::Animation& walk = clip.Clip->GetAnimation("walk");
+	const udsdx::Animation& run = clip.Clip->GetAnimation("run");
+	std::vector<int> boneMap(clip.Clip->GetBoneCount());
+	std::iota(boneMap.begin(), boneMap.end(), 0);
+
+	PoseBlender blender;
+	blender.Reset(clip.Clip->GetBones(), clip.Clip->GetBoneParents());
+	std::array<AnimationCursor, 2> cursors;
+	std::vector<Matrix4x4> pose(boneMap.size());
+	std::vector<Matrix4x4> walkPose(boneMap.size());
+	std::vector<Matrix4x4> runPose(boneMap.size());
+
+	const float time = 1.3f;
+	walk.PopulateTransforms(time, boneMap, walkPose);
+	run.PopulateTransforms(time, boneMap, runPose);
+	auto evaluate = [&](float weight) {
+		std::array<AnimationLayer, 2> layers = { {
+			{ &walk, time, 1.0f, boneMap, {}, &cursors[0] },
+			{ &run, time, weight, boneMap, {}, &cursors[1] } } };
+		blender.Evaluate(layers, {}, pose);
+	};
+
+	// At the ends of the fade, the pose is the one of a single animation
+	float difference = 0.0f;
+	evaluate(0.0f);
+	for (size_t bone = 0; bone < pose.size(); ++bone)
+	{
+		difference = std::max(difference, MaxDifference(pose[bone], walkPose[bone]));
+	}
+	evaluate(1.0f);
+	for (size_t bone = 0; bone < pose.size(); ++bone)
+	{
+		difference = std::max(difference, MaxDifference(pose[bone], runPose[bone]));
+	}
+	CHECK(difference < 1e-4f);
+
+	// Halfway, the local transforms are interpolated before the hierarchy
+	evaluate(0.5f);
+	const ::Animation& walkSource = clip.Animations[0];
+	const ::Animation& runSource = clip.Animations[1];
+	std::vector<Matrix4x4> reference(pose.size());
+	float ticks = time * walkSource.TicksPerSecond;
+	for (size_t bone = 0; bone < pose.size(); ++bone)
+	{
+		XMMATRIX local = XMLoadFloat4x4(&clip.Skeleton.Transforms[bone]);
+		const ::Animation::Channel& walkChannel = walkSource.Channels[bone];
+		const ::Animation::Channel& runChannel = runSource.Channels[bone];
+		if (!walkChannel.Name.empty())
+		{
+			local = XMMatrixAffineTransformation(
+				XMVectorLerp(SampleSourceKeys(walkChannel.ScaleTimestamps, walkChannel.Scales, ticks), SampleSourceKeys(runChannel.ScaleTimestamps, runChannel.Scales, ticks), 0.5f),
+				XMVectorZero(),
+				XMQuaternionSlerp(SampleSourceKeys(walkChannel.RotationTimestamps, walkChannel.Rotations, ticks), SampleSourceKeys(runChannel.RotationTimestamps, runChannel.Rotations, ticks), 0.5f),
+				XMVectorLerp(SampleSourceKeys(walkChannel.PositionTimestamps, walkChannel.Positions, ticks), SampleSourceKeys(runChannel.PositionTimestamps, runChannel.Positions, ticks), 0.5f));
+		}
+		XMStoreFloat4x4(&reference[bone], bone == 0 ? local : XMMatrixMultiply(local, XMLoadFloat4x4(&reference[bone - 1])));
+	}
+	difference = 0.0f;
+	for (size_t bone = 0; bone < pose.size(); ++bone)
+	{
+		difference = std::max(difference, MaxDifference(pose[bone], reference[bone]));
+	}
+	CHECK(difference < 1e-4f);
+
+	// The bones stay rigid down the chain, where interpolating the model space matrices shrinks them
+	std::vector<Matrix4x4> modelSpaceBlend(pose.size());
+	for (size_t bone = 0; bone < pose.size(); ++bone)
+	{
+		modelSpaceBlend[bone] = Matrix4x4::Lerp(walkPose[bone], runPose[bone], 0.5f);
+	}
+	CHECK(MaxScaleError(pose) < 1e-4f);
+	CHECK(MaxScaleError(modelSpaceBlend) > 0.05f);
+}
+
+TEST_CASE(PoseBlender, MaskedLayerOnlyMovesItsBones)
+{
+	TestChainClip clip = CreateChainClip(32);
+	const udsdx::Animation& walk = clip.Clip->GetAnimation("walk");
+	const udsdx::Animation& run = clip.Clip->GetAnimation("run");
+	std::vector<int> boneMap(clip.Clip->GetBoneCount());
+	std::iota(boneMap.begin(), boneMap.end(), 0);
+
+	PoseBlender blender;
+	blender.Reset(clip.Clip->GetBones(), clip.Clip->GetBoneParents());
+	std::array<AnimationCursor, 2> cursors;
+	std::vector<Matrix4x4> basePose(boneMap.size());
+	std::vector<Matrix4x4> layeredPose(boneMap.size());
+	std::vector<Matrix4x4> runPose(boneMap.size());
+	AnimationLayer base = { &walk, 0.8f, 1.0f, boneMap, {}, &cursors[0] };
+	blender.Evaluate(std::span<const AnimationLayer>(&base, 1), {}, basePose);
+	run.PopulateTransforms(0.8f, boneMap, runPose);
+
+	// The layer covers the bones from the middle of the chain on, so the ones before keep the base pose exactly
+	std::vector<float> mask(boneMap.size(), 0.0f);
+	std::fill(mask.begin() + mask.size() / 2, mask.end(), 1.0f);
+	std::array<AnimationLayer, 2> layers = { base, { &run, 0.8f, 1.0f, boneMap, mask, &cursors[1] } };
+	blender.Evaluate(layers, {}, layeredPose);
+	CHECK(memcmp(basePose.data(), layeredPose.data(), mask.size() / 2 * sizeof(Matrix4x4)) == 0);
+
+	// The masked bones take the local transforms of the layer, under the parents of the base pose
+	float difference = 0.0f;
+	for (size_t bone = mask.size() / 2; bone < mask.size(); ++bone)
+	{
+		Matrix4x4 runLocal = runPose[bone] * runPose[bone - 1].Invert();
+		difference = std::max(difference, MaxDifference(layeredPose[bone], runLocal * layeredPose[bone - 1]));
+	}
+	CHECK(difference < 1e-3f);
+}
+
+TEST_CASE(PoseBlender, UnmappedBonesKeepTheRestPoseOfTheMesh)
+{
+	TestChainClip clip = CreateChainClip(16);
+	const udsdx::Animation& walk = clip.Clip->GetAnimation("walk");
+
+	// The mesh has a rest pose of its own, and the clip leaves its last bones alone
+	std::vector<Bone> meshBones = clip.Clip->GetBones();
+	for (Bone& bone : meshBones)
+	{
+		bone.Transform = Matrix4x4::CreateScale(2.0f) * Matrix4x4::CreateTranslation(0.0f, 0.5f, 0.0f);
+	}
+	std::vector<int> boneMap(meshBones.size());
+	std::iota(boneMap.begin(), boneMap.end(), 0);
+	std::fill(boneMap.end() - 4, boneMap.end(), -1);
+
+	PoseBlender blender;
+	blender.Reset(meshBones, clip.Clip->GetBoneParents());
+	AnimationCursor cursor;
+	std::vector<Matrix4x4> pose(boneMap.size());
+	std::vector<Matrix4x4> clipPose(clip.Clip->GetBoneCount());
+	AnimationLayer layer = { &walk, 2.0f, 1.0f, boneMap, {}, &cursor };
+	blender.Evaluate(std::span<const AnimationLayer>(&layer, 1), {}, pose);
+	std::vector<int> identityMap(clipPose.size());
+	std::iota(identityMap.begin(), identityMap.end(), 0);
+	walk.PopulateTransforms(2.0f, identityMap, clipPose);
+
+	float difference = 0.0f;
+	for (size_t bone = 0; bone < pose.size(); ++bone)
+	{
+		const Matrix4x4& expected = boneMap[bone] >= 0 ? clipPose[bone] : meshBones[bone].Transform * pose[bone - 1];
+		difference = std::max(difference, MaxDifference(pose[bone], expected));
+	}
+	CHECK(difference < 1e-3f);
+}
+
+TEST_CASE(PoseBlender, ModifiersMultiplyTheBlendedLocalTransforms)
+{
+	TestChainClip clip = CreateChainClip(16);
+	const udsdx::Animation& walk = clip.Clip->GetAnimation("walk");
+	const udsdx::Animation& run = clip.Clip->GetAnimation("run");
+	std::vector<int> boneMap(clip.Clip->GetBoneCount());
+	std::iota(boneMap.begin(), boneMap.end(), 0);
+
+	PoseBlender blender;
+	blender.Reset(clip.Clip->GetBones(), clip.Clip->GetBoneParents());
+	std::array<AnimationCursor, 2> cursors;
+	std::array<AnimationLayer, 2> layers = { {
+		{ &walk, 0.6f, 1.0f, boneMap, {}, &cursors[0] },
+		{ &run, 0.6f, 0.3f, boneMap, {}, &cursors[1] } } };
+	std::vector<Matrix4x4> pose(boneMap.size());
+	std::vector<Matrix4x4> modifiedPose(boneMap.size());
+	blender.Evaluate(layers, {}, pose);
+
+	// Sorted by bone, as the renderer keeps them
+	std::array<BoneModifier, 2> modifiers = { {
+		{ 3, Matrix4x4(XMMatrixRotationY(0.7f)) },
+		{ 10, Matrix4x4::CreateScale(1.5f) * Matrix4x4::CreateTranslation(0.0f, 0.2f, 0.0f) } } };
+	blender.Evaluate(layers, modifiers, modifiedPose);
+
+	// The bones before the first modifier are untouched, the others follow the modified local transforms down the chain
+	CHECK(memcmp(pose.data(), modifiedPose.data(), 3 * sizeof(Matrix4x4)) == 0);
+	std::vector<Matrix4x4> reference(pose.size());
+	for (size_t bone = 0; bone < pose.size(); ++bone)
+	{
+		Matrix4x4 local = bone == 0 ? pose[0] : pose[bone] * pose[bone - 1].Invert();
+		for (const BoneModifier& modifier : modifiers)
+		{
+			local = modifier.Bone == bone ? local * modifier.Transform : local;
+		}
+		reference[bone] = bone == 0 ? local : local * reference[bone - 1];
+	}
+	float difference = 0.0f;
+	for (size_t bone = 0; bone < pose.size(); ++bone)
+	{
+		difference = std::max(difference, MaxDifference(modifiedPose[bone], reference[bone]));
+	}
+	CHECK(difference < 1e-3f);
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "state_tracking_command_list.h"
+#include "recording_command_list.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+static bool IsSameState(const RecordingCommandList::BoundState& lhs, const RecordingCommandList::BoundState& rhs)
+{
+	for (UINT slot = 0; slot < RecordingCommandList::VertexBufferSlotCount; ++slot)
+	{
+		const D3D12_VERTEX_BUFFER_VIEW& l = lhs.VertexBuffers[slot];
+		const D3D12_VERTEX_BUFFER_VIEW& r = rhs.VertexBuffers[slot];
+		if (l.BufferLocation != r.BufferLocation || l.SizeInBytes != r.SizeInBytes || l.StrideInBytes != r.StrideInBytes)
+		{
+			return false;
+		}
+	}
+	return lhs.IndexBuffer.BufferLocation == rhs.IndexBuffer.BufferLocation &&
+		lhs.IndexBuffer.SizeInBytes == rhs.IndexBuffer.SizeInBytes &&
+		lhs.IndexBuffer.Format == rhs.IndexBuffer.Format &&
+		lhs.Topology == rhs.Topology &&
+		lhs.StencilRef == rhs.StencilRef &&
+		lhs.PipelineState == rhs.PipelineState &&
+		lhs.DescriptorTables == rhs.DescriptorTables;
+}
+
+// The state one draw of the loops binds, the IDs stand for the mesh and the material
+struct TestDraw
+{
+	UINT Mesh;
+	UINT Material;
+	UINT StencilRef;
+};
+
+template <typename CommandList_T>
+static void BindDraw(CommandList_T& commandList, const TestDraw& draw)
+{
+	D3D12_VERTEX_BUFFER_VIEW vertexBuffer = { 0x10000ull * (draw.Mesh + 1), 4096, 32 };
+	D3D12_INDEX_BUFFER_VIEW indexBuffer = { 0x20000000ull + 0x10000ull * draw.Mesh, 1024, DXGI_FORMAT_R32_UINT };
+	commandList.IASetVertexBuffers(0, 1, &vertexBuffer);
+	commandList.IASetIndexBuffer(&indexBuffer);
+	commandList.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	commandList.OMSetStencilRef(draw.StencilRef);
+	commandList.SetPipelineState(reinterpret_cast<ID3D12PipelineState*>(static_cast<uintptr_t>(0x1000 + (draw.Material % 4) * 0x100)));
+	for (UINT texture = 0; texture < 3; ++texture)
+	{
+		commandList.SetGraphicsRootDescriptorTable(RootParam::SrcTexSRV_0 + texture, { 0x40000000ull + draw.Material * 0x100 + texture * 0x20 });
+	}
+}
+
+TEST_CASE(StateTracking, RepeatedStateIsSkipped)
+{
+	RecordingCommandList recorder;
+	StateTrackingCommandList commandList(&recorder);
+	TestDraw draw = { 1, 2, 0 };
+	BindDraw(commandList, draw);
+	UINT issued = commandList.GetStatistics().Issued;
+	CHECK_EQUAL(issued, 8u);
+	CHECK_EQUAL(recorder.GetCallCount(), issued);
+
+	// The same draw again binds nothing, another material only its pipeline and textures
+	BindDraw(commandList, draw);
+	CHECK_EQUAL(commandList.GetStatistics().Issued, issued);
+	CHECK_EQUAL(commandList.GetStatistics().Skipped, issued);
+	BindDraw(commandList, { 1, 3, 0 });
+	CHECK_EQUAL(commandList.GetStatistics().Issued, issued + 4);
+
+	// After invalidating, every call is issued again
+	commandList.Invalidate();
+	commandList.ResetStatistics();
+	BindDraw(commandList, { 1, 3, 0 });
+	CHECK_EQUAL(commandList.GetStatistics().Issued, issued);
+	CHECK_EQUAL(commandList.GetStatistics().Skipped, 0u);
+	CHECK_EQUAL(recorder.GetCallCount(), issued * 2 + 4);
+}
+
+TEST_CASE(StateTracking, PartialAndEmptyBindingsAreTracked)
+{
+	RecordingCommandList recorder;
+	StateTrackingCommandList commandList(&recorder);
+	std::array<D3D12_VERTEX_BUFFER_VIEW, 2> views = { { { 0x1000, 64, 16 }, { 0x2000, 64, 16 } } };
+
+	// Both slots, then the second one alone with the same view, then with another view
+	commandList.IASetVertexBuffers(0, 2, views.data());
+	commandList.IASetVertexBuffers(1, 1, &views[1]);
+	CHECK_EQUAL(commandList.GetStatistics().Skipped, 1u);
+	commandList.IASetVertexBuffers(1, 1, &views[0]);
+	CHECK_EQUAL(commandList.GetStatistics().Skipped, 1u);
+	CHECK_EQUAL(recorder.GetState().VertexBuffers[1].BufferLocation, 0x1000ull);
+
+	// Unbinding the index buffer is a state of its own
+	D3D12_INDEX_BUFFER_VIEW indexBuffer = { 0x3000, 64, DXGI_FORMAT_R16_UINT };
+	commandList.IASetIndexBuffer(&indexBuffer);
+	commandList.IASetIndexBuffer(nullptr);
+	commandList.IASetIndexBuffer(nullptr);
+	CHECK_EQUAL(commandList.GetStatistics().Skipped, 2u);
+	CHECK_EQUAL(recorder.GetState().IndexBuffer.BufferLocation, 0ull);
+}
+
+TEST_CASE(StateTracking, FilteredStreamBindsTheStateOfTheUnfilteredOne)
+{
+	// Draws sorted by material and mesh as the draw list sorts them, the loops setting up the passes directly in between
+	std::mt19937 random(16);
+	std::uniform_int_distribution<UINT> id(0, 11);
+	std::vector<TestDraw> draws(1920);
+	for (TestDraw& draw : draws)
+	{
+		draw = { id(random), id(random), id(random) % 2 };
+	}
+	std::sort(draws.begin(), draws.end(), [](const TestDraw& lhs, const TestDraw& rhs) {
+		return std::tie(lhs.StencilRef, lhs.Material, lhs.Mesh) < std::tie(rhs.StencilRef, rhs.Material, rhs.Mesh);
+		});
+
+	RecordingCommandList unfiltered;
+	RecordingCommandList filtered;
+	StateTrackingCommandList commandList(&filtered);
+	size_t mismatches = 0;
+	for (const TestDraw& draw : draws)
+	{
+		if (id(random) == 0)
+		{
+			TestDraw passSetup = { id(random), id(random), id(random) };
+			BindDraw(unfiltered, passSetup);
+			BindDraw(filtered, passSetup);
+			commandList.Invalidate();
+		}
+
+		BindDraw(unfiltered, draw);
+		BindDraw(commandList, draw);
+		mismatches += IsSameState(unfiltered.GetState(), filtered.GetState()) ? 0 : 1;
+	}
+	CHECK_EQUAL(mismatches, 0u);
+
+	const StateTrackingCommandList::Statistics& statistics = commandList.GetStatistics();
+	CHECK_EQUAL(statistics.Issued + statistics.Skipped, draws.size() * 8);
+	CHECK(statistics.Skipped > statistics.Issued * 4);
+}
\ No newline at end of file
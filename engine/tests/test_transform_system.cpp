@@ -0,0 +1,232 @@
+#include "pch.h"
+#include "test_framework.h"
+#include "transform_test_util.h"
+
+using namespace udsdx;
+using namespace udsdx::test;
+
+static constexpr float Tolerance = 1e-3f;
+
+TEST_CASE(TransformSystem, WorldMatricesMatchTheRecursiveReference)
+{
+	Singleton<TransformSystem>::CreateInstance();
+	std::mt19937 random(1);
+	TestHierarchy hierarchy = BuildHierarchy(3000, 1, random);
+
+	INSTANCE(TransformSystem)->UpdateWorldMatrices();
+	CHECK(MaxReferenceDifference(hierarchy) <= Tolerance);
+
+	// Parents precede their children in the slots, whatever order they were created in
+	for (int i = 0; i < 3000; i += 7)
+	{
+		RandomizeLocal(*hierarchy.Transforms[i], random);
+	}
+	INSTANCE(TransformSystem)->UpdateWorldMatrices();
+	CHECK(MaxReferenceDifference(hierarchy) <= Tolerance);
+}
+
+TEST_CASE(TransformSystem, ReparentingAndReleasingKeepsTheHandles)
+{
+	Singleton<TransformSystem>::CreateInstance();
+	std::mt19937 random(2);
+	TestHierarchy hierarchy = BuildHierarchy(2000, 4, random);
+	INSTANCE(TransformSystem)->UpdateWorldMatrices();
+
+	// Moving a transform under an earlier one never forms a cycle, as every parent was created before its children
+	for (int i = 0; i < 200; ++i)
+	{
+		int index = std::uniform_int_distribution<int>(1, 1999)(random);
+		int parent = std::uniform_int_distribution<int>(0, index - 1)(random);
+		hierarchy.Transforms[index]->SetParent(hierarchy.Transforms[parent].get());
+		hierarchy.Parents[index] = parent;
+	}
+
+	// The children of a released transform become roots
+	for (int i = 0; i < 100; ++i)
+	{
+		int index = std::uniform_int_distribution<int>(0, 1999)(random);
+		hierarchy.Transforms[index].reset();
+		for (int& parent : hierarchy.Parents)
+		{
+			if (parent == index)
+			{
+				parent = -1;
+			}
+		}
+	}
+
+	Vector3 position(1.0f, 2.0f, 3.0f);
+	TestTransform* survivor = std::find_if(hierarchy.Transforms.rbegin(), hierarchy.Transforms.rend(), [](const auto& transform) { return transform != nullptr; })->get();
+	survivor->SetLocalPosition(position);
+
+	INSTANCE(TransformSystem)->UpdateWorldMatrices();
+	CHECK(survivor->GetLocalPosition() == position);
+	CHECK(MaxReferenceDifference(hierarchy) <= Tolerance);
+}
+
+TEST_CASE(TransformSystem, QueriesValidateTheAncestors)
+{
+	Singleton<TransformSystem>::CreateInstance();
+	std::mt19937 random(3);
+	TestHierarchy hierarchy = BuildHierarchy(500, 1, random);
+	std::vector<Matrix4x4> reference = ComputeReferenceWorldMatrices(hierarchy);
+
+	// No update has run, the query resolves the chain of the transform on its own
+	Vector3 position = hierarchy.Transforms.back()->GetWorldPosition();
+	CHECK_NEAR(position.x, reference.back()._41, Tolerance);
+	CHECK_NEAR(position.y, reference.back()._42, Tolerance);
+	CHECK_NEAR(position.z, reference.back()._43, Tolerance);
+	CHECK(MaxDifference(hierarchy.Transforms.back()->GetWorldSRTMatrix(), reference.back()) <= Tolerance);
+
+	// The siblings marked dirty on the way are still resolved by the next update
+	INSTANCE(TransformSystem)->UpdateWorldMatrices();
+	CHECK(MaxReferenceDifference(hierarchy) <= Tolerance);
+}
+
+TEST_CASE(TransformSystem, RootsAllocatedAfterTheReorderAreUpdatedInParallel)
+{
+	Singleton<TransformSystem>::CreateInstance();
+	TransformSystem* system = INSTANCE(TransformSystem);
+	system->SetConcurrency(4);
+
+	// Enough roots to split the first level into subtrees
+	std::mt19937 random(4);
+	TestHierarchy hierarchy = BuildHierarchy(2000, 64, random);
+	system->UpdateWorldMatrices();
+	CHECK(system->GetWorkItemCount() > 1);
+
+	// A new root does not reorder the slots, it lies past the last subtree
+	TestTransform late;
+	late.SetLocalPosition(1.0f, 2.0f, 3.0f);
+
+	// Dirty enough slots for the full parallel pass instead of the dirty subtrees
+	for (auto& transform : hierarchy.Transforms)
+	{
+		RandomizeLocal(*transform, random);
+	}
+	system->UpdateWorldMatrices();
+
+	Matrix4x4 world = late.GetWorldSRTMatrix(false);
+	CHECK(world.Translation() == Vector3(1.0f, 2.0f, 3.0f));
+	CHECK(MaxReferenceDifference(hierarchy) <= Tolerance);
+}
+
+namespace udsdx
+{
+	extern unsigned long long g_localMatrixRecalculateCounter;
+	extern unsigned long long g_worldMatrixRecalculateCounter;
+}
+
+struct TransformUpdateResult
+{
+	std::vector<Matrix4x4> WorldMatrices;
+	size_t WorkItemCount = 0;
+	unsigned long long LocalRecalculations = 0;
+	unsigned long long WorldRecalculations = 0;
+};
+
+// Builds the same hierarchy in a fresh system, and moves every transform twice
+static TransformUpdateResult RunMovingHierarchy(UINT concurrency)
+{
+	Singleton<TransformSystem>::CreateInstance();
+	TransformSystem* system = INSTANCE(TransformSystem);
+	system->SetConcurrency(concurrency);
+
+	std::mt19937 random(5);
+	TestHierarchy hierarchy = BuildHierarchy(5000, 1, random);
+
+	unsigned long long localCounter = g_localMatrixRecalculateCounter;
+	unsigned long long worldCounter = g_worldMatrixRecalculateCounter;
+	for (int frame = 0; frame < 2; ++frame)
+	{
+		for (auto& transform : hierarchy.Transforms)
+		{
+			RandomizeLocal(*transform, random);
+		}
+		system->UpdateWorldMatrices();
+	}
+
+	TransformUpdateResult result;
+	result.WorkItemCount = system->GetWorkItemCount();
+	result.LocalRecalculations = g_localMatrixRecalculateCounter - localCounter;
+	result.WorldRecalculations = g_worldMatrixRecalculateCounter - worldCounter;
+	for (auto& transform : hierarchy.Transforms)
+	{
+		result.WorldMatrices.emplace_back(transform->GetWorldSRTMatrix(false));
+	}
+	return result;
+}
+
+TEST_CASE(TransformSystem, ParallelUpdateMatchesSerialBitForBit)
+{
+	TransformUpdateResult serial = RunMovingHierarchy(1);
+	TransformUpdateResult parallel = RunMovingHierarchy(8);
+
+	CHECK_EQUAL(serial.WorkItemCount, 0u);
+	CHECK(parallel.WorkItemCount > 1);
+	CHECK_EQUAL(parallel.LocalRecalculations, serial.LocalRecalculations);
+	CHECK_EQUAL(parallel.WorldRecalculations, serial.WorldRecalculations);
+	CHECK(std::memcmp(serial.WorldMatrices.data(), parallel.WorldMatrices.data(), serial.WorldMatrices.size() * sizeof(Matrix4x4)) == 0);
+}
+
+TEST_CASE(TransformSystem, UpdatesOnlyTheMovedSubtrees)
+{
+	Singleton<TransformSystem>::CreateInstance();
+	TransformSystem* system = INSTANCE(TransformSystem);
+	std::mt19937 random(6);
+	TestHierarchy hierarchy = BuildHierarchy(10000, 1, random);
+	system->UpdateWorldMatrices();
+
+	// Nothing moved, nothing is recalculated
+	unsigned long long localCounter = g_localMatrixRecalculateCounter;
+	unsigned long long worldCounter = g_worldMatrixRecalculateCounter;
+	system->UpdateWorldMatrices();
+	CHECK_EQUAL(g_localMatrixRecalculateCounter - localCounter, 0ull);
+	CHECK_EQUAL(g_worldMatrixRecalculateCounter - worldCounter, 0ull);
+
+	// Moved leaves only recalculate themselves
+	std::vector<bool> hasChildren(hierarchy.Parents.size(), false);
+	for (int parent : hierarchy.Parents)
+	{
+		if (parent >= 0)
+		{
+			hasChildren[parent] = true;
+		}
+	}
+	unsigned long long movedCount = 0;
+	for (size_t i = 0; i < hierarchy.Transforms.size() && movedCount < 100; i += 3)
+	{
+		if (!hasChildren[i])
+		{
+			hierarchy.Transforms[i]->Translate(Vector3::UnitX);
+			movedCount++;
+		}
+	}
+	localCounter = g_localMatrixRecalculateCounter;
+	worldCounter = g_worldMatrixRecalculateCounter;
+	system->UpdateWorldMatrices();
+	CHECK_EQUAL(g_localMatrixRecalculateCounter - localCounter, movedCount);
+	CHECK_EQUAL(g_worldMatrixRecalculateCounter - worldCounter, movedCount);
+	CHECK(MaxReferenceDifference(hierarchy) <= Tolerance);
+
+	// A moved transform recalculates the world matrices of its whole subtree, once even if a descendant moved too
+	const int movedRoot = 5;
+	std::vector<bool> inSubtree(hierarchy.Parents.size(), false);
+	unsigned long long subtreeSize = 0;
+	for (size_t i = 0; i < hierarchy.Parents.size(); ++i)
+	{
+		inSubtree[i] = static_cast<int>(i) == movedRoot || (hierarchy.Parents[i] >= 0 && inSubtree[hierarchy.Parents[i]]);
+		subtreeSize += inSubtree[i] ? 1 : 0;
+	}
+	CHECK(subtreeSize > 1);
+	hierarchy.Transforms[movedRoot]->Rotate(Quaternion::CreateFromAxisAngle(Vector3::UnitY, 0.5f));
+	auto descendant = std::find(inSubtree.begin() + movedRoot + 1, inSubtree.end(), true);
+	hierarchy.Transforms[descendant - inSubtree.begin()]->SetLocalScale(2.0f);
+
+	localCounter = g_localMatrixRecalculateCounter;
+	worldCounter = g_worldMatrixRecalculateCounter;
+	system->UpdateWorldMatrices();
+	CHECK_EQUAL(g_localMatrixRecalculateCounter - localCounter, 2ull);
+	CHECK_EQUAL(g_worldMatrixRecalculateCounter - worldCounter, subtreeSize);
+	CHECK(MaxReferenceDifference(hierarchy) <= Tolerance);
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "pch.h"
+#include "transform.h"
+
+namespace udsdx::test
+{
+	// Transform with the reparenting SceneObject does, for hierarchies without scene objects
+	class TestTransform : public Transform
+	{
+	public:
+		TransformSystem::Handle GetHandle() const { return m_handle; }
+		void SetParent(TestTransform* parent)
+		{
+			m_system->SetParent(m_handle, parent == nullptr ? TransformSystem::InvalidHandle : parent->m_handle);
+		}
+	};
+
+	// Transforms of the singleton TransformSystem, with the parent of each one kept aside for the reference results
+	struct TestHierarchy
+	{
+		std::vector<std::unique_ptr<TestTransform>> Transforms;
+		std::vector<int> Parents;
+	};
+
+	inline void RandomizeLocal(TestTransform& transform, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> position(-5.0f, 5.0f);
+		std::uniform_real_distribution<float> angle(-PI, PI);
+		std::uniform_real_distribution<float> scale(0.9f, 1.1f);
+		transform.SetLocalPosition(position(random), position(random), position(random));
+		transform.SetLocalRotation(Quaternion::CreateFromYawPitchRoll(angle(random), angle(random), angle(random)));
+		transform.SetLocalScale(scale(random));
+	}
+
+	// The first rootCount transforms are roots, every other one takes a random earlier transform as its parent
+	inline TestHierarchy BuildHierarchy(UINT count, UINT rootCount, std::mt19937& random)
+	{
+		TestHierarchy hierarchy;
+		hierarchy.Transforms.reserve(count);
+		hierarchy.Parents.reserve(count);
+		for (UINT i = 0; i < count; ++i)
+		{
+			auto& transform = hierarchy.Transforms.emplace_back(std::make_unique<TestTransform>());
+			int parent = i < rootCount ? -1 : static_cast<int>(std::uniform_int_distribution<UINT>(0, i - 1)(random));
+			hierarchy.Parents.emplace_back(parent);
+			if (parent >= 0)
+			{
+				transform->SetParent(hierarchy.Transforms[parent].get());
+			}
+			RandomizeLocal(*transform, random);
+		}
+		return hierarchy;
+	}
+
+	// World matrices composed recursively from the local values, the way the per-node transforms did
+	inline std::vector<Matrix4x4> ComputeReferenceWorldMatrices(const TestHierarchy& hierarchy)
+	{
+		const size_t count = hierarchy.Transforms.size();
+		std::vector<Matrix4x4> worldMatrices(count);
+		std::vector<bool> resolved(count, false);
+
+		std::function<void(size_t)> resolve = [&](size_t index) {
+			if (resolved[index])
+			{
+				return;
+			}
+			const TestTransform& transform = *hierarchy.Transforms[index];
+			Vector3 position = transform.GetLocalPosition();
+			Quaternion rotation = transform.GetLocalRotation();
+			Vector3 scale = transform.GetLocalScale();
+			XMMATRIX m = XMMatrixAffineTransformation(XMLoadFloat3(&scale), XMVectorZero(), XMLoadFloat4(&rotation), XMLoadFloat3(&position));
+
+			int parent = hierarchy.Parents[index];
+			if (parent >= 0)
+			{
+				resolve(parent);
+				m = XMMatrixMultiply(m, worldMatrices[parent]);
+			}
+			XMStoreFloat4x4(&worldMatrices[index], m);
+			resolved[index] = true;
+		};
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (hierarchy.Transforms[i] != nullptr)
+			{
+				resolve(i);
+			}
+		}
+		return worldMatrices;
+	}
+
+	inline float MaxDifference(const Matrix4x4& lhs, const Matrix4x4& rhs)
+	{
+		float difference = 0.0f;
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				difference = std::max(difference, std::abs(lhs.m[row][column] - rhs.m[row][column]));
+			}
+		}
+		return difference;
+	}
+
+	// Largest difference between the world matrices of the system and the reference, without validating anything on the way
+	inline float MaxReferenceDifference(TestHierarchy& hierarchy)
+	{
+		std::vector<Matrix4x4> reference = ComputeReferenceWorldMatrices(hierarchy);
+		float difference = 0.0f;
+		for (size_t i = 0; i < hierarchy.Transforms.size(); ++i)
+		{
+			if (hierarchy.Transforms[i] != nullptr)
+			{
+				difference = std::max(difference, MaxDifference(hierarchy.Transforms[i]->GetWorldSRTMatrix(false), reference[i]));
+			}
+		}
+		return difference;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <DirectXMath.h>
+
+// Keys of an animation as read from the scene, with a channel per bone. Bones without keys have an empty channel.
+// Kept apart from the exporter, so the compression builds without the importer.
+struct Animation
+{
+	struct Channel
+	{
+		std::string Name{};
+
+		std::vector<float> PositionTimestamps{};
+		std::vector<float> RotationTimestamps{};
+		std::vector<float> ScaleTimestamps{};
+
+		std::vector<DirectX::XMFLOAT3> Positions{};
+		std::vector<DirectX::XMFLOAT4> Rotations{};
+		std::vector<DirectX::XMFLOAT3> Scales{};
+	};
+
+	std::string Name{};
+
+	float Duration = 0.0f;
+	float TicksPerSecond = 1.0f;
+
+	std::vector<Channel> Channels{};
+};
\ No newline at end of file
@@ -11,9 +11,13 @@
 #include <assimp/scene.h>
 
 #include "vertex.h"
+#include "animation_compression.h"
 
 using namespace DirectX;
 
+// Rate the animations are resampled at, in samples per second
+static constexpr float AnimationSampleRate = 30.0f;
+
 AnimationClipExporter::AnimationClipExporter() : ExporterBase()
 {
 }
@@ -114,6 +118,10 @@ void AnimationClipExporter::Export(const aiScene& scene, const std::filesystem::
 		}
 	}
 
+	// The tag tells the compressed files apart from the ones written with the raw keys, which start with the bone count
+	size_t tag = CompressedAnimationTag;
+	file.write(reinterpret_cast<const char*>(&tag), sizeof(size_t));
+
 	// Write the number of bones
 	size_t boneCount = m_bones.size();
 	file.write(reinterpret_cast<const char*>(&boneCount), sizeof(size_t));
@@ -142,37 +150,28 @@ void AnimationClipExporter::Export(const aiScene& scene, const std::filesystem::
 		file.write(reinterpret_cast<const char*>(&m_animation.TicksPerSecond), sizeof(float));
 		file.write(reinterpret_cast<const char*>(&m_animation.Duration), sizeof(float));
 
-		size_t channelCount = m_animation.Channels.size();
-		file.write(reinterpret_cast<const char*>(&channelCount), sizeof(size_t));
+		CompressedAnimation compressed = CompressAnimation(m_animation, AnimationSampleRate, AnimationTolerance());
+		file.write(reinterpret_cast<const char*>(&compressed.SampleInterval), sizeof(float));
+
+		size_t trackCount = compressed.Tracks.size();
+		file.write(reinterpret_cast<const char*>(&trackCount), sizeof(size_t));
+		file.write(reinterpret_cast<const char*>(compressed.Tracks.data()), trackCount * sizeof(CompressedTrack));
+
+		size_t keyWordCount = compressed.Keys.size();
+		file.write(reinterpret_cast<const char*>(&keyWordCount), sizeof(size_t));
+		file.write(reinterpret_cast<const char*>(compressed.Keys.data()), keyWordCount * sizeof(uint16_t));
+
+		size_t rawSize = 0;
 		for (const auto& channel : m_animation.Channels)
 		{
-			size_t channelNameLength = channel.Name.size();
-			file.write(reinterpret_cast<const char*>(&channelNameLength), sizeof(size_t));
-			file.write(channel.Name.c_str(), channel.Name.size());
-			size_t positionKeyCount = channel.PositionTimestamps.size();
-			file.write(reinterpret_cast<const char*>(&positionKeyCount), sizeof(size_t));
-			for (size_t j = 0; j < positionKeyCount; ++j)
-			{
-				float timestamp = channel.PositionTimestamps[j];
-				file.write(reinterpret_cast<const char*>(&timestamp), sizeof(float));
-				file.write(reinterpret_cast<const char*>(&channel.Positions[j]), sizeof(XMFLOAT3));
-			}
-			size_t rotationKeyCount = channel.RotationTimestamps.size();
-			file.write(reinterpret_cast<const char*>(&rotationKeyCount), sizeof(size_t));
-			for (size_t j = 0; j < rotationKeyCount; ++j)
-			{
-				float timestamp = channel.RotationTimestamps[j];
-				file.write(reinterpret_cast<const char*>(&timestamp), sizeof(float));
-				file.write(reinterpret_cast<const char*>(&channel.Rotations[j]), sizeof(XMFLOAT4));
-			}
-			size_t scaleKeyCount = channel.ScaleTimestamps.size();
-			file.write(reinterpret_cast<const char*>(&scaleKeyCount), sizeof(size_t));
-			for (size_t j = 0; j < scaleKeyCount; ++j)
-			{
-				float timestamp = channel.ScaleTimestamps[j];
-				file.write(reinterpret_cast<const char*>(&timestamp), sizeof(float));
-				file.write(reinterpret_cast<const char*>(&channel.Scales[j]), sizeof(XMFLOAT3));
-			}
+			rawSize += channel.Positions.size() * (sizeof(float) + sizeof(XMFLOAT3));
+			rawSize += channel.Rotations.size() * (sizeof(float) + sizeof(XMFLOAT4));
+			rawSize += channel.Scales.size() * (sizeof(float) + sizeof(XMFLOAT3));
 		}
+		size_t compressedSize = trackCount * sizeof(CompressedTrack) + keyWordCount * sizeof(uint16_t);
+		std::cout << "[LOG]\tCompressed animation " << m_animation.Name << " from " << rawSize << " to " << compressedSize << " bytes of keys, "
+			<< "largest errors " << compressed.MaxPositionError << " in position, "
+			<< XMConvertToDegrees(compressed.MaxRotationError) << " degrees in rotation, "
+			<< compressed.MaxScaleError << " in scale" << std::endl;
 	}
 }
@@ -0,0 +1,270 @@
+#include "animation_compression.h"
+#include "animation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+
+using namespace DirectX;
+
+static_assert(sizeof(CompressedTrack) == 36, "The tracks are written as is");
+
+// Strides tried for the tracks which are not constant, from the fewest keys
+static constexpr unsigned int FrameStrides[] = { 16, 8, 4, 2, 1 };
+
+// Largest magnitude of the components left after dropping the largest one of a unit quaternion
+static constexpr float SmallestThreeRange = 0.70710678f;
+
+enum class TrackKind
+{
+	Position,
+	Rotation,
+	Scale
+};
+
+// Finds the keys around the time, holding the first and the last ones outside of them as the engine does
+static void FindSourceKeys(const std::vector<float>& timestamps, float time, size_t& first, size_t& second, float& fraction)
+{
+	size_t size = timestamps.size();
+	size_t seg = std::distance(timestamps.begin(), std::lower_bound(timestamps.begin(), timestamps.end(), time));
+	if (seg == 0 || seg == size)
+	{
+		first = second = seg == 0 ? 0 : size - 1;
+		fraction = 0.0f;
+		return;
+	}
+	first = seg - 1;
+	second = seg;
+	fraction = (time - timestamps[first]) / (timestamps[second] - timestamps[first]);
+}
+
+static XMVECTOR SampleSource(const std::vector<float>& timestamps, const std::vector<XMFLOAT3>& keys, float time)
+{
+	size_t first, second;
+	float fraction;
+	FindSourceKeys(timestamps, time, first, second, fraction);
+	return XMVectorLerp(XMLoadFloat3(&keys[first]), XMLoadFloat3(&keys[second]), fraction);
+}
+
+static XMVECTOR SampleSource(const std::vector<float>& timestamps, const std::vector<XMFLOAT4>& keys, float time)
+{
+	size_t first, second;
+	float fraction;
+	FindSourceKeys(timestamps, time, first, second, fraction);
+	return XMQuaternionSlerp(XMLoadFloat4(&keys[first]), XMLoadFloat4(&keys[second]), fraction);
+}
+
+static void EncodeVector(FXMVECTOR value, const CompressedTrack& track, uint16_t* words)
+{
+	XMFLOAT3 components;
+	XMStoreFloat3(&components, value);
+	const float* source = &components.x;
+	const float* rangeMin = &track.RangeMin.x;
+	const float* rangeExtent = &track.RangeExtent.x;
+	for (int i = 0; i < 3; ++i)
+	{
+		float normalized = rangeExtent[i] > 0.0f ? std::clamp((source[i] - rangeMin[i]) / rangeExtent[i], 0.0f, 1.0f) : 0.0f;
+		words[i] = static_cast<uint16_t>(std::lround(normalized * 65535.0f));
+	}
+}
+
+static XMVECTOR DecodeVector(const uint16_t* words, const CompressedTrack& track)
+{
+	XMVECTOR normalized = XMVectorSet(words[0], words[1], words[2], 0.0f) * (1.0f / 65535.0f);
+	return XMVectorMultiplyAdd(normalized, XMLoadFloat3(&track.RangeExtent), XMLoadFloat3(&track.RangeMin));
+}
+
+// Packs the index of the largest component in the top bits of the 48, followed by the other components in 15 bits each.
+// The quaternion is negated if needed so the largest component is positive, and rebuilt from the unit length.
+static void EncodeRotation(FXMVECTOR rotation, uint16_t* words)
+{
+	XMFLOAT4 components;
+	XMStoreFloat4(&components, XMQuaternionNormalize(rotation));
+	const float* source = &components.x;
+
+	int largest = 0;
+	for (int i = 1; i < 4; ++i)
+	{
+		largest = std::fabs(source[i]) > std::fabs(source[largest]) ? i : largest;
+	}
+	float sign = source[largest] < 0.0f ? -1.0f : 1.0f;
+
+	uint64_t bits = static_cast<uint64_t>(largest);
+	for (int i = 0; i < 4; ++i)
+	{
+		if (i != largest)
+		{
+			float normalized = std::clamp((source[i] * sign + SmallestThreeRange) / (2.0f * SmallestThreeRange), 0.0f, 1.0f);
+			bits = (bits << 15) | static_cast<uint64_t>(std::lround(normalized * 32767.0f));
+		}
+	}
+	words[0] = static_cast<uint16_t>(bits >> 32);
+	words[1] = static_cast<uint16_t>(bits >> 16);
+	words[2] = static_cast<uint16_t>(bits);
+}
+
+static XMVECTOR DecodeRotation(const uint16_t* words)
+{
+	uint64_t bits = (static_cast<uint64_t>(words[0]) << 32) | (static_cast<uint64_t>(words[1]) << 16) | words[2];
+	float scale = 2.0f * SmallestThreeRange / 32767.0f;
+	float a = static_cast<float>((bits >> 30) & 0x7FFF) * scale - SmallestThreeRange;
+	float b = static_cast<float>((bits >> 15) & 0x7FFF) * scale - SmallestThreeRange;
+	float c = static_cast<float>(bits & 0x7FFF) * scale - SmallestThreeRange;
+	float values[4] = { a, b, c, std::sqrt(std::max(1.0f - a * a - b * b - c * c, 0.0f)) };
+
+	// Slots of the values each component is read from, for every index of the dropped component, so decoding does not branch on it
+	static constexpr int Slots[4][4] = { { 3, 0, 1, 2 }, { 0, 3, 1, 2 }, { 0, 1, 3, 2 }, { 0, 1, 2, 3 } };
+	const int* slots = Slots[(bits >> 45) & 3];
+	return XMVectorSet(values[slots[0]], values[slots[1]], values[slots[2]], values[slots[3]]);
+}
+
+static XMVECTOR DecodeKey(TrackKind kind, const CompressedTrack& track, const std::vector<uint16_t>& keys, size_t key)
+{
+	const uint16_t* words = &keys[(static_cast<size_t>(track.FirstKey) + key) * 3];
+	return kind == TrackKind::Rotation ? DecodeRotation(words) : DecodeVector(words, track);
+}
+
+// Samples the track as the engine does: the key is found by dividing the time by the spacing of the keys
+static XMVECTOR SampleTrack(TrackKind kind, const CompressedTrack& track, const std::vector<uint16_t>& keys, float sampleInterval, float time)
+{
+	if (track.KeyCount == 1)
+	{
+		return DecodeKey(kind, track, keys, 0);
+	}
+
+	float position = std::clamp(time / (sampleInterval * track.FrameStride), 0.0f, static_cast<float>(track.KeyCount - 1));
+	size_t key = std::min(static_cast<size_t>(position), static_cast<size_t>(track.KeyCount - 2));
+	float fraction = position - static_cast<float>(key);
+
+	XMVECTOR key0 = DecodeKey(kind, track, keys, key);
+	XMVECTOR key1 = DecodeKey(kind, track, keys, key + 1);
+	return kind == TrackKind::Rotation ? XMQuaternionSlerp(key0, key1, fraction) : XMVectorLerp(key0, key1, fraction);
+}
+
+static float MeasureError(TrackKind kind, FXMVECTOR value, FXMVECTOR reference)
+{
+	// The angle is taken from the chord between the quaternions, as the arc cosine of their dot product is too coarse near zero
+	if (kind == TrackKind::Rotation)
+	{
+		float chord = std::min(XMVectorGetX(XMVector4Length(value - reference)), XMVectorGetX(XMVector4Length(value + reference)));
+		return 4.0f * std::asin(std::min(chord * 0.5f, 1.0f));
+	}
+	return XMVectorGetX(XMVector3Length(value - reference));
+}
+
+// Appends the keys of the track, keeping one every stride frames for the largest stride which reconstructs the frames within the tolerance.
+// The samples are padded past the last frame, so the last key of any stride exists.
+static CompressedTrack CompressTrack(TrackKind kind, std::span<const XMFLOAT4> samples, size_t frameCount, float sampleInterval, float tolerance, std::vector<uint16_t>& keys)
+{
+	CompressedTrack track;
+	track.FirstKey = static_cast<unsigned int>(keys.size() / 3);
+
+	if (kind != TrackKind::Rotation)
+	{
+		XMVECTOR rangeMin = XMLoadFloat4(&samples[0]);
+		XMVECTOR rangeMax = rangeMin;
+		for (const XMFLOAT4& sample : samples)
+		{
+			rangeMin = XMVectorMin(rangeMin, XMLoadFloat4(&sample));
+			rangeMax = XMVectorMax(rangeMax, XMLoadFloat4(&sample));
+		}
+		XMStoreFloat3(&track.RangeMin, rangeMin);
+		XMStoreFloat3(&track.RangeExtent, rangeMax - rangeMin);
+	}
+
+	auto tryStride = [&](unsigned int stride, size_t keyCount)
+	{
+		track.FrameStride = stride;
+		track.KeyCount = static_cast<unsigned int>(keyCount);
+		keys.resize((static_cast<size_t>(track.FirstKey) + keyCount) * 3);
+		for (size_t key = 0; key < keyCount; ++key)
+		{
+			uint16_t* words = &keys[(track.FirstKey + key) * 3];
+			XMVECTOR sample = XMLoadFloat4(&samples[key * stride]);
+			if (kind == TrackKind::Rotation)
+			{
+				EncodeRotation(sample, words);
+			}
+			else
+			{
+				EncodeVector(sample, track, words);
+			}
+		}
+
+		for (size_t frame = 0; frame < frameCount; ++frame)
+		{
+			XMVECTOR value = SampleTrack(kind, track, keys, sampleInterval, frame * sampleInterval);
+			if (MeasureError(kind, value, XMLoadFloat4(&samples[frame])) > tolerance)
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+
+	// A constant track keeps a single key
+	if (tryStride(1, 1))
+	{
+		return track;
+	}
+	for (unsigned int stride : FrameStrides)
+	{
+		size_t keyCount = (frameCount - 1 + stride - 1) / stride + 1;
+		if (tryStride(stride, keyCount) || stride == 1)
+		{
+			break;
+		}
+	}
+	return track;
+}
+
+CompressedAnimation CompressAnimation(const Animation& animation, float sampleRate, const AnimationTolerance& tolerance)
+{
+	CompressedAnimation result;
+	result.SampleInterval = animation.TicksPerSecond / sampleRate;
+
+	size_t frameCount = static_cast<size_t>(std::ceil(animation.Duration / result.SampleInterval)) + 1;
+	size_t paddedCount = (frameCount - 1 + FrameStrides[0] - 1) / FrameStrides[0] * FrameStrides[0] + 1;
+	std::vector<XMFLOAT4> samples(paddedCount);
+
+	for (const Animation::Channel& channel : animation.Channels)
+	{
+		// Bones without a channel, or with an empty track, hold their bind transform
+		if (channel.Name.empty() || channel.Positions.empty() || channel.Rotations.empty() || channel.Scales.empty())
+		{
+			result.Tracks.resize(result.Tracks.size() + 3);
+			continue;
+		}
+
+		for (TrackKind kind : { TrackKind::Position, TrackKind::Rotation, TrackKind::Scale })
+		{
+			const std::vector<float>& timestamps = kind == TrackKind::Position ? channel.PositionTimestamps : kind == TrackKind::Rotation ? channel.RotationTimestamps : channel.ScaleTimestamps;
+			auto sampleSource = [&](float time)
+			{
+				switch (kind)
+				{
+				case TrackKind::Position: return SampleSource(timestamps, channel.Positions, time);
+				case TrackKind::Rotation: return SampleSource(timestamps, channel.Rotations, time);
+				default: return SampleSource(timestamps, channel.Scales, time);
+				}
+			};
+
+			for (size_t frame = 0; frame < paddedCount; ++frame)
+			{
+				XMStoreFloat4(&samples[frame], sampleSource(frame * result.SampleInterval));
+			}
+
+			float trackTolerance = kind == TrackKind::Position ? tolerance.Position : kind == TrackKind::Rotation ? tolerance.Rotation : tolerance.Scale;
+			const CompressedTrack& track = result.Tracks.emplace_back(CompressTrack(kind, samples, frameCount, result.SampleInterval, trackTolerance, result.Keys));
+
+			// Measured at the source keys, which the resampling may fall between
+			float& maxError = kind == TrackKind::Position ? result.MaxPositionError : kind == TrackKind::Rotation ? result.MaxRotationError : result.MaxScaleError;
+			for (float time : timestamps)
+			{
+				XMVECTOR value = SampleTrack(kind, track, result.Keys, result.SampleInterval, time);
+				maxError = std::max(maxError, MeasureError(kind, value, sampleSource(time)));
+			}
+		}
+	}
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+struct Animation;
+
+// Written in place of the bone count at the start of the compressed files, "YAC2" in ASCII
+constexpr size_t CompressedAnimationTag = 0x32434159;
+
+// Track of a compressed animation, written as is.
+// The keys are spaced evenly by the stride in frames of the sample interval, so the key at a time is found by a division.
+// Every key takes three 16-bit words: positions and scales are quantized over the range of the track, and rotations keep their smallest three components.
+struct CompressedTrack
+{
+	unsigned int FirstKey = 0;
+	unsigned int KeyCount = 0;
+	unsigned int FrameStride = 1;
+	DirectX::XMFLOAT3 RangeMin = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 RangeExtent = { 0.0f, 0.0f, 0.0f };
+};
+
+struct CompressedAnimation
+{
+	// In ticks
+	float SampleInterval = 1.0f;
+	// Position, rotation and scale tracks of every bone. Bones without a channel have no keys.
+	std::vector<CompressedTrack> Tracks;
+	std::vector<uint16_t> Keys;
+
+	// Largest differences to the source keys, the rotation one in radians
+	float MaxPositionError = 0.0f;
+	float MaxRotationError = 0.0f;
+	float MaxScaleError = 0.0f;
+};
+
+// Largest differences to the resampled animation each track may be reduced to
+struct AnimationTolerance
+{
+	float Position = 1e-3f;
+	float Rotation = 5e-4f;
+	float Scale = 1e-3f;
+};
+
+// Resamples the channels at the rate in samples per second, and keeps the fewest keys which reconstruct every sample within the tolerance
+CompressedAnimation CompressAnimation(const Animation& animation, float sampleRate, const AnimationTolerance& tolerance);
\ No newline at end of file
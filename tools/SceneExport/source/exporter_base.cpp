@@ -1,5 +1,123 @@
 #include "exporter_base.h"
 
+#include <algorithm>
+#include <iostream>
+
+#include "mesh_simplifier.h"
+
+using namespace DirectX;
+
+// Triangle counts of the levels of detail, relative to the base level
+static constexpr float LodTriangleRatios[] = { 0.5f, 0.25f, 0.125f };
+// A level is only kept if it has at most this fraction of the triangles of the previous one
+static constexpr float LodMinReduction = 0.8f;
+// Largest projected error of a level when it is drawn, as a fraction of the screen height, about one pixel at 1080p
+static constexpr float LodScreenError = 1.0f / 1080.0f;
+
 ExporterBase::ExporterBase()
 {
 }
+
+std::vector<float> ExporterBase::BuildLods(std::span<const XMFLOAT3> positions, std::vector<Submesh>& submeshes, std::vector<unsigned int>& indices)
+{
+	std::vector<float> lodScreenSizes;
+	if (positions.empty())
+	{
+		return lodScreenSizes;
+	}
+
+	// The engine projects the bounding sphere of the box, whose diameter is its diagonal
+	XMFLOAT3 boundsMin = positions[0];
+	XMFLOAT3 boundsMax = positions[0];
+	for (const XMFLOAT3& position : positions)
+	{
+		boundsMin = XMFLOAT3(std::min(boundsMin.x, position.x), std::min(boundsMin.y, position.y), std::min(boundsMin.z, position.z));
+		boundsMax = XMFLOAT3(std::max(boundsMax.x, position.x), std::max(boundsMax.y, position.y), std::max(boundsMax.z, position.z));
+	}
+	float diameter = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&boundsMax), XMLoadFloat3(&boundsMin))));
+
+	// The vertices of a submesh run up to the base vertex of the next one
+	std::vector<size_t> vertexCounts(submeshes.size());
+	for (size_t index = 0; index < submeshes.size(); ++index)
+	{
+		size_t vertexEnd = positions.size();
+		for (const Submesh& other : submeshes)
+		{
+			if (other.BaseVertexLocation > submeshes[index].BaseVertexLocation)
+			{
+				vertexEnd = std::min<size_t>(vertexEnd, other.BaseVertexLocation);
+			}
+		}
+		vertexCounts[index] = vertexEnd - submeshes[index].BaseVertexLocation;
+	}
+
+	// Each level is simplified from the previous one, so the errors add up
+	std::vector<float> submeshErrors(submeshes.size(), 0.0f);
+	for (float ratio : LodTriangleRatios)
+	{
+		std::vector<std::vector<unsigned int>> levelIndices(submeshes.size());
+		std::vector<float> levelErrors(submeshes.size());
+		size_t previousIndexCount = 0;
+		size_t levelIndexCount = 0;
+		float levelError = 0.0f;
+
+		for (size_t index = 0; index < submeshes.size(); ++index)
+		{
+			const Submesh& submesh = submeshes[index];
+			SubmeshLod previous = submesh.Lods.empty() ? SubmeshLod{ submesh.IndexCount, submesh.StartIndexLocation } : submesh.Lods.back();
+			size_t targetIndexCount = static_cast<size_t>(submesh.IndexCount * ratio) / 3 * 3;
+
+			float error = 0.0f;
+			levelIndices[index] = SimplifyMesh(
+				positions.subspan(submesh.BaseVertexLocation, vertexCounts[index]),
+				std::span<const unsigned int>(indices).subspan(previous.StartIndexLocation, previous.IndexCount),
+				targetIndexCount, error);
+			levelErrors[index] = submeshErrors[index] + error;
+
+			previousIndexCount += previous.IndexCount;
+			levelIndexCount += levelIndices[index].size();
+			levelError = std::max(levelError, levelErrors[index]);
+		}
+
+		if (levelIndexCount == 0 || levelIndexCount > previousIndexCount * LodMinReduction)
+		{
+			break;
+		}
+
+		for (size_t index = 0; index < submeshes.size(); ++index)
+		{
+			submeshes[index].Lods.push_back({ static_cast<unsigned int>(levelIndices[index].size()), static_cast<unsigned int>(indices.size()) });
+			indices.insert(indices.end(), levelIndices[index].begin(), levelIndices[index].end());
+		}
+		submeshErrors = levelErrors;
+
+		float screenSize = levelError > 0.0f ? std::min(LodScreenError * diameter / levelError, 1.0f) : 1.0f;
+		if (!lodScreenSizes.empty())
+		{
+			screenSize = std::min(screenSize, lodScreenSizes.back());
+		}
+		lodScreenSizes.push_back(screenSize);
+
+		std::cout << "[LOG]\tLOD " << lodScreenSizes.size() << " generated with " << levelIndexCount / 3 << " triangles, drawn below screen size " << screenSize << std::endl;
+	}
+
+	return lodScreenSizes;
+}
+
+void ExporterBase::WriteLods(std::ofstream& file, const std::vector<float>& lodScreenSizes, const std::vector<Submesh>& submeshes)
+{
+	size_t lodCount = lodScreenSizes.size();
+	file.write(reinterpret_cast<const char*>(&lodCount), sizeof(size_t));
+	for (float screenSize : lodScreenSizes)
+	{
+		file.write(reinterpret_cast<const char*>(&screenSize), sizeof(float));
+	}
+	for (const auto& submesh : submeshes)
+	{
+		for (const auto& lod : submesh.Lods)
+		{
+			file.write(reinterpret_cast<const char*>(&lod.IndexCount), sizeof(unsigned int));
+			file.write(reinterpret_cast<const char*>(&lod.StartIndexLocation), sizeof(unsigned int));
+		}
+	}
+}
\ No newline at end of file
@@ -2,10 +2,18 @@
 
 #include <assimp/scene.h>
 #include <filesystem>
+#include <fstream>
+#include <span>
 #include <string>
 #include <vector>
 #include <DirectXMath.h>
 
+struct SubmeshLod
+{
+	unsigned int IndexCount = 0;
+	unsigned int StartIndexLocation = 0;
+};
+
 struct Submesh
 {
 	// For Regular Mesh
@@ -13,6 +21,8 @@ struct Submesh
 	unsigned int IndexCount = 0;
 	unsigned int StartIndexLocation = 0;
 	unsigned int BaseVertexLocation = 0;
+	// Index ranges of the coarser levels of detail, over the same vertices
+	std::vector<SubmeshLod> Lods;
 
 	// For Rigged Mesh
 	unsigned int NodeID = 0;
@@ -37,4 +47,11 @@ public:
 
 public:
 	virtual void Export(const aiScene& scene, const std::filesystem::path& outputPath) = 0;
+
+protected:
+	// Simplifies every submesh into the levels of detail after the base one, and appends their indices to the index buffer.
+	// Returns the projected size, as a fraction of the screen height, below which each level is drawn.
+	static std::vector<float> BuildLods(std::span<const DirectX::XMFLOAT3> positions, std::vector<Submesh>& submeshes, std::vector<unsigned int>& indices);
+	// Written after the indices, where the readers of the files without levels of detail stop
+	static void WriteLods(std::ofstream& file, const std::vector<float>& lodScreenSizes, const std::vector<Submesh>& submeshes);
 };
\ No newline at end of file
@@ -0,0 +1,331 @@
+#include "mesh_simplifier.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+using namespace DirectX;
+
+// Symmetric 4x4 matrix of the summed squared distances to a set of planes, weighted by the areas of their triangles
+struct Quadric
+{
+	double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+	double b2 = 0.0, bc = 0.0, bd = 0.0;
+	double c2 = 0.0, cd = 0.0;
+	double d2 = 0.0;
+	double weight = 0.0;
+
+	void AddPlane(double a, double b, double c, double d, double w)
+	{
+		a2 += a * a * w; ab += a * b * w; ac += a * c * w; ad += a * d * w;
+		b2 += b * b * w; bc += b * c * w; bd += b * d * w;
+		c2 += c * c * w; cd += c * d * w;
+		d2 += d * d * w;
+		weight += w;
+	}
+
+	void Add(const Quadric& other)
+	{
+		a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+		b2 += other.b2; bc += other.bc; bd += other.bd;
+		c2 += other.c2; cd += other.cd;
+		d2 += other.d2;
+		weight += other.weight;
+	}
+
+	// Mean squared distance of the point to the planes
+	double Evaluate(const XMFLOAT3& p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double sum =
+			a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x +
+			b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y +
+			c2 * z * z + 2.0 * cd * z +
+			d2;
+		return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+	}
+};
+
+struct Collapse
+{
+	double Cost;
+	unsigned int From;
+	unsigned int To;
+	unsigned int Version;
+
+	bool operator>(const Collapse& other) const { return Cost > other.Cost; }
+};
+
+static XMVECTOR TriangleNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+{
+	XMVECTOR v0 = XMLoadFloat3(&p0);
+	return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&p1), v0), XMVectorSubtract(XMLoadFloat3(&p2), v0));
+}
+
+static unsigned long long EdgeKey(unsigned int a, unsigned int b)
+{
+	return a < b ? (static_cast<unsigned long long>(a) << 32 | b) : (static_cast<unsigned long long>(b) << 32 | a);
+}
+
+std::vector<unsigned int> SimplifyMesh(std::span<const XMFLOAT3> positions, std::span<const unsigned int> indices, size_t targetIndexCount, float& error)
+{
+	const size_t vertexCount = positions.size();
+	error = 0.0f;
+
+	// Vertices sharing a position are split by their attributes, the topology is built over the first vertex of each position
+	std::vector<unsigned int> welded(vertexCount);
+	std::vector<bool> locked(vertexCount, false);
+	{
+		struct PositionHash
+		{
+			size_t operator()(const XMFLOAT3& p) const
+			{
+				auto bits = [](float value) { return static_cast<size_t>(std::bit_cast<unsigned int>(value)); };
+				return bits(p.x) * 73856093u ^ bits(p.y) * 19349663u ^ bits(p.z) * 83492791u;
+			}
+		};
+		struct PositionEqual
+		{
+			bool operator()(const XMFLOAT3& lhs, const XMFLOAT3& rhs) const { return lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z; }
+		};
+
+		std::unordered_map<XMFLOAT3, unsigned int, PositionHash, PositionEqual> firstVertices;
+		for (unsigned int vertex = 0; vertex < vertexCount; ++vertex)
+		{
+			auto [iter, inserted] = firstVertices.try_emplace(positions[vertex], vertex);
+			welded[vertex] = iter->second;
+			if (!inserted)
+			{
+				locked[vertex] = true;
+				locked[iter->second] = true;
+			}
+		}
+	}
+
+	std::vector<unsigned int> triangles;
+	triangles.reserve(indices.size());
+	for (size_t index = 0; index + 2 < indices.size(); index += 3)
+	{
+		unsigned int i0 = indices[index], i1 = indices[index + 1], i2 = indices[index + 2];
+		if (welded[i0] != welded[i1] && welded[i1] != welded[i2] && welded[i2] != welded[i0])
+		{
+			triangles.insert(triangles.end(), { i0, i1, i2 });
+		}
+	}
+	const size_t triangleCount = triangles.size() / 3;
+
+	// Edges of a single triangle are open borders, and the ones of more than two are non-manifold
+	{
+		std::unordered_map<unsigned long long, unsigned int> edgeUses;
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				++edgeUses[EdgeKey(welded[triangles[t * 3 + corner]], welded[triangles[t * 3 + (corner + 1) % 3]])];
+			}
+		}
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int a = triangles[t * 3 + corner];
+				unsigned int b = triangles[t * 3 + (corner + 1) % 3];
+				if (edgeUses[EdgeKey(welded[a], welded[b])] != 2)
+				{
+					locked[a] = true;
+					locked[b] = true;
+				}
+			}
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertexCount);
+	std::vector<std::vector<unsigned int>> vertexTriangles(vertexCount);
+	for (unsigned int t = 0; t < triangleCount; ++t)
+	{
+		const XMFLOAT3& p0 = positions[triangles[t * 3]];
+		XMVECTOR normal = TriangleNormal(p0, positions[triangles[t * 3 + 1]], positions[triangles[t * 3 + 2]]);
+		float area = XMVectorGetX(XMVector3Length(normal)) * 0.5f;
+		if (area > 0.0f)
+		{
+			XMFLOAT3 n;
+			XMStoreFloat3(&n, XMVector3Normalize(normal));
+			double d = -(static_cast<double>(n.x) * p0.x + static_cast<double>(n.y) * p0.y + static_cast<double>(n.z) * p0.z);
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				quadrics[triangles[t * 3 + corner]].AddPlane(n.x, n.y, n.z, d, area);
+			}
+		}
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			vertexTriangles[triangles[t * 3 + corner]].push_back(t);
+		}
+	}
+
+	std::vector<bool> liveTriangles(triangleCount, true);
+	std::vector<bool> removed(vertexCount, false);
+	std::vector<unsigned int> versions(vertexCount, 0);
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+
+	auto pushCollapse = [&](unsigned int from, unsigned int to) {
+		if (!locked[from])
+		{
+			queue.push({ quadrics[from].Evaluate(positions[to]), from, to, versions[from] });
+		}
+	};
+	auto liveTrianglesOf = [&](unsigned int vertex) -> std::vector<unsigned int>& {
+		std::vector<unsigned int>& list = vertexTriangles[vertex];
+		list.erase(std::remove_if(list.begin(), list.end(), [&](unsigned int t) { return !liveTriangles[t]; }), list.end());
+		return list;
+	};
+	auto contains = [&](unsigned int t, unsigned int vertex) {
+		return triangles[t * 3] == vertex || triangles[t * 3 + 1] == vertex || triangles[t * 3 + 2] == vertex;
+	};
+
+	for (unsigned int t = 0; t < triangleCount; ++t)
+	{
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			pushCollapse(triangles[t * 3 + corner], triangles[t * 3 + (corner + 1) % 3]);
+			pushCollapse(triangles[t * 3 + (corner + 1) % 3], triangles[t * 3 + corner]);
+		}
+	}
+
+	size_t liveCount = triangleCount;
+	std::vector<unsigned int> neighboursFrom;
+	std::vector<unsigned int> neighboursTo;
+	while (liveCount * 3 > targetIndexCount && !queue.empty())
+	{
+		Collapse collapse = queue.top();
+		queue.pop();
+
+		const unsigned int u = collapse.From;
+		const unsigned int v = collapse.To;
+		if (removed[u] || removed[v] || collapse.Version != versions[u])
+		{
+			continue;
+		}
+
+		std::vector<unsigned int>& trianglesFrom = liveTrianglesOf(u);
+		std::vector<unsigned int>& trianglesTo = liveTrianglesOf(v);
+
+		// The edge may be gone since the collapse was queued
+		size_t sharedTriangles = std::count_if(trianglesFrom.begin(), trianglesFrom.end(), [&](unsigned int t) { return contains(t, v); });
+		if (sharedTriangles == 0)
+		{
+			continue;
+		}
+
+		// Link condition, the only vertices adjacent to both ends are the opposite corners of the shared triangles
+		auto gatherNeighbours = [&](const std::vector<unsigned int>& list, unsigned int self, std::vector<unsigned int>& neighbours) {
+			neighbours.clear();
+			for (unsigned int t : list)
+			{
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					unsigned int other = welded[triangles[t * 3 + corner]];
+					if (other != welded[self])
+					{
+						neighbours.push_back(other);
+					}
+				}
+			}
+			std::sort(neighbours.begin(), neighbours.end());
+			neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+		};
+		gatherNeighbours(trianglesFrom, u, neighboursFrom);
+		gatherNeighbours(trianglesTo, v, neighboursTo);
+		size_t commonNeighbours = 0;
+		for (unsigned int neighbour : neighboursFrom)
+		{
+			commonNeighbours += std::binary_search(neighboursTo.begin(), neighboursTo.end(), neighbour) ? 1 : 0;
+		}
+		if (commonNeighbours != sharedTriangles)
+		{
+			continue;
+		}
+
+		// Moving the vertex must not fold any remaining triangle over
+		bool flips = false;
+		for (unsigned int t : trianglesFrom)
+		{
+			if (contains(t, v))
+			{
+				continue;
+			}
+			XMFLOAT3 corners[3];
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				corners[corner] = positions[triangles[t * 3 + corner]];
+			}
+			XMVECTOR before = TriangleNormal(corners[0], corners[1], corners[2]);
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				if (triangles[t * 3 + corner] == u)
+				{
+					corners[corner] = positions[v];
+				}
+			}
+			XMVECTOR after = TriangleNormal(corners[0], corners[1], corners[2]);
+			if (XMVectorGetX(XMVector3Dot(before, after)) <= 0.0f)
+			{
+				flips = true;
+				break;
+			}
+		}
+		if (flips)
+		{
+			continue;
+		}
+
+		for (unsigned int t : trianglesFrom)
+		{
+			if (contains(t, v))
+			{
+				liveTriangles[t] = false;
+				--liveCount;
+				continue;
+			}
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				if (triangles[t * 3 + corner] == u)
+				{
+					triangles[t * 3 + corner] = v;
+				}
+			}
+			vertexTriangles[v].push_back(t);
+		}
+		trianglesFrom.clear();
+		removed[u] = true;
+
+		quadrics[v].Add(quadrics[u]);
+		++versions[v];
+		error = std::max(error, static_cast<float>(std::sqrt(collapse.Cost)));
+
+		for (unsigned int t : liveTrianglesOf(v))
+		{
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int other = triangles[t * 3 + corner];
+				if (other != v)
+				{
+					pushCollapse(v, other);
+					pushCollapse(other, v);
+				}
+			}
+		}
+	}
+
+	std::vector<unsigned int> result;
+	result.reserve(liveCount * 3);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		if (liveTriangles[t])
+		{
+			result.insert(result.end(), { triangles[t * 3], triangles[t * 3 + 1], triangles[t * 3 + 2] });
+		}
+	}
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <DirectXMath.h>
+
+// Quadric error edge collapse over an indexed triangle list.
+// A vertex is only ever collapsed onto one of its neighbours, so the result indexes the same vertex buffer as the source.
+// Vertices on open borders, on non-manifold edges, and on attribute seams where several vertices share a position are kept in place.
+// Returns the triangles left once the index count reaches the target or no collapse is possible.
+// The error is the largest distance to the source surface estimated by the quadrics of the collapsed vertices.
+std::vector<unsigned int> SimplifyMesh(std::span<const DirectX::XMFLOAT3> positions, std::span<const unsigned int> indices, size_t targetIndexCount, float& error);
\ No newline at end of file
@@ -172,6 +172,15 @@ void RiggedMeshExporter::Export(const aiScene& scene, const std::filesystem::pat
 		std::cout << "[LOG]\tSubmesh \'" << submesh.Name.c_str() << "\' generated" << std::endl;
 	}
 
+	// Coarser index ranges are appended to the indices, over the same vertices
+	std::vector<XMFLOAT3> positions;
+	positions.reserve(vertices.size());
+	for (const auto& vertex : vertices)
+	{
+		positions.push_back(vertex.position);
+	}
+	std::vector<float> lodScreenSizes = BuildLods(positions, m_submeshes, indices);
+
 	// Write the number of bones
 	size_t boneCount = m_bones.size();
 	file.write(reinterpret_cast<const char*>(&boneCount), sizeof(size_t));
@@ -237,4 +246,7 @@ void RiggedMeshExporter::Export(const aiScene& scene, const std::filesystem::pat
 	{
 		file.write(reinterpret_cast<const char*>(&index), sizeof(unsigned int));
 	}
+
+	// Write the levels of detail
+	WriteLods(file, lodScreenSizes, m_submeshes);
 }
\ No newline at end of file
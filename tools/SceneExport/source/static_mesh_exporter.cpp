@@ -159,6 +159,15 @@ void StaticMeshExporter::Export(const aiScene& scene, const std::filesystem::pat
 		}
 	}
 
+	// Coarser index ranges are appended to the indices, over the same vertices
+	std::vector<XMFLOAT3> positions;
+	positions.reserve(vertices.size());
+	for (const auto& vertex : vertices)
+	{
+		positions.push_back(vertex.position);
+	}
+	std::vector<float> lodScreenSizes = BuildLods(positions, m_submeshes, indices);
+
 	// Write submeshes
 	size_t submeshCount = m_submeshes.size();
 	file.write(reinterpret_cast<const char*>(&submeshCount), sizeof(size_t));
@@ -197,4 +206,7 @@ void StaticMeshExporter::Export(const aiScene& scene, const std::filesystem::pat
 	{
 		file.write(reinterpret_cast<const char*>(&index), sizeof(unsigned int));
 	}
+
+	// Write the levels of detail
+	WriteLods(file, lodScreenSizes, m_submeshes);
 }
\ No newline at end of file